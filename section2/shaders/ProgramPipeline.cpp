@@ -0,0 +1,144 @@
+#include "ProgramPipeline.h"
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ShaderPreprocessor.h"
+
+namespace gl
+{
+
+constexpr size_t kLinkLogBufferSize = 512;
+
+StageCache::~StageCache()
+{
+    for(const auto& program : m_programs)
+        glDeleteProgram(program.second);
+}
+
+GLuint StageCache::get(GLenum stage, const char* filePath)
+{
+    // The preprocessor has already logged why if this is empty.
+    std::shared_ptr<const std::string> source = shaderPreprocessor().expand(filePath);
+    if(source->empty())
+        return 0;
+
+    const std::pair<GLenum, size_t> key(stage, std::hash<std::string>()(*source));
+    auto cached = m_programs.find(key);
+    if(cached != m_programs.end())
+        return cached->second;
+
+    // Compiles, links and deletes the shader object in one call.
+    const char* sourceCStr = source->c_str();
+    GLuint program = glCreateShaderProgramv(stage, 1, &sourceCStr);
+
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(!success)
+    {
+        char infoLog[kLinkLogBufferSize];
+        memset(infoLog, 0, kLinkLogBufferSize);
+        glGetProgramInfoLog(program, kLinkLogBufferSize, NULL, infoLog);
+        std::cerr << "ERROR::STAGE_CACHE::PROGRAM::LINKING_FAILED: " << filePath << "\n" << infoLog << std::endl;
+
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    m_programs.emplace(key, program);
+    return program;
+}
+
+ProgramPipeline::ProgramPipeline(GLuint vertexProgram, GLuint fragmentProgram)
+    : m_pipeline(0)
+    , m_stages{{vertexProgram, {}}, {fragmentProgram, {}}}
+{
+    glGenProgramPipelines(1, &m_pipeline);
+    glUseProgramStages(m_pipeline, GL_VERTEX_SHADER_BIT, vertexProgram);
+    glUseProgramStages(m_pipeline, GL_FRAGMENT_SHADER_BIT, fragmentProgram);
+
+    for(Stage& stage : m_stages)
+        reflectUniforms(stage);
+
+    // Catch stages whose interfaces don't match up front rather than at the
+    // first draw.
+    glValidateProgramPipeline(m_pipeline);
+
+    int success = 0;
+    glGetProgramPipelineiv(m_pipeline, GL_VALIDATE_STATUS, &success);
+    if(!success)
+    {
+        char infoLog[kLinkLogBufferSize];
+        memset(infoLog, 0, kLinkLogBufferSize);
+        glGetProgramPipelineInfoLog(m_pipeline, kLinkLogBufferSize, NULL, infoLog);
+        std::cerr << "ERROR::PROGRAM_PIPELINE::VALIDATION_FAILED\n" << infoLog << std::endl;
+    }
+}
+
+ProgramPipeline::~ProgramPipeline()
+{
+    // The stage programs belong to the StageCache.
+    glDeleteProgramPipelines(1, &m_pipeline);
+}
+
+bool ProgramPipeline::supported()
+{
+    return GLEW_ARB_separate_shader_objects;
+}
+
+void ProgramPipeline::bind()
+{
+    glUseProgram(0);
+    glBindProgramPipeline(m_pipeline);
+}
+
+void ProgramPipeline::setBool(const std::string& name, GLboolean value)
+{
+    setInt(name, (GLint)value);
+}
+
+void ProgramPipeline::setInt(const std::string& name, GLint value)
+{
+    for(const Stage& stage : m_stages)
+    {
+        auto uniform = stage.uniforms.find(name);
+        if(uniform != stage.uniforms.end())
+            glProgramUniform1i(stage.program, uniform->second, value);
+    }
+}
+
+void ProgramPipeline::setFloat(const std::string& name, GLfloat value)
+{
+    for(const Stage& stage : m_stages)
+    {
+        auto uniform = stage.uniforms.find(name);
+        if(uniform != stage.uniforms.end())
+            glProgramUniform1f(stage.program, uniform->second, value);
+    }
+}
+
+void ProgramPipeline::reflectUniforms(Stage& stage)
+{
+    GLint numUniforms = 0, maxNameLength = 0;
+    glGetProgramiv(stage.program, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(stage.program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> name(maxNameLength + 1, 0);
+    for(GLint i = 0; i < numUniforms; ++i)
+    {
+        GLsizei nameLength = 0;
+        GLint size = 0;
+        GLenum type = GL_NONE;
+        glGetActiveUniform(stage.program, i, (GLsizei)name.size(), &nameLength, &size, &type, name.data());
+
+        // Members of uniform blocks don't have a location.
+        GLint location = glGetUniformLocation(stage.program, name.data());
+        if(location >= 0)
+            stage.uniforms.emplace(std::string(name.data(), nameLength), location);
+    }
+}
+
+}   // namespace gl
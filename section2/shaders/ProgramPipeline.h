@@ -0,0 +1,91 @@
+#ifndef PROGRAM_PIPELINE_H
+#define PROGRAM_PIPELINE_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <GL/glew.h>
+
+namespace gl
+{
+
+// Separable single stage programs, built with glCreateShaderProgramv. Each
+// distinct source is compiled once per stage however many pipelines use it.
+class StageCache
+{
+public:
+    StageCache() = default;
+
+    // Disable assignment and copy constructors
+    StageCache(const StageCache& rhs) = delete;
+    StageCache& operator=(const StageCache& rhs) = delete;
+
+    ~StageCache();
+
+    // Program for stage (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER...) built from
+    // the file at filePath, expanded by the ShaderPreprocessor, or 0 if it
+    // couldn't be read, compiled or linked.
+    GLuint get(GLenum stage, const char* filePath);
+
+    size_t size() const { return m_programs.size(); }
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const std::pair<GLenum, size_t>& key) const
+        {
+            return key.second ^ (std::hash<GLenum>()(key.first) << 1);
+        }
+    };
+
+    // Keyed by stage and a hash of the source.
+    std::unordered_map<std::pair<GLenum, size_t>, GLuint, KeyHash> m_programs;
+};
+
+// Combines separable stage programs at bind time rather than linking them
+// into one program, so N vertex and M fragment stages need N + M programs
+// rather than N x M.
+//
+// Needs ARB_separate_shader_objects, see supported().
+class ProgramPipeline
+{
+public:
+    ProgramPipeline(GLuint vertexProgram, GLuint fragmentProgram);
+
+    // Disable assignment and copy constructors
+    ProgramPipeline(const ProgramPipeline& rhs) = delete;
+    ProgramPipeline& operator=(const ProgramPipeline& rhs) = delete;
+
+    ~ProgramPipeline();
+
+    static bool supported();
+
+    // Bind the pipeline for drawing. Any program set with glUseProgram
+    // overrides the pipeline, so that is cleared.
+    void bind();
+
+    // Set uniforms on whichever stages declare them.
+    void setBool(const std::string& name, GLboolean value);
+    void setInt(const std::string& name, GLint value);
+    void setFloat(const std::string& name, GLfloat value);
+
+private:
+    // A stage program and the locations of its active uniforms by name,
+    // looked up once rather than on every set.
+    struct Stage
+    {
+        GLuint program;
+        std::unordered_map<std::string, GLint> uniforms;
+    };
+
+    static void reflectUniforms(Stage& stage);
+
+    GLuint m_pipeline;
+    Stage m_stages[2];
+};
+
+}   // namespace gl
+
+#endif
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cmath>
+#include <memory>
 
 // OpenGL Extension Manager
 #define GLEW_STATIC
@@ -8,6 +9,7 @@
 // GLFW
 #include <GLFW/glfw3.h>
 
+#include "ProgramPipeline.h"
 #include "Shader.h"
 
 const GLint WIDTH = 800;
@@ -50,9 +52,38 @@ int main(int argc, const char** argv)
     // Setup OpenGL viewport
     glViewport(0, 0, screenWidth, screenHeight);
 
-    // Setup the shaders
-    gl::Shader multiColorShader("SimpleVShader.glsl", "MultiColourFragShader.glsl");
-    gl::Shader yellowShader("SimpleVShader.glsl", "YellowTriangleFragShader.glsl");
+    // Setup the shaders. Both draw with the same vertex stage, so where
+    // separable programs are supported it's compiled once and combined with
+    // each fragment stage at bind time rather than linked into two programs.
+    bool separable = gl::ProgramPipeline::supported();
+    gl::StageCache stageCache;
+    std::unique_ptr<gl::ProgramPipeline> multiColorPipeline, yellowPipeline;
+    std::unique_ptr<gl::Shader> multiColorShader, yellowShader;
+    if(separable)
+    {
+        GLuint vertexProgram = stageCache.get(GL_VERTEX_SHADER, "SimpleVShader.glsl");
+        GLuint multiColorProgram = stageCache.get(GL_FRAGMENT_SHADER, "MultiColourFragShader.glsl");
+        GLuint yellowProgram = stageCache.get(GL_FRAGMENT_SHADER, "YellowTriangleFragShader.glsl");
+
+        // The stage cache has logged what failed. Linked programs report
+        // their own errors and draw whatever does build.
+        separable = vertexProgram && multiColorProgram && yellowProgram;
+        if(separable)
+        {
+            multiColorPipeline.reset(new gl::ProgramPipeline(vertexProgram, multiColorProgram));
+            yellowPipeline.reset(new gl::ProgramPipeline(vertexProgram, yellowProgram));
+        }
+        else
+        {
+            std::cerr << "Failed to build separable programs, falling back to linked programs." << std::endl;
+        }
+    }
+
+    if(!separable)
+    {
+        multiColorShader.reset(new gl::Shader("SimpleVShader.glsl", "MultiColourFragShader.glsl"));
+        yellowShader.reset(new gl::Shader("SimpleVShader.glsl", "YellowTriangleFragShader.glsl"));
+    }
 
     GLfloat verticies[] = {
         // positions        // colours
@@ -118,14 +149,20 @@ int main(int argc, const char** argv)
                 // Setup our uniforms
                 float timeValue = glfwGetTime();
                 float greenValue = (sin(timeValue) / 2.0f) + 0.5f;
-                multiColorShader.use();
+                if(separable)
+                    multiColorPipeline->bind();
+                else
+                    multiColorShader->use();
 
                 // Push a value to the shader uniform
                 //glUniform4f(colorUniform, 0.0f, greenValue, 0.0f, 1.0f);
             }
             else
             {
-                yellowShader.use();
+                if(separable)
+                    yellowPipeline->bind();
+                else
+                    yellowShader->use();
             }
 
             glBindVertexArray(trianglesVAOs[triangle]);
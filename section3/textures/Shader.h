@@ -31,9 +31,6 @@ public:
     void setFloat(const std::string& name, GLfloat value);
 
 private:
-    // Read the contents of the file specified by filePath and return it.
-    const std::string&& readFile(const char* filePath);
-
     GLint m_shaderProgram;
 };
 
@@ -0,0 +1,256 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include "StringHash.h"
+
+namespace gl
+{
+
+bool readTextFile(const std::string& path, std::string& contents)
+{
+    std::ifstream input(path, std::ios_base::in | std::ios_base::binary);
+    if(!input)
+        return false;
+
+    // Size the string up front and read straight into it.
+    input.seekg(0, std::ios_base::end);
+    std::streamoff size = input.tellg();
+    input.seekg(0, std::ios_base::beg);
+    if(size < 0)
+        return false;
+
+    contents.resize((size_t)size);
+    return (bool)input.read(&contents[0], size);
+}
+
+// If line is `#include "name"` return true and set name.
+static bool parseInclude(std::string_view line, std::string_view& name)
+{
+    auto skipSpace = [&line]()
+    {
+        while(!line.empty() && (line.front() == ' ' || line.front() == '\t'))
+            line.remove_prefix(1);
+    };
+
+    skipSpace();
+    if(line.empty() || line.front() != '#')
+        return false;
+
+    line.remove_prefix(1);
+    skipSpace();
+    if(line.substr(0, 7) != "include")
+        return false;
+
+    line.remove_prefix(7);
+    skipSpace();
+    if(line.empty() || line.front() != '"')
+        return false;
+
+    size_t end = line.find('"', 1);
+    if(end == std::string_view::npos)
+        return false;
+
+    name = line.substr(1, end - 1);
+    return true;
+}
+
+static bool isVersionLine(std::string_view line)
+{
+    size_t start = line.find_first_not_of(" \t");
+    return start != std::string_view::npos && line.substr(start, 8) == "#version";
+}
+
+std::shared_ptr<const std::string> ShaderPreprocessor::expand(const std::string& path, const ShaderDefines& defines)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<std::string> includeStack;
+    const Expansion* expansion = expandFile(path, includeStack);
+    if(!expansion)
+        return std::make_shared<const std::string>();
+
+    std::string defineBlock;
+    for(const auto& define : defines)
+        defineBlock += "#define " + define.first + " " + define.second + "\n";
+
+    const uint64_t key = hashString(defineBlock, m_expansionKeys[path]);
+    auto program = m_programs.find(key);
+    if(program != m_programs.end())
+        return program->second;
+
+    // Defines go straight after #version, which has to come first, followed
+    // by a #line for the file itself. Without one, its lines before the first
+    // include would be counted from the define block as source string 0.
+    const std::string& text = *expansion->text;
+    size_t insertAt = 0;
+    int nextLine = 1;
+    for(size_t lineStart = 0; lineStart < text.size(); ++nextLine)
+    {
+        size_t lineEnd = text.find('\n', lineStart);
+        lineEnd = lineEnd == std::string::npos ? text.size() : lineEnd + 1;
+        if(isVersionLine(std::string_view(text).substr(lineStart, lineEnd - lineStart)))
+        {
+            insertAt = lineEnd;
+            ++nextLine;
+            break;
+        }
+
+        lineStart = lineEnd;
+    }
+
+    if(insertAt == 0)
+        nextLine = 1;
+
+    std::shared_ptr<std::string> result = std::make_shared<std::string>();
+    result->reserve(text.size() + defineBlock.size() + 32);
+    result->append(text, 0, insertAt);
+    result->append(defineBlock);
+    result->append("#line " + std::to_string(nextLine) + " " + std::to_string(m_files[path].index) + "\n");
+    result->append(text, insertAt, std::string::npos);
+
+    m_programs.emplace(key, result);
+    return result;
+}
+
+std::vector<std::string> ShaderPreprocessor::dependencies(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<std::string> includeStack;
+    if(!expandFile(path, includeStack))
+        return {path};
+
+    std::vector<std::string> files = {path};
+    for(size_t i = 0; i < files.size(); ++i)
+    {
+        const Expansion& expansion = m_expansions[m_expansionKeys[files[i]]];
+        for(const std::string& include : expansion.includes)
+        {
+            if(std::find(files.begin(), files.end(), include) == files.end())
+                files.push_back(include);
+        }
+    }
+
+    return files;
+}
+
+void ShaderPreprocessor::invalidate(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Anything could include the file, so drop every expansion. This only
+    // happens on hot reload.
+    m_files.erase(path);
+    m_expansions.clear();
+    m_expansionKeys.clear();
+    m_programs.clear();
+}
+
+std::string ShaderPreprocessor::fileName(int index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return index >= 0 && index < (int)m_fileNames.size() ? m_fileNames[index] : std::string();
+}
+
+const ShaderPreprocessor::File* ShaderPreprocessor::loadFile(const std::string& path)
+{
+    auto cached = m_files.find(path);
+    if(cached != m_files.end())
+        return &cached->second;
+
+    std::shared_ptr<std::string> contents = std::make_shared<std::string>();
+    if(!readTextFile(path, *contents))
+    {
+        std::cerr << "ERROR::SHADER_PREPROCESSOR::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return nullptr;
+    }
+
+    // Files keep their index across reloads so #line numbers stay stable.
+    auto name = std::find(m_fileNames.begin(), m_fileNames.end(), path);
+    int index = (int)(name - m_fileNames.begin());
+    if(name == m_fileNames.end())
+        m_fileNames.push_back(path);
+
+    File file = {hashString(*contents), index, std::move(contents)};
+    return &m_files.emplace(path, std::move(file)).first->second;
+}
+
+const ShaderPreprocessor::Expansion* ShaderPreprocessor::expandFile(const std::string& path, std::vector<std::string>& includeStack)
+{
+    const File* file = loadFile(path);
+    if(!file)
+        return nullptr;
+
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    const uint64_t key = hashString(directory.string(), file->hash);
+    m_expansionKeys[path] = key;
+
+    auto cached = m_expansions.find(key);
+    if(cached != m_expansions.end())
+        return &cached->second;
+
+    if(std::find(includeStack.begin(), includeStack.end(), path) != includeStack.end())
+    {
+        std::cerr << "ERROR::SHADER_PREPROCESSOR::RECURSIVE_INCLUDE: " << path << std::endl;
+        return nullptr;
+    }
+
+    includeStack.push_back(path);
+
+    std::shared_ptr<std::string> text = std::make_shared<std::string>();
+    text->reserve(file->contents->size());
+    std::vector<std::string> includes;
+
+    const std::string_view contents(*file->contents);
+    int lineNumber = 0;
+    for(size_t lineStart = 0; lineStart < contents.size();)
+    {
+        size_t lineEnd = contents.find('\n', lineStart);
+        lineEnd = lineEnd == std::string_view::npos ? contents.size() : lineEnd + 1;
+        const std::string_view line = contents.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd;
+        ++lineNumber;
+
+        std::string_view includeName;
+        if(!parseInclude(line, includeName))
+        {
+            text->append(line);
+            continue;
+        }
+
+        const std::string includePath = (directory / std::string(includeName)).lexically_normal().string();
+        const Expansion* include = expandFile(includePath, includeStack);
+        if(!include)
+        {
+            std::cerr << "ERROR::SHADER_PREPROCESSOR::INCLUDE_FAILED: " << path << ":" << lineNumber << std::endl;
+            includeStack.pop_back();
+            return nullptr;
+        }
+
+        text->append("#line 1 " + std::to_string(m_files[includePath].index) + "\n");
+        text->append(*include->text);
+        if(!text->empty() && text->back() != '\n')
+            text->push_back('\n');
+        text->append("#line " + std::to_string(lineNumber + 1) + " " + std::to_string(file->index) + "\n");
+
+        includes.push_back(includePath);
+    }
+
+    includeStack.pop_back();
+
+    Expansion expansion = {std::move(text), std::move(includes)};
+    return &m_expansions.emplace(key, std::move(expansion)).first->second;
+}
+
+ShaderPreprocessor& shaderPreprocessor()
+{
+    static ShaderPreprocessor s_preprocessor;
+    return s_preprocessor;
+}
+
+}   // namespace gl
@@ -1,11 +1,12 @@
 #include "Shader.h"
 
 #include <cstring>
-#include <fstream>
 #include <iostream>
-#include <sstream>
+#include <memory>
 #include <string>
 
+#include "ShaderPreprocessor.h"
+
 namespace gl
 {
 
@@ -14,37 +15,12 @@ constexpr size_t kCompileLogBufferSize = 512;
 Shader::Shader(const char* vertexShaderFilePath, const char* fragmentShaderFilePath)
     : m_shaderProgram(-1)
 {
-    std::ifstream vertexShaderInputStream, fragmentShaderInputStream;
-
-    // Configure to throw exceptions
-    vertexShaderInputStream.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fragmentShaderInputStream.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    std::string vertexCode, fragmentCode;
-    try
-    {
-        vertexShaderInputStream.open(vertexShaderFilePath, std::ios_base::in);
-        fragmentShaderInputStream.open(fragmentShaderFilePath, std::ios_base::in);
-
-        std::stringstream vShaderSS, fShaderSS;
-        vShaderSS << vertexShaderInputStream.rdbuf();
-        fShaderSS << fragmentShaderInputStream.rdbuf();
-
-        // Close the files
-        vertexShaderInputStream.close();
-        fragmentShaderInputStream.close();
-
-        vertexCode = vShaderSS.str();
-        fragmentCode = fShaderSS.str();
-    }
-    catch(const std::ios_base::failure& exception)
-    {
-        std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << exception.what() << std::endl;
-    }
+    std::shared_ptr<const std::string> vertexCode = shaderPreprocessor().expand(vertexShaderFilePath);
+    std::shared_ptr<const std::string> fragmentCode = shaderPreprocessor().expand(fragmentShaderFilePath);
 
     // Now compile the shaders.
-    const char* vShaderSourceCStr = vertexCode.c_str();
-    const char* fShaderSourceCStr = fragmentCode.c_str();
+    const char* vShaderSourceCStr = vertexCode->c_str();
+    const char* fShaderSourceCStr = fragmentCode->c_str();
 
     int success = 0;
     char infoLog[kCompileLogBufferSize];
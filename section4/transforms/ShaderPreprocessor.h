@@ -0,0 +1,83 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gl
+{
+
+// Read a whole file into contents. Returns false if it couldn't be read.
+bool readTextFile(const std::string& path, std::string& contents);
+
+// Name/value pairs injected as #define lines after a shader's #version.
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// Expands GLSL before it's handed to the driver:
+//  - #include "file" is replaced by the file's contents, resolved relative to
+//    the including file. Headers use ordinary #ifndef guards.
+//  - Defines are injected straight after #version.
+//  - #line directives are emitted after #version and around every include
+//    so compile errors point at the right line. The source string number is
+//    the file's index, see fileName().
+//
+// Files are read once and their expansions cached by content hash, so a
+// header shared by many programs is read and expanded once per process.
+// Results are shared and immutable. Safe to use from multiple threads.
+class ShaderPreprocessor
+{
+public:
+    // Expanded source of the file at path. Empty if it, or anything it
+    // includes, couldn't be read; the error has been logged.
+    std::shared_ptr<const std::string> expand(const std::string& path, const ShaderDefines& defines = {});
+
+    // Files path depends on, itself first, as of its last expansion.
+    std::vector<std::string> dependencies(const std::string& path);
+
+    // Drop path from the cache so the next expansion reads it again.
+    void invalidate(const std::string& path);
+
+    // The file a #line source string number refers to.
+    std::string fileName(int index);
+
+private:
+    struct File
+    {
+        uint64_t hash;
+        int index;
+        std::shared_ptr<const std::string> contents;
+    };
+
+    struct Expansion
+    {
+        std::shared_ptr<const std::string> text;
+        std::vector<std::string> includes;
+    };
+
+    // These expect m_mutex to be held.
+    const File* loadFile(const std::string& path);
+    const Expansion* expandFile(const std::string& path, std::vector<std::string>& includeStack);
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, File> m_files;
+    std::vector<std::string> m_fileNames;
+
+    // Keyed by a hash of the file's contents and directory.
+    std::unordered_map<uint64_t, Expansion> m_expansions;
+    std::unordered_map<std::string, uint64_t> m_expansionKeys;
+
+    // Keyed by the root's expansion key and the defines.
+    std::unordered_map<uint64_t, std::shared_ptr<const std::string>> m_programs;
+};
+
+// The process-wide preprocessor shaders are loaded through.
+ShaderPreprocessor& shaderPreprocessor();
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef STRING_HASH_H
+#define STRING_HASH_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace gl
+{
+
+// 64-bit FNV-1a. Usable in constant expressions so names known at compile
+// time (uniforms, blocks, etc.) never need hashing at runtime.
+constexpr uint64_t hashString(std::string_view str, uint64_t seed = 14695981039346656037ull)
+{
+    uint64_t hash = seed;
+    for(char c : str)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,526 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "ThreadPool.h"
+
+namespace gl
+{
+
+constexpr int kBlockTexels = 16;
+
+// Interpolation weights, out of 64, for BC7's 4-bit indices.
+constexpr int kBC7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Power iterations used to find a block's principal axis.
+constexpr int kAxisIterations = 8;
+
+// Rows of blocks handed to each ThreadPool task.
+constexpr int kBlockRowsPerTask = 4;
+
+// Mean of a block's texels and the direction they vary most along, over the
+// first channels components.
+static void principalAxis(const float (*texels)[4], int channels, float* mean, float* axis)
+{
+    for(int c = 0; c < channels; ++c)
+    {
+        mean[c] = 0.0f;
+        for(int i = 0; i < kBlockTexels; ++i)
+            mean[c] += texels[i][c];
+        mean[c] /= kBlockTexels;
+    }
+
+    float covariance[4][4] = {};
+    for(int i = 0; i < kBlockTexels; ++i)
+    {
+        for(int a = 0; a < channels; ++a)
+        {
+            for(int b = 0; b < channels; ++b)
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+        }
+    }
+
+    for(int c = 0; c < channels; ++c)
+        axis[c] = 1.0f;
+
+    for(int iteration = 0; iteration < kAxisIterations; ++iteration)
+    {
+        float next[4] = {};
+        float length = 0.0f;
+        for(int a = 0; a < channels; ++a)
+        {
+            for(int b = 0; b < channels; ++b)
+                next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::fabs(next[a]));
+        }
+
+        // Flat blocks have no axis; any will do.
+        if(length < 1e-6f)
+            break;
+
+        for(int c = 0; c < channels; ++c)
+            axis[c] = next[c] / length;
+    }
+
+    float length = 0.0f;
+    for(int c = 0; c < channels; ++c)
+        length += axis[c] * axis[c];
+    length = std::sqrt(length);
+    for(int c = 0; c < channels; ++c)
+        axis[c] /= length;
+}
+
+// Endpoints at either end of the texels' spread along the principal axis.
+static void axisEndpoints(const float (*texels)[4], int channels, float* end0, float* end1)
+{
+    float mean[4];
+    float axis[4];
+    principalAxis(texels, channels, mean, axis);
+
+    float low = 0.0f;
+    float high = 0.0f;
+    for(int i = 0; i < kBlockTexels; ++i)
+    {
+        float t = 0.0f;
+        for(int c = 0; c < channels; ++c)
+            t += (texels[i][c] - mean[c]) * axis[c];
+        low = std::min(low, t);
+        high = std::max(high, t);
+    }
+
+    for(int c = 0; c < channels; ++c)
+    {
+        end0[c] = std::min(255.0f, std::max(0.0f, mean[c] + high * axis[c]));
+        end1[c] = std::min(255.0f, std::max(0.0f, mean[c] + low * axis[c]));
+    }
+}
+
+// Endpoints minimising the squared error of texels interpolated with weights
+// (0 gives end0, 1 gives end1). Returns false if the weights don't determine
+// them, e.g. all texels picked the same palette entry.
+static bool leastSquaresEndpoints(const float (*texels)[4], int channels, const float* weights, float* end0, float* end1)
+{
+    float a = 0.0f;
+    float b = 0.0f;
+    float c = 0.0f;
+    float x0[4] = {};
+    float x1[4] = {};
+    for(int i = 0; i < kBlockTexels; ++i)
+    {
+        const float w = weights[i];
+        a += (1.0f - w) * (1.0f - w);
+        b += (1.0f - w) * w;
+        c += w * w;
+        for(int k = 0; k < channels; ++k)
+        {
+            x0[k] += (1.0f - w) * texels[i][k];
+            x1[k] += w * texels[i][k];
+        }
+    }
+
+    const float determinant = a * c - b * b;
+    if(std::fabs(determinant) < 1e-6f)
+        return false;
+
+    for(int k = 0; k < channels; ++k)
+    {
+        end0[k] = std::min(255.0f, std::max(0.0f, (c * x0[k] - b * x1[k]) / determinant));
+        end1[k] = std::min(255.0f, std::max(0.0f, (a * x1[k] - b * x0[k]) / determinant));
+    }
+
+    return true;
+}
+
+static void loadTexels(const uint8_t* rgba, float (*texels)[4])
+{
+    for(int i = 0; i < kBlockTexels; ++i)
+    {
+        for(int c = 0; c < 4; ++c)
+            texels[i][c] = rgba[i * 4 + c];
+    }
+}
+
+static int squaredDistance(const int* a, const float* b, int channels)
+{
+    int distance = 0;
+    for(int c = 0; c < channels; ++c)
+    {
+        const int d = a[c] - (int)(b[c] + 0.5f);
+        distance += d * d;
+    }
+
+    return distance;
+}
+
+// Pick the nearest palette entry for each texel. Returns the total error.
+static int chooseIndices(const float (*texels)[4], int channels, const int (*palette)[4], int paletteSize, int* indices)
+{
+    int total = 0;
+    for(int i = 0; i < kBlockTexels; ++i)
+    {
+        int best = 0;
+        int bestDistance = squaredDistance(palette[0], texels[i], channels);
+        for(int p = 1; p < paletteSize; ++p)
+        {
+            const int distance = squaredDistance(palette[p], texels[i], channels);
+            if(distance < bestDistance)
+            {
+                best = p;
+                bestDistance = distance;
+            }
+        }
+
+        indices[i] = best;
+        total += bestDistance;
+    }
+
+    return total;
+}
+
+// BC1 / BC3 colour
+
+static uint16_t packRGB565(const float* colour)
+{
+    const int r = (int)(colour[0] * 31.0f / 255.0f + 0.5f);
+    const int g = (int)(colour[1] * 63.0f / 255.0f + 0.5f);
+    const int b = (int)(colour[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t packed, int* colour)
+{
+    const int r = (packed >> 11) & 0x1f;
+    const int g = (packed >> 5) & 0x3f;
+    const int b = packed & 0x1f;
+    colour[0] = (r << 3) | (r >> 2);
+    colour[1] = (g << 2) | (g >> 4);
+    colour[2] = (b << 3) | (b >> 2);
+}
+
+// Four-colour palette order: end0, end1, then the two thirds in between.
+constexpr float kBC1Weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+// Quantise endpoints and pick indices for them. Returns the error.
+static int fitColourBlock(const float (*texels)[4], const float* end0, const float* end1,
+                          uint16_t& colour0, uint16_t& colour1, int* indices)
+{
+    colour0 = packRGB565(end0);
+    colour1 = packRGB565(end1);
+
+    // Four-colour mode needs colour0 > colour1.
+    if(colour0 < colour1)
+        std::swap(colour0, colour1);
+
+    int palette[4][4] = {};
+    unpackRGB565(colour0, palette[0]);
+    unpackRGB565(colour1, palette[1]);
+    for(int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    // Equal endpoints would mean three-colour mode; index 0 is exact anyway.
+    if(colour0 == colour1)
+    {
+        std::fill(indices, indices + kBlockTexels, 0);
+        int error = 0;
+        for(int i = 0; i < kBlockTexels; ++i)
+            error += squaredDistance(palette[0], texels[i], 3);
+        return error;
+    }
+
+    return chooseIndices(texels, 3, palette, 4, indices);
+}
+
+static void compressColourBlock(const uint8_t* rgba, uint8_t* block)
+{
+    float texels[kBlockTexels][4];
+    loadTexels(rgba, texels);
+
+    float end0[4];
+    float end1[4];
+    axisEndpoints(texels, 3, end0, end1);
+
+    uint16_t colour0 = 0;
+    uint16_t colour1 = 0;
+    int indices[kBlockTexels];
+    int error = fitColourBlock(texels, end0, end1, colour0, colour1, indices);
+
+    float weights[kBlockTexels];
+    for(int i = 0; i < kBlockTexels; ++i)
+        weights[i] = kBC1Weights[indices[i]];
+
+    // Indices refer to the endpoints as stored, which may be swapped, so the
+    // refined endpoints come out the same way round.
+    float refined0[4];
+    float refined1[4];
+    if(leastSquaresEndpoints(texels, 3, weights, refined0, refined1))
+    {
+        uint16_t refinedColour0 = 0;
+        uint16_t refinedColour1 = 0;
+        int refinedIndices[kBlockTexels];
+        const int refinedError = fitColourBlock(texels, refined0, refined1, refinedColour0, refinedColour1, refinedIndices);
+        if(refinedError < error)
+        {
+            colour0 = refinedColour0;
+            colour1 = refinedColour1;
+            std::copy(refinedIndices, refinedIndices + kBlockTexels, indices);
+        }
+    }
+
+    uint32_t packedIndices = 0;
+    for(int i = 0; i < kBlockTexels; ++i)
+        packedIndices |= (uint32_t)indices[i] << (i * 2);
+
+    block[0] = (uint8_t)(colour0 & 0xff);
+    block[1] = (uint8_t)(colour0 >> 8);
+    block[2] = (uint8_t)(colour1 & 0xff);
+    block[3] = (uint8_t)(colour1 >> 8);
+    for(int i = 0; i < 4; ++i)
+        block[4 + i] = (uint8_t)(packedIndices >> (i * 8));
+}
+
+// BC3 alpha, the same as a BC4 block.
+static void compressAlphaBlock(const uint8_t* rgba, uint8_t* block)
+{
+    int low = 255;
+    int high = 0;
+    for(int i = 0; i < kBlockTexels; ++i)
+    {
+        low = std::min(low, (int)rgba[i * 4 + 3]);
+        high = std::max(high, (int)rgba[i * 4 + 3]);
+    }
+
+    // Eight-value mode: alpha0 > alpha1, six values in between.
+    int palette[8];
+    palette[0] = high;
+    palette[1] = low;
+    for(int i = 2; i < 8; ++i)
+        palette[i] = ((8 - i) * high + (i - 1) * low) / 7;
+
+    uint64_t packedIndices = 0;
+    for(int i = 0; i < kBlockTexels && high != low; ++i)
+    {
+        const int alpha = rgba[i * 4 + 3];
+        int best = 0;
+        for(int p = 1; p < 8; ++p)
+        {
+            if(std::abs(palette[p] - alpha) < std::abs(palette[best] - alpha))
+                best = p;
+        }
+
+        packedIndices |= (uint64_t)best << (i * 3);
+    }
+
+    block[0] = (uint8_t)high;
+    block[1] = (uint8_t)low;
+    for(int i = 0; i < 6; ++i)
+        block[2 + i] = (uint8_t)(packedIndices >> (i * 8));
+}
+
+void compressBlockBC1(const uint8_t* rgba, uint8_t* block)
+{
+    compressColourBlock(rgba, block);
+}
+
+void compressBlockBC3(const uint8_t* rgba, uint8_t* block)
+{
+    compressAlphaBlock(rgba, block);
+    compressColourBlock(rgba, block + 8);
+}
+
+// BC7
+
+struct BC7Endpoints
+{
+    int quantised[2][4];    // 7 bits per channel
+    int pbits[2];
+};
+
+static void bc7Endpoint(const BC7Endpoints& endpoints, int end, int* colour)
+{
+    for(int c = 0; c < 4; ++c)
+        colour[c] = (endpoints.quantised[end][c] << 1) | endpoints.pbits[end];
+}
+
+// Quantise end0 / end1 with the p-bits that fit best and pick indices.
+// Returns the error.
+static int fitBC7Block(const float (*texels)[4], const float* end0, const float* end1,
+                       BC7Endpoints& best, int* indices)
+{
+    int bestError = -1;
+    for(int pbits = 0; pbits < 4; ++pbits)
+    {
+        BC7Endpoints endpoints;
+        endpoints.pbits[0] = pbits & 1;
+        endpoints.pbits[1] = pbits >> 1;
+        for(int c = 0; c < 4; ++c)
+        {
+            endpoints.quantised[0][c] = std::min(127, std::max(0, (int)((end0[c] - endpoints.pbits[0]) / 2.0f + 0.5f)));
+            endpoints.quantised[1][c] = std::min(127, std::max(0, (int)((end1[c] - endpoints.pbits[1]) / 2.0f + 0.5f)));
+        }
+
+        int colour0[4];
+        int colour1[4];
+        bc7Endpoint(endpoints, 0, colour0);
+        bc7Endpoint(endpoints, 1, colour1);
+
+        int palette[16][4];
+        for(int p = 0; p < 16; ++p)
+        {
+            for(int c = 0; c < 4; ++c)
+                palette[p][c] = ((64 - kBC7Weights[p]) * colour0[c] + kBC7Weights[p] * colour1[c] + 32) >> 6;
+        }
+
+        int candidate[kBlockTexels];
+        const int error = chooseIndices(texels, 4, palette, 16, candidate);
+        if(bestError < 0 || error < bestError)
+        {
+            bestError = error;
+            best = endpoints;
+            std::copy(candidate, candidate + kBlockTexels, indices);
+        }
+    }
+
+    return bestError;
+}
+
+// Appends bits to a 128-bit block, least significant first.
+class BlockBitWriter
+{
+public:
+    explicit BlockBitWriter(uint8_t* block)
+        : m_block(block)
+        , m_position(0)
+    {
+        std::memset(m_block, 0, 16);
+    }
+
+    void write(uint32_t value, int bits)
+    {
+        for(int i = 0; i < bits; ++i, ++m_position)
+        {
+            if(value & (1u << i))
+                m_block[m_position / 8] |= (uint8_t)(1u << (m_position % 8));
+        }
+    }
+
+private:
+    uint8_t* m_block;
+    int m_position;
+};
+
+void compressBlockBC7(const uint8_t* rgba, uint8_t* block)
+{
+    float texels[kBlockTexels][4];
+    loadTexels(rgba, texels);
+
+    float end0[4];
+    float end1[4];
+    axisEndpoints(texels, 4, end0, end1);
+
+    BC7Endpoints endpoints;
+    int indices[kBlockTexels];
+    int error = fitBC7Block(texels, end0, end1, endpoints, indices);
+
+    float weights[kBlockTexels];
+    for(int i = 0; i < kBlockTexels; ++i)
+        weights[i] = kBC7Weights[indices[i]] / 64.0f;
+
+    float refined0[4];
+    float refined1[4];
+    if(leastSquaresEndpoints(texels, 4, weights, refined0, refined1))
+    {
+        BC7Endpoints refinedEndpoints;
+        int refinedIndices[kBlockTexels];
+        const int refinedError = fitBC7Block(texels, refined0, refined1, refinedEndpoints, refinedIndices);
+        if(refinedError < error)
+        {
+            endpoints = refinedEndpoints;
+            std::copy(refinedIndices, refinedIndices + kBlockTexels, indices);
+        }
+    }
+
+    // The first texel's index is stored with its top bit implied zero, so
+    // swap the endpoints if it's in the upper half.
+    if(indices[0] >= 8)
+    {
+        for(int c = 0; c < 4; ++c)
+            std::swap(endpoints.quantised[0][c], endpoints.quantised[1][c]);
+        std::swap(endpoints.pbits[0], endpoints.pbits[1]);
+        for(int i = 0; i < kBlockTexels; ++i)
+            indices[i] = 15 - indices[i];
+    }
+
+    BlockBitWriter writer(block);
+    writer.write(1u << 6, 7);   // mode 6
+    for(int c = 0; c < 4; ++c)
+    {
+        writer.write((uint32_t)endpoints.quantised[0][c], 7);
+        writer.write((uint32_t)endpoints.quantised[1][c], 7);
+    }
+    writer.write((uint32_t)endpoints.pbits[0], 1);
+    writer.write((uint32_t)endpoints.pbits[1], 1);
+    writer.write((uint32_t)indices[0], 3);
+    for(int i = 1; i < kBlockTexels; ++i)
+        writer.write((uint32_t)indices[i], 4);
+}
+
+static void compressBlockRows(BlockFormat format, const uint8_t* rgba, int width, int height,
+                              int firstRow, int lastRow, uint8_t* output)
+{
+    const int blocksX = std::max(1, (width + 3) / 4);
+    const size_t bytes = blockSize(format);
+
+    uint8_t texels[kBlockTexels * 4];
+    for(int blockY = firstRow; blockY < lastRow; ++blockY)
+    {
+        for(int blockX = 0; blockX < blocksX; ++blockX)
+        {
+            for(int y = 0; y < 4; ++y)
+            {
+                const int sourceY = std::min(blockY * 4 + y, height - 1);
+                for(int x = 0; x < 4; ++x)
+                {
+                    const int sourceX = std::min(blockX * 4 + x, width - 1);
+                    std::memcpy(texels + (y * 4 + x) * 4, rgba + ((size_t)sourceY * width + sourceX) * 4, 4);
+                }
+            }
+
+            uint8_t* block = output + ((size_t)blockY * blocksX + blockX) * bytes;
+            switch(format)
+            {
+            case BlockFormat::BC1: compressBlockBC1(texels, block); break;
+            case BlockFormat::BC3: compressBlockBC3(texels, block); break;
+            case BlockFormat::BC7: compressBlockBC7(texels, block); break;
+            }
+        }
+    }
+}
+
+std::vector<uint8_t> compressImage(BlockFormat format, const uint8_t* rgba, int width, int height, ThreadPool* pool)
+{
+    std::vector<uint8_t> output(blockLevelSize(format, width, height));
+    const int blocksY = std::max(1, (height + 3) / 4);
+
+    if(!pool)
+    {
+        compressBlockRows(format, rgba, width, height, 0, blocksY, output.data());
+        return output;
+    }
+
+    const int tasks = (blocksY + kBlockRowsPerTask - 1) / kBlockRowsPerTask;
+    uint8_t* data = output.data();
+    pool->parallelFor((size_t)tasks, [format, rgba, width, height, blocksY, data](size_t task)
+    {
+        const int row = (int)task * kBlockRowsPerTask;
+        compressBlockRows(format, rgba, width, height, row, std::min(blocksY, row + kBlockRowsPerTask), data);
+    });
+
+    return output;
+}
+
+}   // namespace gl
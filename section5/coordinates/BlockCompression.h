@@ -0,0 +1,31 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstdint>
+#include <vector>
+
+#include "DdsFile.h"
+
+namespace gl
+{
+
+class ThreadPool;
+
+// CPU encoders for the BC formats. Each takes the 16 texels of a 4x4 block as
+// RGBA8, row by row, and writes blockSize() bytes. They aim for reasonable
+// quality at baking speed: endpoints along the block's principal axis, then a
+// least squares refinement, rather than an exhaustive search.
+void compressBlockBC1(const uint8_t* rgba, uint8_t* block);
+void compressBlockBC3(const uint8_t* rgba, uint8_t* block);
+
+// BC7 using mode 6 only: one subset, RGBA endpoints and 4-bit indices.
+void compressBlockBC7(const uint8_t* rgba, uint8_t* block);
+
+// Compress a width x height RGBA8 image, spreading rows of blocks over pool if
+// given. Partial blocks at the right and bottom edges repeat the edge texels.
+std::vector<uint8_t> compressImage(BlockFormat format, const uint8_t* rgba, int width, int height,
+                                   ThreadPool* pool = nullptr);
+
+}   // namespace gl
+
+#endif
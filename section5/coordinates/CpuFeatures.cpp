@@ -0,0 +1,50 @@
+#include "CpuFeatures.h"
+
+#if defined(GL_SIMD_X86) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace gl
+{
+
+static CpuFeatures detectCpuFeatures()
+{
+    CpuFeatures features;
+
+#if defined(GL_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    // These check the OS saves the AVX registers too.
+    __builtin_cpu_init();
+    features.sse2 = __builtin_cpu_supports("sse2");
+    features.sse41 = __builtin_cpu_supports("sse4.1");
+    features.avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    features.f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#elif defined(GL_SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool osSavesAvx = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    features.sse2 = (info[3] & (1 << 26)) != 0;
+    features.sse41 = (info[2] & (1 << 19)) != 0;
+    features.f16c = osSavesAvx && (info[2] & (1 << 28)) && (info[2] & (1 << 29));
+    const bool fma = osSavesAvx && (info[2] & (1 << 12));
+
+    if(maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        features.avx2 = fma && (info[1] & (1 << 5));
+    }
+#endif
+
+    return features;
+}
+
+const CpuFeatures& cpuFeatures()
+{
+    static const CpuFeatures s_features = detectCpuFeatures();
+    return s_features;
+}
+
+}   // namespace gl
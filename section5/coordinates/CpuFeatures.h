@@ -0,0 +1,40 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GL_SIMD_X86 1
+#endif
+
+// Lets a function use instructions beyond the ones the build targets. It must
+// only be called after cpuFeatures() says they're there. MSVC allows the
+// intrinsics anywhere, so needs nothing.
+#if defined(GL_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GL_TARGET_SSE2 __attribute__((target("sse2")))
+#define GL_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define GL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define GL_TARGET_F16C __attribute__((target("avx,f16c")))
+#else
+#define GL_TARGET_SSE2
+#define GL_TARGET_SSE41
+#define GL_TARGET_AVX2
+#define GL_TARGET_F16C
+#endif
+
+namespace gl
+{
+
+// Instruction set extensions the CPU and OS support, for picking SIMD
+// kernels at runtime. Everything is false off x86.
+struct CpuFeatures
+{
+    bool sse2 = false;
+    bool sse41 = false;
+    bool avx2 = false;     // with FMA
+    bool f16c = false;
+};
+
+const CpuFeatures& cpuFeatures();
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,226 @@
+#include "DdsFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace gl
+{
+
+constexpr uint32_t fourCC(char a, char b, char c, char d)
+{
+    return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+}
+
+constexpr uint32_t kDdsMagic = fourCC('D', 'D', 'S', ' ');
+
+constexpr uint32_t kDdsdCaps = 0x1;
+constexpr uint32_t kDdsdHeight = 0x2;
+constexpr uint32_t kDdsdWidth = 0x4;
+constexpr uint32_t kDdsdPixelFormat = 0x1000;
+constexpr uint32_t kDdsdMipMapCount = 0x20000;
+constexpr uint32_t kDdsdLinearSize = 0x80000;
+
+constexpr uint32_t kDdpfFourCC = 0x4;
+
+constexpr uint32_t kDdsCapsComplex = 0x8;
+constexpr uint32_t kDdsCapsTexture = 0x1000;
+constexpr uint32_t kDdsCapsMipMap = 0x400000;
+
+constexpr uint32_t kDxgiFormatBC1Unorm = 71;
+constexpr uint32_t kDxgiFormatBC3Unorm = 77;
+constexpr uint32_t kDxgiFormatBC7Unorm = 98;
+constexpr uint32_t kResourceDimensionTexture2D = 3;
+
+// Laid out as in the file, which is little-endian like everything we run on.
+struct DdsPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DdsHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DdsPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "DDS_HEADER is 124 bytes");
+static_assert(sizeof(DdsHeaderDx10) == 20, "DDS_HEADER_DXT10 is 20 bytes");
+
+static uint32_t dxgiFormat(BlockFormat format)
+{
+    switch(format)
+    {
+    case BlockFormat::BC1: return kDxgiFormatBC1Unorm;
+    case BlockFormat::BC3: return kDxgiFormatBC3Unorm;
+    default: return kDxgiFormatBC7Unorm;
+    }
+}
+
+size_t blockSize(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t blockLevelSize(BlockFormat format, int width, int height)
+{
+    return (size_t)std::max(1, (width + 3) / 4) * std::max(1, (height + 3) / 4) * blockSize(format);
+}
+
+const char* blockFormatName(BlockFormat format)
+{
+    switch(format)
+    {
+    case BlockFormat::BC1: return "bc1";
+    case BlockFormat::BC3: return "bc3";
+    default: return "bc7";
+    }
+}
+
+bool parseDds(const void* data, size_t size, DdsInfo& info)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t offset = sizeof(uint32_t) + sizeof(DdsHeader);
+    if(size < offset)
+        return false;
+
+    uint32_t magic = 0;
+    DdsHeader header;
+    std::memcpy(&magic, bytes, sizeof(magic));
+    std::memcpy(&header, bytes + sizeof(magic), sizeof(header));
+    if(magic != kDdsMagic || header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat) ||
+       !(header.pixelFormat.flags & kDdpfFourCC) || header.width == 0 || header.height == 0)
+        return false;
+
+    switch(header.pixelFormat.fourCC)
+    {
+    case fourCC('D', 'X', 'T', '1'):
+        info.format = BlockFormat::BC1;
+        break;
+    case fourCC('D', 'X', 'T', '5'):
+        info.format = BlockFormat::BC3;
+        break;
+    case fourCC('D', 'X', '1', '0'):
+    {
+        DdsHeaderDx10 dx10;
+        if(size < offset + sizeof(dx10))
+            return false;
+
+        std::memcpy(&dx10, bytes + offset, sizeof(dx10));
+        offset += sizeof(dx10);
+        if(dx10.resourceDimension != kResourceDimensionTexture2D || dx10.arraySize > 1)
+            return false;
+
+        if(dx10.dxgiFormat == kDxgiFormatBC1Unorm)
+            info.format = BlockFormat::BC1;
+        else if(dx10.dxgiFormat == kDxgiFormatBC3Unorm)
+            info.format = BlockFormat::BC3;
+        else if(dx10.dxgiFormat == kDxgiFormatBC7Unorm)
+            info.format = BlockFormat::BC7;
+        else
+            return false;
+        break;
+    }
+    default:
+        return false;
+    }
+
+    info.width = (int)header.width;
+    info.height = (int)header.height;
+    info.levels.clear();
+
+    const uint32_t levelCount = (header.flags & kDdsdMipMapCount) ? std::max(1u, header.mipMapCount) : 1;
+    int width = info.width;
+    int height = info.height;
+    for(uint32_t level = 0; level < levelCount; ++level)
+    {
+        DdsLevel dds;
+        dds.width = width;
+        dds.height = height;
+        dds.offset = offset;
+        dds.size = blockLevelSize(info.format, width, height);
+        if(dds.size > size - offset)
+            return false;
+
+        info.levels.push_back(dds);
+        offset += dds.size;
+
+        if(width == 1 && height == 1)
+            break;
+
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+
+    return true;
+}
+
+bool writeDds(const std::string& path, BlockFormat format, int width, int height,
+              const std::vector<std::vector<uint8_t>>& levels)
+{
+    DdsHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.size = sizeof(DdsHeader);
+    header.flags = kDdsdCaps | kDdsdHeight | kDdsdWidth | kDdsdPixelFormat | kDdsdMipMapCount | kDdsdLinearSize;
+    header.height = (uint32_t)height;
+    header.width = (uint32_t)width;
+    header.pitchOrLinearSize = (uint32_t)blockLevelSize(format, width, height);
+    header.mipMapCount = (uint32_t)levels.size();
+    header.pixelFormat.size = sizeof(DdsPixelFormat);
+    header.pixelFormat.flags = kDdpfFourCC;
+    header.pixelFormat.fourCC = fourCC('D', 'X', '1', '0');
+    header.caps = kDdsCapsTexture | (levels.size() > 1 ? kDdsCapsComplex | kDdsCapsMipMap : 0);
+
+    DdsHeaderDx10 dx10;
+    std::memset(&dx10, 0, sizeof(dx10));
+    dx10.dxgiFormat = dxgiFormat(format);
+    dx10.resourceDimension = kResourceDimensionTexture2D;
+    dx10.arraySize = 1;
+
+    std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    file.write((const char*)&kDdsMagic, sizeof(kDdsMagic));
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)&dx10, sizeof(dx10));
+    for(const std::vector<uint8_t>& level : levels)
+        file.write((const char*)level.data(), level.size());
+
+    file.close();
+    if(!file)
+    {
+        std::cerr << "ERROR::DDS::NOT_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+}   // namespace gl
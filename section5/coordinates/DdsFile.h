@@ -0,0 +1,57 @@
+#ifndef DDS_FILE_H
+#define DDS_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gl
+{
+
+// Block-compressed formats texture_baker writes and TextureLoader uploads.
+enum class BlockFormat
+{
+    BC1,    // RGB, 8 bytes per 4x4 block
+    BC3,    // RGBA, BC1 colour plus an interpolated alpha block, 16 bytes
+    BC7     // RGBA, 16 bytes, higher quality than either
+};
+
+// Bytes in one 4x4 block.
+size_t blockSize(BlockFormat format);
+
+// Bytes in a level of width x height, edge blocks included.
+size_t blockLevelSize(BlockFormat format, int width, int height);
+
+const char* blockFormatName(BlockFormat format);
+
+struct DdsLevel
+{
+    int width = 0;
+    int height = 0;
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+// Layout of a block-compressed 2D texture in a .dds file, level 0 first.
+struct DdsInfo
+{
+    BlockFormat format = BlockFormat::BC1;
+    int width = 0;
+    int height = 0;
+    std::vector<DdsLevel> levels;
+};
+
+// Check the header of a .dds file held in memory and work out where each
+// level is. Only 2D textures in the formats above are accepted, with either a
+// DX10 header or the legacy DXT1/DXT5 four character codes.
+bool parseDds(const void* data, size_t size, DdsInfo& info);
+
+// Write levels, each blockLevelSize() bytes and half the size of the one
+// before, as a .dds file with a DX10 header.
+bool writeDds(const std::string& path, BlockFormat format, int width, int height,
+              const std::vector<std::vector<uint8_t>>& levels);
+
+}   // namespace gl
+
+#endif
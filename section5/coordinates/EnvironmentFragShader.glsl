@@ -0,0 +1,17 @@
+#version 330 core
+
+#include "SpirvCompat.glsl"
+#include "EnvironmentLighting.glsl"
+
+VARYING_LOCATION(0) in vec3 direction;
+VARYING_LOCATION(0) out vec4 color;
+
+UNIFORM_LOCATION(2) uniform samplerCube environment;
+
+void main()
+{
+    // The environment is HDR and the framebuffer isn't, so tone map it and
+    // encode it for display as the rest of the scene's sRGB textures are.
+    vec3 radiance = environmentSpecular(environment, normalize(direction), 0.0);
+    color = vec4(pow(radiance / (1.0 + radiance), vec3(1.0 / 2.2)), 1.0);
+}
@@ -0,0 +1,120 @@
+#include "EnvironmentLighting.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "SamplerCache.h"
+#include "Texture2D.h"
+#include "ThreadPool.h"
+
+namespace gl
+{
+
+EnvironmentLighting::EnvironmentLighting(ThreadPool& pool, SamplerCache& samplers, const std::string& path,
+                                         const EnvironmentMapOptions& options)
+    : m_sampler(0)
+    , m_parameters(sizeof(EnvironmentBlock))
+    , m_texture(0)
+    , m_failed(false)
+{
+    // Seamless filtering blends across faces, so wrapping never applies.
+    SamplerState state = SamplerState::trilinear();
+    state.wrapS = GL_CLAMP_TO_EDGE;
+    state.wrapT = GL_CLAMP_TO_EDGE;
+    m_sampler = samplers.get(state);
+
+    // The task prefilters on the same pool, which parallelFor() allows.
+    ThreadPool* workers = &pool;
+    m_loading = pool.submit([path, options, workers]() {
+        std::unique_ptr<EnvironmentMap> map(new EnvironmentMap());
+        if(!loadEnvironment(path, options, *map, workers))
+            map.reset();
+        return map;
+    });
+}
+
+EnvironmentLighting::~EnvironmentLighting()
+{
+    if(m_loading.valid())
+        m_loading.wait();
+
+    if(m_texture)
+        glDeleteTextures(1, &m_texture);
+}
+
+void EnvironmentLighting::update()
+{
+    if(!m_loading.valid() || m_loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+
+    const std::unique_ptr<EnvironmentMap> map = m_loading.get();
+    if(!map)
+    {
+        std::cerr << "ERROR::ENVIRONMENT_LIGHTING::NOT_LOADED" << std::endl;
+        m_failed = true;
+        return;
+    }
+
+    upload(*map);
+}
+
+void EnvironmentLighting::upload(const EnvironmentMap& map)
+{
+    const GLsizei levels = (GLsizei)map.specular.size();
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture);
+
+    const bool immutable = Texture2D::immutableStorageSupported();
+    if(immutable)
+        glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, GL_RGB9_E5, map.faceSize, map.faceSize);
+    else
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    for(GLint level = 0; level < levels; ++level)
+    {
+        const GLsizei size = map.levelSize(level);
+        for(int face = 0; face < 6; ++face)
+        {
+            const uint32_t* texels = map.specular[level].data() + (size_t)face * size * size;
+            const GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+            if(immutable)
+                glTexSubImage2D(target, level, 0, 0, size, size, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, texels);
+            else
+                glTexImage2D(target, level, GL_RGB9_E5, size, size, 0, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, texels);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    // Without this each face filters on its own and the rough levels, a few
+    // texels across, show their seams. It only changes how cube maps are
+    // sampled.
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    static glm::vec4 EnvironmentBlock::* const s_irradiance[kIrradianceCoefficients] = {
+        &EnvironmentBlock::environmentIrradiance0, &EnvironmentBlock::environmentIrradiance1,
+        &EnvironmentBlock::environmentIrradiance2, &EnvironmentBlock::environmentIrradiance3,
+        &EnvironmentBlock::environmentIrradiance4, &EnvironmentBlock::environmentIrradiance5,
+        &EnvironmentBlock::environmentIrradiance6, &EnvironmentBlock::environmentIrradiance7,
+        &EnvironmentBlock::environmentIrradiance8
+    };
+
+    EnvironmentBlock parameters;
+    for(int i = 0; i < kIrradianceCoefficients; ++i)
+        parameters.*s_irradiance[i] = glm::vec4(map.irradiance[i], 0.0f);
+    parameters.environmentSpecularLevels = (GLfloat)levels;
+    m_parameters.update(parameters);
+}
+
+void EnvironmentLighting::bind(GLuint unit)
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture);
+    glBindSampler(unit, m_sampler);
+
+    glActiveTexture(GL_TEXTURE0);
+    m_parameters.bind(EnvironmentBlock::kBinding);
+}
+
+}   // namespace gl
@@ -0,0 +1,49 @@
+// Image-based lighting from an environment prefiltered by
+// gl::EnvironmentLighting: diffuse light as spherical harmonics, specular
+// light as a cube map whose levels are convolved with rougher and rougher
+// GGX lobes.
+#ifndef ENVIRONMENT_LIGHTING_GLSL
+#define ENVIRONMENT_LIGHTING_GLSL
+
+// Set by the EnvironmentLighting when it's bound, see gl::EnvironmentBlock.
+#ifdef GL_SPIRV
+layout (std140, binding = 3) uniform EnvironmentBlock
+#else
+layout (std140) uniform EnvironmentBlock
+#endif
+{
+    vec4 environmentIrradiance0;
+    vec4 environmentIrradiance1;
+    vec4 environmentIrradiance2;
+    vec4 environmentIrradiance3;
+    vec4 environmentIrradiance4;
+    vec4 environmentIrradiance5;
+    vec4 environmentIrradiance6;
+    vec4 environmentIrradiance7;
+    vec4 environmentIrradiance8;
+    float environmentSpecularLevels;
+};
+
+// Irradiance over pi at a surface facing normal n, so a Lambertian surface
+// reflects its albedo times this.
+vec3 environmentDiffuse(vec3 n)
+{
+    return environmentIrradiance0.rgb * 0.282095 +
+           environmentIrradiance1.rgb * 0.488603 * n.y +
+           environmentIrradiance2.rgb * 0.488603 * n.z +
+           environmentIrradiance3.rgb * 0.488603 * n.x +
+           environmentIrradiance4.rgb * 1.092548 * n.x * n.y +
+           environmentIrradiance5.rgb * 1.092548 * n.y * n.z +
+           environmentIrradiance6.rgb * 0.315392 * (3.0 * n.z * n.z - 1.0) +
+           environmentIrradiance7.rgb * 1.092548 * n.x * n.z +
+           environmentIrradiance8.rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
+// Light reflected along r by a GGX surface of perceptual roughness 0..1,
+// before the BRDF's scale and bias for the view angle are applied.
+vec3 environmentSpecular(samplerCube environment, vec3 r, float roughness)
+{
+    return textureLod(environment, r, roughness * (environmentSpecularLevels - 1.0)).rgb;
+}
+
+#endif
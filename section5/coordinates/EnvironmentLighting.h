@@ -0,0 +1,71 @@
+#ifndef ENVIRONMENT_LIGHTING_H
+#define ENVIRONMENT_LIGHTING_H
+
+#include <future>
+#include <memory>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "EnvironmentMap.h"
+#include "UniformBlocks.h"
+#include "UniformBuffer.h"
+
+namespace gl
+{
+
+class SamplerCache;
+class ThreadPool;
+
+// Image-based lighting from an equirectangular environment image, usually
+// HDR, for EnvironmentLighting.glsl: diffuse light as spherical harmonics in
+// EnvironmentBlock and specular light as a cube map prefiltered for a range
+// of roughness.
+//
+// Everything is prefiltered on the CPU (see EnvironmentMap.h), once; after
+// that it's read from the cache beside the image, or ibl_prefilter can build
+// the cache ahead of time. Loading happens on the pool, so it never holds up
+// startup, and the lighting is uploaded by the first update() after it's
+// done.
+//
+// All calls must be made on the thread that owns the GL context.
+class EnvironmentLighting
+{
+public:
+    EnvironmentLighting(ThreadPool& pool, SamplerCache& samplers, const std::string& path,
+                        const EnvironmentMapOptions& options = EnvironmentMapOptions());
+
+    EnvironmentLighting(const EnvironmentLighting& rhs) = delete;
+    EnvironmentLighting& operator=(const EnvironmentLighting& rhs) = delete;
+
+    // Waits for loading to finish.
+    ~EnvironmentLighting();
+
+    // Upload the lighting once it has loaded. Call once per frame.
+    void update();
+
+    // Uploaded and ready to bind.
+    bool ready() const { return m_texture != 0; }
+
+    // The image couldn't be decoded; the lighting never arrives.
+    bool failed() const { return m_failed; }
+
+    // Bind the specular cube map, with its sampler, to a texture unit and the
+    // irradiance to EnvironmentBlock's binding. The program's environment
+    // sampler must use the same unit.
+    void bind(GLuint unit);
+
+private:
+    void upload(const EnvironmentMap& map);
+
+    GLuint m_sampler;
+    UniformBuffer m_parameters;
+    GLuint m_texture;
+    bool m_failed;
+
+    std::future<std::unique_ptr<EnvironmentMap>> m_loading;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,731 @@
+#include "EnvironmentMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "CpuFeatures.h"
+#include "ImageDecoder.h"
+#include "PixelPacking.h"
+#include "StringHash.h"
+#include "ThreadPool.h"
+
+#if defined(GL_SIMD_X86)
+#include <immintrin.h>
+#endif
+
+namespace gl
+{
+
+constexpr float kPi = 3.14159265358979f;
+
+constexpr uint32_t kEnvironmentCacheMagic = 0x42494c47;   // "GLIB"
+constexpr uint32_t kEnvironmentCacheVersion = 1;
+
+// Bump when the output for the same image and options changes.
+constexpr const char* kPrefilterVersion = "environment 1";
+
+// Largest face picked for an image, and read from a cache.
+constexpr int kMaxAutoFaceSize = 512;
+constexpr int kMaxFaceSize = 4096;
+
+// Equirectangular texels averaged into each texel of the cube map's sharpest
+// level, each way, at most.
+constexpr int kMaxSupersampling = 8;
+
+// Texels each way of the tiles handed to each thread.
+constexpr int kTileSize = 32;
+
+// Samples whose taps are found before the kernel sums them.
+constexpr size_t kTapBatch = 64;
+
+// Laid out as in the file, which is little-endian like everything we run on.
+// Every level's faces follow, in order.
+struct EnvironmentCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t faceSize;
+    uint32_t levels;
+    float irradiance[kIrradianceCoefficients * 3];
+    uint32_t reserved;
+};
+
+// A level of a cube map being filtered: six faces of RGBA floats, alpha 1,
+// each with a column and a row past its far edges repeating the last, so all
+// four texels of a bilinear tap are always there.
+struct CubeLevel
+{
+    int size;
+    std::vector<float> texels;
+
+    explicit CubeLevel(int levelSize)
+        : size(levelSize)
+        , texels((size_t)6 * (levelSize + 1) * (levelSize + 1) * 4, 1.0f)
+    {
+    }
+
+    // Floats from one row to the next.
+    size_t stride() const { return (size_t)(size + 1) * 4; }
+
+    float* texel(int face, int x, int y) { return texels.data() + ((size_t)face * (size + 1) + y) * stride() + (size_t)x * 4; }
+    const float* texel(int face, int x, int y) const { return texels.data() + ((size_t)face * (size + 1) + y) * stride() + (size_t)x * 4; }
+
+    void padEdges()
+    {
+        for(int face = 0; face < 6; ++face)
+        {
+            for(int y = 0; y < size; ++y)
+                std::copy(texel(face, size - 1, y), texel(face, size - 1, y) + 4, texel(face, size, y));
+
+            std::copy(texel(face, 0, size - 1), texel(face, 0, size - 1) + stride(), texel(face, 0, size));
+        }
+    }
+};
+
+static int levelCount(int size)
+{
+    int levels = 1;
+    for(; size > 1; size /= 2)
+        ++levels;
+
+    return levels;
+}
+
+// The direction through s, t in -1..1 across a face, as GL's cube map lookup
+// finds them.
+static glm::vec3 faceDirection(int face, float s, float t)
+{
+    switch(face)
+    {
+    case 0: return glm::vec3(1.0f, -t, -s);
+    case 1: return glm::vec3(-1.0f, -t, s);
+    case 2: return glm::vec3(s, 1.0f, t);
+    case 3: return glm::vec3(s, -1.0f, -t);
+    case 4: return glm::vec3(s, -t, 1.0f);
+    default: return glm::vec3(-s, -t, -1.0f);
+    }
+}
+
+// And back: the face direction points at, and where on it in 0..1.
+static int directionFace(const glm::vec3& direction, float& s, float& t)
+{
+    const glm::vec3 magnitude = glm::abs(direction);
+
+    int face;
+    float major, sc, tc;
+    if(magnitude.x >= magnitude.y && magnitude.x >= magnitude.z)
+    {
+        major = magnitude.x;
+        face = direction.x > 0.0f ? 0 : 1;
+        sc = direction.x > 0.0f ? -direction.z : direction.z;
+        tc = -direction.y;
+    }
+    else if(magnitude.y >= magnitude.z)
+    {
+        major = magnitude.y;
+        face = direction.y > 0.0f ? 2 : 3;
+        sc = direction.x;
+        tc = direction.y > 0.0f ? direction.z : -direction.z;
+    }
+    else
+    {
+        major = magnitude.z;
+        face = direction.z > 0.0f ? 4 : 5;
+        sc = direction.z > 0.0f ? direction.x : -direction.x;
+        tc = -direction.y;
+    }
+
+    s = 0.5f * (sc / major + 1.0f);
+    t = 0.5f * (tc / major + 1.0f);
+    return face;
+}
+
+// Run body(face, x0, y0, x1, y1) over every face of a level in tiles, on the
+// pool if there is one.
+static void forEachTile(int size, ThreadPool* pool, const std::function<void(int, int, int, int, int)>& body)
+{
+    const int tiles = (size + kTileSize - 1) / kTileSize;
+    const size_t tilesPerFace = (size_t)tiles * tiles;
+    const auto tile = [&](size_t i) {
+        const int face = (int)(i / tilesPerFace);
+        const int x0 = (int)(i % tilesPerFace % tiles) * kTileSize;
+        const int y0 = (int)(i % tilesPerFace / tiles) * kTileSize;
+        body(face, x0, y0, std::min(x0 + kTileSize, size), std::min(y0 + kTileSize, size));
+    };
+
+    if(pool)
+    {
+        pool->parallelFor(6 * tilesPerFace, tile);
+        return;
+    }
+
+    for(size_t i = 0; i < 6 * tilesPerFace; ++i)
+        tile(i);
+}
+
+// Bilinear sample of an equirectangular image, wrapping around and clamped
+// at the poles.
+static glm::vec3 sampleEquirect(const float* rgb, int width, int height, const glm::vec3& direction)
+{
+    const float u = 0.5f + std::atan2(direction.x, -direction.z) / (2.0f * kPi);
+    const float v = std::acos(std::min(std::max(direction.y, -1.0f), 1.0f)) / kPi;
+
+    const float x = u * width - 0.5f;
+    const float y = std::min(std::max(v * height - 0.5f, 0.0f), (float)(height - 1));
+    const int x0 = (int)std::floor(x);
+    const int y0 = (int)y;
+    const float fx = x - x0;
+    const float fy = y - y0;
+
+    const int left = (x0 % width + width) % width;
+    const int right = (left + 1) % width;
+    const int bottom = std::min(y0 + 1, height - 1);
+
+    const auto texel = [&](int column, int row) { return glm::vec3(glm::make_vec3(rgb + ((size_t)row * width + column) * 3)); };
+    return glm::mix(glm::mix(texel(left, y0), texel(right, y0), fx), glm::mix(texel(left, bottom), texel(right, bottom), fx), fy);
+}
+
+// The cube map's sharpest level, each texel the average of a grid of
+// samples enough to cover the equirectangular texels it spans.
+static void equirectToCube(const float* rgb, int width, int height, CubeLevel& level, ThreadPool* pool)
+{
+    const int samples = std::min(std::max((width / 4 + level.size - 1) / level.size, 1), kMaxSupersampling);
+    forEachTile(level.size, pool, [&](int face, int x0, int y0, int x1, int y1) {
+        for(int y = y0; y < y1; ++y)
+        {
+            for(int x = x0; x < x1; ++x)
+            {
+                glm::vec3 sum(0.0f);
+                for(int j = 0; j < samples; ++j)
+                {
+                    for(int i = 0; i < samples; ++i)
+                    {
+                        const float s = 2.0f * (x + (i + 0.5f) / samples) / level.size - 1.0f;
+                        const float t = 2.0f * (y + (j + 0.5f) / samples) / level.size - 1.0f;
+                        sum += sampleEquirect(rgb, width, height, glm::normalize(faceDirection(face, s, t)));
+                    }
+                }
+
+                sum /= (float)(samples * samples);
+                std::copy(&sum.x, &sum.x + 3, level.texel(face, x, y));
+            }
+        }
+    });
+    level.padEdges();
+}
+
+// Half the size of above, each texel the average of the four under it.
+static void downsample(const CubeLevel& above, CubeLevel& level, ThreadPool* pool)
+{
+    forEachTile(level.size, pool, [&](int face, int x0, int y0, int x1, int y1) {
+        for(int y = y0; y < y1; ++y)
+        {
+            const int top = std::min(y * 2, above.size - 1);
+            const int bottom = std::min(y * 2 + 1, above.size - 1);
+            for(int x = x0; x < x1; ++x)
+            {
+                const int left = std::min(x * 2, above.size - 1);
+                const int right = std::min(x * 2 + 1, above.size - 1);
+                for(int c = 0; c < 3; ++c)
+                {
+                    level.texel(face, x, y)[c] = 0.25f * (above.texel(face, left, top)[c] + above.texel(face, right, top)[c] +
+                                                          above.texel(face, left, bottom)[c] + above.texel(face, right, bottom)[c]);
+                }
+            }
+        }
+    });
+    level.padEdges();
+}
+
+// The real spherical harmonics of bands 0 to 2 in direction.
+static void shBasis(const glm::vec3& direction, float* basis)
+{
+    const float x = direction.x;
+    const float y = direction.y;
+    const float z = direction.z;
+
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * y;
+    basis[2] = 0.488603f * z;
+    basis[3] = 0.488603f * x;
+    basis[4] = 1.092548f * x * y;
+    basis[5] = 1.092548f * y * z;
+    basis[6] = 0.315392f * (3.0f * z * z - 1.0f);
+    basis[7] = 1.092548f * x * z;
+    basis[8] = 0.546274f * (x * x - y * y);
+}
+
+// Solid angle a face subtends from its centre to (s, t) in -1..1.
+static double areaElement(double s, double t)
+{
+    return std::atan2(s * t, std::sqrt(s * s + t * t + 1.0));
+}
+
+static double texelSolidAngle(int size, int x, int y)
+{
+    const double s0 = 2.0 * x / size - 1.0;
+    const double t0 = 2.0 * y / size - 1.0;
+    const double s1 = 2.0 * (x + 1) / size - 1.0;
+    const double t1 = 2.0 * (y + 1) / size - 1.0;
+    return areaElement(s0, t0) - areaElement(s0, t1) - areaElement(s1, t0) + areaElement(s1, t1);
+}
+
+// Project the cube map onto the spherical harmonics, a face per thread and
+// summed in face order so the result doesn't depend on the threads, then
+// convolve with the cosine lobe (Ramamoorthi and Hanrahan, "An Efficient
+// Representation for Irradiance Environment Maps") and divide by pi.
+static void projectIrradiance(const CubeLevel& level, glm::vec3* irradiance, ThreadPool* pool)
+{
+    std::vector<glm::dvec3> faceSums((size_t)6 * kIrradianceCoefficients, glm::dvec3(0.0));
+    const auto projectFace = [&](size_t face) {
+        glm::dvec3* sums = faceSums.data() + face * kIrradianceCoefficients;
+        for(int y = 0; y < level.size; ++y)
+        {
+            const float t = 2.0f * (y + 0.5f) / level.size - 1.0f;
+            for(int x = 0; x < level.size; ++x)
+            {
+                const float s = 2.0f * (x + 0.5f) / level.size - 1.0f;
+                float basis[kIrradianceCoefficients];
+                shBasis(glm::normalize(faceDirection((int)face, s, t)), basis);
+
+                const glm::dvec3 radiance = glm::dvec3(glm::make_vec3(level.texel((int)face, x, y))) * texelSolidAngle(level.size, x, y);
+                for(int i = 0; i < kIrradianceCoefficients; ++i)
+                    sums[i] += radiance * (double)basis[i];
+            }
+        }
+    };
+
+    if(pool)
+    {
+        pool->parallelFor(6, projectFace);
+    }
+    else
+    {
+        for(size_t face = 0; face < 6; ++face)
+            projectFace(face);
+    }
+
+    // The cosine lobe's bands, pi, 2pi/3 and pi/4, over pi.
+    static const double s_bandScales[kIrradianceCoefficients] = {1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25};
+    for(int i = 0; i < kIrradianceCoefficients; ++i)
+    {
+        glm::dvec3 sum(0.0);
+        for(int face = 0; face < 6; ++face)
+            sum += faceSums[(size_t)face * kIrradianceCoefficients + i];
+
+        irradiance[i] = glm::vec3(sum * s_bandScales[i]);
+    }
+}
+
+// A GGX sample around +Z, the normal and view direction of every texel.
+struct SpecularSample
+{
+    glm::vec3 direction;
+
+    // N.L
+    float weight;
+
+    // The source level whose texels are about the solid angle the sample
+    // stands for, so a few hundred samples don't alias (Colbert and Krivanek,
+    // "GPU-Based Importance Sampling", GPU Gems 3).
+    int level;
+};
+
+static float radicalInverse(uint32_t bits)
+{
+    bits = (bits << 16) | (bits >> 16);
+    bits = ((bits & 0x55555555u) << 1) | ((bits & 0xaaaaaaaau) >> 1);
+    bits = ((bits & 0x33333333u) << 2) | ((bits & 0xccccccccu) >> 2);
+    bits = ((bits & 0x0f0f0f0fu) << 4) | ((bits & 0xf0f0f0f0u) >> 4);
+    bits = ((bits & 0x00ff00ffu) << 8) | ((bits & 0xff00ff00u) >> 8);
+    return bits * 2.3283064365386963e-10f;
+}
+
+// Light directions importance sampled from the GGX lobe of roughness on a
+// Hammersley set, as in Karis, "Real Shading in Unreal Engine 4". The same
+// set serves every texel, turned to face its direction.
+static std::vector<SpecularSample> specularSamples(float roughness, int count, const std::vector<CubeLevel>& source)
+{
+    const float alpha2 = roughness * roughness * roughness * roughness;
+    const float texelAngle = 4.0f * kPi / (6.0f * source[0].size * source[0].size);
+
+    std::vector<SpecularSample> samples;
+    samples.reserve(count);
+    for(int i = 0; i < count; ++i)
+    {
+        const float phi = 2.0f * kPi * (i + 0.5f) / count;
+        const float u = radicalInverse((uint32_t)i);
+        const float cosTheta = std::sqrt((1.0f - u) / (1.0f + (alpha2 - 1.0f) * u));
+        const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+        const glm::vec3 halfway(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+        const glm::vec3 light = 2.0f * cosTheta * halfway - glm::vec3(0.0f, 0.0f, 1.0f);
+        if(light.z <= 0.0f)
+            continue;
+
+        // With N = V the pdf of the light direction is D(H) / 4.
+        const float denominator = cosTheta * cosTheta * (alpha2 - 1.0f) + 1.0f;
+        const float pdf = alpha2 / (kPi * denominator * denominator) / 4.0f;
+        const float sampleAngle = 1.0f / (count * pdf);
+        const float level = 0.5f * std::log2(sampleAngle / texelAngle);
+
+        samples.push_back({light, light.z, std::min(std::max((int)std::lround(level), 0), (int)source.size() - 1)});
+    }
+
+    return samples;
+}
+
+// A bilinear sample of a cube map level: its two rows of two texels, and
+// their weights times the sample's.
+struct BilinearTap
+{
+    const float* top;
+    const float* bottom;
+    float weights[4];
+};
+
+static void makeTap(const CubeLevel& level, const glm::vec3& direction, float weight, BilinearTap& tap)
+{
+    float s, t;
+    const int face = directionFace(direction, s, t);
+    const float x = std::min(std::max(s * level.size - 0.5f, 0.0f), (float)(level.size - 1));
+    const float y = std::min(std::max(t * level.size - 0.5f, 0.0f), (float)(level.size - 1));
+    const int x0 = (int)x;
+    const int y0 = (int)y;
+    const float fx = x - x0;
+    const float fy = y - y0;
+
+    tap.top = level.texel(face, x0, y0);
+    tap.bottom = tap.top + level.stride();
+    tap.weights[0] = weight * (1.0f - fx) * (1.0f - fy);
+    tap.weights[1] = weight * fx * (1.0f - fy);
+    tap.weights[2] = weight * (1.0f - fx) * fy;
+    tap.weights[3] = weight * fx * fy;
+}
+
+// Kernels adding the weighted texels of count taps to the RGBA sum. Alpha is
+// 1 in every texel, so sum[3] ends up the total weight.
+
+using AccumulateKernel = void (*)(const BilinearTap* taps, size_t count, float* sum);
+
+static void accumulateScalar(const BilinearTap* taps, size_t count, float* sum)
+{
+    for(size_t i = 0; i < count; ++i)
+    {
+        const BilinearTap& tap = taps[i];
+        for(int c = 0; c < 4; ++c)
+        {
+            sum[c] += tap.weights[0] * tap.top[c] + tap.weights[1] * tap.top[4 + c] +
+                      tap.weights[2] * tap.bottom[c] + tap.weights[3] * tap.bottom[4 + c];
+        }
+    }
+}
+
+#if defined(GL_SIMD_X86)
+
+// One texel per SSE register.
+GL_TARGET_SSE2 static void accumulateSse2(const BilinearTap* taps, size_t count, float* sum)
+{
+    __m128 total = _mm_loadu_ps(sum);
+    for(size_t i = 0; i < count; ++i)
+    {
+        const BilinearTap& tap = taps[i];
+        const __m128 top = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tap.weights[0]), _mm_loadu_ps(tap.top)),
+                                      _mm_mul_ps(_mm_set1_ps(tap.weights[1]), _mm_loadu_ps(tap.top + 4)));
+        const __m128 bottom = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tap.weights[2]), _mm_loadu_ps(tap.bottom)),
+                                         _mm_mul_ps(_mm_set1_ps(tap.weights[3]), _mm_loadu_ps(tap.bottom + 4)));
+        total = _mm_add_ps(total, _mm_add_ps(top, bottom));
+    }
+
+    _mm_storeu_ps(sum, total);
+}
+
+// A row's two texels sit side by side, so each is one AVX load, weighted by
+// its two weights spread over the halves.
+GL_TARGET_AVX2 static void accumulateAvx2(const BilinearTap* taps, size_t count, float* sum)
+{
+    const __m256i topWeights = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+    const __m256i bottomWeights = _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3);
+
+    __m256 total = _mm256_setzero_ps();
+    for(size_t i = 0; i < count; ++i)
+    {
+        const BilinearTap& tap = taps[i];
+        const __m256 weights = _mm256_castps128_ps256(_mm_loadu_ps(tap.weights));
+        total = _mm256_fmadd_ps(_mm256_permutevar8x32_ps(weights, topWeights), _mm256_loadu_ps(tap.top), total);
+        total = _mm256_fmadd_ps(_mm256_permutevar8x32_ps(weights, bottomWeights), _mm256_loadu_ps(tap.bottom), total);
+    }
+
+    const __m128 halves = _mm_add_ps(_mm256_castps256_ps128(total), _mm256_extractf128_ps(total, 1));
+    _mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), halves));
+}
+
+#endif
+
+static AccumulateKernel selectAccumulateKernel()
+{
+#if defined(GL_SIMD_X86)
+    if(cpuFeatures().avx2)
+        return accumulateAvx2;
+    if(cpuFeatures().sse2)
+        return accumulateSse2;
+#endif
+    return accumulateScalar;
+}
+
+static AccumulateKernel accumulateKernel()
+{
+    static const AccumulateKernel s_kernel = selectAccumulateKernel();
+    return s_kernel;
+}
+
+// Convolve the source with a GGX lobe into a level of size texels, as RGBA
+// floats.
+static void prefilterSpecular(const std::vector<CubeLevel>& source, const std::vector<SpecularSample>& samples, int size,
+                              std::vector<float>& texels, ThreadPool* pool)
+{
+    const AccumulateKernel accumulate = accumulateKernel();
+    forEachTile(size, pool, [&](int face, int x0, int y0, int x1, int y1) {
+        BilinearTap taps[kTapBatch];
+        for(int y = y0; y < y1; ++y)
+        {
+            const float t = 2.0f * (y + 0.5f) / size - 1.0f;
+            for(int x = x0; x < x1; ++x)
+            {
+                const float s = 2.0f * (x + 0.5f) / size - 1.0f;
+                const glm::vec3 normal = glm::normalize(faceDirection(face, s, t));
+                const glm::vec3 up = std::abs(normal.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                const glm::vec3 tangent = glm::normalize(glm::cross(up, normal));
+                const glm::vec3 bitangent = glm::cross(normal, tangent);
+
+                float sum[4] = {};
+                for(size_t first = 0; first < samples.size(); first += kTapBatch)
+                {
+                    const size_t count = std::min(kTapBatch, samples.size() - first);
+                    for(size_t i = 0; i < count; ++i)
+                    {
+                        const SpecularSample& sample = samples[first + i];
+                        const glm::vec3 direction = tangent * sample.direction.x + bitangent * sample.direction.y +
+                                                    normal * sample.direction.z;
+                        makeTap(source[sample.level], direction, sample.weight, taps[i]);
+                    }
+
+                    accumulate(taps, count, sum);
+                }
+
+                float* texel = texels.data() + (((size_t)face * size + y) * size + x) * 4;
+                for(int c = 0; c < 3; ++c)
+                    texel[c] = sum[3] > 0.0f ? sum[c] / sum[3] : 0.0f;
+                texel[3] = 1.0f;
+            }
+        }
+    });
+}
+
+static std::vector<uint32_t> packLevel(const std::vector<float>& texels)
+{
+    std::vector<uint16_t> halves(texels.size());
+    packHalf(texels.data(), halves.data(), texels.size());
+
+    std::vector<uint32_t> packed(texels.size() / 4);
+    packRgb9e5(halves.data(), packed.data(), packed.size());
+    return packed;
+}
+
+void prefilterEnvironment(const float* rgb, int width, int height, const EnvironmentMapOptions& options,
+                          EnvironmentMap& map, ThreadPool* pool)
+{
+    int faceSize = std::min(options.faceSize, kMaxFaceSize);
+    if(faceSize <= 0)
+    {
+        faceSize = 1;
+        while(faceSize * 2 <= width / 4 && faceSize < kMaxAutoFaceSize)
+            faceSize *= 2;
+    }
+
+    // The source is filtered down to 1x1 for the samples to read from.
+    std::vector<CubeLevel> source;
+    source.emplace_back(faceSize);
+    equirectToCube(rgb, width, height, source[0], pool);
+    for(int size = faceSize / 2; size >= 1; size /= 2)
+    {
+        source.emplace_back(size);
+        downsample(source[source.size() - 2], source.back(), pool);
+    }
+
+    map.faceSize = faceSize;
+    projectIrradiance(source[0], map.irradiance, pool);
+
+    // Level 0 is a mirror, the source as it is.
+    const int levels = std::min(std::max(options.specularLevels, 1), levelCount(faceSize));
+    map.specular.clear();
+
+    std::vector<float> texels((size_t)6 * faceSize * faceSize * 4);
+    for(int face = 0; face < 6; ++face)
+    {
+        for(int y = 0; y < faceSize; ++y)
+            std::copy(source[0].texel(face, 0, y), source[0].texel(face, faceSize, y),
+                      texels.data() + ((size_t)face * faceSize + y) * faceSize * 4);
+    }
+    map.specular.push_back(packLevel(texels));
+
+    for(int level = 1; level < levels; ++level)
+    {
+        const int size = map.levelSize(level);
+        const std::vector<SpecularSample> samples = specularSamples((float)level / (levels - 1), std::max(options.specularSamples, 1), source);
+
+        texels.assign((size_t)6 * size * size * 4, 0.0f);
+        prefilterSpecular(source, samples, size, texels, pool);
+        map.specular.push_back(packLevel(texels));
+    }
+}
+
+// sRGB to linear, for environments that aren't HDR.
+static float srgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+bool prefilterEnvironmentFile(const std::string& path, const EnvironmentMapOptions& options,
+                              EnvironmentMap& map, ThreadPool* pool)
+{
+    ImageArena arena;
+    ImageView image;
+    ImageDecodeOptions decodeOptions;
+    decodeOptions.channels = 3;
+    decodeOptions.highPrecision = true;
+    decodeOptions.fullFloat = true;
+    if(!ImageDecoder::decodeFile(path, decodeOptions, arena, image))
+        return false;
+
+    const size_t count = (size_t)image.width * image.height * 3;
+    std::vector<float> converted;
+    const float* rgb = (const float*)image.pixels;
+    if(image.type == ImageChannelType::Half)
+    {
+        converted.resize(count);
+        unpackHalf((const uint16_t*)image.pixels, converted.data(), count);
+        rgb = converted.data();
+    }
+    else if(image.type == ImageChannelType::UInt8)
+    {
+        float linear[256];
+        for(int i = 0; i < 256; ++i)
+            linear[i] = srgbToLinear(i / 255.0f);
+
+        converted.resize(count);
+        for(size_t i = 0; i < count; ++i)
+            converted[i] = linear[image.pixels[i]];
+        rgb = converted.data();
+    }
+
+    prefilterEnvironment(rgb, image.width, image.height, options, map, pool);
+    return true;
+}
+
+std::string environmentCachePath(const std::string& imagePath)
+{
+    return imagePath + ".ibl";
+}
+
+uint64_t environmentCacheKey(const std::string& imagePath, const EnvironmentMapOptions& options)
+{
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(imagePath, error);
+    if(error)
+        return 0;
+
+    const std::filesystem::file_time_type modified = std::filesystem::last_write_time(imagePath, error);
+    if(error)
+        return 0;
+
+    return hashString(std::string(kPrefilterVersion) + " " + std::to_string(options.faceSize) + " " +
+                      std::to_string(options.specularLevels) + " " + std::to_string(options.specularSamples) + " " +
+                      std::to_string(size) + " " + std::to_string(modified.time_since_epoch().count()));
+}
+
+bool readEnvironmentCache(const std::string& path, uint64_t key, EnvironmentMap& map)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return false;
+
+    EnvironmentCacheHeader header;
+    if(!file.read((char*)&header, sizeof(header)) || header.magic != kEnvironmentCacheMagic ||
+       header.version != kEnvironmentCacheVersion || header.key != key || header.faceSize == 0 ||
+       header.faceSize > (uint32_t)kMaxFaceSize || header.levels == 0 ||
+       header.levels > (uint32_t)levelCount((int)header.faceSize))
+        return false;
+
+    EnvironmentMap loaded;
+    loaded.faceSize = (int)header.faceSize;
+    for(int i = 0; i < kIrradianceCoefficients; ++i)
+        loaded.irradiance[i] = glm::make_vec3(header.irradiance + i * 3);
+
+    for(int level = 0; level < (int)header.levels; ++level)
+    {
+        const int size = loaded.levelSize(level);
+        std::vector<uint32_t> texels((size_t)6 * size * size);
+        if(!file.read((char*)texels.data(), texels.size() * sizeof(uint32_t)))
+            return false;
+
+        loaded.specular.push_back(std::move(texels));
+    }
+
+    map = std::move(loaded);
+    return true;
+}
+
+bool writeEnvironmentCache(const std::string& path, uint64_t key, const EnvironmentMap& map)
+{
+    EnvironmentCacheHeader header = {};
+    header.magic = kEnvironmentCacheMagic;
+    header.version = kEnvironmentCacheVersion;
+    header.key = key;
+    header.faceSize = (uint32_t)map.faceSize;
+    header.levels = (uint32_t)map.specular.size();
+    for(int i = 0; i < kIrradianceCoefficients; ++i)
+        std::copy(&map.irradiance[i].x, &map.irradiance[i].x + 3, header.irradiance + i * 3);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(header));
+    for(const std::vector<uint32_t>& level : map.specular)
+        file.write((const char*)level.data(), level.size() * sizeof(uint32_t));
+
+    file.close();
+    if(!file)
+    {
+        std::cerr << "ERROR::ENVIRONMENT_MAP::NOT_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool loadEnvironment(const std::string& imagePath, const EnvironmentMapOptions& options,
+                     EnvironmentMap& map, ThreadPool* pool)
+{
+    const uint64_t key = environmentCacheKey(imagePath, options);
+    const std::string cachePath = environmentCachePath(imagePath);
+    if(key != 0 && readEnvironmentCache(cachePath, key, map))
+        return true;
+
+    if(!prefilterEnvironmentFile(imagePath, options, map, pool))
+        return false;
+
+    // Still usable if the cache can't be written, e.g. beside a read-only
+    // image; it's prefiltered again next time.
+    if(key != 0)
+        writeEnvironmentCache(cachePath, key, map);
+
+    return true;
+}
+
+}   // namespace gl
@@ -0,0 +1,90 @@
+#ifndef ENVIRONMENT_MAP_H
+#define ENVIRONMENT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace gl
+{
+
+class ThreadPool;
+
+// Second order spherical harmonics: one band 0, three band 1 and five band 2
+// coefficients.
+constexpr int kIrradianceCoefficients = 9;
+
+struct EnvironmentMapOptions
+{
+    // Texels across each face of the sharpest cube map level. 0 picks the
+    // largest power of two within a quarter of the image's width, at most
+    // 512.
+    int faceSize = 0;
+
+    // Levels of the specular chain, each half the size of the one before and
+    // rougher, from a mirror at level 0 to fully rough at the last.
+    int specularLevels = 6;
+
+    // GGX samples per texel of each rough level.
+    int specularSamples = 256;
+};
+
+// Image-based lighting prefiltered from an environment: diffuse light as
+// spherical harmonics and specular light as a cube map whose levels are
+// convolved with GGX lobes of increasing roughness.
+struct EnvironmentMap
+{
+    int faceSize = 0;
+
+    // Irradiance divided by pi, so a Lambertian surface with normal n
+    // reflects its albedo times the sum of these weighted by the basis
+    // functions at n, in the order EnvironmentLighting.glsl evaluates them.
+    glm::vec3 irradiance[kIrradianceCoefficients];
+
+    // Each level's six faces, +X -X +Y -Y +Z -Z as GL orders them, in GL's
+    // cube map texel order, as GL_RGB9_E5 texels. Level l has perceptual
+    // roughness l / (levels - 1), and alpha its square.
+    std::vector<std::vector<uint32_t>> specular;
+
+    int levelSize(int level) const { return faceSize >> level > 0 ? faceSize >> level : 1; }
+};
+
+// Prefilter an equirectangular image of linear RGB floats, its first row
+// straight up and its middle column looking down -Z. Faces and their tiles
+// are shared between the pool's threads if given one.
+void prefilterEnvironment(const float* rgb, int width, int height, const EnvironmentMapOptions& options,
+                          EnvironmentMap& map, ThreadPool* pool = nullptr);
+
+// Decode the equirectangular image at path and prefilter it. HDR images are
+// used as the floats stbi_loadf gives; others are taken to be sRGB. Returns
+// false, having logged why, if it couldn't be decoded.
+bool prefilterEnvironmentFile(const std::string& path, const EnvironmentMapOptions& options,
+                              EnvironmentMap& map, ThreadPool* pool = nullptr);
+
+// Prefiltered environments are cached beside their images, so lighting costs
+// a file read once they've been prefiltered, by ibl_prefilter or a previous
+// run. The cache records the image's size and modification time and the
+// options it was prefiltered with, and is ignored if any of them change.
+std::string environmentCachePath(const std::string& imagePath);
+
+// What a cache of the image at path has to match; 0 if the image can't be
+// found.
+uint64_t environmentCacheKey(const std::string& imagePath, const EnvironmentMapOptions& options);
+
+// Read a cache written with key. Returns false if it's missing, stale or
+// damaged, leaving map as it was.
+bool readEnvironmentCache(const std::string& path, uint64_t key, EnvironmentMap& map);
+
+bool writeEnvironmentCache(const std::string& path, uint64_t key, const EnvironmentMap& map);
+
+// Read the image's cache if it's up to date, otherwise prefilter the image
+// and write its cache.
+bool loadEnvironment(const std::string& imagePath, const EnvironmentMapOptions& options,
+                     EnvironmentMap& map, ThreadPool* pool = nullptr);
+
+}   // namespace gl
+
+#endif
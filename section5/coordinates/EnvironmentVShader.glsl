@@ -0,0 +1,19 @@
+#version 330 core
+
+#include "SpirvCompat.glsl"
+#include "Transforms.glsl"
+
+// Drawn as one triangle covering the screen, with no vertex buffer, behind
+// everything else.
+VARYING_LOCATION(0) out vec3 direction;
+
+void main()
+{
+    vec2 corner = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+    gl_Position = vec4(corner, 1.0, 1.0);
+
+    // The view ray through the corner, turned into the world. The camera only
+    // rotates and moves, so its rotation's inverse is its transpose.
+    vec4 eye = inverse(projection) * vec4(corner, 1.0, 1.0);
+    direction = transpose(mat3(view)) * (eye.xyz / eye.w);
+}
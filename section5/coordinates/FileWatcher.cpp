@@ -0,0 +1,186 @@
+#include "FileWatcher.h"
+
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <utility>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace gl
+{
+
+// How often the thread wakes to check whether it should stop (and, without
+// inotify, to compare modification times).
+constexpr std::chrono::milliseconds kWatchPollInterval(100);
+
+// Editors tend to produce several events per save; wait this long after the
+// first one so the file is complete and the burst is reported once.
+constexpr std::chrono::milliseconds kWatchSettleTime(50);
+
+#if defined(__linux__)
+
+static void splitPath(const std::string& path, std::string& directory, std::string& fileName)
+{
+    size_t separator = path.find_last_of('/');
+    directory = separator == std::string::npos ? "." : path.substr(0, separator);
+    fileName = separator == std::string::npos ? path : path.substr(separator + 1);
+}
+
+FileWatcher::FileWatcher(std::function<void(const std::string&)> onChanged)
+    : m_onChanged(std::move(onChanged))
+    , m_running(true)
+    , m_inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+    if(m_inotify < 0)
+        std::cerr << "ERROR::FILE_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+
+    m_thread = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    m_running = false;
+    m_thread.join();
+
+    if(m_inotify >= 0)
+        close(m_inotify);
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+    if(m_inotify < 0)
+        return;
+
+    std::string directory, fileName;
+    splitPath(path, directory, fileName);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto directoryWatch = m_directoryWatches.find(directory);
+    if(directoryWatch == m_directoryWatches.end())
+    {
+        int wd = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if(wd < 0)
+        {
+            std::cerr << "ERROR::FILE_WATCHER::WATCH_FAILED: " << directory << std::endl;
+            return;
+        }
+
+        directoryWatch = m_directoryWatches.emplace(directory, wd).first;
+    }
+
+    std::vector<WatchedFile>& files = m_watchedFiles[directoryWatch->second];
+    for(const WatchedFile& file : files)
+    {
+        if(file.path == path)
+            return;
+    }
+
+    files.push_back({fileName, path});
+}
+
+void FileWatcher::run()
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while(m_running)
+    {
+        pollfd descriptor = {m_inotify, POLLIN, 0};
+        if(m_inotify < 0 || poll(&descriptor, 1, (int)kWatchPollInterval.count()) <= 0)
+        {
+            if(m_inotify < 0)
+                std::this_thread::sleep_for(kWatchPollInterval);
+            continue;
+        }
+
+        std::this_thread::sleep_for(kWatchSettleTime);
+
+        std::set<std::string> changed;
+        ssize_t length;
+        while((length = read(m_inotify, buffer, sizeof(buffer))) > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for(char* ptr = buffer; ptr < buffer + length;)
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                auto files = m_watchedFiles.find(event->wd);
+                if(event->len == 0 || files == m_watchedFiles.end())
+                    continue;
+
+                for(const WatchedFile& file : files->second)
+                {
+                    if(file.fileName == event->name)
+                        changed.insert(file.path);
+                }
+            }
+        }
+
+        for(const std::string& path : changed)
+            m_onChanged(path);
+    }
+}
+
+#else
+
+FileWatcher::FileWatcher(std::function<void(const std::string&)> onChanged)
+    : m_onChanged(std::move(onChanged))
+    , m_running(true)
+{
+    m_thread = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    m_running = false;
+    m_thread.join();
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_modificationTimes.emplace(path, time);
+}
+
+void FileWatcher::run()
+{
+    while(m_running)
+    {
+        std::this_thread::sleep_for(kWatchPollInterval);
+
+        std::vector<std::string> changed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for(auto& entry : m_modificationTimes)
+            {
+                std::error_code error;
+                std::filesystem::file_time_type time = std::filesystem::last_write_time(entry.first, error);
+                if(!error && time != entry.second)
+                {
+                    entry.second = time;
+                    changed.push_back(entry.first);
+                }
+            }
+        }
+
+        if(changed.empty())
+            continue;
+
+        std::this_thread::sleep_for(kWatchSettleTime);
+        for(const std::string& path : changed)
+            m_onChanged(path);
+    }
+}
+
+#endif
+
+}   // namespace gl
@@ -0,0 +1,65 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(__linux__)
+#include <filesystem>
+#endif
+
+namespace gl
+{
+
+// Watches a set of files from a background thread and calls back when one is
+// written. Uses inotify on Linux, watching the parent directories so editors
+// that save by writing a new file and renaming it are picked up too. Elsewhere
+// it falls back to polling modification times.
+class FileWatcher
+{
+public:
+    // onChanged is called on the watcher thread with the path exactly as it
+    // was passed to watch(). A burst of writes to one file is reported once.
+    explicit FileWatcher(std::function<void(const std::string&)> onChanged);
+
+    FileWatcher(const FileWatcher& rhs) = delete;
+    FileWatcher& operator=(const FileWatcher& rhs) = delete;
+
+    ~FileWatcher();
+
+    void watch(const std::string& path);
+
+private:
+    void run();
+
+    std::function<void(const std::string&)> m_onChanged;
+
+    std::mutex m_mutex;
+    std::atomic<bool> m_running;
+
+#if defined(__linux__)
+    struct WatchedFile
+    {
+        std::string fileName;
+        std::string path;
+    };
+
+    int m_inotify;
+    std::unordered_map<std::string, int> m_directoryWatches;
+    std::unordered_map<int, std::vector<WatchedFile>> m_watchedFiles;
+#else
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_modificationTimes;
+#endif
+
+    // Started last so everything above is initialised before it runs.
+    std::thread m_thread;
+};
+
+}   // namespace gl
+
+#endif
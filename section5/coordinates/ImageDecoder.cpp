@@ -0,0 +1,340 @@
+#include "ImageDecoder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "PixelPacking.h"
+#include "stb_image.h"
+
+namespace gl
+{
+
+// Everything handed out is aligned as malloc() would align it.
+constexpr size_t kArenaAlignment = alignof(std::max_align_t);
+
+static size_t alignArena(size_t size)
+{
+    return (size + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+}
+
+// The arena stb_image allocates from on this thread, if any.
+static thread_local ImageArena* s_currentArena = nullptr;
+
+// Makes an arena the current one for as long as it's in scope.
+class ImageArenaScope
+{
+public:
+    explicit ImageArenaScope(ImageArena& arena)
+        : m_previous(s_currentArena)
+    {
+        s_currentArena = &arena;
+    }
+
+    ~ImageArenaScope()
+    {
+        s_currentArena = m_previous;
+    }
+
+private:
+    ImageArena* m_previous;
+};
+
+ImageArena::ImageArena(size_t capacity)
+    : m_memory(capacity ? new unsigned char[alignArena(capacity)] : nullptr)
+    , m_capacity(capacity ? alignArena(capacity) : 0)
+    , m_used(0)
+    , m_last(0)
+    , m_spilledBytes(0)
+{
+}
+
+ImageArena::~ImageArena()
+{
+    for(void* pointer : m_spilled)
+        std::free(pointer);
+}
+
+bool ImageArena::owns(const void* pointer) const
+{
+    const unsigned char* bytes = (const unsigned char*)pointer;
+    return m_memory && bytes >= m_memory.get() && bytes < m_memory.get() + m_capacity;
+}
+
+void* ImageArena::allocate(size_t size)
+{
+    const size_t aligned = alignArena(size);
+    if(aligned <= m_capacity - m_used)
+    {
+        m_last = m_used;
+        m_used += aligned;
+        return m_memory.get() + m_last;
+    }
+
+    void* pointer = std::malloc(size);
+    if(pointer)
+    {
+        m_spilled.push_back(pointer);
+        m_spilledBytes += aligned;
+    }
+
+    return pointer;
+}
+
+void* ImageArena::reallocate(void* pointer, size_t oldSize, size_t newSize)
+{
+    if(!pointer)
+        return allocate(newSize);
+
+    if(owns(pointer))
+    {
+        // stb_image mostly grows the buffer it allocated last, which can
+        // happen in place.
+        const size_t aligned = alignArena(newSize);
+        if(pointer == m_memory.get() + m_last && aligned <= m_capacity - m_last)
+        {
+            m_used = m_last + aligned;
+            return pointer;
+        }
+
+        void* moved = allocate(newSize);
+        if(moved)
+            std::memcpy(moved, pointer, std::min(oldSize, newSize));
+        return moved;
+    }
+
+    auto spilled = std::find(m_spilled.begin(), m_spilled.end(), pointer);
+    void* moved = std::realloc(pointer, newSize);
+    if(moved && spilled != m_spilled.end())
+    {
+        *spilled = moved;
+        m_spilledBytes += alignArena(newSize);
+    }
+
+    return moved;
+}
+
+void ImageArena::release(void* pointer)
+{
+    if(!pointer)
+        return;
+
+    if(owns(pointer))
+    {
+        if(pointer == m_memory.get() + m_last)
+            m_used = m_last;
+        return;
+    }
+
+    auto spilled = std::find(m_spilled.begin(), m_spilled.end(), pointer);
+    if(spilled != m_spilled.end())
+        m_spilled.erase(spilled);
+    std::free(pointer);
+}
+
+void ImageArena::reset()
+{
+    for(void* pointer : m_spilled)
+        std::free(pointer);
+    m_spilled.clear();
+
+    if(m_spilledBytes)
+    {
+        m_capacity = alignArena(m_used + m_spilledBytes);
+        m_memory.reset(new unsigned char[m_capacity]);
+    }
+
+    m_used = 0;
+    m_last = 0;
+    m_spilledBytes = 0;
+}
+
+std::unique_ptr<ImageArena> ImageArenaPool::acquire()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_free.empty())
+        return std::unique_ptr<ImageArena>(new ImageArena());
+
+    std::unique_ptr<ImageArena> arena = std::move(m_free.back());
+    m_free.pop_back();
+    return arena;
+}
+
+void ImageArenaPool::release(std::unique_ptr<ImageArena> arena)
+{
+    if(!arena)
+        return;
+
+    arena->reset();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(std::move(arena));
+}
+
+static void flipRows(unsigned char* pixels, size_t rowSize, int height)
+{
+    for(int row = 0; row < height / 2; ++row)
+    {
+        unsigned char* top = pixels + row * rowSize;
+        unsigned char* bottom = pixels + (height - 1 - row) * rowSize;
+        std::swap_ranges(top, top + rowSize, bottom);
+    }
+}
+
+// HDR images decode to floats and 16-bit ones to 16-bit integers, either way
+// packed to half floats in place, where stb_image put them. With fullFloat
+// HDR images stay floats.
+static unsigned char* decodeHalf(const stbi_uc* data, int size, const ImageDecodeOptions& options,
+                                 ImageView& image, int& channels)
+{
+    image.type = ImageChannelType::Half;
+
+    if(stbi_is_hdr_from_memory(data, size))
+    {
+        float* pixels = stbi_loadf_from_memory(data, size, &image.width, &image.height, &channels, options.channels);
+        if(options.fullFloat)
+            image.type = ImageChannelType::Float;
+        else if(pixels)
+            packHalf(pixels, (uint16_t*)pixels, (size_t)image.width * image.height * (options.channels ? options.channels : channels));
+        return (unsigned char*)pixels;
+    }
+
+    stbi_us* pixels = stbi_load_16_from_memory(data, size, &image.width, &image.height, &channels, options.channels);
+    if(pixels)
+        packHalfUnorm16(pixels, pixels, (size_t)image.width * image.height * (options.channels ? options.channels : channels));
+    return (unsigned char*)pixels;
+}
+
+static bool decodeImage(const void* data, size_t size, const ImageDecodeOptions& options,
+                        ImageArena& arena, ImageView& image, const std::string& name)
+{
+    image = ImageView();
+
+    ImageArenaScope scope(arena);
+
+    int channels = 0;
+    unsigned char* pixels = nullptr;
+    if(options.highPrecision && (stbi_is_hdr_from_memory((const stbi_uc*)data, (int)size) ||
+                                 stbi_is_16_bit_from_memory((const stbi_uc*)data, (int)size)))
+        pixels = decodeHalf((const stbi_uc*)data, (int)size, options, image, channels);
+    else
+        pixels = stbi_load_from_memory_scaled((const stbi_uc*)data, (int)size, &image.width, &image.height,
+                                              &channels, options.channels, options.scale);
+    if(!pixels)
+    {
+        std::cerr << "ERROR::IMAGE_DECODER::DECODE_FAILED: " << name << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    image.channels = options.channels ? options.channels : channels;
+    image.pixels = pixels;
+
+    // Flipped here rather than with stbi_set_flip_vertically_on_load(), which
+    // changes it for every thread.
+    if(options.flipVertically)
+        flipRows(image.pixels, (size_t)image.width * image.channels * image.channelSize(), image.height);
+
+    return true;
+}
+
+bool ImageDecoder::decode(const void* data, size_t size, const ImageDecodeOptions& options,
+                          ImageArena& arena, ImageView& image)
+{
+    return decodeImage(data, size, options, arena, image, "<memory>");
+}
+
+bool ImageDecoder::decodeFile(const std::string& path, const ImageDecodeOptions& options,
+                              ImageArena& arena, ImageView& image)
+{
+    image = ImageView();
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file)
+    {
+        std::cerr << "ERROR::IMAGE_DECODER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    const size_t size = (size_t)file.tellg();
+    void* data = arena.allocate(size);
+    file.seekg(0);
+    if(!data || !file.read((char*)data, size))
+    {
+        std::cerr << "ERROR::IMAGE_DECODER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    return decodeImage(data, size, options, arena, image, path);
+}
+
+bool ImageDecoder::probeFile(const std::string& path, ImageView& image)
+{
+    image = ImageView();
+
+    // Opened once for all three checks, each reading the header from the
+    // start. stbi_is_hdr_from_file() doesn't seek back as the others do.
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if(!file)
+    {
+        std::cerr << "ERROR::IMAGE_DECODER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    const bool probed = stbi_info_from_file(file, &image.width, &image.height, &image.channels) != 0;
+    if(probed)
+    {
+        const bool hdr = stbi_is_hdr_from_file(file) != 0;
+        std::rewind(file);
+        if(hdr || stbi_is_16_bit_from_file(file))
+            image.type = ImageChannelType::Half;
+    }
+
+    std::fclose(file);
+
+    if(!probed)
+    {
+        std::cerr << "ERROR::IMAGE_DECODER::PROBE_FAILED: " << path << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageDecoder::probe(const void* data, size_t size, ImageView& image)
+{
+    image = ImageView();
+    const stbi_uc* buffer = (const stbi_uc*)data;
+    if(!stbi_info_from_memory(buffer, (int)size, &image.width, &image.height, &image.channels))
+    {
+        std::cerr << "ERROR::IMAGE_DECODER::PROBE_FAILED: " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    if(stbi_is_hdr_from_memory(buffer, (int)size) || stbi_is_16_bit_from_memory(buffer, (int)size))
+        image.type = ImageChannelType::Half;
+
+    return true;
+}
+
+void* imageArenaMalloc(size_t size)
+{
+    return s_currentArena ? s_currentArena->allocate(size) : std::malloc(size);
+}
+
+void* imageArenaRealloc(void* pointer, size_t oldSize, size_t newSize)
+{
+    return s_currentArena ? s_currentArena->reallocate(pointer, oldSize, newSize) : std::realloc(pointer, newSize);
+}
+
+void imageArenaFree(void* pointer)
+{
+    if(s_currentArena)
+        s_currentArena->release(pointer);
+    else
+        std::free(pointer);
+}
+
+}   // namespace gl
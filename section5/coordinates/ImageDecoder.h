@@ -0,0 +1,147 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace gl
+{
+
+// Bump allocator that stb_image allocates from while an ImageDecoder is
+// decoding into it, so a decode costs no heap traffic once the arena has
+// grown to fit. The decoded pixels live in the arena until reset(); reuse one
+// arena per in-flight image rather than freeing it.
+//
+// Allocations that don't fit spill to the heap and are released by reset().
+// Not thread-safe; an arena is used by one thread at a time.
+class ImageArena
+{
+public:
+    explicit ImageArena(size_t capacity = 0);
+
+    ImageArena(const ImageArena& rhs) = delete;
+    ImageArena& operator=(const ImageArena& rhs) = delete;
+
+    ~ImageArena();
+
+    void* allocate(size_t size);
+    void* reallocate(void* pointer, size_t oldSize, size_t newSize);
+
+    // Only the most recent allocation's space is reclaimed before reset().
+    void release(void* pointer);
+
+    // Drop everything allocated. If the last use spilled, the arena grows so
+    // it fits next time.
+    void reset();
+
+    size_t capacity() const { return m_capacity; }
+    size_t used() const { return m_used; }
+
+private:
+    bool owns(const void* pointer) const;
+
+    std::unique_ptr<unsigned char[]> m_memory;
+    size_t m_capacity;
+    size_t m_used;
+    size_t m_last;
+
+    std::vector<void*> m_spilled;
+    size_t m_spilledBytes;
+};
+
+struct ImageDecodeOptions
+{
+    // Make the first row the bottom of the image, as GL expects.
+    bool flipVertically = false;
+
+    // Convert to this many channels; 0 keeps the image's own.
+    int channels = 0;
+
+    // Decode a JPEG at 1/scale of its size, rounded up: 1, 2, 4 or 8. Only
+    // the low frequencies of each block are transformed, so it's much cheaper
+    // than decoding the whole image and shrinking it. Other formats ignore it.
+    int scale = 1;
+
+    // Keep HDR and 16-bit images' precision, as half floats, rather than
+    // reducing them to 8 bits. Check ImageView::type for which was decoded.
+    bool highPrecision = false;
+
+    // With highPrecision, leave HDR images as the 32-bit floats stbi_loadf
+    // gives rather than packing them to half floats, for processing that
+    // needs their whole range, like prefiltering an environment.
+    bool fullFloat = false;
+};
+
+// Arenas shared between threads decoding in parallel, so each decode reuses a
+// warm one instead of allocating its own. Thread-safe.
+class ImageArenaPool
+{
+public:
+    std::unique_ptr<ImageArena> acquire();
+
+    // Reset an arena and make it available again.
+    void release(std::unique_ptr<ImageArena> arena);
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<ImageArena>> m_free;
+};
+
+// What each channel of an ImageView is stored as.
+enum class ImageChannelType
+{
+    UInt8,
+    Half,   // 16-bit float, see PixelPacking.h
+    Float
+};
+
+// Pixels decoded into an ImageArena. Valid until the arena is reset; never
+// pass them to stbi_image_free().
+struct ImageView
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    ImageChannelType type = ImageChannelType::UInt8;
+    unsigned char* pixels = nullptr;
+
+    size_t channelSize() const { return type == ImageChannelType::Float ? 4 : type == ImageChannelType::Half ? 2 : 1; }
+    size_t size() const { return (size_t)width * height * channels * channelSize(); }
+};
+
+// Thread-safe front end over stb_image. Options are per call rather than
+// stb_image's process-wide settings, and every allocation, including the
+// result, comes from the caller's arena.
+class ImageDecoder
+{
+public:
+    // Decode an encoded image held in memory. Returns false, having logged
+    // why, if it isn't one stb_image supports.
+    static bool decode(const void* data, size_t size, const ImageDecodeOptions& options,
+                       ImageArena& arena, ImageView& image);
+
+    // Read the file at path into the arena and decode it.
+    static bool decodeFile(const std::string& path, const ImageDecodeOptions& options,
+                           ImageArena& arena, ImageView& image);
+
+    // Read just enough of the file at path to know the image's size, channels
+    // and, for HDR and 16-bit images, that decoding with highPrecision gives
+    // half floats, leaving image.pixels null. Much cheaper than decoding.
+    static bool probeFile(const std::string& path, ImageView& image);
+
+    // The same for an encoded image held in memory.
+    static bool probe(const void* data, size_t size, ImageView& image);
+};
+
+// stb_image's allocation hooks, see stb_image.cpp. They use the arena of the
+// decode in progress on the calling thread, or the heap outside of one.
+void* imageArenaMalloc(size_t size);
+void* imageArenaRealloc(void* pointer, size_t oldSize, size_t newSize);
+void imageArenaFree(void* pointer);
+
+}   // namespace gl
+
+#endif
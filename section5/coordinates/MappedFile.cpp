@@ -0,0 +1,71 @@
+#include "MappedFile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace gl
+{
+
+#if defined(__unix__) || defined(__APPLE__)
+
+MappedFile::MappedFile(const std::string& path)
+    : m_data(nullptr)
+    , m_size(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+
+    struct stat info;
+    if(fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped != MAP_FAILED)
+        {
+            m_data = mapped;
+            m_size = (size_t)info.st_size;
+        }
+    }
+
+    // The mapping keeps the file alive by itself.
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if(m_data)
+        munmap(const_cast<void*>(m_data), m_size);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+    : m_data(nullptr)
+    , m_size(0)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file)
+        return;
+
+    m_contents.resize((size_t)file.tellg());
+    file.seekg(0);
+    if(m_contents.empty() || !file.read(m_contents.data(), m_contents.size()))
+        return;
+
+    m_data = m_contents.data();
+    m_size = m_contents.size();
+}
+
+MappedFile::~MappedFile()
+{
+}
+
+#endif
+
+}   // namespace gl
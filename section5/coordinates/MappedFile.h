@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gl
+{
+
+// A file mapped read-only into memory for as long as this lives, so large
+// assets can be handed to GL without first being read into a buffer. Where
+// mmap() isn't available the file is read instead.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile& rhs) = delete;
+    MappedFile& operator=(const MappedFile& rhs) = delete;
+
+    ~MappedFile();
+
+    bool valid() const { return m_data != nullptr; }
+
+    const void* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const void* m_data;
+    size_t m_size;
+
+    // Contents when the file was read rather than mapped.
+    std::vector<char> m_contents;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef MATERIAL_FEATURES_GLSL
+#define MATERIAL_FEATURES_GLSL
+
+// Feature switches set per variant by gl::ShaderVariants. The defaults give
+// the full two texture material when a shader is built on its own.
+#ifndef FEATURE_TEXTURE0
+#define FEATURE_TEXTURE0 1
+#endif
+
+#ifndef FEATURE_TEXTURE1
+#define FEATURE_TEXTURE1 1
+#endif
+
+#ifndef FEATURE_VERTEX_COLOUR
+#define FEATURE_VERTEX_COLOUR 0
+#endif
+
+#ifndef FEATURE_TEXTURE_ARRAY
+#define FEATURE_TEXTURE_ARRAY 0
+#endif
+
+#endif
@@ -0,0 +1,585 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "CpuFeatures.h"
+#include "PixelPacking.h"
+#include "ThreadPool.h"
+
+#if defined(GL_SIMD_X86)
+#include <immintrin.h>
+#endif
+
+namespace gl
+{
+
+constexpr float kPi = 3.14159265358979f;
+
+// Kaiser window shape and the half-width of both windowed sincs, in texels
+// of the destination.
+constexpr float kKaiserAlpha = 4.0f;
+constexpr float kSincSupport = 3.0f;
+
+// Rows per tile handed to each thread.
+constexpr int kRowsPerTile = 16;
+
+// The largest finite half float.
+constexpr float kHalfMax = 65504.0f;
+
+static float sinc(float x)
+{
+    if(std::fabs(x) < 1e-5f)
+        return 1.0f;
+
+    x *= kPi;
+    return std::sin(x) / x;
+}
+
+// Modified Bessel function of the first kind, order zero.
+static float besselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    for(int k = 1; k < 32 && term > sum * 1e-8f; ++k)
+    {
+        const float factor = x / (2.0f * k);
+        term *= factor * factor;
+        sum += term;
+    }
+
+    return sum;
+}
+
+static float filterSupport(MipFilter filter)
+{
+    return filter == MipFilter::Box ? 0.5f : kSincSupport;
+}
+
+static float filterWeight(MipFilter filter, float x)
+{
+    switch(filter)
+    {
+    case MipFilter::Box:
+        return 1.0f;
+    case MipFilter::Kaiser:
+    {
+        const float t = x / kSincSupport;
+        return sinc(x) * besselI0(kKaiserAlpha * std::sqrt(std::max(0.0f, 1.0f - t * t))) / besselI0(kKaiserAlpha);
+    }
+    default:
+        return sinc(x) * sinc(x / kSincSupport);
+    }
+}
+
+// The source texels and weights making up each destination texel along one
+// axis. Every destination texel has the same number of taps so the kernels
+// don't branch; those past the filter's edge have no weight.
+struct FilterTaps
+{
+    int taps = 0;
+    std::vector<int> indices;
+    std::vector<float> weights;
+};
+
+static FilterTaps buildFilterTaps(MipFilter filter, int sourceSize, int destinationSize)
+{
+    // Shrinking stretches the filter over the source so it also band-limits;
+    // enlarging just interpolates.
+    const float scale = (float)sourceSize / destinationSize;
+    const float filterScale = std::max(1.0f, scale);
+    const float support = filterSupport(filter);
+    const float radius = support * filterScale;
+
+    FilterTaps taps;
+    taps.taps = (int)std::ceil(radius * 2.0f) + 1;
+    taps.indices.resize((size_t)destinationSize * taps.taps);
+    taps.weights.resize((size_t)destinationSize * taps.taps);
+
+    for(int i = 0; i < destinationSize; ++i)
+    {
+        const float centre = (i + 0.5f) * scale;
+        const int first = (int)std::floor(centre - radius);
+
+        int* indices = &taps.indices[(size_t)i * taps.taps];
+        float* weights = &taps.weights[(size_t)i * taps.taps];
+        float total = 0.0f;
+        for(int t = 0; t < taps.taps; ++t)
+        {
+            const float x = (first + t + 0.5f - centre) / filterScale;
+            indices[t] = std::min(sourceSize - 1, std::max(0, first + t));
+            weights[t] = std::fabs(x) < support ? filterWeight(filter, x) : 0.0f;
+            total += weights[t];
+        }
+
+        if(std::fabs(total) < 1e-6f)
+        {
+            // Nothing landed inside the filter; take the nearest texel.
+            std::fill(weights, weights + taps.taps, 0.0f);
+            indices[0] = std::min(sourceSize - 1, std::max(0, (int)centre));
+            weights[0] = 1.0f;
+            continue;
+        }
+
+        for(int t = 0; t < taps.taps; ++t)
+            weights[t] /= total;
+    }
+
+    return taps;
+}
+
+// Kernels over RGBA float texels. A horizontal pass filters one source row
+// into a row of destination width; a vertical pass sums taps whole rows of
+// that output into a destination row.
+
+using HorizontalKernel = void (*)(const float* source, float* destination, int width, const int* indices, const float* weights, int taps);
+using VerticalKernel = void (*)(const float* rows, size_t rowFloats, float* destination, const int* indices, const float* weights, int taps);
+
+static void horizontalScalar(const float* source, float* destination, int width, const int* indices, const float* weights, int taps)
+{
+    for(int x = 0; x < width; ++x, indices += taps, weights += taps)
+    {
+        float sum[4] = {};
+        for(int t = 0; t < taps; ++t)
+        {
+            const float* texel = source + (size_t)indices[t] * 4;
+            for(int c = 0; c < 4; ++c)
+                sum[c] += weights[t] * texel[c];
+        }
+
+        for(int c = 0; c < 4; ++c)
+            destination[(size_t)x * 4 + c] = sum[c];
+    }
+}
+
+static void verticalScalar(const float* rows, size_t rowFloats, float* destination, const int* indices, const float* weights, int taps)
+{
+    std::fill(destination, destination + rowFloats, 0.0f);
+    for(int t = 0; t < taps; ++t)
+    {
+        const float* row = rows + (size_t)indices[t] * rowFloats;
+        for(size_t i = 0; i < rowFloats; ++i)
+            destination[i] += weights[t] * row[i];
+    }
+}
+
+#if defined(GL_SIMD_X86)
+
+// One texel per SSE register.
+GL_TARGET_SSE2 static void horizontalSse2(const float* source, float* destination, int width, const int* indices, const float* weights, int taps)
+{
+    for(int x = 0; x < width; ++x, indices += taps, weights += taps)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for(int t = 0; t < taps; ++t)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(source + (size_t)indices[t] * 4)));
+
+        _mm_storeu_ps(destination + (size_t)x * 4, sum);
+    }
+}
+
+GL_TARGET_SSE2 static void verticalSse2(const float* rows, size_t rowFloats, float* destination, const int* indices, const float* weights, int taps)
+{
+    const float* first = rows + (size_t)indices[0] * rowFloats;
+    const __m128 firstWeight = _mm_set1_ps(weights[0]);
+    for(size_t i = 0; i < rowFloats; i += 4)
+        _mm_storeu_ps(destination + i, _mm_mul_ps(firstWeight, _mm_loadu_ps(first + i)));
+
+    for(int t = 1; t < taps; ++t)
+    {
+        const float* row = rows + (size_t)indices[t] * rowFloats;
+        const __m128 weight = _mm_set1_ps(weights[t]);
+        for(size_t i = 0; i < rowFloats; i += 4)
+            _mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(weight, _mm_loadu_ps(row + i))));
+    }
+}
+
+// Two destination texels per AVX register.
+GL_TARGET_AVX2 static void horizontalAvx2(const float* source, float* destination, int width, const int* indices, const float* weights, int taps)
+{
+    int x = 0;
+    for(; x + 1 < width; x += 2, indices += taps * 2, weights += taps * 2)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        for(int t = 0; t < taps; ++t)
+        {
+            const __m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(source + (size_t)indices[t] * 4)),
+                                                       _mm_loadu_ps(source + (size_t)indices[taps + t] * 4), 1);
+            const __m256 weight = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weights[t])),
+                                                       _mm_set1_ps(weights[taps + t]), 1);
+            sum = _mm256_fmadd_ps(weight, texels, sum);
+        }
+
+        _mm256_storeu_ps(destination + (size_t)x * 4, sum);
+    }
+
+    if(x < width)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for(int t = 0; t < taps; ++t)
+            sum = _mm_fmadd_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(source + (size_t)indices[t] * 4), sum);
+
+        _mm_storeu_ps(destination + (size_t)x * 4, sum);
+    }
+}
+
+GL_TARGET_AVX2 static void verticalAvx2(const float* rows, size_t rowFloats, float* destination, const int* indices, const float* weights, int taps)
+{
+    // Rows are whole texels, so a multiple of 4 floats; at most one half
+    // register is left over.
+    const size_t wide = rowFloats & ~(size_t)7;
+
+    const float* first = rows + (size_t)indices[0] * rowFloats;
+    const __m256 firstWeight = _mm256_set1_ps(weights[0]);
+    for(size_t i = 0; i < wide; i += 8)
+        _mm256_storeu_ps(destination + i, _mm256_mul_ps(firstWeight, _mm256_loadu_ps(first + i)));
+    if(wide < rowFloats)
+        _mm_storeu_ps(destination + wide, _mm_mul_ps(_mm256_castps256_ps128(firstWeight), _mm_loadu_ps(first + wide)));
+
+    for(int t = 1; t < taps; ++t)
+    {
+        const float* row = rows + (size_t)indices[t] * rowFloats;
+        const __m256 weight = _mm256_set1_ps(weights[t]);
+        for(size_t i = 0; i < wide; i += 8)
+            _mm256_storeu_ps(destination + i, _mm256_fmadd_ps(weight, _mm256_loadu_ps(row + i), _mm256_loadu_ps(destination + i)));
+        if(wide < rowFloats)
+            _mm_storeu_ps(destination + wide, _mm_fmadd_ps(_mm256_castps256_ps128(weight), _mm_loadu_ps(row + wide), _mm_loadu_ps(destination + wide)));
+    }
+}
+
+#endif
+
+struct ResampleKernels
+{
+    HorizontalKernel horizontal;
+    VerticalKernel vertical;
+};
+
+static ResampleKernels selectResampleKernels()
+{
+#if defined(GL_SIMD_X86)
+    if(cpuFeatures().avx2)
+        return {horizontalAvx2, verticalAvx2};
+    if(cpuFeatures().sse2)
+        return {horizontalSse2, verticalSse2};
+#endif
+    return {horizontalScalar, verticalScalar};
+}
+
+static const ResampleKernels& resampleKernels()
+{
+    static const ResampleKernels s_kernels = selectResampleKernels();
+    return s_kernels;
+}
+
+// sRGB conversion. Decoding is a lookup; encoding finds the first code whose
+// upper midpoint is above the value, which rounds exactly.
+struct SrgbTables
+{
+    float decode[256];
+    float thresholds[255];
+};
+
+static float srgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static const SrgbTables& srgbTables()
+{
+    static const SrgbTables s_tables = []()
+    {
+        SrgbTables tables;
+        for(int i = 0; i < 256; ++i)
+            tables.decode[i] = srgbToLinear(i / 255.0f);
+        for(int i = 0; i < 255; ++i)
+            tables.thresholds[i] = srgbToLinear((i + 0.5f) / 255.0f);
+        return tables;
+    }();
+
+    return s_tables;
+}
+
+static uint8_t linearToSrgb(const SrgbTables& tables, float value)
+{
+    return (uint8_t)(std::upper_bound(tables.thresholds, tables.thresholds + 255, value) - tables.thresholds);
+}
+
+// Whether channel holds sRGB-encoded colour rather than alpha.
+static bool srgbChannel(const MipOptions& options, int channel, int channels)
+{
+    return options.srgb && !(channel == channels - 1 && (channels == 2 || channels == 4));
+}
+
+static void forEachTile(ThreadPool* pool, int rows, const std::function<void(int, int)>& body)
+{
+    const int tiles = (rows + kRowsPerTile - 1) / kRowsPerTile;
+    auto tile = [rows, &body](size_t i)
+    {
+        const int first = (int)i * kRowsPerTile;
+        body(first, std::min(rows, first + kRowsPerTile));
+    };
+
+    if(pool && tiles > 1)
+    {
+        pool->parallelFor((size_t)tiles, tile);
+        return;
+    }
+
+    for(int i = 0; i < tiles; ++i)
+        tile((size_t)i);
+}
+
+static std::vector<float> loadLinear(const uint8_t* pixels, int width, int height, int channels,
+                                     const MipOptions& options, ThreadPool* pool)
+{
+    const SrgbTables& tables = srgbTables();
+    std::vector<float> image((size_t)width * height * 4, 0.0f);
+    forEachTile(pool, height, [&](int first, int last)
+    {
+        for(size_t i = (size_t)first * width; i < (size_t)last * width; ++i)
+        {
+            for(int c = 0; c < channels; ++c)
+            {
+                const uint8_t value = pixels[i * channels + c];
+                image[i * 4 + c] = srgbChannel(options, c, channels) ? tables.decode[value] : value / 255.0f;
+            }
+        }
+    });
+
+    return image;
+}
+
+static void storeLinear(const std::vector<float>& image, int width, int height, int channels,
+                        const MipOptions& options, uint8_t* pixels, ThreadPool* pool)
+{
+    const SrgbTables& tables = srgbTables();
+    forEachTile(pool, height, [&](int first, int last)
+    {
+        for(size_t i = (size_t)first * width; i < (size_t)last * width; ++i)
+        {
+            for(int c = 0; c < channels; ++c)
+            {
+                // Sharpening filters overshoot a little either side.
+                const float value = std::min(1.0f, std::max(0.0f, image[i * 4 + c]));
+                pixels[i * channels + c] = srgbChannel(options, c, channels) ? linearToSrgb(tables, value)
+                                                                             : (uint8_t)(value * 255.0f + 0.5f);
+            }
+        }
+    });
+}
+
+static std::vector<float> resampleLinear(const std::vector<float>& source, int width, int height,
+                                         int newWidth, int newHeight, MipFilter filter, ThreadPool* pool)
+{
+    const ResampleKernels& kernels = resampleKernels();
+    const FilterTaps horizontal = buildFilterTaps(filter, width, newWidth);
+    const FilterTaps vertical = buildFilterTaps(filter, height, newHeight);
+    const size_t rowFloats = (size_t)newWidth * 4;
+
+    std::vector<float> rows(rowFloats * height);
+    forEachTile(pool, height, [&](int first, int last)
+    {
+        for(int y = first; y < last; ++y)
+        {
+            kernels.horizontal(&source[(size_t)y * width * 4], &rows[y * rowFloats], newWidth,
+                               horizontal.indices.data(), horizontal.weights.data(), horizontal.taps);
+        }
+    });
+
+    std::vector<float> destination(rowFloats * newHeight);
+    forEachTile(pool, newHeight, [&](int first, int last)
+    {
+        for(int y = first; y < last; ++y)
+        {
+            kernels.vertical(rows.data(), rowFloats, &destination[y * rowFloats],
+                             &vertical.indices[(size_t)y * vertical.taps], &vertical.weights[(size_t)y * vertical.taps], vertical.taps);
+        }
+    });
+
+    return destination;
+}
+
+// Unpack a row of half texels into RGBA floats. Channels the row doesn't
+// have are left as they are in row.
+static void loadHalfRow(const uint16_t* pixels, int width, int channels, float* row, std::vector<float>& values)
+{
+    if(channels == 4)
+    {
+        unpackHalf(pixels, row, (size_t)width * 4);
+        return;
+    }
+
+    values.resize((size_t)width * channels);
+    unpackHalf(pixels, values.data(), values.size());
+    for(int x = 0; x < width; ++x)
+    {
+        for(int c = 0; c < channels; ++c)
+            row[(size_t)x * 4 + c] = values[(size_t)x * channels + c];
+    }
+}
+
+static void storeHalfRow(const float* row, int width, int channels, uint16_t* pixels, std::vector<float>& values)
+{
+    values.resize((size_t)width * channels);
+    for(int x = 0; x < width; ++x)
+    {
+        for(int c = 0; c < channels; ++c)
+        {
+            // Sharpening filters overshoot, below 0 even on positive images.
+            const bool alpha = c == channels - 1 && (channels == 2 || channels == 4);
+            values[(size_t)x * channels + c] = std::min(alpha ? 1.0f : kHalfMax, std::max(0.0f, row[(size_t)x * 4 + c]));
+        }
+    }
+
+    packHalf(values.data(), pixels, values.size());
+}
+
+// resampleLinear() for half texels, a tile of destination rows at a time:
+// each tile filters just the source rows its taps reach and packs its rows
+// straight back to halves. Only a tile's rows are ever held as floats, not
+// the image, at the cost of filtering the source rows tiles share twice.
+static void resampleHalf(const uint16_t* source, int width, int height, int channels,
+                         uint16_t* destination, int newWidth, int newHeight, MipFilter filter, ThreadPool* pool)
+{
+    const ResampleKernels& kernels = resampleKernels();
+    const FilterTaps horizontal = buildFilterTaps(filter, width, newWidth);
+    const FilterTaps vertical = buildFilterTaps(filter, height, newHeight);
+    const size_t rowFloats = (size_t)newWidth * 4;
+
+    forEachTile(pool, newHeight, [&](int first, int last)
+    {
+        const int* tileIndices = &vertical.indices[(size_t)first * vertical.taps];
+        const size_t tileTaps = (size_t)(last - first) * vertical.taps;
+        const int firstRow = *std::min_element(tileIndices, tileIndices + tileTaps);
+        const int lastRow = *std::max_element(tileIndices, tileIndices + tileTaps) + 1;
+
+        std::vector<float> values;
+        std::vector<float> sourceRow((size_t)width * 4, 0.0f);
+        std::vector<float> rows(rowFloats * (lastRow - firstRow));
+        for(int y = firstRow; y < lastRow; ++y)
+        {
+            loadHalfRow(source + (size_t)y * width * channels, width, channels, sourceRow.data(), values);
+            kernels.horizontal(sourceRow.data(), &rows[(y - firstRow) * rowFloats], newWidth,
+                               horizontal.indices.data(), horizontal.weights.data(), horizontal.taps);
+        }
+
+        // The taps as rows of this tile rather than of the source.
+        std::vector<int> indices(tileIndices, tileIndices + tileTaps);
+        for(int& index : indices)
+            index -= firstRow;
+
+        std::vector<float> row(rowFloats);
+        for(int y = first; y < last; ++y)
+        {
+            kernels.vertical(rows.data(), rowFloats, row.data(), &indices[(size_t)(y - first) * vertical.taps],
+                             &vertical.weights[(size_t)y * vertical.taps], vertical.taps);
+            storeHalfRow(row.data(), newWidth, channels, destination + (size_t)y * newWidth * channels, values);
+        }
+    });
+}
+
+int mipLevelCount(int width, int height)
+{
+    int levels = 1;
+    for(int size = std::max(width, height); size > 1; size /= 2)
+        ++levels;
+
+    return levels;
+}
+
+void mipLevelDimensions(int level, int width, int height, int& levelWidth, int& levelHeight)
+{
+    levelWidth = std::max(1, width >> level);
+    levelHeight = std::max(1, height >> level);
+}
+
+size_t mipChainSize(int width, int height, int texelSize)
+{
+    size_t size = 0;
+    for(int level = 1; level < mipLevelCount(width, height); ++level)
+    {
+        int levelWidth = 0;
+        int levelHeight = 0;
+        mipLevelDimensions(level, width, height, levelWidth, levelHeight);
+        size += (size_t)levelWidth * levelHeight * texelSize;
+    }
+
+    return size;
+}
+
+void generateMips(const uint8_t* level0, int width, int height, int channels, const MipOptions& options,
+                  uint8_t* levels, ThreadPool* pool)
+{
+    std::vector<float> current = loadLinear(level0, width, height, channels, options, pool);
+
+    const int levelCount = mipLevelCount(width, height);
+    for(int level = 1; level < levelCount; ++level)
+    {
+        int levelWidth = 0;
+        int levelHeight = 0;
+        mipLevelDimensions(level, width, height, levelWidth, levelHeight);
+
+        int aboveWidth = 0;
+        int aboveHeight = 0;
+        mipLevelDimensions(level - 1, width, height, aboveWidth, aboveHeight);
+
+        current = resampleLinear(current, aboveWidth, aboveHeight, levelWidth, levelHeight, options.filter, pool);
+        storeLinear(current, levelWidth, levelHeight, channels, options, levels, pool);
+        levels += (size_t)levelWidth * levelHeight * channels;
+    }
+}
+
+std::vector<uint8_t> resampleImage(const uint8_t* pixels, int width, int height, int channels,
+                                   int newWidth, int newHeight, const MipOptions& options, ThreadPool* pool)
+{
+    const std::vector<float> source = loadLinear(pixels, width, height, channels, options, pool);
+    const std::vector<float> resampled = resampleLinear(source, width, height, newWidth, newHeight, options.filter, pool);
+
+    std::vector<uint8_t> result((size_t)newWidth * newHeight * channels);
+    storeLinear(resampled, newWidth, newHeight, channels, options, result.data(), pool);
+    return result;
+}
+
+void generateMipsHalf(const uint16_t* level0, int width, int height, int channels, const MipOptions& options,
+                      uint16_t* levels, ThreadPool* pool)
+{
+    const uint16_t* above = level0;
+    const int levelCount = mipLevelCount(width, height);
+    for(int level = 1; level < levelCount; ++level)
+    {
+        int levelWidth = 0;
+        int levelHeight = 0;
+        mipLevelDimensions(level, width, height, levelWidth, levelHeight);
+
+        int aboveWidth = 0;
+        int aboveHeight = 0;
+        mipLevelDimensions(level - 1, width, height, aboveWidth, aboveHeight);
+
+        resampleHalf(above, aboveWidth, aboveHeight, channels, levels, levelWidth, levelHeight, options.filter, pool);
+        above = levels;
+        levels += (size_t)levelWidth * levelHeight * channels;
+    }
+}
+
+std::vector<uint16_t> resampleImageHalf(const uint16_t* pixels, int width, int height, int channels,
+                                        int newWidth, int newHeight, const MipOptions& options, ThreadPool* pool)
+{
+    std::vector<uint16_t> result((size_t)newWidth * newHeight * channels);
+    resampleHalf(pixels, width, height, channels, result.data(), newWidth, newHeight, options.filter, pool);
+    return result;
+}
+
+bool fitDimensions(int& width, int& height, int maxDimension)
+{
+    if(maxDimension <= 0 || (width <= maxDimension && height <= maxDimension))
+        return false;
+
+    const double scale = (double)maxDimension / std::max(width, height);
+    width = std::max(1, std::min(maxDimension, (int)(width * scale + 0.5)));
+    height = std::max(1, std::min(maxDimension, (int)(height * scale + 0.5)));
+    return true;
+}
+
+}   // namespace gl
@@ -0,0 +1,67 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gl
+{
+
+class ThreadPool;
+
+enum class MipFilter
+{
+    Box,        // 2x2 average, what glGenerateMipmap usually gives
+    Kaiser,     // Kaiser-windowed sinc; sharp with little ringing
+    Lanczos3    // sharper still, rings a little more
+};
+
+struct MipOptions
+{
+    MipFilter filter = MipFilter::Kaiser;
+
+    // Colour channels are sRGB encoded, so filter them in linear space and
+    // encode the results again. Alpha is always linear.
+    bool srgb = false;
+};
+
+// Levels in a full chain for width x height, down to 1x1, level 0 included.
+int mipLevelCount(int width, int height);
+
+// Size of level of a width x height image.
+void mipLevelDimensions(int level, int width, int height, int& levelWidth, int& levelHeight);
+
+// Bytes in levels 1 and below of a width x height image whose texels are
+// texelSize bytes.
+size_t mipChainSize(int width, int height, int texelSize);
+
+// Fill levels, mipChainSize() bytes, with every level below level0 down to
+// 1x1, each following the one before without row padding. Each level is
+// filtered from the full-precision one above, in tiles spread over pool if
+// given. channels is 1 to 4; with 2 or 4 the last one is alpha.
+void generateMips(const uint8_t* level0, int width, int height, int channels, const MipOptions& options,
+                  uint8_t* levels, ThreadPool* pool = nullptr);
+
+// Resample an image to newWidth x newHeight with the filter in options.
+std::vector<uint8_t> resampleImage(const uint8_t* pixels, int width, int height, int channels,
+                                   int newWidth, int newHeight, const MipOptions& options, ThreadPool* pool = nullptr);
+
+// The same for half float channels, see PixelPacking.h. They're linear, so
+// options.srgb is ignored. Colour is kept within 0..65504, the largest half,
+// and alpha within 0..1. levels is mipChainSize(width, height, channels * 2)
+// bytes. Each level is filtered from the half level above, a tile of rows at
+// a time, so only a tile's rows are ever unpacked to floats.
+void generateMipsHalf(const uint16_t* level0, int width, int height, int channels, const MipOptions& options,
+                      uint16_t* levels, ThreadPool* pool = nullptr);
+
+std::vector<uint16_t> resampleImageHalf(const uint16_t* pixels, int width, int height, int channels,
+                                        int newWidth, int newHeight, const MipOptions& options, ThreadPool* pool = nullptr);
+
+// Shrink width and height, keeping their ratio, so neither is more than
+// maxDimension. Returns false if they already fit or maxDimension is 0.
+bool fitDimensions(int& width, int& height, int maxDimension);
+
+}   // namespace gl
+
+#endif
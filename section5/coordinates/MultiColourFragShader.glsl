@@ -1,15 +1,38 @@
 #version 330 core
-out vec4 color;
 
-uniform vec4 ourColor;
+#include "SpirvCompat.glsl"
+#include "MaterialFeatures.glsl"
 
-uniform float mixLevel;
+VARYING_LOCATION(0) out vec4 color;
 
-in vec4 vertexColor; // this is linked to the output from above..
-in vec2 texCoords;
+UNIFORM_LOCATION(1) uniform vec4 ourColor;
 
-uniform sampler2D ourTexture;
-uniform sampler2D ourTexture2;
+UNIFORM_LOCATION(0) uniform float mixLevel;
+
+#if FEATURE_VERTEX_COLOUR
+VARYING_LOCATION(0) in vec4 vertexColor; // this is linked to the output from above..
+#endif
+VARYING_LOCATION(1) in vec2 texCoords;
+
+#if FEATURE_TEXTURE_ARRAY
+// Both textures are layers of one array, so drawing binds nothing.
+UNIFORM_LOCATION(2) uniform sampler2DArray ourTextures;
+UNIFORM_LOCATION(3) uniform int ourTextureLayer;
+UNIFORM_LOCATION(5) uniform int ourTexture2Layer;
+
+#define SAMPLE_TEXTURE0(uv) texture(ourTextures, vec3(uv, ourTextureLayer))
+#define SAMPLE_TEXTURE1(uv) texture(ourTextures, vec3(uv, ourTexture2Layer))
+#else
+#if FEATURE_TEXTURE0
+UNIFORM_LOCATION(2) uniform sampler2D ourTexture;
+#endif
+#if FEATURE_TEXTURE1
+UNIFORM_LOCATION(3) uniform sampler2D ourTexture2;
+#endif
+
+#define SAMPLE_TEXTURE0(uv) texture(ourTexture, uv)
+#define SAMPLE_TEXTURE1(uv) texture(ourTexture2, uv)
+#endif
 
 void main()
 {
@@ -20,6 +43,19 @@ void main()
     // Cause wrapping.
     // flippedTexCoords *= 2.0f;
 
-    color = mix(texture(ourTexture, texCoords), texture(ourTexture2, flippedTexCoords), mixLevel);
-    //color = texture(ourTexture2, texCoords) * vec4(vertexColor);
+    // Only mix when both textures are in use; a single texture variant
+    // samples once.
+#if FEATURE_TEXTURE0 && FEATURE_TEXTURE1
+    color = mix(SAMPLE_TEXTURE0(texCoords), SAMPLE_TEXTURE1(flippedTexCoords), mixLevel);
+#elif FEATURE_TEXTURE0
+    color = SAMPLE_TEXTURE0(texCoords);
+#elif FEATURE_TEXTURE1
+    color = SAMPLE_TEXTURE1(flippedTexCoords);
+#else
+    color = vec4(1.0);
+#endif
+
+#if FEATURE_VERTEX_COLOUR
+    color *= vertexColor;
+#endif
 }
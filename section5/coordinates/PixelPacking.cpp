@@ -0,0 +1,285 @@
+#include "PixelPacking.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+#include "CpuFeatures.h"
+
+#if defined(GL_SIMD_X86)
+#include <immintrin.h>
+#endif
+
+namespace gl
+{
+
+// Largest value GL_RGB9_E5 holds: 511/512 * 2^16.
+constexpr float kRgb9e5Max = 65408.0f;
+
+// Texels converted to floats at a time on the way to GL_RGB9_E5.
+constexpr size_t kRgb9e5Chunk = 64;
+
+// The scalar kernels go through memcpy so they're safe in place, where
+// source and destination are the same memory as different types.
+
+static void packHalfScalar(const float* source, uint16_t* destination, size_t count)
+{
+    for(size_t i = 0; i < count; ++i)
+    {
+        float value;
+        std::memcpy(&value, source + i, sizeof(value));
+        const uint16_t half = glm::packHalf1x16(value);
+        std::memcpy(destination + i, &half, sizeof(half));
+    }
+}
+
+static void unpackHalfScalar(const uint16_t* source, float* destination, size_t count)
+{
+    for(size_t i = 0; i < count; ++i)
+        destination[i] = glm::unpackHalf1x16(source[i]);
+}
+
+static void packHalfUnorm16Scalar(const uint16_t* source, uint16_t* destination, size_t count)
+{
+    for(size_t i = 0; i < count; ++i)
+        destination[i] = glm::packHalf1x16(source[i] * (1.0f / 65535.0f));
+}
+
+// Following the EXT_texture_shared_exponent spec, with floor(log2()) taken
+// from the float's exponent bits.
+static uint32_t packRgb9e5Texel(float red, float green, float blue)
+{
+    // Written so NaNs become 0 too.
+    red = std::min(red > 0.0f ? red : 0.0f, kRgb9e5Max);
+    green = std::min(green > 0.0f ? green : 0.0f, kRgb9e5Max);
+    blue = std::min(blue > 0.0f ? blue : 0.0f, kRgb9e5Max);
+
+    const float maxValue = std::max(red, std::max(green, blue));
+    uint32_t bits;
+    std::memcpy(&bits, &maxValue, sizeof(bits));
+    int exponent = std::max(-16, (int)(bits >> 23) - 127) + 16;
+
+    // 2^(24 - exponent), one over the size of a mantissa step.
+    uint32_t scaleBits = (uint32_t)(151 - exponent) << 23;
+    float scale;
+    std::memcpy(&scale, &scaleBits, sizeof(scale));
+
+    // Rounding the largest up to 512 needs the next exponent.
+    if((uint32_t)(maxValue * scale + 0.5f) == 512)
+    {
+        ++exponent;
+        scale *= 0.5f;
+    }
+
+    return (uint32_t)(red * scale + 0.5f) | (uint32_t)(green * scale + 0.5f) << 9 |
+           (uint32_t)(blue * scale + 0.5f) << 18 | (uint32_t)exponent << 27;
+}
+
+static void packRgb9e5Scalar(const float* rgba, uint32_t* destination, size_t texels)
+{
+    for(size_t i = 0; i < texels; ++i)
+        destination[i] = packRgb9e5Texel(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+}
+
+#if defined(GL_SIMD_X86)
+
+GL_TARGET_SSE2 static __m128i selectBits(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// glm's float to half conversion, four at a time, leaving each half in the
+// low bits of its lane. F16C would be quicker, but rounds ties to even where
+// glm rounds them up.
+GL_TARGET_SSE2 static __m128i halfFromFloatSse2(__m128 value)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i roundBit = _mm_set1_epi32(0x1000);
+    const __m128i bits = _mm_castps_si128(value);
+    const __m128i sign = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+    const __m128i exponent = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff)), _mm_set1_epi32(127 - 15));
+    const __m128i mantissa = _mm_and_si128(bits, _mm_set1_epi32(0x7fffff));
+
+    // Rounding can carry into the exponent, which past 30 is infinity.
+    __m128i normal = _mm_or_si128(_mm_slli_epi32(exponent, 23), mantissa);
+    normal = _mm_add_epi32(normal, _mm_slli_epi32(_mm_and_si128(mantissa, roundBit), 1));
+    const __m128i overflow = _mm_cmpgt_epi32(_mm_srli_epi32(normal, 23), _mm_set1_epi32(30));
+    normal = selectBits(overflow, _mm_set1_epi32(0x7c00), _mm_srli_epi32(normal, 13));
+
+    // The implicit 1 shifted right by 1 - exponent, which SSE2 can't do per
+    // lane, so it's a multiply by 2^(exponent - 1) instead. Exact, as the
+    // mantissa fits a float.
+    const __m128 shift = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(126)), 23));
+    __m128i denormal = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_or_si128(mantissa, _mm_set1_epi32(0x800000))), shift));
+    denormal = _mm_add_epi32(denormal, _mm_slli_epi32(_mm_and_si128(denormal, roundBit), 1));
+    denormal = _mm_srli_epi32(denormal, 13);
+
+    // Infinity, or a NaN that keeps at least one mantissa bit.
+    const __m128i top = _mm_srli_epi32(mantissa, 13);
+    const __m128i lost = _mm_andnot_si128(_mm_cmpeq_epi32(mantissa, zero), _mm_cmpeq_epi32(top, zero));
+    const __m128i special = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_or_si128(top, _mm_and_si128(lost, _mm_set1_epi32(1))));
+
+    const __m128i isSpecial = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0xff - (127 - 15)));
+    const __m128i isNormal = _mm_andnot_si128(isSpecial, _mm_cmpgt_epi32(exponent, zero));
+    const __m128i isDenormal = _mm_andnot_si128(_mm_cmpgt_epi32(exponent, zero), _mm_cmpgt_epi32(exponent, _mm_set1_epi32(-11)));
+
+    __m128i half = _mm_and_si128(isNormal, normal);
+    half = _mm_or_si128(half, _mm_and_si128(isDenormal, denormal));
+    half = _mm_or_si128(half, _mm_and_si128(isSpecial, special));
+    return _mm_or_si128(sign, half);
+}
+
+// Eight 16-bit values from the low halves of two registers' lanes.
+GL_TARGET_SSE2 static __m128i packLowHalves(__m128i low, __m128i high)
+{
+    // Sign extended so the saturating pack leaves them as they are.
+    low = _mm_srai_epi32(_mm_slli_epi32(low, 16), 16);
+    high = _mm_srai_epi32(_mm_slli_epi32(high, 16), 16);
+    return _mm_packs_epi32(low, high);
+}
+
+GL_TARGET_SSE2 static void packHalfSse2(const float* source, uint16_t* destination, size_t count)
+{
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m128i low = halfFromFloatSse2(_mm_loadu_ps(source + i));
+        const __m128i high = halfFromFloatSse2(_mm_loadu_ps(source + i + 4));
+        _mm_storeu_si128((__m128i*)(destination + i), packLowHalves(low, high));
+    }
+
+    packHalfScalar(source + i, destination + i, count - i);
+}
+
+GL_TARGET_SSE2 static void packHalfUnorm16Sse2(const uint16_t* source, uint16_t* destination, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 65535.0f);
+
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m128i values = _mm_loadu_si128((const __m128i*)(source + i));
+        const __m128 low = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero)), scale);
+        const __m128 high = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero)), scale);
+        _mm_storeu_si128((__m128i*)(destination + i), packLowHalves(halfFromFloatSse2(low), halfFromFloatSse2(high)));
+    }
+
+    packHalfUnorm16Scalar(source + i, destination + i, count - i);
+}
+
+// Four texels at a time, transposed so each channel has a register.
+GL_TARGET_SSE2 static void packRgb9e5Sse2(const float* rgba, uint32_t* destination, size_t texels)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxValue = _mm_set1_ps(kRgb9e5Max);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    size_t i = 0;
+    for(; i + 4 <= texels; i += 4)
+    {
+        __m128 red = _mm_loadu_ps(rgba + i * 4);
+        __m128 green = _mm_loadu_ps(rgba + i * 4 + 4);
+        __m128 blue = _mm_loadu_ps(rgba + i * 4 + 8);
+        __m128 alpha = _mm_loadu_ps(rgba + i * 4 + 12);
+        _MM_TRANSPOSE4_PS(red, green, blue, alpha);
+
+        // max() returns its second operand for a NaN.
+        red = _mm_min_ps(_mm_max_ps(red, zero), maxValue);
+        green = _mm_min_ps(_mm_max_ps(green, zero), maxValue);
+        blue = _mm_min_ps(_mm_max_ps(blue, zero), maxValue);
+
+        const __m128 largest = _mm_max_ps(red, _mm_max_ps(green, blue));
+        __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(largest), 23), _mm_set1_epi32(127));
+        const __m128i tooSmall = _mm_cmplt_epi32(exponent, _mm_set1_epi32(-16));
+        exponent = _mm_add_epi32(selectBits(tooSmall, _mm_set1_epi32(-16), exponent), _mm_set1_epi32(16));
+
+        __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(151), exponent), 23));
+        const __m128i largestMantissa = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(largest, scale), half));
+        const __m128i roundedUp = _mm_cmpeq_epi32(largestMantissa, _mm_set1_epi32(512));
+        exponent = _mm_sub_epi32(exponent, roundedUp);
+        scale = _mm_mul_ps(scale, _mm_castsi128_ps(selectBits(roundedUp, _mm_castps_si128(half), _mm_castps_si128(_mm_set1_ps(1.0f)))));
+
+        __m128i packed = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(red, scale), half));
+        packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(green, scale), half)), 9));
+        packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(blue, scale), half)), 18));
+        packed = _mm_or_si128(packed, _mm_slli_epi32(exponent, 27));
+        _mm_storeu_si128((__m128i*)(destination + i), packed);
+    }
+
+    packRgb9e5Scalar(rgba + i * 4, destination + i, texels - i);
+}
+
+// Converting from half is exact, so F16C gives the same bits as glm.
+GL_TARGET_F16C static void unpackHalfF16c(const uint16_t* source, float* destination, size_t count)
+{
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(destination + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(source + i))));
+
+    unpackHalfScalar(source + i, destination + i, count - i);
+}
+
+#endif
+
+struct PackingKernels
+{
+    void (*packHalf)(const float* source, uint16_t* destination, size_t count);
+    void (*unpackHalf)(const uint16_t* source, float* destination, size_t count);
+    void (*packHalfUnorm16)(const uint16_t* source, uint16_t* destination, size_t count);
+    void (*packRgb9e5)(const float* rgba, uint32_t* destination, size_t texels);
+};
+
+static PackingKernels selectPackingKernels()
+{
+    PackingKernels kernels = {packHalfScalar, unpackHalfScalar, packHalfUnorm16Scalar, packRgb9e5Scalar};
+#if defined(GL_SIMD_X86)
+    if(cpuFeatures().sse2)
+    {
+        kernels.packHalf = packHalfSse2;
+        kernels.packHalfUnorm16 = packHalfUnorm16Sse2;
+        kernels.packRgb9e5 = packRgb9e5Sse2;
+    }
+    if(cpuFeatures().f16c)
+        kernels.unpackHalf = unpackHalfF16c;
+#endif
+    return kernels;
+}
+
+static const PackingKernels& packingKernels()
+{
+    static const PackingKernels s_kernels = selectPackingKernels();
+    return s_kernels;
+}
+
+void packHalf(const float* source, uint16_t* destination, size_t count)
+{
+    packingKernels().packHalf(source, destination, count);
+}
+
+void unpackHalf(const uint16_t* source, float* destination, size_t count)
+{
+    packingKernels().unpackHalf(source, destination, count);
+}
+
+void packHalfUnorm16(const uint16_t* source, uint16_t* destination, size_t count)
+{
+    packingKernels().packHalfUnorm16(source, destination, count);
+}
+
+void packRgb9e5(const uint16_t* source, uint32_t* destination, size_t texels)
+{
+    // A chunk is read whole before any of it is written, which is what makes
+    // this safe in place.
+    const PackingKernels& kernels = packingKernels();
+    float rgba[kRgb9e5Chunk * 4];
+    for(size_t first = 0; first < texels; first += kRgb9e5Chunk)
+    {
+        const size_t count = std::min(kRgb9e5Chunk, texels - first);
+        kernels.unpackHalf(source + first * 4, rgba, count * 4);
+        kernels.packRgb9e5(rgba, destination + first, count);
+    }
+}
+
+}   // namespace gl
@@ -0,0 +1,34 @@
+#ifndef PIXEL_PACKING_H
+#define PIXEL_PACKING_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gl
+{
+
+// Conversions into the packed formats HDR and 16-bit images are stored in,
+// GL_RGBA16F and GL_RGB9_E5, so they never take 32-bit floats' memory on the
+// CPU or GPU. Each picks SIMD kernels for the CPU at runtime, and gives the
+// same bits as the scalar ones on every CPU.
+//
+// Packing can be done in place: destination may be source, since every
+// value is read before anything is written over it.
+
+// Convert count floats to half floats, rounding as glm::packHalf does.
+void packHalf(const float* source, uint16_t* destination, size_t count);
+
+// And back again.
+void unpackHalf(const uint16_t* source, float* destination, size_t count);
+
+// Convert count 16-bit unsigned normalized values to half floats in 0..1.
+void packHalfUnorm16(const uint16_t* source, uint16_t* destination, size_t count);
+
+// Convert RGBA half float texels to GL_RGB9_E5's three 9-bit mantissas
+// sharing a 5-bit exponent, dropping alpha. Negative values and NaNs become
+// 0, and those too large for the format its largest value, 65408.
+void packRgb9e5(const uint16_t* source, uint32_t* destination, size_t texels);
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,174 @@
+#include "ProgramCache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "StringHash.h"
+
+namespace gl
+{
+
+// "GLPB" followed by the layout version of the header below.
+constexpr uint32_t kProgramCacheMagic = 0x42504c47;
+constexpr uint32_t kProgramCacheVersion = 1;
+
+struct ProgramCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+// Chain a string into a running hash with a terminator so "ab" + "c" and
+// "a" + "bc" don't collide.
+static uint64_t hashField(std::string_view field, uint64_t hash)
+{
+    return hashString(std::string_view("\0", 1), hashString(field, hash));
+}
+
+static std::string_view glString(GLenum name)
+{
+    const GLubyte* str = glGetString(name);
+    return str ? std::string_view(reinterpret_cast<const char*>(str)) : std::string_view();
+}
+
+ProgramCache::ProgramCache(const std::string& directory)
+    : m_directory(directory)
+    , m_driverHash(0)
+    , m_enabled(false)
+    , m_hits(0)
+    , m_misses(0)
+{
+    if(!GLEW_ARB_get_program_binary)
+        return;
+
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if(numFormats <= 0)
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if(error)
+    {
+        std::cerr << "ERROR::PROGRAM_CACHE::DIRECTORY: " << m_directory << ": " << error.message() << std::endl;
+        return;
+    }
+
+    m_driverHash = hashField(glString(GL_VENDOR), hashString(""));
+    m_driverHash = hashField(glString(GL_RENDERER), m_driverHash);
+    m_driverHash = hashField(glString(GL_VERSION), m_driverHash);
+    m_enabled = true;
+}
+
+uint64_t ProgramCache::key(std::string_view vertexSource, std::string_view fragmentSource, std::string_view defines) const
+{
+    uint64_t hash = hashField(vertexSource, m_driverHash);
+    hash = hashField(fragmentSource, hash);
+    return hashField(defines, hash);
+}
+
+GLuint ProgramCache::load(uint64_t key)
+{
+    if(!m_enabled)
+        return 0;
+
+    const std::string path = pathFor(key);
+    std::ifstream input(path, std::ios_base::in | std::ios_base::binary);
+    if(!input)
+    {
+        ++m_misses;
+        return 0;
+    }
+
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    if(input.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+       header.magic == kProgramCacheMagic &&
+       header.version == kProgramCacheVersion &&
+       header.key == key)
+    {
+        binary.resize(header.length);
+        input.read(binary.data(), header.length);
+    }
+
+    if(binary.empty() || !input)
+    {
+        std::remove(path.c_str());
+        ++m_misses;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), header.length);
+
+    // Drivers may reject binaries from an older build of themselves even if
+    // the version string didn't change; fall back to compiling.
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(!success)
+    {
+        glDeleteProgram(program);
+        std::remove(path.c_str());
+        ++m_misses;
+        return 0;
+    }
+
+    ++m_hits;
+    return program;
+}
+
+void ProgramCache::store(uint64_t key, GLuint program)
+{
+    if(!m_enabled)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0)
+        return;
+
+    ProgramCacheHeader header;
+    header.magic = kProgramCacheMagic;
+    header.version = kProgramCacheVersion;
+    header.key = key;
+
+    std::vector<char> binary(length);
+    GLenum format = GL_NONE;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    header.format = format;
+    header.length = (uint32_t)length;
+
+    // Write to a temporary and rename so a crash never leaves a torn entry.
+    const std::string path = pathFor(key);
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream output(tempPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(binary.data(), length);
+        if(!output)
+        {
+            std::cerr << "ERROR::PROGRAM_CACHE::WRITE_FAILED: " << tempPath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if(error)
+        std::remove(tempPath.c_str());
+}
+
+std::string ProgramCache::pathFor(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+}   // namespace gl
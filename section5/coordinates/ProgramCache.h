@@ -0,0 +1,56 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <GL/glew.h>
+
+namespace gl
+{
+
+// On-disk cache of linked program binaries (ARB_get_program_binary). Entries
+// are keyed by a hash of the shader sources, any defines and the GL
+// vendor/renderer/version strings, so a driver update invalidates them.
+//
+// Requires a current GL context at construction. If the driver exposes no
+// binary formats or the directory can't be created the cache is disabled and
+// every call is a no-op.
+class ProgramCache
+{
+public:
+    explicit ProgramCache(const std::string& directory);
+
+    ProgramCache(const ProgramCache& rhs) = delete;
+    ProgramCache& operator=(const ProgramCache& rhs) = delete;
+
+    bool enabled() const { return m_enabled; }
+
+    uint64_t key(std::string_view vertexSource, std::string_view fragmentSource, std::string_view defines) const;
+
+    // Create a program from the binary stored under key. Returns 0 on a miss
+    // or if the driver rejects the binary, in which case the stale entry is
+    // removed and the caller should compile from source.
+    GLuint load(uint64_t key);
+
+    // Read back the binary of a linked program and store it under key.
+    void store(uint64_t key, GLuint program);
+
+    uint32_t hits() const { return m_hits; }
+    uint32_t misses() const { return m_misses; }
+
+private:
+    std::string pathFor(uint64_t key) const;
+
+    std::string m_directory;
+    uint64_t m_driverHash;
+    bool m_enabled;
+
+    uint32_t m_hits;
+    uint32_t m_misses;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,73 @@
+#include "SamplerCache.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace gl
+{
+
+SamplerState SamplerState::trilinear(GLfloat anisotropy)
+{
+    SamplerState state;
+    state.maxAnisotropy = anisotropy;
+    return state;
+}
+
+SamplerState SamplerState::nearest()
+{
+    SamplerState state;
+    state.minFilter = GL_NEAREST_MIPMAP_NEAREST;
+    state.magFilter = GL_NEAREST;
+    return state;
+}
+
+bool SamplerState::operator<(const SamplerState& rhs) const
+{
+    return std::tie(minFilter, magFilter, wrapS, wrapT, maxAnisotropy) <
+           std::tie(rhs.minFilter, rhs.magFilter, rhs.wrapS, rhs.wrapT, rhs.maxAnisotropy);
+}
+
+SamplerCache::~SamplerCache()
+{
+    for(const auto& sampler : m_samplers)
+        glDeleteSamplers(1, &sampler.second);
+}
+
+GLuint SamplerCache::get(const SamplerState& requested)
+{
+    // Key on what the driver will actually do, so asking for 16x where only
+    // 8x is supported shares the 8x sampler.
+    SamplerState state = requested;
+    state.maxAnisotropy = std::min(std::max(1.0f, state.maxAnisotropy), maxAnisotropySupported());
+
+    auto found = m_samplers.find(state);
+    if(found != m_samplers.end())
+        return found->second;
+
+    GLuint sampler = 0;
+    glGenSamplers(1, &sampler);
+    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, state.minFilter);
+    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, state.magFilter);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, state.wrapS);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, state.wrapT);
+    if(state.maxAnisotropy > 1.0f)
+        glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT, state.maxAnisotropy);
+
+    m_samplers.emplace(state, sampler);
+    return sampler;
+}
+
+GLfloat SamplerCache::maxAnisotropySupported()
+{
+    static GLfloat s_maxAnisotropy = 0.0f;
+    if(s_maxAnisotropy == 0.0f)
+    {
+        s_maxAnisotropy = 1.0f;
+        if(GLEW_VERSION_4_6 || GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic)
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &s_maxAnisotropy);
+    }
+
+    return s_maxAnisotropy;
+}
+
+}   // namespace gl
@@ -0,0 +1,61 @@
+#ifndef SAMPLER_CACHE_H
+#define SAMPLER_CACHE_H
+
+#include <cstddef>
+#include <map>
+
+#include <GL/glew.h>
+
+namespace gl
+{
+
+// How a texture is filtered and wrapped when sampled.
+struct SamplerState
+{
+    GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLenum magFilter = GL_LINEAR;
+    GLenum wrapS = GL_REPEAT;
+    GLenum wrapT = GL_REPEAT;
+
+    // 1 for none. Clamped to what the driver supports.
+    GLfloat maxAnisotropy = 1.0f;
+
+    // Blend between mips, and with anisotropy > 1 take extra samples along
+    // the direction the surface is squashed in.
+    static SamplerState trilinear(GLfloat anisotropy = 1.0f);
+
+    // No filtering at all, e.g. for pixel art or lookup tables.
+    static SamplerState nearest();
+
+    bool operator<(const SamplerState& rhs) const;
+};
+
+// Sampler objects shared by everything that samples with the same state, so
+// a scene with many textures binds a handful of samplers rather than
+// setting parameters on every texture. The samplers live as long as the
+// cache.
+class SamplerCache
+{
+public:
+    SamplerCache() = default;
+
+    SamplerCache(const SamplerCache& rhs) = delete;
+    SamplerCache& operator=(const SamplerCache& rhs) = delete;
+
+    ~SamplerCache();
+
+    // The sampler for state, created the first time it's asked for.
+    GLuint get(const SamplerState& state);
+
+    size_t size() const { return m_samplers.size(); }
+
+    // Largest anisotropy the driver supports, 1 without the extension.
+    static GLfloat maxAnisotropySupported();
+
+private:
+    std::map<SamplerState, GLuint> m_samplers;
+};
+
+}   // namespace gl
+
+#endif
@@ -1,101 +1,119 @@
 #include "Shader.h"
 
 #include <cstring>
-#include <fstream>
 #include <iostream>
-#include <sstream>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "ProgramCache.h"
+#include "ShaderPreprocessor.h"
+#include "UniformBlocks.h"
 
 namespace gl
 {
 
 constexpr size_t kCompileLogBufferSize = 512;
 
-Shader::Shader(const char* vertexShaderFilePath, const char* fragmentShaderFilePath)
-    : m_shaderProgram(-1)
+Shader::Shader(const char* vertexShaderFilePath, const char* fragmentShaderFilePath, ProgramCache* cache)
+    : m_shaderProgram(0)
+    , m_generation(0)
+    , m_vertexPath(vertexShaderFilePath)
+    , m_fragmentPath(fragmentShaderFilePath)
 {
-    std::ifstream vertexShaderInputStream, fragmentShaderInputStream;
+    std::shared_ptr<const std::string> vertexCode = shaderPreprocessor().expand(vertexShaderFilePath);
+    std::shared_ptr<const std::string> fragmentCode = shaderPreprocessor().expand(fragmentShaderFilePath);
 
-    // Configure to throw exceptions
-    vertexShaderInputStream.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fragmentShaderInputStream.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    // Reuse a previously linked binary if the driver accepts it.
+    uint64_t cacheKey = 0;
+    if(cache && cache->enabled())
+    {
+        cacheKey = cache->key(*vertexCode, *fragmentCode, {});
+        m_shaderProgram = cache->load(cacheKey);
+    }
 
-    std::string vertexCode, fragmentCode;
-    try
+    if(m_shaderProgram <= 0)
     {
-        vertexShaderInputStream.open(vertexShaderFilePath, std::ios_base::in);
-        fragmentShaderInputStream.open(fragmentShaderFilePath, std::ios_base::in);
+        buildFromSource(*vertexCode, *fragmentCode, cache && cache->enabled());
 
-        std::stringstream vShaderSS, fShaderSS;
-        vShaderSS << vertexShaderInputStream.rdbuf();
-        fShaderSS << fragmentShaderInputStream.rdbuf();
+        if(checkLinkStatus(m_shaderProgram) && cache && cache->enabled())
+            cache->store(cacheKey, m_shaderProgram);
+    }
 
-        // Close the files
-        vertexShaderInputStream.close();
-        fragmentShaderInputStream.close();
+    reflectUniforms();
+}
 
-        vertexCode = vShaderSS.str();
-        fragmentCode = fShaderSS.str();
-    }
-    catch(const std::ios_base::failure& exception)
-    {
-        std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << exception.what() << std::endl;
-    }
+Shader::Shader(GLuint program, const std::vector<std::pair<std::string, int>>* uniformNames)
+    : m_shaderProgram(program)
+    , m_generation(0)
+{
+    reflectUniforms(uniformNames);
+}
 
+void Shader::buildFromSource(const std::string& vertexCode, const std::string& fragmentCode, bool retrievable)
+{
     // Now compile the shaders.
     const char* vShaderSourceCStr = vertexCode.c_str();
     const char* fShaderSourceCStr = fragmentCode.c_str();
 
-    int success = 0;
-    char infoLog[kCompileLogBufferSize];
-
     GLint vertexShader = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertexShader, 1, &vShaderSourceCStr, NULL);
     glCompileShader(vertexShader);
-
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if(!success)
-    {
-        memset(infoLog, 0, kCompileLogBufferSize);
-        glGetShaderInfoLog(vertexShader, kCompileLogBufferSize, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+    checkCompileStatus(vertexShader, "VERTEX");
 
     GLint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(fragmentShader, 1, &fShaderSourceCStr, NULL);
     glCompileShader(fragmentShader);
+    checkCompileStatus(fragmentShader, "FRAGMENT");
 
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    // Link to create a shader program. If it's going into the program cache
+    // let the driver know we'll want the binary back.
+    m_shaderProgram = glCreateProgram();
+    glAttachShader(m_shaderProgram, vertexShader);
+    glAttachShader(m_shaderProgram, fragmentShader);
+    if(retrievable)
+        glProgramParameteri(m_shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(m_shaderProgram);
+
+    // Clean up the shader resources...
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+}
+
+bool Shader::checkCompileStatus(GLuint shader, const char* stageName)
+{
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if(!success)
     {
+        char infoLog[kCompileLogBufferSize];
         memset(infoLog, 0, kCompileLogBufferSize);
-        glGetShaderInfoLog(vertexShader, kCompileLogBufferSize, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glGetShaderInfoLog(shader, kCompileLogBufferSize, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << infoLog << std::endl;
     }
 
-    // Link to create a shader program.
-    m_shaderProgram = glCreateProgram();
-    glAttachShader(m_shaderProgram, vertexShader);
-    glAttachShader(m_shaderProgram, fragmentShader);
-    glLinkProgram(m_shaderProgram);
+    return success;
+}
 
-    // Check for linking errors
-    glGetProgramiv(m_shaderProgram, GL_LINK_STATUS, &success);
+bool Shader::checkLinkStatus(GLuint program)
+{
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
     if(!success)
     {
+        char infoLog[kCompileLogBufferSize];
         memset(infoLog, 0, kCompileLogBufferSize);
-        glGetProgramInfoLog(m_shaderProgram, kCompileLogBufferSize, NULL, infoLog);
+        glGetProgramInfoLog(program, kCompileLogBufferSize, NULL, infoLog);
         std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
     }
 
-    // Clean up the shader resources...
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    return success;
 }
 
 Shader::~Shader()
 {
-
+    glDeleteProgram(m_shaderProgram);
 }
 
 void Shader::use()
@@ -103,22 +121,133 @@ void Shader::use()
     glUseProgram(m_shaderProgram);
 }
 
-void Shader::setBool(const std::string& name, GLboolean value)
+void Shader::adopt(Shader& replacement)
+{
+    // Replay the values we last uploaded into the new program.
+    GLint previousProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+    glUseProgram(replacement.m_shaderProgram);
+
+    m_uniforms.forEach([&replacement](const UniformInfo& info)
+    {
+        UniformInfo* target = replacement.m_uniforms.find(UniformID::fromHash(info.hash));
+        if(!info.shadowValid || !target || target->type != info.type || target->size != info.size)
+            return;
+
+        uploadUniformRaw(*target, info.shadow);
+        std::memcpy(target->shadow, info.shadow, sizeof(info.shadow));
+        target->shadowValid = true;
+    });
+
+    std::swap(m_shaderProgram, replacement.m_shaderProgram);
+    std::swap(m_uniforms, replacement.m_uniforms);
+    ++m_generation;
+
+    glUseProgram(previousProgram == replacement.m_shaderProgram ? m_shaderProgram : previousProgram);
+}
+
+void Shader::setBool(UniformID id, GLboolean value)
+{
+    if(UniformInfo* uniform = m_uniforms.find(id))
+        uploadUniform(*uniform, (GLint)value);
+}
+
+void Shader::setInt(UniformID id, GLint value)
 {
-    GLint uniformLocation = glGetUniformLocation(m_shaderProgram, name.c_str());
-    glUniform1i(uniformLocation, (GLint)value);
+    if(UniformInfo* uniform = m_uniforms.find(id))
+        uploadUniform(*uniform, value);
 }
 
-void Shader::setInt(const std::string &name, GLint value)
+void Shader::setFloat(UniformID id, GLfloat value)
 {
-    GLint uniformLocation = glGetUniformLocation(m_shaderProgram, name.c_str());
-    glUniform1i(uniformLocation, (GLint)value);
+    if(UniformInfo* uniform = m_uniforms.find(id))
+        uploadUniform(*uniform, value);
 }
 
-void Shader::setFloat(const std::string& name, GLfloat value)
+void Shader::setMat4(UniformID id, const glm::mat4& value)
 {
-    GLint uniformLocation = glGetUniformLocation(m_shaderProgram, name.c_str());
-    glUniform1f(uniformLocation, value);
+    if(UniformInfo* uniform = m_uniforms.find(id))
+        uploadUniform(*uniform, value);
+}
+
+GLint Shader::location(UniformID id) const
+{
+    const UniformInfo* uniform = m_uniforms.find(id);
+    return uniform ? uniform->location : -1;
+}
+
+void Shader::reflectUniforms(const std::vector<std::pair<std::string, int>>* uniformNames)
+{
+    GLint numUniforms = 0, maxNameLength = 0;
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    m_uniforms.reset(numUniforms);
+    std::vector<GLchar> name(maxNameLength + 1, 0);
+    for(GLint i = 0; i < numUniforms; ++i)
+    {
+        GLsizei nameLength = 0;
+        GLint size = 0;
+        GLenum type = GL_NONE;
+        glGetActiveUniform(m_shaderProgram, i, (GLsizei)name.size(), &nameLength, &size, &type, name.data());
+
+        // Members of uniform blocks don't have a location.
+        GLint location = glGetUniformLocation(m_shaderProgram, name.data());
+        std::string_view uniformName(name.data(), nameLength);
+
+        // SPIR-V programs don't keep names, so look ours up by location.
+        if(nameLength == 0 && uniformNames)
+        {
+            const GLenum property = GL_LOCATION;
+            glGetProgramResourceiv(m_shaderProgram, GL_UNIFORM, i, 1, &property, 1, NULL, &location);
+            for(const auto& uniform : *uniformNames)
+            {
+                if(uniform.second == location)
+                    uniformName = uniform.first;
+            }
+        }
+
+        if(location < 0 || uniformName.empty())
+            continue;
+
+        // Arrays are reported as "name[0]", callers use the bare name.
+        if(uniformName.size() > 3 && uniformName.substr(uniformName.size() - 3) == "[0]")
+            uniformName.remove_suffix(3);
+
+        if(!m_uniforms.insert(uniformName, location, type, size))
+            std::cerr << "ERROR::SHADER::UNIFORM::HASH_COLLISION: " << uniformName << std::endl;
+    }
+
+    bindUniformBlocks();
+}
+
+void Shader::bindUniformBlocks()
+{
+    GLint numBlocks = 0, maxNameLength = 0;
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> name(maxNameLength + 1, 0);
+    for(GLint i = 0; i < numBlocks; ++i)
+    {
+        GLsizei nameLength = 0;
+        glGetActiveUniformBlockName(m_shaderProgram, i, (GLsizei)name.size(), &nameLength, name.data());
+
+        // SPIR-V blocks are nameless, their bindings are fixed in the shader.
+        if(nameLength == 0)
+            continue;
+
+        const UniformBlockLayout* layout = findUniformBlockLayout(name.data());
+        if(!layout)
+        {
+            std::cerr << "ERROR::SHADER::UNIFORM_BLOCK::UNKNOWN: " << name.data() << std::endl;
+            continue;
+        }
+
+        // GLSL 330 can't give a block a binding, so it's set after linking.
+        glUniformBlockBinding(m_shaderProgram, i, layout->binding);
+        checkUniformBlockLayout(m_shaderProgram, i, *layout);
+    }
 }
 
 }   //  namespace gl
@@ -1,17 +1,30 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <GL/glew.h>
 
+#include <glm/glm.hpp>
+
+#include "ShaderPreprocessor.h"
+#include "Uniform.h"
+#include "UniformTable.h"
+
 namespace gl
 {
 
+class ProgramCache;
+
 class Shader
 {
 public:
-    Shader(const char* vertexShaderFilePath, const char* fragmentShaderFilePath);
+    // If cache is given, a stored program binary is used in place of
+    // compiling when the driver accepts it, and fresh links are stored.
+    Shader(const char* vertexShaderFilePath, const char* fragmentShaderFilePath, ProgramCache* cache = nullptr);
 
     // Disable assignment, copy and move constructors
     Shader(const Shader& rhs) = delete;
@@ -27,18 +40,136 @@ public:
 
     const GLint id() const { return m_shaderProgram; }
 
-    // Set uniforms for this shader
-    void setBool(const std::string& name, GLboolean value);
-    void setInt(const std::string& name, GLint value);
-    void setFloat(const std::string& name, GLfloat value);
+    // Paths of the files this shader was built from; empty if it was built
+    // from source in memory.
+    const std::string& vertexPath() const { return m_vertexPath; }
+    const std::string& fragmentPath() const { return m_fragmentPath; }
+
+    // Defines the files were expanded with, for shaders built as variants.
+    const ShaderDefines& defines() const { return m_defines; }
+
+    // Take over the program of replacement, which must have linked. Uniform
+    // values set on this shader carry over wherever the new program has a
+    // uniform with the same name and type. replacement is left holding the
+    // old program.
+    void adopt(Shader& replacement);
+
+    // Incremented every time adopt() replaces the program.
+    uint32_t generation() const { return m_generation; }
+
+    // Typed handle to the named uniform. T is checked against the reflected
+    // GLSL type; on a mismatch an error is logged and an invalid handle that
+    // ignores writes is returned.
+    template<typename T>
+    Uniform<T> uniform(UniformID id);
+
+    // Set uniforms for this shader. Names are resolved against the table
+    // built at link time; unknown names are ignored as GL would. Values equal
+    // to the last upload are skipped.
+    void setBool(UniformID id, GLboolean value);
+    void setInt(UniformID id, GLint value);
+    void setFloat(UniformID id, GLfloat value);
+    void setMat4(UniformID id, const glm::mat4& value);
+
+    // Location of the named uniform or -1 if it isn't active.
+    GLint location(UniformID id) const;
 
 private:
-    // Read the contents of the file specified by filePath and return it.
-    const std::string&& readFile(const char* filePath);
+    friend class ShaderCompiler;
+
+    template<typename T>
+    friend class Uniform;
+
+    // Find the named uniform and check it can hold a T.
+    template<typename T>
+    UniformInfo* resolveUniform(UniformID id);
+
+    // Adopt a program that has already been linked successfully. Programs
+    // built from SPIR-V have no uniform names; pass them in uniformNames
+    // with their locations.
+    explicit Shader(GLuint program, const std::vector<std::pair<std::string, int>>* uniformNames = nullptr);
+
+    // Compile both stages and link them into m_shaderProgram. Set retrievable
+    // if the program binary will be read back for the cache.
+    void buildFromSource(const std::string& vertexCode, const std::string& fragmentCode, bool retrievable);
+
+    // Query the active uniforms of the linked program and fill m_uniforms.
+    void reflectUniforms(const std::vector<std::pair<std::string, int>>* uniformNames = nullptr);
+
+    // Point the program's uniform blocks at their shared binding points and
+    // check them against the C++ structs in UniformBlocks.h.
+    void bindUniformBlocks();
+
+    // Log and return the result of compiling a shader or linking a program.
+    static bool checkCompileStatus(GLuint shader, const char* stageName);
+    static bool checkLinkStatus(GLuint program);
 
     GLint m_shaderProgram;
+    UniformTable m_uniforms;
+    uint32_t m_generation;
+
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    ShaderDefines m_defines;
 };
 
+template<typename T>
+Uniform<T> Shader::uniform(UniformID id)
+{
+    return Uniform<T>(this, id);
+}
+
+template<typename T>
+UniformInfo* Shader::resolveUniform(UniformID id)
+{
+    UniformInfo* info = m_uniforms.find(id);
+    if(!info)
+        return nullptr;
+
+    if(!UniformTraits<T>::accepts(info->type) || info->size != 1)
+    {
+        std::cerr << "ERROR::SHADER::UNIFORM::TYPE_MISMATCH: " << info->name
+                  << " has GLSL type 0x" << std::hex << info->type << std::dec << std::endl;
+        return nullptr;
+    }
+
+    return info;
+}
+
+template<typename T>
+Uniform<T>::Uniform(Shader* shader, UniformID id)
+    : m_shader(shader)
+    , m_id(id)
+    , m_info(shader->resolveUniform<T>(id))
+    , m_generation(shader->generation())
+{
+}
+
+template<typename T>
+void Uniform<T>::refresh() const
+{
+    if(m_shader && m_generation != m_shader->generation())
+    {
+        m_info = m_shader->resolveUniform<T>(m_id);
+        m_generation = m_shader->generation();
+    }
+}
+
+template<typename T>
+bool Uniform<T>::valid() const
+{
+    refresh();
+    return m_info != nullptr;
+}
+
+template<typename T>
+void Uniform<T>::set(const T& value) const
+{
+    refresh();
+    if(m_info)
+        uploadUniform(*m_info, value);
+}
+
 }   // namespace gl
 
 #endif
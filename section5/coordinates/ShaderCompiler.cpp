@@ -0,0 +1,255 @@
+#include "ShaderCompiler.h"
+
+#include <iostream>
+
+#include "ProgramCache.h"
+#include "ShaderPreprocessor.h"
+#include "SpirvLibrary.h"
+
+// Shared by KHR_parallel_shader_compile and ARB_parallel_shader_compile;
+// older GLEW headers don't define it.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace gl
+{
+
+// Without parallel compile every status query may block while the driver
+// compiles, so only finish this many programs per poll().
+constexpr size_t kMaxBlockingCompletesPerPoll = 1;
+
+static const char* kFallbackVertexShader = R"(#version 330 core
+layout (location = 0) in vec3 position;
+
+layout (std140) uniform CameraBlock
+{
+    mat4 view;
+    mat4 projection;
+};
+
+layout (std140) uniform DrawBlock
+{
+    mat4 model;
+};
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(position, 1.0);
+}
+)";
+
+static const char* kFallbackFragmentShader = R"(#version 330 core
+out vec4 color;
+
+void main()
+{
+    color = vec4(0.5, 0.5, 0.5, 1.0);
+}
+)";
+
+ShaderCompiler::ShaderCompiler(ProgramCache* cache, SpirvLibrary* spirv)
+    : m_cache(cache)
+    , m_spirv(spirv)
+    , m_parallel(glewIsSupported("GL_KHR_parallel_shader_compile") ||
+                 glewIsSupported("GL_ARB_parallel_shader_compile"))
+{
+    ShaderHandle fallback = submitSource("fallback", kFallbackVertexShader, kFallbackFragmentShader);
+    if(fallback.m_pending->state == PendingProgram::State::Compiling)
+    {
+        complete(*fallback.m_pending);
+        m_pending.pop_back();
+    }
+
+    // complete() has already logged why; without it there's nothing to draw
+    // with, so the caller has to give up.
+    m_fallback = std::move(fallback.m_pending->shader);
+    if(!m_fallback)
+        std::cerr << "ERROR::SHADER_COMPILER::FALLBACK_FAILED" << std::endl;
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+    // Release anything still in flight; the driver will cancel the work.
+    for(const std::shared_ptr<PendingProgram>& pending : m_pending)
+    {
+        glDeleteShader(pending->vertexShader);
+        glDeleteShader(pending->fragmentShader);
+        glDeleteProgram(pending->program);
+        pending->state = PendingProgram::State::Failed;
+    }
+}
+
+ShaderHandle ShaderCompiler::submit(const char* vertexShaderFilePath, const char* fragmentShaderFilePath,
+                                    const ShaderDefines& defines)
+{
+    std::string name = std::string(vertexShaderFilePath) + " + " + fragmentShaderFilePath;
+    for(const auto& define : defines)
+        name += " " + define.first + "=" + define.second;
+
+    std::shared_ptr<const std::string> vertexCode = shaderPreprocessor().expand(vertexShaderFilePath, defines);
+    std::shared_ptr<const std::string> fragmentCode = shaderPreprocessor().expand(fragmentShaderFilePath, defines);
+
+    // Prefer modules compiled at build time, as long as they match the
+    // source we'd compile.
+    ShaderHandle handle;
+    if(m_spirv && m_spirv->enabled())
+    {
+        const SpirvModule* vertexModule = m_spirv->find(vertexShaderFilePath, defines, *vertexCode);
+        const SpirvModule* fragmentModule = m_spirv->find(fragmentShaderFilePath, defines, *fragmentCode);
+        if(vertexModule && fragmentModule)
+            handle = submitSpirv(name, *vertexModule, *fragmentModule);
+    }
+
+    if(!handle.valid())
+        handle = submitSource(name, *vertexCode, *fragmentCode);
+
+    handle.m_pending->vertexPath = vertexShaderFilePath;
+    handle.m_pending->fragmentPath = fragmentShaderFilePath;
+    handle.m_pending->defines = defines;
+    if(handle.ready())
+    {
+        handle.m_pending->shader->m_vertexPath = vertexShaderFilePath;
+        handle.m_pending->shader->m_fragmentPath = fragmentShaderFilePath;
+        handle.m_pending->shader->m_defines = defines;
+    }
+
+    return handle;
+}
+
+ShaderHandle ShaderCompiler::submitSource(const std::string& name, const std::string& vertexCode, const std::string& fragmentCode)
+{
+    std::shared_ptr<PendingProgram> pending = std::make_shared<PendingProgram>();
+    pending->name = name;
+
+    const bool useCache = m_cache && m_cache->enabled();
+    if(useCache)
+    {
+        pending->cacheKey = m_cache->key(vertexCode, fragmentCode, {});
+        if(GLuint program = m_cache->load(pending->cacheKey))
+        {
+            pending->shader.reset(new Shader(program));
+            pending->state = PendingProgram::State::Ready;
+            return ShaderHandle(pending);
+        }
+    }
+
+    // Issue everything without querying status so the driver can run ahead.
+    const char* vShaderSourceCStr = vertexCode.c_str();
+    const char* fShaderSourceCStr = fragmentCode.c_str();
+
+    pending->vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pending->vertexShader, 1, &vShaderSourceCStr, NULL);
+    glCompileShader(pending->vertexShader);
+
+    pending->fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pending->fragmentShader, 1, &fShaderSourceCStr, NULL);
+    glCompileShader(pending->fragmentShader);
+
+    pending->program = glCreateProgram();
+    glAttachShader(pending->program, pending->vertexShader);
+    glAttachShader(pending->program, pending->fragmentShader);
+    if(useCache)
+        glProgramParameteri(pending->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(pending->program);
+
+    m_pending.push_back(pending);
+    return ShaderHandle(pending);
+}
+
+ShaderHandle ShaderCompiler::submitSpirv(const std::string& name, const SpirvModule& vertexModule, const SpirvModule& fragmentModule)
+{
+    // Specialising is where the driver translates the module, so there's
+    // nothing to gain from the program cache here.
+    GLuint vertexShader = m_spirv->createShader(GL_VERTEX_SHADER, vertexModule);
+    GLuint fragmentShader = vertexShader ? m_spirv->createShader(GL_FRAGMENT_SHADER, fragmentModule) : 0;
+    if(!fragmentShader)
+    {
+        glDeleteShader(vertexShader);
+        return ShaderHandle();
+    }
+
+    std::shared_ptr<PendingProgram> pending = std::make_shared<PendingProgram>();
+    pending->name = name;
+    pending->spirv = true;
+    pending->vertexShader = vertexShader;
+    pending->fragmentShader = fragmentShader;
+    pending->spirvUniforms = vertexModule.uniforms;
+    pending->spirvUniforms.insert(pending->spirvUniforms.end(), fragmentModule.uniforms.begin(), fragmentModule.uniforms.end());
+
+    pending->program = glCreateProgram();
+    glAttachShader(pending->program, pending->vertexShader);
+    glAttachShader(pending->program, pending->fragmentShader);
+    glLinkProgram(pending->program);
+
+    m_pending.push_back(pending);
+    return ShaderHandle(pending);
+}
+
+void ShaderCompiler::poll()
+{
+    size_t blockingCompletes = 0;
+    for(size_t i = 0; i < m_pending.size();)
+    {
+        PendingProgram& pending = *m_pending[i];
+        if(m_parallel)
+        {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &completed);
+            if(!completed)
+            {
+                ++i;
+                continue;
+            }
+        }
+        else if(blockingCompletes++ == kMaxBlockingCompletesPerPoll)
+        {
+            break;
+        }
+
+        complete(pending);
+        m_pending.erase(m_pending.begin() + i);
+    }
+}
+
+void ShaderCompiler::finish()
+{
+    for(const std::shared_ptr<PendingProgram>& pending : m_pending)
+        complete(*pending);
+
+    m_pending.clear();
+}
+
+void ShaderCompiler::complete(PendingProgram& pending)
+{
+    // Link failures report the stage logs poorly, so check each stage first.
+    bool success = Shader::checkCompileStatus(pending.vertexShader, "VERTEX");
+    success = Shader::checkCompileStatus(pending.fragmentShader, "FRAGMENT") && success;
+    success = Shader::checkLinkStatus(pending.program) && success;
+
+    glDeleteShader(pending.vertexShader);
+    glDeleteShader(pending.fragmentShader);
+    pending.vertexShader = 0;
+    pending.fragmentShader = 0;
+
+    if(!success)
+    {
+        std::cerr << "ERROR::SHADER_COMPILER::BUILD_FAILED: " << pending.name << std::endl;
+        glDeleteProgram(pending.program);
+        pending.program = 0;
+        pending.state = PendingProgram::State::Failed;
+        return;
+    }
+
+    if(m_cache && m_cache->enabled() && !pending.spirv)
+        m_cache->store(pending.cacheKey, pending.program);
+
+    pending.shader.reset(new Shader(pending.program, pending.spirv ? &pending.spirvUniforms : nullptr));
+    pending.shader->m_vertexPath = pending.vertexPath;
+    pending.shader->m_fragmentPath = pending.fragmentPath;
+    pending.shader->m_defines = pending.defines;
+    pending.program = 0;
+    pending.state = PendingProgram::State::Ready;
+}
+
+}   // namespace gl
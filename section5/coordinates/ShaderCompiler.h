@@ -0,0 +1,140 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Shader.h"
+
+namespace gl
+{
+
+class ProgramCache;
+class SpirvLibrary;
+struct SpirvModule;
+
+// State of a program submitted to a ShaderCompiler.
+struct PendingProgram
+{
+    enum class State
+    {
+        Compiling,
+        Ready,
+        Failed
+    };
+
+    State state = State::Compiling;
+    std::string name;
+    std::string vertexPath;
+    std::string fragmentPath;
+    ShaderDefines defines;
+
+    GLuint vertexShader = 0;
+    GLuint fragmentShader = 0;
+    GLuint program = 0;
+    uint64_t cacheKey = 0;
+
+    // Set for programs built from SPIR-V, which need their uniform names.
+    bool spirv = false;
+    std::vector<std::pair<std::string, int>> spirvUniforms;
+
+    std::unique_ptr<Shader> shader;
+};
+
+// Future-like handle to a program being built by a ShaderCompiler. Cheap to
+// copy; all copies observe the same program.
+class ShaderHandle
+{
+public:
+    ShaderHandle() = default;
+
+    bool valid() const { return m_pending != nullptr; }
+    bool ready() const { return m_pending && m_pending->state == PendingProgram::State::Ready; }
+    bool failed() const { return m_pending && m_pending->state == PendingProgram::State::Failed; }
+
+    // Only call once ready() returns true.
+    Shader& get() const { return *m_pending->shader; }
+
+    // The finished shader, or fallback while it's still compiling or if it failed.
+    Shader& getOr(Shader& fallback) const { return ready() ? *m_pending->shader : fallback; }
+
+private:
+    friend class ShaderCompiler;
+
+    explicit ShaderHandle(std::shared_ptr<PendingProgram> pending) : m_pending(std::move(pending)) {}
+
+    std::shared_ptr<PendingProgram> m_pending;
+};
+
+// Batches program builds so the driver can compile them concurrently.
+//
+// submit() issues every compile and link call up front without asking for a
+// status. With KHR_parallel_shader_compile the driver does that work on its
+// own threads and poll() checks GL_COMPLETION_STATUS_KHR, finishing only the
+// programs that are done, so nothing on the render thread blocks. Without the
+// extension a status query can block, so poll() finishes a limited number of
+// programs per call to spread the cost over several frames.
+//
+// Stages with an up to date SPIR-V module in the SpirvLibrary are loaded from
+// that instead of compiled from GLSL.
+//
+// All calls must be made on the thread that owns the GL context.
+class ShaderCompiler
+{
+public:
+    explicit ShaderCompiler(ProgramCache* cache = nullptr, SpirvLibrary* spirv = nullptr);
+
+    ShaderCompiler(const ShaderCompiler& rhs) = delete;
+    ShaderCompiler& operator=(const ShaderCompiler& rhs) = delete;
+
+    ~ShaderCompiler();
+
+    // Build a program from two files, expanded with defines if given.
+    ShaderHandle submit(const char* vertexShaderFilePath, const char* fragmentShaderFilePath,
+                        const ShaderDefines& defines = {});
+
+    // Same as submit() but from source already in memory. name is only used
+    // when reporting errors.
+    ShaderHandle submitSource(const std::string& name, const std::string& vertexCode, const std::string& fragmentCode);
+
+    // Finish any programs the driver has completed. Call once per frame.
+    void poll();
+
+    // Block until every submitted program has finished.
+    void finish();
+
+    size_t pending() const { return m_pending.size(); }
+    bool parallel() const { return m_parallel; }
+
+    // False if the fallback program failed to build. Nothing else can be
+    // drawn safely, so check this once after construction.
+    bool valid() const { return m_fallback != nullptr; }
+
+    // A trivial program that's always ready, for drawing with while the real
+    // one compiles. Uses attribute 0 and the camera and draw uniform blocks.
+    // Only call if valid().
+    Shader& fallback() { return *m_fallback; }
+
+private:
+    // Link a program from two SPIR-V modules. Returns an invalid handle if the
+    // driver rejects either, for the caller to fall back to GLSL.
+    ShaderHandle submitSpirv(const std::string& name, const SpirvModule& vertexModule, const SpirvModule& fragmentModule);
+
+    // Collect the results of a program whose compile and link have completed.
+    void complete(PendingProgram& pending);
+
+    ProgramCache* m_cache;
+    SpirvLibrary* m_spirv;
+    bool m_parallel;
+
+    std::vector<std::shared_ptr<PendingProgram>> m_pending;
+    std::unique_ptr<Shader> m_fallback;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,144 @@
+#include "ShaderReloader.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Shader.h"
+#include "ShaderPreprocessor.h"
+
+namespace gl
+{
+
+ShaderReloader::ShaderReloader(ShaderCompiler& compiler)
+    : m_compiler(compiler)
+    , m_watcher([this](const std::string& path) { onFileChanged(path); })
+{
+}
+
+void ShaderReloader::watch(Shader& shader)
+{
+    if(shader.vertexPath().empty() || shader.fragmentPath().empty())
+        return;
+
+    std::vector<std::string> files = dependencies(shader.vertexPath(), shader.fragmentPath());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(const Entry& entry : m_entries)
+        {
+            if(entry.shader == &shader)
+                return;
+        }
+
+        m_entries.push_back({&shader, shader.vertexPath(), shader.fragmentPath(), shader.defines(), ShaderHandle(), files});
+    }
+
+    for(const std::string& file : files)
+        m_watcher.watch(file);
+}
+
+void ShaderReloader::unwatch(Shader& shader)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                   [&shader](const Entry& entry) { return entry.shader == &shader; }),
+                    m_entries.end());
+    m_changed.erase(std::remove_if(m_changed.begin(), m_changed.end(),
+                                   [&shader](const ChangedSource& changed) { return changed.shader == &shader; }),
+                    m_changed.end());
+}
+
+void ShaderReloader::onFileChanged(const std::string& path)
+{
+    shaderPreprocessor().invalidate(path);
+
+    std::vector<Entry> affected;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(const Entry& entry : m_entries)
+        {
+            if(std::find(entry.files.begin(), entry.files.end(), path) != entry.files.end())
+                affected.push_back({entry.shader, entry.vertexPath, entry.fragmentPath, entry.defines, ShaderHandle(), {}});
+        }
+    }
+
+    // Read and expand without the lock held; this is the slow part we're
+    // keeping off the render thread.
+    for(Entry& entry : affected)
+    {
+        ChangedSource changed = {entry.shader,
+                                 *shaderPreprocessor().expand(entry.vertexPath, entry.defines),
+                                 *shaderPreprocessor().expand(entry.fragmentPath, entry.defines)};
+
+        // The edit may have added includes.
+        entry.files = dependencies(entry.vertexPath, entry.fragmentPath);
+        for(const std::string& file : entry.files)
+            m_watcher.watch(file);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(Entry& watched : m_entries)
+        {
+            if(watched.shader == entry.shader)
+                watched.files = entry.files;
+        }
+
+        if(changed.vertexCode.empty() || changed.fragmentCode.empty())
+            continue;
+
+        // A newer read supersedes one the render thread hasn't picked up yet.
+        m_changed.erase(std::remove_if(m_changed.begin(), m_changed.end(),
+                                       [&entry](const ChangedSource& pending) { return pending.shader == entry.shader; }),
+                        m_changed.end());
+        m_changed.push_back(std::move(changed));
+    }
+}
+
+std::vector<std::string> ShaderReloader::dependencies(const std::string& vertexPath, const std::string& fragmentPath)
+{
+    std::vector<std::string> files = shaderPreprocessor().dependencies(vertexPath);
+    for(const std::string& file : shaderPreprocessor().dependencies(fragmentPath))
+    {
+        if(std::find(files.begin(), files.end(), file) == files.end())
+            files.push_back(file);
+    }
+
+    return files;
+}
+
+void ShaderReloader::update()
+{
+    std::vector<ChangedSource> changed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        changed.swap(m_changed);
+    }
+
+    for(ChangedSource& source : changed)
+    {
+        for(Entry& entry : m_entries)
+        {
+            if(entry.shader != source.shader)
+                continue;
+
+            std::string name = entry.vertexPath + " + " + entry.fragmentPath;
+            entry.pending = m_compiler.submitSource(name, source.vertexCode, source.fragmentCode);
+        }
+    }
+
+    for(Entry& entry : m_entries)
+    {
+        if(entry.pending.ready())
+        {
+            entry.shader->adopt(entry.pending.get());
+            std::cout << "Reloaded " << entry.vertexPath << " + " << entry.fragmentPath << std::endl;
+            entry.pending = ShaderHandle();
+        }
+        else if(entry.pending.failed())
+        {
+            std::cerr << "ERROR::SHADER_RELOADER::RELOAD_FAILED: keeping the previous program for "
+                      << entry.vertexPath << " + " << entry.fragmentPath << std::endl;
+            entry.pending = ShaderHandle();
+        }
+    }
+}
+
+}   // namespace gl
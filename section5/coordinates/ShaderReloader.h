@@ -0,0 +1,80 @@
+#ifndef SHADER_RELOADER_H
+#define SHADER_RELOADER_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FileWatcher.h"
+#include "ShaderCompiler.h"
+
+namespace gl
+{
+
+class Shader;
+
+// Hot reload for shaders built from files. A FileWatcher thread notices when
+// a watched shader's .glsl files, or anything they #include, change and
+// reads and preprocesses the new source there, off the render thread.
+// update() hands that source to the ShaderCompiler and, once the new program
+// has linked, swaps it into the existing Shader so everything holding a
+// reference to it picks it up. If the edit doesn't compile or link the error
+// is logged and the old program keeps running.
+class ShaderReloader
+{
+public:
+    explicit ShaderReloader(ShaderCompiler& compiler);
+
+    ShaderReloader(const ShaderReloader& rhs) = delete;
+    ShaderReloader& operator=(const ShaderReloader& rhs) = delete;
+
+    // Reload shader whenever its files change. It must stay alive until it's
+    // unwatched or the reloader is destroyed.
+    void watch(Shader& shader);
+    void unwatch(Shader& shader);
+
+    // Submit freshly read sources for compiling and swap in any programs
+    // that have finished. Call once per frame, after ShaderCompiler::poll().
+    void update();
+
+private:
+    struct Entry
+    {
+        Shader* shader;
+        std::string vertexPath;
+        std::string fragmentPath;
+        ShaderDefines defines;
+        ShaderHandle pending;
+
+        // Both stages' files and everything they include.
+        std::vector<std::string> files;
+    };
+
+    struct ChangedSource
+    {
+        Shader* shader;
+        std::string vertexCode;
+        std::string fragmentCode;
+    };
+
+    // Called on the watcher thread.
+    void onFileChanged(const std::string& path);
+
+    // The files to watch for a shader built from these two roots.
+    static std::vector<std::string> dependencies(const std::string& vertexPath, const std::string& fragmentPath);
+
+    ShaderCompiler& m_compiler;
+
+    // Entries are added and removed on the render thread; the watcher thread
+    // only reads them and updates their file lists. Writers hold the lock.
+    std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    std::vector<ChangedSource> m_changed;
+
+    // Last so its thread is stopped before the state it uses is destroyed.
+    FileWatcher m_watcher;
+};
+
+}   // namespace gl
+
+#endif
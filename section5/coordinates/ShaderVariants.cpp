@@ -0,0 +1,153 @@
+#include "ShaderVariants.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+#include "ShaderPreprocessor.h"
+#include "ThreadPool.h"
+
+namespace gl
+{
+
+ShaderVariants::ShaderVariants(ShaderCompiler& compiler, ThreadPool& pool,
+                               std::string vertexPath, std::string fragmentPath,
+                               std::vector<ShaderFeature> features)
+    : m_compiler(compiler)
+    , m_pool(pool)
+    , m_vertexPath(std::move(vertexPath))
+    , m_fragmentPath(std::move(fragmentPath))
+    , m_features(std::move(features))
+    , m_featureBits(0)
+{
+    for(const ShaderFeature& feature : m_features)
+        m_featureBits |= feature.bit;
+}
+
+const ShaderHandle& ShaderVariants::get(FeatureMask mask)
+{
+    mask &= m_featureBits;
+
+    Variant& variant = m_variants[mask];
+    variant.used = true;
+    if(!variant.handle.valid())
+    {
+        // A warm-up that hasn't finished expanding; don't wait for it.
+        if(!variant.preparing.valid() ||
+           variant.preparing.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            submit(mask, variant);
+        }
+    }
+
+    return variant.handle;
+}
+
+void ShaderVariants::warm(FeatureMask mask)
+{
+    mask &= m_featureBits;
+
+    Variant& variant = m_variants[mask];
+    if(variant.handle.valid() || variant.preparing.valid())
+        return;
+
+    // Expanding fills the preprocessor's cache, so the submit from update()
+    // only has to look the sources up.
+    std::string vertexPath = m_vertexPath;
+    std::string fragmentPath = m_fragmentPath;
+    ShaderDefines variantDefines = defines(mask);
+    variant.preparing = m_pool.submit([vertexPath, fragmentPath, variantDefines]()
+    {
+        shaderPreprocessor().expand(vertexPath, variantDefines);
+        shaderPreprocessor().expand(fragmentPath, variantDefines);
+    });
+}
+
+void ShaderVariants::update()
+{
+    for(auto& entry : m_variants)
+    {
+        Variant& variant = entry.second;
+        if(!variant.handle.valid() && variant.preparing.valid() &&
+           variant.preparing.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            submit(entry.first, variant);
+        }
+    }
+}
+
+bool ShaderVariants::loadWarmupList(const std::string& path)
+{
+    std::ifstream input(path);
+    if(!input)
+        return false;
+
+    std::string line;
+    while(std::getline(input, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        FeatureMask mask = 0;
+        if(!(fields >> std::hex >> mask))
+        {
+            std::cerr << "ERROR::SHADER_VARIANTS::BAD_WARMUP_ENTRY: " << path << ": " << line << std::endl;
+            continue;
+        }
+
+        mask &= m_featureBits;
+        if(std::find(m_warmupList.begin(), m_warmupList.end(), mask) == m_warmupList.end())
+            m_warmupList.push_back(mask);
+
+        warm(mask);
+    }
+
+    return true;
+}
+
+bool ShaderVariants::saveWarmupList(const std::string& path) const
+{
+    std::vector<FeatureMask> masks = m_warmupList;
+    for(const auto& entry : m_variants)
+    {
+        if(entry.second.used && std::find(masks.begin(), masks.end(), entry.first) == masks.end())
+            masks.push_back(entry.first);
+    }
+
+    std::sort(masks.begin(), masks.end());
+
+    std::ofstream output(path, std::ios_base::out | std::ios_base::trunc);
+    if(!output)
+    {
+        std::cerr << "ERROR::SHADER_VARIANTS::WARMUP_LIST_NOT_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    output << "# Feature masks of " << m_vertexPath << " + " << m_fragmentPath << " to prebuild\n";
+    for(FeatureMask mask : masks)
+        output << std::hex << mask << "\n";
+
+    return (bool)output;
+}
+
+ShaderDefines ShaderVariants::defines(FeatureMask mask) const
+{
+    ShaderDefines result;
+    result.reserve(m_features.size());
+    for(const ShaderFeature& feature : m_features)
+        result.emplace_back(feature.define, (mask & feature.bit) ? "1" : "0");
+
+    return result;
+}
+
+void ShaderVariants::submit(FeatureMask mask, Variant& variant)
+{
+    variant.preparing = std::future<void>();
+    variant.handle = m_compiler.submit(m_vertexPath.c_str(), m_fragmentPath.c_str(), defines(mask));
+}
+
+}   // namespace gl
@@ -0,0 +1,98 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderCompiler.h"
+
+namespace gl
+{
+
+class ThreadPool;
+
+// A set of feature bits. Each bit a material turns on enables a code path in
+// its shaders; everything else is compiled out.
+using FeatureMask = uint32_t;
+
+// One feature of a shader. Variants are expanded with `#define name 1` when
+// bit is set and `#define name 0` when it isn't.
+struct ShaderFeature
+{
+    FeatureMask bit;
+    const char* define;
+};
+
+// Specialised programs built from one pair of shader files, one per
+// combination of features actually used.
+//
+// A variant is compiled the first time get() asks for it; until it's ready
+// the handle falls back like any other. Masks listed in a warm-up file, saved
+// from earlier runs, are preprocessed on a ThreadPool and submitted from
+// update() so they're usually built before they're needed.
+//
+// Everything except the background preprocessing happens on the GL thread.
+class ShaderVariants
+{
+public:
+    ShaderVariants(ShaderCompiler& compiler, ThreadPool& pool,
+                   std::string vertexPath, std::string fragmentPath,
+                   std::vector<ShaderFeature> features);
+
+    ShaderVariants(const ShaderVariants& rhs) = delete;
+    ShaderVariants& operator=(const ShaderVariants& rhs) = delete;
+
+    // The program for mask, submitting it if this is the first request. Bits
+    // that aren't features are ignored. The handle is invalid while a
+    // warm-up of the variant is still being preprocessed.
+    const ShaderHandle& get(FeatureMask mask);
+
+    // Start preparing mask in the background without marking it used.
+    void warm(FeatureMask mask);
+
+    // Submit variants whose background preprocessing has finished. Call once
+    // per frame, before ShaderCompiler::poll().
+    void update();
+
+    // Warm every mask in the file at path. Returns false if it couldn't be read.
+    bool loadWarmupList(const std::string& path);
+
+    // Write the masks used by this run, and any loaded, for the next one.
+    bool saveWarmupList(const std::string& path) const;
+
+    // The defines a variant is expanded with.
+    ShaderDefines defines(FeatureMask mask) const;
+
+    size_t size() const { return m_variants.size(); }
+
+private:
+    struct Variant
+    {
+        ShaderHandle handle;
+
+        // Set while the sources are being expanded on the pool.
+        std::future<void> preparing;
+
+        bool used = false;
+    };
+
+    void submit(FeatureMask mask, Variant& variant);
+
+    ShaderCompiler& m_compiler;
+    ThreadPool& m_pool;
+
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    std::vector<ShaderFeature> m_features;
+    FeatureMask m_featureBits;
+
+    std::unordered_map<FeatureMask, Variant> m_variants;
+    std::vector<FeatureMask> m_warmupList;
+};
+
+}   // namespace gl
+
+#endif
@@ -1,21 +1,20 @@
 #version 330 core
 
-layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 color;
-layout (location = 2) in vec2 textureCoords;
+#include "SpirvCompat.glsl"
+#include "MaterialFeatures.glsl"
+#include "VertexLayout.glsl"
+#include "Transforms.glsl"
 
-out vec4 vertexColor;
-out vec2 texCoords;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-uniform mat4 transform;
+#if FEATURE_VERTEX_COLOUR
+VARYING_LOCATION(0) out vec4 vertexColor;
+#endif
+VARYING_LOCATION(1) out vec2 texCoords;
 
 void main()
 {
     gl_Position = projection * view * model * vec4(position, 1.0);
+#if FEATURE_VERTEX_COLOUR
     vertexColor = vec4(color, 1.0);
+#endif
     texCoords = textureCoords;
 }
@@ -0,0 +1,137 @@
+#include "SkylinePacker.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace gl
+{
+
+SkylinePacker::SkylinePacker(int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_usedArea(0)
+{
+    m_skyline.push_back({0, 0, width});
+}
+
+bool SkylinePacker::insert(int width, int height, PackRect& rect)
+{
+    if(width <= 0 || height <= 0)
+        return false;
+
+    // Lowest top wins; of those the narrowest segment, which wastes least.
+    size_t bestIndex = m_skyline.size();
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+    for(size_t i = 0; i < m_skyline.size(); ++i)
+    {
+        const int y = fit(i, width, height);
+        if(y < 0)
+            continue;
+
+        const int top = y + height;
+        if(top < bestTop || (top == bestTop && m_skyline[i].width < bestWidth))
+        {
+            bestIndex = i;
+            bestTop = top;
+            bestWidth = m_skyline[i].width;
+        }
+    }
+
+    if(bestIndex == m_skyline.size())
+        return false;
+
+    rect.x = m_skyline[bestIndex].x;
+    rect.y = bestTop - height;
+    rect.width = width;
+    rect.height = height;
+
+    place(bestIndex, rect);
+    m_usedArea += static_cast<long long>(width) * height;
+    return true;
+}
+
+int SkylinePacker::usedWidth() const
+{
+    int used = 0;
+    for(const Segment& segment : m_skyline)
+    {
+        if(segment.y > 0)
+            used = segment.x + segment.width;
+    }
+
+    return used;
+}
+
+int SkylinePacker::usedHeight() const
+{
+    int used = 0;
+    for(const Segment& segment : m_skyline)
+        used = std::max(used, segment.y);
+
+    return used;
+}
+
+float SkylinePacker::occupancy() const
+{
+    return static_cast<float>(m_usedArea) / (static_cast<float>(m_width) * m_height);
+}
+
+int SkylinePacker::fit(size_t index, int width, int height) const
+{
+    if(m_skyline[index].x + width > m_width)
+        return -1;
+
+    // The rectangle rests on the highest segment it spans.
+    int y = 0;
+    int remaining = width;
+    for(size_t i = index; remaining > 0; ++i)
+    {
+        y = std::max(y, m_skyline[i].y);
+        if(y + height > m_height)
+            return -1;
+
+        remaining -= m_skyline[i].width;
+    }
+
+    return y;
+}
+
+void SkylinePacker::place(size_t index, const PackRect& rect)
+{
+    m_skyline.insert(m_skyline.begin() + index, {rect.x, rect.y + rect.height, rect.width});
+
+    // Trim the segments now underneath it.
+    const int right = rect.x + rect.width;
+    size_t i = index + 1;
+    while(i < m_skyline.size() && m_skyline[i].x < right)
+    {
+        Segment& segment = m_skyline[i];
+        const int end = segment.x + segment.width;
+        if(end <= right)
+        {
+            m_skyline.erase(m_skyline.begin() + i);
+            continue;
+        }
+
+        segment.width = end - right;
+        segment.x = right;
+        break;
+    }
+
+    // Merge runs at the same height.
+    for(size_t j = 0; j + 1 < m_skyline.size();)
+    {
+        if(m_skyline[j].y == m_skyline[j + 1].y)
+        {
+            m_skyline[j].width += m_skyline[j + 1].width;
+            m_skyline.erase(m_skyline.begin() + j + 1);
+        }
+        else
+        {
+            ++j;
+        }
+    }
+}
+
+}   // namespace gl
@@ -0,0 +1,66 @@
+#ifndef SKYLINE_PACKER_H
+#define SKYLINE_PACKER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace gl
+{
+
+// Where a rectangle was placed by SkylinePacker.
+struct PackRect
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Packs rectangles into a fixed sized bin, tracking only the top edge of
+// what's been placed so far. Each rectangle goes where its top would be
+// lowest, which leaves few gaps for the texture sizes we see and keeps
+// inserts cheap. Padding is up to the caller.
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height);
+
+    // Find room for a width x height rectangle. Returns false if the bin is
+    // too full.
+    bool insert(int width, int height, PackRect& rect);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    // Bounds of everything inserted so far.
+    int usedWidth() const;
+    int usedHeight() const;
+
+    // Fraction of the bin covered by inserted rectangles.
+    float occupancy() const;
+
+private:
+    // A horizontal run of the skyline.
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    // Where a rectangle's bottom would be with its left edge on the segment
+    // at index, or -1 if it doesn't fit there.
+    int fit(size_t index, int width, int height) const;
+
+    // Raise the skyline under a rectangle placed on the segment at index.
+    void place(size_t index, const PackRect& rect);
+
+    int m_width;
+    int m_height;
+    long long m_usedArea;
+    std::vector<Segment> m_skyline;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,20 @@
+// Layout qualifiers SPIR-V requires but GLSL 330 doesn't allow. When the
+// build compiles a shader with glslangValidator -G, GL_SPIRV is defined and
+// these give uniforms and varyings explicit locations; otherwise they expand
+// to nothing. Include this first, before any declarations.
+#ifndef SPIRV_COMPAT_GLSL
+#define SPIRV_COMPAT_GLSL
+
+#ifdef GL_SPIRV
+#extension GL_ARB_explicit_uniform_location : require
+#extension GL_ARB_separate_shader_objects : require
+#extension GL_ARB_shading_language_420pack : require
+
+#define UNIFORM_LOCATION(n) layout (location = n)
+#define VARYING_LOCATION(n) layout (location = n)
+#else
+#define UNIFORM_LOCATION(n)
+#define VARYING_LOCATION(n)
+#endif
+
+#endif
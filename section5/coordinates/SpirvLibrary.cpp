@@ -0,0 +1,71 @@
+#include "SpirvLibrary.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace gl
+{
+
+constexpr size_t kSpecializeLogBufferSize = 512;
+
+SpirvLibrary::SpirvLibrary(const std::string& directory)
+    : m_directory(directory)
+    , m_enabled(false)
+{
+    // SPIR-V programs have no uniform names, so locations are matched up
+    // through program interface queries.
+    if(!(GLEW_VERSION_4_6 || GLEW_ARB_gl_spirv) || !(GLEW_VERSION_4_3 || GLEW_ARB_program_interface_query))
+        return;
+
+    // Not every driver lists SPIR-V in GL_SHADER_BINARY_FORMATS (Mesa
+    // doesn't), so the extension is all we go on.
+    m_enabled = readSpirvManifest(m_directory + "/manifest.txt", m_manifest);
+}
+
+const SpirvModule* SpirvLibrary::find(const std::string& path, const ShaderDefines& defines, const std::string& source) const
+{
+    if(!m_enabled)
+        return nullptr;
+
+    auto module = m_manifest.find(spirvModuleKey(path, defines));
+    if(module == m_manifest.end() || module->second.sourceHash != spirvSourceHash(source))
+        return nullptr;
+
+    return &module->second;
+}
+
+GLuint SpirvLibrary::createShader(GLenum stage, const SpirvModule& module) const
+{
+    const std::string path = m_directory + "/" + module.file;
+    std::string binary;
+    if(!readTextFile(path, binary) || binary.empty() || binary.size() % 4 != 0)
+    {
+        std::cerr << "ERROR::SPIRV_LIBRARY::MODULE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return 0;
+    }
+
+    GLuint shader = glCreateShader(stage);
+    glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, binary.data(), (GLsizei)binary.size());
+    if(GLEW_VERSION_4_6)
+        glSpecializeShader(shader, "main", 0, NULL, NULL);
+    else
+        glSpecializeShaderARB(shader, "main", 0, NULL, NULL);
+
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if(!success)
+    {
+        char infoLog[kSpecializeLogBufferSize];
+        memset(infoLog, 0, kSpecializeLogBufferSize);
+        glGetShaderInfoLog(shader, kSpecializeLogBufferSize, NULL, infoLog);
+        std::cerr << "ERROR::SPIRV_LIBRARY::SPECIALIZATION_FAILED: " << path << "\n" << infoLog << std::endl;
+
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+}   // namespace gl
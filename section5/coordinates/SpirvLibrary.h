@@ -0,0 +1,48 @@
+#ifndef SPIRV_LIBRARY_H
+#define SPIRV_LIBRARY_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "SpirvManifest.h"
+
+namespace gl
+{
+
+// SPIR-V modules compiled from the .glsl files at build time (see
+// spirv_tool.cpp), loaded with glShaderBinary and glSpecializeShader so the
+// driver skips parsing and validating GLSL.
+//
+// Requires a current GL context at construction. Without GL 4.6 or
+// ARB_gl_spirv, or without a manifest in directory, the library is disabled
+// and callers compile GLSL as before.
+class SpirvLibrary
+{
+public:
+    explicit SpirvLibrary(const std::string& directory);
+
+    SpirvLibrary(const SpirvLibrary& rhs) = delete;
+    SpirvLibrary& operator=(const SpirvLibrary& rhs) = delete;
+
+    bool enabled() const { return m_enabled; }
+
+    // The module built from path with defines, if there is one and it was
+    // built from exactly source (the expanded GLSL we'd otherwise compile).
+    const SpirvModule* find(const std::string& path, const ShaderDefines& defines, const std::string& source) const;
+
+    // Create and specialise a shader object of type stage from module.
+    // Returns 0, having logged why, if the driver rejects it.
+    GLuint createShader(GLenum stage, const SpirvModule& module) const;
+
+private:
+    std::string m_directory;
+    SpirvManifest m_manifest;
+    bool m_enabled;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,116 @@
+#include "SpirvManifest.h"
+
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string_view>
+
+#include "StringHash.h"
+
+namespace gl
+{
+
+uint64_t spirvModuleKey(const std::string& path, const ShaderDefines& defines)
+{
+    uint64_t key = hashString(path);
+    for(const auto& define : defines)
+    {
+        key = hashString(define.first, hashString("\n", key));
+        key = hashString(define.second, hashString("=", key));
+    }
+
+    return key;
+}
+
+uint64_t spirvSourceHash(const std::string& source)
+{
+    const std::string_view text(source);
+    uint64_t hash = hashString("");
+    for(size_t lineStart = 0; lineStart < text.size();)
+    {
+        size_t lineEnd = text.find('\n', lineStart);
+        lineEnd = lineEnd == std::string_view::npos ? text.size() : lineEnd + 1;
+        const std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd;
+
+        if(line.substr(0, 5) != "#line")
+            hash = hashString(line, hash);
+    }
+
+    return hash;
+}
+
+std::vector<std::pair<std::string, int>> parseUniformLocations(const std::string& source)
+{
+    static const std::regex s_declaration(R"(UNIFORM_LOCATION\s*\(\s*(\d+)\s*\)\s*uniform\s+\w+\s+(\w+))");
+
+    std::vector<std::pair<std::string, int>> uniforms;
+    for(auto match = std::sregex_iterator(source.begin(), source.end(), s_declaration);
+        match != std::sregex_iterator(); ++match)
+    {
+        uniforms.emplace_back((*match)[2].str(), std::stoi((*match)[1].str()));
+    }
+
+    return uniforms;
+}
+
+bool readSpirvManifest(const std::string& path, SpirvManifest& manifest)
+{
+    std::ifstream input(path);
+    if(!input)
+        return false;
+
+    SpirvModule* module = nullptr;
+    std::string line;
+    while(std::getline(input, line))
+    {
+        std::istringstream fields(line);
+        std::string kind;
+        if(!(fields >> kind) || kind[0] == '#')
+            continue;
+
+        if(kind == "module")
+        {
+            SpirvModule entry;
+            if(!(fields >> std::hex >> entry.key >> entry.sourceHash >> entry.file))
+            {
+                std::cerr << "ERROR::SPIRV_MANIFEST::BAD_ENTRY: " << path << ": " << line << std::endl;
+                return false;
+            }
+
+            module = &(manifest[entry.key] = std::move(entry));
+        }
+        else if(kind == "uniform" && module)
+        {
+            std::string name;
+            int location = -1;
+            if(fields >> std::dec >> location >> name)
+                module->uniforms.emplace_back(name, location);
+        }
+    }
+
+    return true;
+}
+
+bool writeSpirvManifest(const std::string& path, const std::vector<SpirvModule>& modules)
+{
+    std::ofstream output(path, std::ios_base::out | std::ios_base::trunc);
+    if(!output)
+    {
+        std::cerr << "ERROR::SPIRV_MANIFEST::NOT_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    output << "# SPIR-V modules built from the .glsl files, see SpirvManifest.h\n";
+    for(const SpirvModule& module : modules)
+    {
+        output << "module " << std::hex << module.key << " " << module.sourceHash << " " << module.file << "\n";
+        for(const auto& uniform : module.uniforms)
+            output << "uniform " << std::dec << uniform.second << " " << uniform.first << "\n";
+    }
+
+    return (bool)output;
+}
+
+}   // namespace gl
@@ -0,0 +1,53 @@
+#ifndef SPIRV_MANIFEST_H
+#define SPIRV_MANIFEST_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ShaderPreprocessor.h"
+
+namespace gl
+{
+
+// One shader stage compiled to SPIR-V at build time.
+struct SpirvModule
+{
+    // spirvModuleKey() of the file and defines it was built from.
+    uint64_t key;
+
+    // spirvSourceHash() of the expanded source, so a module that no longer
+    // matches its .glsl, e.g. after a hot reload edit, isn't used.
+    uint64_t sourceHash;
+
+    // Relative to the manifest.
+    std::string file;
+
+    // SPIR-V drops uniform names, so we keep them here, see
+    // parseUniformLocations().
+    std::vector<std::pair<std::string, int>> uniforms;
+};
+
+using SpirvManifest = std::unordered_map<uint64_t, SpirvModule>;
+
+// Shared by the build tool, which writes the manifest, and SpirvLibrary,
+// which reads it. Nothing here needs GL.
+
+uint64_t spirvModuleKey(const std::string& path, const ShaderDefines& defines);
+
+// Hash of source ignoring #line directives, whose file numbers depend on the
+// order files happened to be loaded in.
+uint64_t spirvSourceHash(const std::string& source);
+
+// Names and locations of uniforms declared as
+// `UNIFORM_LOCATION(n) uniform type name;`, see SpirvCompat.glsl.
+std::vector<std::pair<std::string, int>> parseUniformLocations(const std::string& source);
+
+bool readSpirvManifest(const std::string& path, SpirvManifest& manifest);
+bool writeSpirvManifest(const std::string& path, const std::vector<SpirvModule>& modules);
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,298 @@
+#include "Texture2D.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace gl
+{
+
+// How glTexImage2D is told about a sized format when it has to allocate the
+// levels itself, and how much memory it takes.
+struct TextureFormatInfo
+{
+    GLenum format;
+    GLenum type;
+    bool compressed;
+
+    // Bytes per texel of an uncompressed format, or per 4x4 block of a
+    // compressed one.
+    GLsizei bytes;
+};
+
+static TextureFormatInfo textureFormatInfo(GLenum internalFormat)
+{
+    switch(internalFormat)
+    {
+    case GL_RGBA16F: return {GL_RGBA, GL_HALF_FLOAT, false, 8};
+    case GL_RGB9_E5: return {GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, false, 4};
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return {GL_RGBA, GL_UNSIGNED_BYTE, true, 8};
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM: return {GL_RGBA, GL_UNSIGNED_BYTE, true, 16};
+    default: return {GL_RGBA, GL_UNSIGNED_BYTE, false, 4};
+    }
+}
+
+static size_t imageSize(const TextureFormatInfo& info, GLsizei width, GLsizei height)
+{
+    if(info.compressed)
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * info.bytes;
+
+    return (size_t)width * height * info.bytes;
+}
+
+static GLsizei fullLevelCount(GLsizei width, GLsizei height)
+{
+    GLsizei levels = 1;
+    for(GLsizei size = std::max(width, height); size > 1; size /= 2)
+        ++levels;
+
+    return levels;
+}
+
+Texture2D::Texture2D(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei levels)
+    : m_internalFormat(internalFormat)
+    , m_width(width)
+    , m_height(height)
+    , m_levels(levels > 0 ? std::min(levels, fullLevelCount(width, height)) : fullLevelCount(width, height))
+    , m_immutable(immutableStorageSupported())
+{
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+
+    if(m_immutable)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, m_levels, m_internalFormat, m_width, m_height);
+    }
+    else
+    {
+        // Without immutable storage the texture is only complete if its
+        // levels stop where ours do. Compressed levels are specified as
+        // they're uploaded, since glCompressedTexImage2D needs the data.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+
+        const TextureFormatInfo info = textureFormatInfo(m_internalFormat);
+        for(GLint level = 0; level < m_levels && !info.compressed; ++level)
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, m_internalFormat, levelWidth(level), levelHeight(level), 0,
+                         info.format, info.type, NULL);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+Texture2D::Texture2D(Texture2D&& rhs)
+    : m_texture(rhs.m_texture)
+    , m_internalFormat(rhs.m_internalFormat)
+    , m_width(rhs.m_width)
+    , m_height(rhs.m_height)
+    , m_levels(rhs.m_levels)
+    , m_immutable(rhs.m_immutable)
+{
+    rhs.m_texture = 0;
+}
+
+Texture2D& Texture2D::operator=(Texture2D&& rhs)
+{
+    if(this != &rhs)
+    {
+        release();
+        m_texture = rhs.m_texture;
+        m_internalFormat = rhs.m_internalFormat;
+        m_width = rhs.m_width;
+        m_height = rhs.m_height;
+        m_levels = rhs.m_levels;
+        m_immutable = rhs.m_immutable;
+        rhs.m_texture = 0;
+    }
+
+    return *this;
+}
+
+Texture2D::~Texture2D()
+{
+    release();
+}
+
+void Texture2D::release()
+{
+    if(m_texture)
+        glDeleteTextures(1, &m_texture);
+    m_texture = 0;
+}
+
+void Texture2D::upload(GLint level, GLenum format, GLenum type, const void* pixels)
+{
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelWidth(level), levelHeight(level), format, type, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture2D::uploadCompressed(GLint level, GLsizei size, const void* data)
+{
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    if(m_immutable)
+    {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelWidth(level), levelHeight(level),
+                                  m_internalFormat, size, data);
+    }
+    else
+    {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, m_internalFormat, levelWidth(level), levelHeight(level), 0,
+                               size, data);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GLsizei Texture2D::levelWidth(GLint level) const
+{
+    return std::max(1, m_width >> level);
+}
+
+GLsizei Texture2D::levelHeight(GLint level) const
+{
+    return std::max(1, m_height >> level);
+}
+
+size_t Texture2D::levelSize(GLint level) const
+{
+    return imageSize(textureFormatInfo(m_internalFormat), levelWidth(level), levelHeight(level));
+}
+
+size_t Texture2D::byteSize() const
+{
+    size_t size = 0;
+    for(GLint level = 0; level < m_levels && m_texture; ++level)
+        size += levelSize(level);
+
+    return size;
+}
+
+bool Texture2D::immutableStorageSupported()
+{
+    return GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+}
+
+bool Texture2D::compressed(GLenum internalFormat)
+{
+    return textureFormatInfo(internalFormat).compressed;
+}
+
+void Texture2D::pixelFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+{
+    const TextureFormatInfo info = textureFormatInfo(internalFormat);
+    format = info.format;
+    type = info.type;
+}
+
+Texture2DArray::Texture2DArray(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels)
+    : m_internalFormat(internalFormat)
+    , m_width(width)
+    , m_height(height)
+    , m_layers(layers)
+    , m_levels(levels > 0 ? std::min(levels, fullLevelCount(width, height)) : fullLevelCount(width, height))
+{
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+
+    if(Texture2D::immutableStorageSupported())
+    {
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, m_levels, m_internalFormat, m_width, m_height, m_layers);
+    }
+    else
+    {
+        // Every layer of a level is specified at once, so unlike Texture2D
+        // compressed levels are allocated here too, with no data.
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+
+        const TextureFormatInfo info = textureFormatInfo(m_internalFormat);
+        for(GLint level = 0; level < m_levels; ++level)
+        {
+            const GLsizei width = levelWidth(level);
+            const GLsizei height = levelHeight(level);
+            if(info.compressed)
+            {
+                const GLsizei size = (GLsizei)(imageSize(info, width, height) * m_layers);
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, m_internalFormat, width, height, m_layers, 0,
+                                       size, NULL);
+            }
+            else
+            {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, level, m_internalFormat, width, height, m_layers, 0,
+                             info.format, info.type, NULL);
+            }
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+Texture2DArray::Texture2DArray(Texture2DArray&& rhs)
+    : m_texture(rhs.m_texture)
+    , m_internalFormat(rhs.m_internalFormat)
+    , m_width(rhs.m_width)
+    , m_height(rhs.m_height)
+    , m_layers(rhs.m_layers)
+    , m_levels(rhs.m_levels)
+{
+    rhs.m_texture = 0;
+}
+
+Texture2DArray& Texture2DArray::operator=(Texture2DArray&& rhs)
+{
+    if(this != &rhs)
+    {
+        release();
+        m_texture = rhs.m_texture;
+        m_internalFormat = rhs.m_internalFormat;
+        m_width = rhs.m_width;
+        m_height = rhs.m_height;
+        m_layers = rhs.m_layers;
+        m_levels = rhs.m_levels;
+        rhs.m_texture = 0;
+    }
+
+    return *this;
+}
+
+Texture2DArray::~Texture2DArray()
+{
+    release();
+}
+
+void Texture2DArray::release()
+{
+    if(m_texture)
+        glDeleteTextures(1, &m_texture);
+    m_texture = 0;
+}
+
+void Texture2DArray::upload(GLint layer, GLint level, GLenum format, GLenum type, const void* pixels)
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth(level), levelHeight(level), 1,
+                    format, type, pixels);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+GLsizei Texture2DArray::levelWidth(GLint level) const
+{
+    return std::max(1, m_width >> level);
+}
+
+GLsizei Texture2DArray::levelHeight(GLint level) const
+{
+    return std::max(1, m_height >> level);
+}
+
+size_t Texture2DArray::byteSize() const
+{
+    const TextureFormatInfo info = textureFormatInfo(m_internalFormat);
+    size_t size = 0;
+    for(GLint level = 0; level < m_levels && m_texture; ++level)
+        size += imageSize(info, levelWidth(level), levelHeight(level)) * m_layers;
+
+    return size;
+}
+
+}   // namespace gl
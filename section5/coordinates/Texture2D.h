@@ -0,0 +1,131 @@
+#ifndef TEXTURE_2D_H
+#define TEXTURE_2D_H
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+namespace gl
+{
+
+// A 2D texture that owns its GL object. Storage for every level is allocated
+// up front with glTexStorage2D in a sized format, so the driver knows the
+// final shape and never has to convert or reallocate; without
+// ARB_texture_storage each level is specified with glTexImage2D instead.
+//
+// Sampling state lives in sampler objects (see SamplerCache), not here.
+class Texture2D
+{
+public:
+    Texture2D() = default;
+
+    // levels of 0 means a full chain down to 1x1.
+    Texture2D(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei levels = 0);
+
+    Texture2D(const Texture2D& rhs) = delete;
+    Texture2D& operator=(const Texture2D& rhs) = delete;
+
+    Texture2D(Texture2D&& rhs);
+    Texture2D& operator=(Texture2D&& rhs);
+
+    ~Texture2D();
+
+    // Replace all of level with pixels in format and type. With a pixel
+    // unpack buffer bound pixels is an offset into it.
+    void upload(GLint level, GLenum format, GLenum type, const void* pixels);
+
+    // Replace all of level with size bytes of blocks in the texture's own
+    // compressed format.
+    void uploadCompressed(GLint level, GLsizei size, const void* data);
+
+    bool valid() const { return m_texture != 0; }
+    GLuint id() const { return m_texture; }
+
+    GLenum internalFormat() const { return m_internalFormat; }
+    GLsizei width() const { return m_width; }
+    GLsizei height() const { return m_height; }
+    GLsizei levels() const { return m_levels; }
+
+    // Whether storage was allocated with glTexStorage2D.
+    bool immutable() const { return m_immutable; }
+
+    // Size of a level.
+    GLsizei levelWidth(GLint level) const;
+    GLsizei levelHeight(GLint level) const;
+
+    // Bytes of memory a level takes, and the whole texture.
+    size_t levelSize(GLint level) const;
+    size_t byteSize() const;
+
+    static bool immutableStorageSupported();
+
+    // Whether internalFormat is one of the block-compressed formats.
+    static bool compressed(GLenum internalFormat);
+
+    // The format and type pixels of an uncompressed internalFormat upload in
+    // without the driver converting them.
+    static void pixelFormat(GLenum internalFormat, GLenum& format, GLenum& type);
+
+private:
+    void release();
+
+    GLuint m_texture = 0;
+    GLenum m_internalFormat = 0;
+    GLsizei m_width = 0;
+    GLsizei m_height = 0;
+    GLsizei m_levels = 0;
+    bool m_immutable = false;
+};
+
+// Layers of same sized 2D textures in one GL_TEXTURE_2D_ARRAY, so a shader
+// can pick between them with an index rather than have each bound in turn.
+// Storage is allocated the same way as Texture2D's.
+class Texture2DArray
+{
+public:
+    Texture2DArray() = default;
+
+    // levels of 0 means a full chain down to 1x1.
+    Texture2DArray(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels = 0);
+
+    Texture2DArray(const Texture2DArray& rhs) = delete;
+    Texture2DArray& operator=(const Texture2DArray& rhs) = delete;
+
+    Texture2DArray(Texture2DArray&& rhs);
+    Texture2DArray& operator=(Texture2DArray&& rhs);
+
+    ~Texture2DArray();
+
+    // Replace all of level in one layer with pixels in format and type.
+    void upload(GLint layer, GLint level, GLenum format, GLenum type, const void* pixels);
+
+    bool valid() const { return m_texture != 0; }
+    GLuint id() const { return m_texture; }
+
+    GLenum internalFormat() const { return m_internalFormat; }
+    GLsizei width() const { return m_width; }
+    GLsizei height() const { return m_height; }
+    GLsizei layers() const { return m_layers; }
+    GLsizei levels() const { return m_levels; }
+
+    // Size of a level.
+    GLsizei levelWidth(GLint level) const;
+    GLsizei levelHeight(GLint level) const;
+
+    // Bytes of memory the whole array takes, every layer and level.
+    size_t byteSize() const;
+
+private:
+    void release();
+
+    GLuint m_texture = 0;
+    GLenum m_internalFormat = 0;
+    GLsizei m_width = 0;
+    GLsizei m_height = 0;
+    GLsizei m_layers = 0;
+    GLsizei m_levels = 0;
+};
+
+}   // namespace gl
+
+#endif
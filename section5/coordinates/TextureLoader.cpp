@@ -0,0 +1,406 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <utility>
+
+#include "MipGenerator.h"
+#include "PixelPacking.h"
+#include "ThreadPool.h"
+
+namespace gl
+{
+
+static GLenum compressedFormat(BlockFormat format)
+{
+    switch(format)
+    {
+    case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+}
+
+// Map the .dds texture_baker made of an image, if there is one the driver
+// can use.
+static bool mapBaked(const std::string& bakedPath, bool s3tcSupported, bool bptcSupported, DecodedImage& decoded)
+{
+    std::unique_ptr<MappedFile> file(new MappedFile(bakedPath));
+    if(!file->valid())
+        return false;
+
+    if(!parseDds(file->data(), file->size(), decoded.dds))
+    {
+        std::cerr << "ERROR::TEXTURE_LOADER::BAD_DDS: " << bakedPath << std::endl;
+        return false;
+    }
+
+    if(!(decoded.dds.format == BlockFormat::BC7 ? bptcSupported : s3tcSupported))
+        return false;
+
+    decoded.baked = std::move(file);
+    return true;
+}
+
+// What a worker needs to know to turn a file into a DecodedImage.
+struct DecodeSettings
+{
+    // Size of the first level wanted, and the JPEG scale to decode at on
+    // the way there.
+    int width;
+    int height;
+    int scale;
+    MipOptions mips;
+
+    // The texture's internal format, which says what to decode to.
+    GLenum format;
+};
+
+// RGBA8, or for an image with more than 8 bits a channel the HDR format,
+// falling back to GL_RGBA16F if GL_RGB9_E5 would lose its alpha.
+static GLenum textureFormat(const ImageView& probed, GLenum hdrFormat)
+{
+    if(probed.type != ImageChannelType::Half)
+        return GL_RGBA8;
+
+    const bool alpha = probed.channels == 2 || probed.channels == 4;
+    return hdrFormat == GL_RGB9_E5 && alpha ? GL_RGBA16F : hdrFormat;
+}
+
+// The largest scale a JPEG can be decoded at and still be at least width by
+// height, so what's left is a resample by less than half.
+static int decodeScale(int imageWidth, int imageHeight, int width, int height)
+{
+    int scale = 1;
+    while(scale < 8 && (imageWidth + scale * 2 - 1) / (scale * 2) >= width &&
+          (imageHeight + scale * 2 - 1) / (scale * 2) >= height)
+        scale *= 2;
+
+    return scale;
+}
+
+static DecodedImage decodeImage(ImageArenaPool& arenas, ThreadPool& pool, const std::string& path, const DecodeSettings& settings)
+{
+    // Three-channel images are padded to RGBA as they're decoded, so they
+    // upload to RGBA8 or RGBA16F storage with no conversion in the driver.
+    ImageDecodeOptions options;
+    options.flipVertically = true;
+    options.channels = 4;
+    options.scale = settings.scale;
+    options.highPrecision = settings.format != GL_RGBA8;
+
+    DecodedImage decoded;
+    decoded.arena = arenas.acquire();
+    ImageArena& arena = *decoded.arena;
+    ImageView& image = decoded.image;
+    if(!ImageDecoder::decodeFile(path, options, arena, image))
+        return decoded;
+
+    // The storage was allocated from the probe; if the file has changed
+    // since, the pixels won't fit it.
+    if((image.type == ImageChannelType::Half) != options.highPrecision)
+    {
+        std::cerr << "ERROR::TEXTURE_LOADER::FORMAT_CHANGED: " << path << std::endl;
+        image.pixels = nullptr;
+        return decoded;
+    }
+
+    const bool half = image.type == ImageChannelType::Half;
+
+    // Scaled down past maxDimension, or to the first level wanted, whatever
+    // the scaled decode didn't already do.
+    if(image.width != settings.width || image.height != settings.height)
+    {
+        if(half)
+        {
+            const std::vector<uint16_t> resampled = resampleImageHalf((const uint16_t*)image.pixels, image.width, image.height, image.channels,
+                                                                      settings.width, settings.height, settings.mips, &pool);
+            image.pixels = (unsigned char*)arena.allocate(resampled.size() * sizeof(uint16_t));
+            if(!image.pixels)
+            {
+                std::cerr << "ERROR::TEXTURE_LOADER::OUT_OF_MEMORY: " << path << std::endl;
+                return decoded;
+            }
+
+            std::copy(resampled.begin(), resampled.end(), (uint16_t*)image.pixels);
+        }
+        else
+        {
+            const std::vector<uint8_t> resampled = resampleImage(image.pixels, image.width, image.height, image.channels,
+                                                                 settings.width, settings.height, settings.mips, &pool);
+            image.pixels = (unsigned char*)arena.allocate(resampled.size());
+            if(!image.pixels)
+            {
+                std::cerr << "ERROR::TEXTURE_LOADER::OUT_OF_MEMORY: " << path << std::endl;
+                return decoded;
+            }
+
+            std::copy(resampled.begin(), resampled.end(), image.pixels);
+        }
+
+        image.width = settings.width;
+        image.height = settings.height;
+    }
+
+    // The rest of the chain goes straight after level 0 so each level can be
+    // found by its offset. The pixels are normally the arena's last
+    // allocation, in which case this grows them in place.
+    const size_t level0Size = image.size();
+    const size_t chainSize = mipChainSize(image.width, image.height, (int)(image.channels * image.channelSize()));
+    image.pixels = (unsigned char*)arena.reallocate(image.pixels, level0Size, level0Size + chainSize);
+    if(!image.pixels)
+    {
+        std::cerr << "ERROR::TEXTURE_LOADER::OUT_OF_MEMORY: " << path << std::endl;
+        return decoded;
+    }
+
+    if(half)
+        generateMipsHalf((const uint16_t*)image.pixels, image.width, image.height, image.channels, settings.mips,
+                         (uint16_t*)(image.pixels + level0Size), &pool);
+    else
+        generateMips(image.pixels, image.width, image.height, image.channels, settings.mips, image.pixels + level0Size, &pool);
+    decoded.levels = mipLevelCount(image.width, image.height);
+
+    // Filtered as halves, then every level packed down in place to 4 bytes a
+    // texel; the levels are found by the texture's sizes from here on.
+    if(settings.format == GL_RGB9_E5)
+    {
+        const size_t texels = (level0Size + chainSize) / (image.channels * image.channelSize());
+        packRgb9e5((const uint16_t*)image.pixels, (uint32_t*)image.pixels, texels);
+    }
+
+    return decoded;
+}
+
+// Keeps a decoded image alive until the scheduler has copied out the last of
+// it, then hands its arena back.
+struct UploadSource
+{
+    DecodedImage decoded;
+    std::shared_ptr<ImageArenaPool> arenas;
+
+    ~UploadSource()
+    {
+        if(arenas)
+            arenas->release(std::move(decoded.arena));
+    }
+};
+
+// Called as each level of a texture's incoming storage is uploaded.
+static void levelUploaded(StreamedTexture& texture, GLint level)
+{
+    // Sample only the levels that are in so far.
+    const Texture2D& target = texture.incoming.valid() ? texture.incoming : texture.texture;
+    glBindTexture(GL_TEXTURE_2D, target.id());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // A new texture is shown from its first mip; one being streamed again
+    // once it's caught up with the one it replaces.
+    const bool replace = texture.state != StreamedTexture::State::Ready || !texture.texture.valid() ||
+                         texture.streamLevel + level <= texture.firstLevel;
+    if(texture.incoming.valid() && replace)
+    {
+        texture.texture = std::move(texture.incoming);
+        texture.incoming = Texture2D();
+        texture.firstLevel = texture.streamLevel;
+        texture.state = StreamedTexture::State::Ready;
+    }
+
+    if(level == 0)
+        texture.streaming = false;
+}
+
+static void streamFailed(StreamedTexture& texture)
+{
+    // A failed restream leaves the texture we already had.
+    texture.incoming = Texture2D();
+    texture.streaming = false;
+    if(!texture.texture.valid())
+        texture.state = StreamedTexture::State::Failed;
+}
+
+TextureLoader::TextureLoader(ThreadPool& pool, const TextureLoaderOptions& options)
+    : m_pool(pool)
+    , m_arenas(std::make_shared<ImageArenaPool>())
+    , m_options(options)
+    , m_s3tcSupported(GLEW_EXT_texture_compression_s3tc)
+    , m_bptcSupported(GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc)
+    , m_placeholder(GL_RGBA8, 1, 1, 1)
+    , m_uploads(options.uploads)
+{
+    const unsigned char grey[4] = {128, 128, 128, 255};
+    m_placeholder.upload(0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+}
+
+TextureHandle TextureLoader::load(const std::string& path)
+{
+    std::shared_ptr<StreamedTexture> texture = std::make_shared<StreamedTexture>();
+    texture->path = path;
+    stream(texture);
+
+    return TextureHandle(texture, m_placeholder.id());
+}
+
+void TextureLoader::restream(const TextureHandle& handle, GLint firstLevel)
+{
+    const std::shared_ptr<StreamedTexture>& texture = handle.m_texture;
+    if(!texture || texture->streaming)
+        return;
+
+    texture->streamLevel = std::max(0, firstLevel);
+    stream(texture);
+}
+
+void TextureLoader::stream(const std::shared_ptr<StreamedTexture>& texture)
+{
+    const std::string& path = texture->path;
+    texture->streaming = true;
+
+    if(!m_options.bakedDirectory.empty())
+    {
+        DecodedImage baked;
+        const std::string bakedPath = m_options.bakedDirectory + "/" + path.substr(path.find_last_of("/\\") + 1) + ".dds";
+        if(mapBaked(bakedPath, m_s3tcSupported, m_bptcSupported, baked))
+        {
+            queueBaked(texture, std::move(baked));
+            return;
+        }
+    }
+
+    // The header is enough to allocate the texture, so it's there to upload
+    // into as soon as the pixels have been decoded.
+    ImageView probed;
+    if(!ImageDecoder::probeFile(path, probed))
+    {
+        streamFailed(*texture);
+        return;
+    }
+
+    int width = probed.width;
+    int height = probed.height;
+    fitDimensions(width, height, m_options.maxDimension);
+
+    const GLint levels = mipLevelCount(width, height);
+    texture->streamLevel = std::min(texture->streamLevel, levels - 1);
+    texture->incoming = Texture2D(textureFormat(probed, m_options.hdrFormat), std::max(1, width >> texture->streamLevel),
+                                  std::max(1, height >> texture->streamLevel), levels - texture->streamLevel);
+
+    // Only the levels from streamLevel down are decoded. A JPEG several times
+    // bigger than that is decoded straight at a fraction of its size, which
+    // is most of what makes bringing back a few mips cheap.
+    DecodeSettings settings;
+    settings.width = texture->incoming.width();
+    settings.height = texture->incoming.height();
+    settings.scale = decodeScale(probed.width, probed.height, settings.width, settings.height);
+    settings.mips = m_options.mips;
+    settings.format = texture->incoming.internalFormat();
+
+    // The pool of arenas is shared with the workers in case a decode is still
+    // running when the loader goes away.
+    std::shared_ptr<ImageArenaPool> arenas = m_arenas;
+
+    ThreadPool& pool = m_pool;
+    texture->decoded = m_pool.submit([arenas, &pool, path, settings]()
+    {
+        return decodeImage(*arenas, pool, path, settings);
+    });
+
+    m_pending.push_back(texture);
+}
+
+void TextureLoader::update()
+{
+    for(size_t i = 0; i < m_pending.size();)
+    {
+        const std::shared_ptr<StreamedTexture> texture = m_pending[i];
+        if(texture->decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++i;
+            continue;
+        }
+
+        DecodedImage decoded = texture->decoded.get();
+        if(decoded.image.pixels)
+        {
+            queueUpload(texture, std::move(decoded));
+        }
+        else
+        {
+            m_arenas->release(std::move(decoded.arena));
+            streamFailed(*texture);
+        }
+
+        m_pending.erase(m_pending.begin() + i);
+    }
+
+    m_uploads.update();
+}
+
+void TextureLoader::finish()
+{
+    for(const std::shared_ptr<StreamedTexture>& texture : m_pending)
+        texture->decoded.wait();
+
+    while(!m_pending.empty())
+        update();
+
+    m_uploads.finish();
+}
+
+void TextureLoader::queueUpload(const std::shared_ptr<StreamedTexture>& texture, DecodedImage decoded)
+{
+    const ImageView& image = decoded.image;
+    Texture2D& incoming = texture->incoming;
+
+    // The worker decoded to incoming's size, so the chain matches it level
+    // for level.
+    std::vector<const unsigned char*> levels;
+    const unsigned char* pixels = image.pixels;
+    for(GLint level = 0; level < decoded.levels; ++level)
+    {
+        levels.push_back(pixels);
+        pixels += incoming.levelSize(level);
+    }
+
+    GLenum format = 0;
+    GLenum type = 0;
+    Texture2D::pixelFormat(incoming.internalFormat(), format, type);
+
+    std::shared_ptr<UploadSource> source = std::make_shared<UploadSource>();
+    source->decoded = std::move(decoded);
+    source->arenas = m_arenas;
+
+    // In the texture's own format with the mips filtered on a worker, so
+    // there's no glGenerateMipmap().
+    for(GLint level = incoming.levels() - 1; level >= 0; --level)
+    {
+        m_uploads.enqueue(incoming, level, format, type, levels[level], source,
+                          [texture, level]() { levelUploaded(*texture, level); });
+    }
+}
+
+void TextureLoader::queueBaked(const std::shared_ptr<StreamedTexture>& texture, DecodedImage decoded)
+{
+    const std::vector<DdsLevel>& levels = decoded.dds.levels;
+    const size_t firstLevel = std::min((size_t)texture->streamLevel, levels.size() - 1);
+    texture->streamLevel = (GLint)firstLevel;
+    texture->incoming = Texture2D(compressedFormat(decoded.dds.format), levels[firstLevel].width,
+                                  levels[firstLevel].height, (GLsizei)(levels.size() - firstLevel));
+
+    std::shared_ptr<UploadSource> source = std::make_shared<UploadSource>();
+    source->decoded = std::move(decoded);
+    const unsigned char* data = (const unsigned char*)source->decoded.baked->data();
+
+    // The mip chain was built offline, so each level goes straight from the
+    // mapped file to the driver.
+    for(GLint level = texture->incoming.levels() - 1; level >= 0; --level)
+    {
+        const DdsLevel& dds = source->decoded.dds.levels[firstLevel + level];
+        m_uploads.enqueueCompressed(texture->incoming, level, data + dds.offset, source,
+                                    [texture, level]() { levelUploaded(*texture, level); });
+    }
+}
+
+}   // namespace gl
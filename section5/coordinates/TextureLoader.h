@@ -0,0 +1,204 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "DdsFile.h"
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "Texture2D.h"
+#include "UploadScheduler.h"
+
+namespace gl
+{
+
+class ThreadPool;
+
+// Pixels decoded on a worker, waiting to be uploaded. They live in the
+// arena, which goes back to the loader's pool once they have been copied out.
+// Baked textures are mapped instead, and uploaded straight from the file.
+struct DecodedImage
+{
+    // Level 0, with the rest of the mip chain straight after it.
+    ImageView image;
+    int levels = 1;
+    std::unique_ptr<ImageArena> arena;
+
+    std::unique_ptr<MappedFile> baked;
+    DdsInfo dds;
+};
+
+// State of a texture being streamed in by a TextureLoader.
+struct StreamedTexture
+{
+    enum class State
+    {
+        Decoding,
+        Ready,
+        Failed,
+        // Released to stay within a memory budget; see TextureResidency.
+        Evicted
+    };
+
+    State state = State::Decoding;
+    std::string path;
+
+    // From when the image is probed until its last level is uploaded. It may
+    // be replacing a texture that's already Ready.
+    bool streaming = false;
+    std::future<DecodedImage> decoded;
+
+    // Level of the full image the texture starts at, when the larger mips
+    // have been left out to save memory, and where the one being streamed
+    // in will start.
+    GLint firstLevel = 0;
+    GLint streamLevel = 0;
+
+    Texture2D texture;
+
+    // Storage allocated up front for the image being streamed, filled from
+    // the smallest mip up. It takes over from texture as soon as it has at
+    // least as much detail.
+    Texture2D incoming;
+};
+
+// Handle to a texture being streamed in. Until the pixels have been decoded
+// and uploaded id() is the loader's placeholder, so callers can bind it every
+// frame and pick up the real texture as soon as it's there. Cheap to copy.
+class TextureHandle
+{
+public:
+    TextureHandle() = default;
+
+    bool valid() const { return m_texture != nullptr; }
+    bool ready() const { return m_texture && m_texture->state == StreamedTexture::State::Ready; }
+    bool failed() const { return m_texture && m_texture->state == StreamedTexture::State::Failed; }
+
+    // Still gaining detail; the texture may only have its smaller mips.
+    bool streaming() const { return m_texture && m_texture->streaming; }
+
+    GLuint id() const { return ready() ? m_texture->texture.id() : m_placeholder; }
+
+    // The texture itself once ready, else null.
+    const Texture2D* texture() const { return ready() ? &m_texture->texture : nullptr; }
+
+private:
+    friend class TextureLoader;
+    friend class TextureResidency;
+
+    TextureHandle(std::shared_ptr<StreamedTexture> texture, GLuint placeholder)
+        : m_texture(std::move(texture))
+        , m_placeholder(placeholder)
+    {
+    }
+
+    std::shared_ptr<StreamedTexture> m_texture;
+    GLuint m_placeholder = 0;
+};
+
+struct TextureLoaderOptions
+{
+    // Where texture_baker puts its .dds files; empty to always decode.
+    std::string bakedDirectory;
+
+    // How much is uploaded each frame.
+    UploadSchedulerOptions uploads;
+
+    // Images bigger than this either way are scaled down as they're decoded;
+    // 0 for no limit.
+    int maxDimension = 0;
+
+    // How decoded images' mip chains are filtered. They're colour, so sRGB.
+    MipOptions mips{MipFilter::Kaiser, true};
+
+    // What HDR and 16-bit images are stored as, rather than RGBA8: half float
+    // GL_RGBA16F, or GL_RGB9_E5's shared exponent in half the memory for
+    // those without alpha. Both are linear, so mips ignores srgb for them.
+    GLenum hdrFormat = GL_RGBA16F;
+};
+
+// Streams textures in without blocking the render thread. Each image's
+// header is probed on load() so its storage can be allocated straight away.
+// The file is then read and decoded by ImageDecoder on a ThreadPool, into an
+// arena from a shared pool so steady-state loads don't touch the heap. The
+// workers also scale down images over maxDimension, decoding JPEGs at a
+// reduced scale where they can, and filter the mip chain with MipGenerator.
+// HDR and 16-bit images keep their range as half floats, packed further to
+// GL_RGB9_E5 if hdrFormat asks; past stb's decode of an HDR file, which is
+// packed to halves in place, they're never held as 32-bit floats.
+// update() hands finished images to an UploadScheduler, smallest mip first,
+// which uploads a few rows at a time within a per-frame budget; a texture can
+// be drawn from its first mip on, and sharpens as the rest arrive.
+//
+// If texture_baker has baked an image into bakedDirectory in a format the
+// driver supports, the .dds is mapped instead and its levels are uploaded
+// as they are, with nothing to decode.
+//
+// restream() decodes an image again, for TextureResidency to bring back
+// detail it dropped to stay within budget.
+//
+// Everything but the decoding happens on the GL thread.
+class TextureLoader
+{
+public:
+    explicit TextureLoader(ThreadPool& pool, const TextureLoaderOptions& options = TextureLoaderOptions());
+
+    TextureLoader(const TextureLoader& rhs) = delete;
+    TextureLoader& operator=(const TextureLoader& rhs) = delete;
+
+    // Start streaming the image at path into a texture.
+    TextureHandle load(const std::string& path);
+
+    // Decode a texture's image again and replace the texture with its mips
+    // from firstLevel down, e.g. to bring back detail that was dropped or
+    // evicted. The current texture stays in use until then. Does nothing
+    // while a decode is already in flight.
+    void restream(const TextureHandle& handle, GLint firstLevel = 0);
+
+    // Upload images that have finished decoding, up to one per pixel buffer.
+    // Call once per frame.
+    void update();
+
+    // Block until everything loaded so far is ready or has failed.
+    void finish();
+
+    size_t pending() const { return m_pending.size(); }
+
+    // Queue depth and bytes uploaded last update().
+    const UploadStats& uploadStats() const { return m_uploads.stats(); }
+
+    // A 1x1 grey texture, bound in place of textures still loading.
+    GLuint placeholder() const { return m_placeholder.id(); }
+
+private:
+    // Allocate storage for texture's image and start decoding it on the pool.
+    void stream(const std::shared_ptr<StreamedTexture>& texture);
+
+    // Queue a decoded image's levels for upload, smallest first.
+    void queueUpload(const std::shared_ptr<StreamedTexture>& texture, DecodedImage decoded);
+
+    // Queue every level of a baked texture the same way.
+    void queueBaked(const std::shared_ptr<StreamedTexture>& texture, DecodedImage decoded);
+
+    ThreadPool& m_pool;
+    std::shared_ptr<ImageArenaPool> m_arenas;
+
+    TextureLoaderOptions m_options;
+    bool m_s3tcSupported;
+    bool m_bptcSupported;
+
+    Texture2D m_placeholder;
+    UploadScheduler m_uploads;
+
+    std::vector<std::shared_ptr<StreamedTexture>> m_pending;
+};
+
+}   // namespace gl
+
+#endif
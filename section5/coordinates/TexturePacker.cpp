@@ -0,0 +1,238 @@
+#include "TexturePacker.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+#include "SkylinePacker.h"
+
+namespace gl
+{
+
+static GLsizei alignUp(GLsizei value, GLsizei alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Repeat the edge texels of the image at x, y on level out into the pad
+// texels around it, corners included.
+static void extendEdges(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLsizei pad)
+{
+    for(GLint i = 1; i <= pad; ++i)
+    {
+        glCopyImageSubData(texture, GL_TEXTURE_2D, level, x, y, 0,
+                           texture, GL_TEXTURE_2D, level, x - i, y, 0, 1, height, 1);
+        glCopyImageSubData(texture, GL_TEXTURE_2D, level, x + width - 1, y, 0,
+                           texture, GL_TEXTURE_2D, level, x + width - 1 + i, y, 0, 1, height, 1);
+    }
+
+    // The rows now span the left and right padding, so these fill the corners.
+    for(GLint i = 1; i <= pad; ++i)
+    {
+        glCopyImageSubData(texture, GL_TEXTURE_2D, level, x - pad, y, 0,
+                           texture, GL_TEXTURE_2D, level, x - pad, y - i, 0, width + 2 * pad, 1, 1);
+        glCopyImageSubData(texture, GL_TEXTURE_2D, level, x - pad, y + height - 1, 0,
+                           texture, GL_TEXTURE_2D, level, x - pad, y + height - 1 + i, 0, width + 2 * pad, 1, 1);
+    }
+}
+
+glm::vec2 PackedTexture::remap(glm::vec2 uv) const
+{
+    if(kind != Kind::Atlas)
+        return uv;
+
+    return glm::clamp(uv, glm::vec2(0.0f), glm::vec2(1.0f)) * uvScale + uvOffset;
+}
+
+void remapTexCoords(const PackedTexture& packed, GLfloat* texCoords, size_t count, size_t stride)
+{
+    for(size_t i = 0; i < count; ++i, texCoords += stride)
+    {
+        const glm::vec2 uv = packed.remap(glm::vec2(texCoords[0], texCoords[1]));
+        texCoords[0] = uv.x;
+        texCoords[1] = uv.y;
+    }
+}
+
+TexturePacker::TexturePacker(const TexturePackerOptions& options)
+    : m_options(options)
+    , m_maxArrayLayers(0)
+{
+    GLsizei padding = 1;
+    while(padding < m_options.padding)
+        padding *= 2;
+    m_options.padding = padding;
+
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &m_maxArrayLayers);
+}
+
+std::vector<PackedTexture> TexturePacker::pack(const std::vector<const Texture2D*>& textures)
+{
+    std::vector<PackedTexture> packed(textures.size());
+    for(size_t i = 0; i < textures.size(); ++i)
+        packed[i].texture = textures[i] ? textures[i]->id() : 0;
+
+    if(!supported())
+    {
+        std::cerr << "ERROR::TEXTURE_PACKER::UNSUPPORTED: needs ARB_copy_image" << std::endl;
+        return packed;
+    }
+
+    // Only textures that match in every way can share an array.
+    typedef std::tuple<GLenum, GLsizei, GLsizei, GLsizei> ArrayKey;
+    std::map<ArrayKey, std::vector<size_t>> arrayGroups;
+    for(size_t i = 0; i < textures.size(); ++i)
+    {
+        const Texture2D* texture = textures[i];
+        if(texture && texture->valid())
+        {
+            const ArrayKey key(texture->internalFormat(), texture->width(), texture->height(), texture->levels());
+            arrayGroups[key].push_back(i);
+        }
+    }
+
+    std::map<GLenum, std::vector<size_t>> atlasGroups;
+    for(const auto& group : arrayGroups)
+    {
+        const std::vector<size_t>& indices = group.second;
+        for(size_t first = 0; first < indices.size(); first += m_maxArrayLayers)
+        {
+            const size_t last = std::min(indices.size(), first + static_cast<size_t>(m_maxArrayLayers));
+            const std::vector<size_t> layers(indices.begin() + first, indices.begin() + last);
+            if(layers.size() >= m_options.minArrayLayers)
+            {
+                packArray(textures, layers, packed);
+            }
+            else if(!Texture2D::compressed(std::get<0>(group.first)))
+            {
+                std::vector<size_t>& atlas = atlasGroups[std::get<0>(group.first)];
+                atlas.insert(atlas.end(), layers.begin(), layers.end());
+            }
+        }
+    }
+
+    for(const auto& group : atlasGroups)
+        packAtlases(textures, group.second, packed);
+
+    return packed;
+}
+
+bool TexturePacker::supported()
+{
+    return GLEW_VERSION_4_3 || GLEW_ARB_copy_image;
+}
+
+void TexturePacker::packArray(const std::vector<const Texture2D*>& textures, const std::vector<size_t>& indices,
+                              std::vector<PackedTexture>& packed)
+{
+    const Texture2D& first = *textures[indices.front()];
+    Texture2DArray array(first.internalFormat(), first.width(), first.height(),
+                         static_cast<GLsizei>(indices.size()), first.levels());
+
+    for(GLint layer = 0; layer < array.layers(); ++layer)
+    {
+        const Texture2D& texture = *textures[indices[layer]];
+        for(GLint level = 0; level < array.levels(); ++level)
+        {
+            glCopyImageSubData(texture.id(), GL_TEXTURE_2D, level, 0, 0, 0,
+                               array.id(), GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                               texture.levelWidth(level), texture.levelHeight(level), 1);
+        }
+
+        PackedTexture& result = packed[indices[layer]];
+        result.kind = PackedTexture::Kind::Array;
+        result.target = GL_TEXTURE_2D_ARRAY;
+        result.texture = array.id();
+        result.layer = layer;
+    }
+
+    m_arrays.push_back(std::move(array));
+}
+
+void TexturePacker::packAtlases(const std::vector<const Texture2D*>& textures, std::vector<size_t> indices,
+                                std::vector<PackedTexture>& packed)
+{
+    const GLsizei padding = m_options.padding;
+
+    // Levels on which every image still starts on a whole texel with at
+    // least one texel of padding.
+    GLsizei levels = 1;
+    for(GLsizei alignment = padding; alignment > 1; alignment /= 2)
+        ++levels;
+
+    // Tallest first packs tightest on a skyline.
+    std::sort(indices.begin(), indices.end(), [&](size_t a, size_t b)
+    {
+        return std::make_pair(textures[a]->height(), textures[a]->width()) >
+               std::make_pair(textures[b]->height(), textures[b]->width());
+    });
+
+    while(!indices.empty())
+    {
+        SkylinePacker packer(m_options.maxAtlasSize, m_options.maxAtlasSize);
+        std::vector<std::pair<size_t, PackRect>> placed;
+        std::vector<size_t> remaining;
+        for(size_t index : indices)
+        {
+            // Sizes that are a multiple of the padding keep every rectangle
+            // aligned to it.
+            const Texture2D& texture = *textures[index];
+            PackRect rect;
+            if(packer.insert(alignUp(texture.width() + 2 * padding, padding),
+                             alignUp(texture.height() + 2 * padding, padding), rect))
+            {
+                placed.emplace_back(index, rect);
+            }
+            else
+            {
+                remaining.push_back(index);
+            }
+        }
+
+        // Nothing left fits, or an atlas of one would just be a copy.
+        if(placed.size() < 2)
+        {
+            if(placed.empty())
+                break;
+
+            indices = remaining;
+            continue;
+        }
+
+        GLsizei atlasLevels = levels;
+        for(const auto& entry : placed)
+            atlasLevels = std::min(atlasLevels, textures[entry.first]->levels());
+
+        Texture2D atlas(textures[placed.front().first]->internalFormat(), packer.usedWidth(), packer.usedHeight(),
+                        atlasLevels);
+
+        const glm::vec2 atlasSize(atlas.width(), atlas.height());
+        for(const auto& entry : placed)
+        {
+            const Texture2D& texture = *textures[entry.first];
+            const GLint x = entry.second.x + padding;
+            const GLint y = entry.second.y + padding;
+            for(GLint level = 0; level < atlas.levels(); ++level)
+            {
+                const GLsizei width = texture.levelWidth(level);
+                const GLsizei height = texture.levelHeight(level);
+                glCopyImageSubData(texture.id(), GL_TEXTURE_2D, level, 0, 0, 0,
+                                   atlas.id(), GL_TEXTURE_2D, level, x >> level, y >> level, 0, width, height, 1);
+                extendEdges(atlas.id(), level, x >> level, y >> level, width, height, padding >> level);
+            }
+
+            PackedTexture& result = packed[entry.first];
+            result.kind = PackedTexture::Kind::Atlas;
+            result.target = GL_TEXTURE_2D;
+            result.texture = atlas.id();
+            result.uvScale = glm::vec2(texture.width(), texture.height()) / atlasSize;
+            result.uvOffset = glm::vec2(x, y) / atlasSize;
+        }
+
+        m_atlases.push_back(std::move(atlas));
+        indices = remaining;
+    }
+}
+
+}   // namespace gl
@@ -0,0 +1,115 @@
+#ifndef TEXTURE_PACKER_H
+#define TEXTURE_PACKER_H
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Texture2D.h"
+
+namespace gl
+{
+
+// Where TexturePacker put a texture and how to sample it there.
+struct PackedTexture
+{
+    enum class Kind
+    {
+        // Left as it was; bind the original.
+        Unpacked,
+        // A layer of a texture array.
+        Array,
+        // A rectangle of an atlas.
+        Atlas
+    };
+
+    Kind kind = Kind::Unpacked;
+
+    // What to bind: a GL_TEXTURE_2D_ARRAY for arrays, else a GL_TEXTURE_2D.
+    GLenum target = GL_TEXTURE_2D;
+    GLuint texture = 0;
+
+    // Layer to sample from an array.
+    GLint layer = 0;
+
+    // Maps the texture's own UVs to the atlas. Identity unless in one.
+    glm::vec2 uvScale = glm::vec2(1.0f);
+    glm::vec2 uvOffset = glm::vec2(0.0f);
+
+    // uv moved into the atlas. The neighbours there aren't repeats, so it's
+    // clamped to the texture's edges first.
+    glm::vec2 remap(glm::vec2 uv) const;
+};
+
+// Rewrite count texture coordinates, each stride floats after the last,
+// from a mesh's own UVs to where its texture was packed.
+void remapTexCoords(const PackedTexture& packed, GLfloat* texCoords, size_t count, size_t stride);
+
+struct TexturePackerOptions
+{
+    // Largest atlas to create, either way.
+    GLsizei maxAtlasSize = 2048;
+
+    // Texels of each image's edge repeated around it in an atlas, so
+    // filtering doesn't pick up its neighbours. Rounded up to a power of two
+    // and also used as the alignment, which gives an atlas log2(padding) + 1
+    // mip levels, all with at least one texel of padding.
+    GLsizei padding = 4;
+
+    // Fewest textures of the same size and format to put in an array. Fewer
+    // go in an atlas instead.
+    size_t minArrayLayers = 2;
+};
+
+// Collapses textures into fewer GL objects so a batch of draws can share
+// one binding and pick its texture with a layer index or UV offset.
+//
+// Textures with the same size, format and mip count become the layers of a
+// Texture2DArray, with every level kept. Uncompressed textures left over
+// are packed by format into atlases with a SkylinePacker, padded and
+// aligned for their first few levels. A texture that would be on its own is
+// left where it is.
+//
+// The texels are copied on the GPU with glCopyImageSubData, so nothing is
+// read back, and the sources can be released once pack() returns.
+class TexturePacker
+{
+public:
+    explicit TexturePacker(const TexturePackerOptions& options = TexturePackerOptions());
+
+    TexturePacker(const TexturePacker& rhs) = delete;
+    TexturePacker& operator=(const TexturePacker& rhs) = delete;
+
+    // Pack textures, returning where each one went in the same order. Only
+    // call if supported().
+    std::vector<PackedTexture> pack(const std::vector<const Texture2D*>& textures);
+
+    // Everything created so far; they live as long as the packer.
+    const std::vector<Texture2DArray>& arrays() const { return m_arrays; }
+    const std::vector<Texture2D>& atlases() const { return m_atlases; }
+
+    // Needs GL 4.3 or ARB_copy_image.
+    static bool supported();
+
+private:
+    // Copy each texture into a layer of a new array.
+    void packArray(const std::vector<const Texture2D*>& textures, const std::vector<size_t>& indices,
+                   std::vector<PackedTexture>& packed);
+
+    // Fit as many of the textures as possible into atlases. Those that end
+    // up alone are left unpacked.
+    void packAtlases(const std::vector<const Texture2D*>& textures, std::vector<size_t> indices,
+                     std::vector<PackedTexture>& packed);
+
+    TexturePackerOptions m_options;
+    GLsizei m_maxArrayLayers;
+
+    std::vector<Texture2DArray> m_arrays;
+    std::vector<Texture2D> m_atlases;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,248 @@
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <utility>
+
+namespace gl
+{
+
+TextureResidency::TextureResidency(TextureLoader& loader, const TextureResidencyOptions& options)
+    : m_loader(loader)
+    , m_options(options)
+    , m_copySupported(GLEW_VERSION_4_3 || GLEW_ARB_copy_image)
+    , m_frame(0)
+    , m_residentBytes(0)
+{
+}
+
+void TextureResidency::track(const TextureHandle& handle)
+{
+    if(handle.valid())
+        entry(handle);
+}
+
+void TextureResidency::release(const TextureHandle& handle)
+{
+    auto found = m_indices.find(handle.m_texture.get());
+    if(found == m_indices.end())
+        return;
+
+    // Move the last entry into its place.
+    const size_t index = found->second;
+    m_indices.erase(found);
+    evict(m_entries[index]);
+    if(index != m_entries.size() - 1)
+    {
+        m_entries[index] = std::move(m_entries.back());
+        m_indices[m_entries[index].texture.get()] = index;
+    }
+
+    m_entries.pop_back();
+}
+
+void TextureResidency::track(const Texture2DArray& array)
+{
+    if(array.valid())
+        m_arrays[array.id()] = array.byteSize();
+}
+
+void TextureResidency::untrack(const Texture2DArray& array)
+{
+    m_arrays.erase(array.id());
+}
+
+void TextureResidency::use(const TextureHandle& handle, float screenSize)
+{
+    if(!handle.valid())
+        return;
+
+    // Drawn more than once a frame, the largest counts.
+    Entry& used = entry(handle);
+    if(used.lastUsedFrame != m_frame)
+        used.screenSize = screenSize;
+    else
+        used.screenSize = std::max(used.screenSize, screenSize);
+
+    used.lastUsedFrame = m_frame;
+}
+
+void TextureResidency::update()
+{
+    m_stats = ResidencyStats();
+    m_stats.textures = m_entries.size();
+
+    m_residentBytes = 0;
+    for(const auto& array : m_arrays)
+        m_residentBytes += array.second;
+
+    std::vector<size_t> resident;
+    for(size_t i = 0; i < m_entries.size(); ++i)
+    {
+        Entry& entry = m_entries[i];
+        // Textures still being uploaded count, but are left alone until
+        // they're done.
+        const StreamedTexture& texture = *entry.texture;
+        m_residentBytes += texture.texture.byteSize() + texture.incoming.byteSize();
+        if(texture.state != StreamedTexture::State::Ready || texture.streaming)
+            continue;
+
+        entry.fullSize = std::max(texture.texture.width(), texture.texture.height()) << texture.firstLevel;
+        entry.fullBytes = texture.texture.byteSize() << (2 * texture.firstLevel);
+        resident.push_back(i);
+    }
+
+    // Least recently used first, then those smallest on screen.
+    std::sort(resident.begin(), resident.end(), [this](size_t a, size_t b)
+    {
+        return std::make_tuple(m_entries[a].lastUsedFrame, m_entries[a].screenSize) <
+               std::make_tuple(m_entries[b].lastUsedFrame, m_entries[b].screenSize);
+    });
+
+    // What was drawn this frame with less detail than it needs.
+    size_t wantedBytes = 0;
+    std::vector<size_t> restreams;
+    for(size_t i = 0; i < m_entries.size(); ++i)
+    {
+        const Entry& entry = m_entries[i];
+        const StreamedTexture& texture = *entry.texture;
+        if(entry.lastUsedFrame != m_frame || texture.streaming || entry.fullSize == 0)
+            continue;
+
+        const GLint wanted = wantedLevel(entry);
+        if(texture.state == StreamedTexture::State::Evicted)
+            wantedBytes += chainBytes(entry, wanted);
+        else if(texture.state == StreamedTexture::State::Ready && texture.firstLevel > wanted)
+            wantedBytes += chainBytes(entry, wanted) - texture.texture.byteSize();
+        else
+            continue;
+
+        restreams.push_back(i);
+    }
+
+    // Idle textures make way for those that are drawn.
+    for(size_t i = 0; i < resident.size() && m_residentBytes + wantedBytes > m_options.budget; ++i)
+    {
+        Entry& entry = m_entries[resident[i]];
+        if(m_frame - entry.lastUsedFrame > m_options.evictAfterFrames)
+            evict(entry);
+    }
+
+    for(size_t i = 0; i < resident.size() && m_residentBytes > m_options.budget; ++i)
+    {
+        Entry& entry = m_entries[resident[i]];
+        if(entry.texture->state == StreamedTexture::State::Ready && entry.texture->firstLevel < wantedLevel(entry))
+            downgrade(entry, wantedLevel(entry));
+    }
+
+    // Take a level at a time from each so the loss is spread around.
+    bool progress = true;
+    while(progress && m_residentBytes > m_options.budget)
+    {
+        progress = false;
+        for(size_t i = 0; i < resident.size() && m_residentBytes > m_options.budget; ++i)
+        {
+            Entry& entry = m_entries[resident[i]];
+            if(entry.texture->state == StreamedTexture::State::Ready && entry.texture->firstLevel < lowestLevel(entry))
+                progress = downgrade(entry, entry.texture->firstLevel + 1) || progress;
+        }
+    }
+
+    // Bring back detail where there's now room for it.
+    for(size_t i : restreams)
+    {
+        Entry& entry = m_entries[i];
+        StreamedTexture& texture = *entry.texture;
+        const GLint wanted = wantedLevel(entry);
+        const size_t current = texture.state == StreamedTexture::State::Ready ? texture.texture.byteSize() : 0;
+        const size_t needed = chainBytes(entry, wanted);
+        if(m_residentBytes - current + needed > m_options.budget)
+            continue;
+
+        m_loader.restream(TextureHandle(entry.texture, 0), wanted);
+        m_residentBytes += needed - current;
+        ++m_stats.restreamed;
+    }
+
+    m_stats.residentBytes = m_residentBytes;
+    ++m_frame;
+}
+
+TextureResidency::Entry& TextureResidency::entry(const TextureHandle& handle)
+{
+    auto found = m_indices.find(handle.m_texture.get());
+    if(found != m_indices.end())
+        return m_entries[found->second];
+
+    m_indices.emplace(handle.m_texture.get(), m_entries.size());
+    m_entries.emplace_back();
+    m_entries.back().texture = handle.m_texture;
+    m_entries.back().lastUsedFrame = m_frame;
+    return m_entries.back();
+}
+
+GLint TextureResidency::wantedLevel(const Entry& entry) const
+{
+    GLint level = 0;
+    if(entry.screenSize > 0.0f && entry.screenSize < entry.fullSize)
+        level = (GLint)std::floor(std::log2(entry.fullSize / entry.screenSize));
+
+    return std::min(level, lowestLevel(entry));
+}
+
+GLint TextureResidency::lowestLevel(const Entry& entry) const
+{
+    GLint level = 0;
+    while((entry.fullSize >> (level + 1)) >= m_options.minDimension)
+        ++level;
+
+    return level;
+}
+
+bool TextureResidency::downgrade(Entry& entry, GLint firstLevel)
+{
+    if(!m_copySupported)
+    {
+        evict(entry);
+        return true;
+    }
+
+    StreamedTexture& texture = *entry.texture;
+    const GLint drop = firstLevel - texture.firstLevel;
+    if(drop <= 0 || drop >= texture.texture.levels())
+        return false;
+
+    // The smaller levels are already on the GPU, so copy them rather than
+    // decode the image again.
+    const Texture2D& from = texture.texture;
+    Texture2D smaller(from.internalFormat(), from.levelWidth(drop), from.levelHeight(drop), from.levels() - drop);
+    for(GLint level = 0; level < smaller.levels(); ++level)
+    {
+        glCopyImageSubData(from.id(), GL_TEXTURE_2D, level + drop, 0, 0, 0,
+                           smaller.id(), GL_TEXTURE_2D, level, 0, 0, 0,
+                           smaller.levelWidth(level), smaller.levelHeight(level), 1);
+    }
+
+    m_residentBytes -= from.byteSize() - smaller.byteSize();
+    texture.texture = std::move(smaller);
+    texture.firstLevel = firstLevel;
+    ++m_stats.downgraded;
+    return true;
+}
+
+void TextureResidency::evict(Entry& entry)
+{
+    StreamedTexture& texture = *entry.texture;
+    m_residentBytes -= texture.texture.byteSize();
+    texture.texture = Texture2D();
+    texture.state = StreamedTexture::State::Evicted;
+    ++m_stats.evicted;
+}
+
+size_t TextureResidency::chainBytes(const Entry& entry, GLint firstLevel)
+{
+    return entry.fullBytes >> (2 * firstLevel);
+}
+
+}   // namespace gl
@@ -0,0 +1,143 @@
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "TextureLoader.h"
+
+namespace gl
+{
+
+struct TextureResidencyOptions
+{
+    // Bytes of texture memory to stay within.
+    size_t budget = 256 * 1024 * 1024;
+
+    // Textures unused for longer than this are evicted outright rather than
+    // downgraded, when there's need.
+    uint64_t evictAfterFrames = 120;
+
+    // Textures in use are never downgraded below this size either way.
+    GLsizei minDimension = 64;
+};
+
+// What TextureResidency did last update().
+struct ResidencyStats
+{
+    size_t residentBytes = 0;
+    size_t textures = 0;
+    size_t evicted = 0;
+    size_t downgraded = 0;
+    size_t restreamed = 0;
+};
+
+// Keeps the textures streamed by a TextureLoader within a memory budget, so
+// content bigger than the GPU's memory degrades a little at a time rather
+// than having the driver page textures in and out mid-frame.
+//
+// Callers say which textures they draw each frame and how large they appear
+// on screen. When the textures take more than the budget, update() frees
+// memory in order of least harm:
+//   - textures that haven't been used for a while are evicted, and show the
+//     loader's placeholder until used again;
+//   - mips larger than a texture appears on screen are dropped;
+//   - then the least recently used and smallest on screen textures lose a
+//     level at a time, down to minDimension.
+// Mips are dropped by copying the rest of the chain into a smaller texture
+// on the GPU, which needs ARB_copy_image; without it textures are evicted
+// instead. Once there is room again, textures that are drawn larger than
+// what's resident are decoded again by the loader at the detail they need.
+// The old texture is kept until the new one catches up, so usage can run
+// over the budget for the few frames that takes.
+//
+// Texture arrays a TexturePacker built from streamed textures count against
+// the budget too, but are left as they are: their layers can't be decoded
+// again. The textures packed into them should be released once the array is
+// drawn instead.
+class TextureResidency
+{
+public:
+    explicit TextureResidency(TextureLoader& loader, const TextureResidencyOptions& options = TextureResidencyOptions());
+
+    TextureResidency(const TextureResidency& rhs) = delete;
+    TextureResidency& operator=(const TextureResidency& rhs) = delete;
+
+    // Start managing a texture.
+    void track(const TextureHandle& handle);
+
+    // Stop managing a texture that has finished streaming and free its
+    // storage, for one whose contents have been packed elsewhere. Its handle
+    // shows the loader's placeholder from then on.
+    void release(const TextureHandle& handle);
+
+    // Count a packed array against the budget until it's untracked.
+    void track(const Texture2DArray& array);
+    void untrack(const Texture2DArray& array);
+
+    // Note that handle is drawn this frame, screenSize pixels across at its
+    // largest. The default asks for full detail.
+    void use(const TextureHandle& handle, float screenSize = std::numeric_limits<float>::max());
+
+    // Bring the textures within budget. Call once per frame, after the
+    // loader's update().
+    void update();
+
+    const ResidencyStats& stats() const { return m_stats; }
+    size_t budget() const { return m_options.budget; }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<StreamedTexture> texture;
+        uint64_t lastUsedFrame = 0;
+        float screenSize = 0.0f;
+
+        // Size of the full image at its largest and the bytes it takes with
+        // every level, as of when it was last resident.
+        GLsizei fullSize = 0;
+        size_t fullBytes = 0;
+    };
+
+    Entry& entry(const TextureHandle& handle);
+
+    // Mip of the full image that's about screenSize across, but no smaller
+    // than minDimension.
+    GLint wantedLevel(const Entry& entry) const;
+
+    // Level of the full image at which a texture is as small as it's allowed
+    // to get.
+    GLint lowestLevel(const Entry& entry) const;
+
+    // Replace a texture with its mips from firstLevel of the full image down.
+    bool downgrade(Entry& entry, GLint firstLevel);
+
+    void evict(Entry& entry);
+
+    // About how many bytes the texture would take starting at firstLevel.
+    static size_t chainBytes(const Entry& entry, GLint firstLevel);
+
+    TextureLoader& m_loader;
+    TextureResidencyOptions m_options;
+    bool m_copySupported;
+
+    uint64_t m_frame;
+    size_t m_residentBytes;
+    std::vector<Entry> m_entries;
+    std::unordered_map<const StreamedTexture*, size_t> m_indices;
+
+    // Bytes of each packed array by its name.
+    std::unordered_map<GLuint, size_t> m_arrays;
+
+    ResidencyStats m_stats;
+};
+
+}   // namespace gl
+
+#endif
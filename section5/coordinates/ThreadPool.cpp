@@ -0,0 +1,140 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <utility>
+
+namespace gl
+{
+
+// State shared by the threads taking part in a parallelFor(). Workers that
+// only get to their task after the loop has finished find nothing left and
+// never touch body, which may be gone by then.
+struct ParallelFor
+{
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    size_t count = 0;
+    const std::function<void(size_t)>* body = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t done = 0;
+    std::exception_ptr error;
+};
+
+static void runIterations(ParallelFor& loop)
+{
+    // An iteration that throws still counts as done, or the caller would wait
+    // forever. Once one has, the rest are skipped.
+    size_t completed = 0;
+    std::exception_ptr error;
+    for(size_t i = loop.next++; i < loop.count; i = loop.next++, ++completed)
+    {
+        if(loop.failed)
+            continue;
+
+        try
+        {
+            (*loop.body)(i);
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+            loop.failed = true;
+        }
+    }
+
+    if(completed == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(loop.mutex);
+    if(error && !loop.error)
+        loop.error = error;
+
+    loop.done += completed;
+    if(loop.done == loop.count)
+        loop.finished.notify_all();
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+    : m_stopping(false)
+{
+    if(threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    m_threads.reserve(threadCount);
+    for(unsigned i = 0; i < threadCount; ++i)
+        m_threads.emplace_back(&ThreadPool::run, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_condition.notify_all();
+    for(std::thread& thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    if(count == 0)
+        return;
+
+    std::shared_ptr<ParallelFor> loop = std::make_shared<ParallelFor>();
+    loop->count = count;
+    loop->body = &body;
+
+    const size_t helpers = std::min(count - 1, m_threads.size());
+    for(size_t i = 0; i < helpers; ++i)
+        enqueue([loop]() { runIterations(*loop); });
+
+    runIterations(*loop);
+
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->finished.wait(lock, [&loop]() { return loop->done == loop->count; });
+    if(loop->error)
+        std::rethrow_exception(loop->error);
+}
+
+size_t ThreadPool::queued()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.size();
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+
+    m_condition.notify_one();
+}
+
+void ThreadPool::run()
+{
+    for(;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if(m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+}   // namespace gl
@@ -0,0 +1,74 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace gl
+{
+
+// Fixed set of worker threads running queued tasks in FIFO order. Work still
+// queued when the pool is destroyed is finished first.
+class ThreadPool
+{
+public:
+    // threadCount of 0 means one per hardware thread.
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    ThreadPool(const ThreadPool& rhs) = delete;
+    ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+    ~ThreadPool();
+
+    // Queue task and return a future for its result.
+    template<typename F>
+    auto submit(F&& task) -> std::future<typename std::result_of<F()>::type>;
+
+    // Run body(i) for every i below count on the workers and the calling
+    // thread, returning once all have finished. The caller works through
+    // iterations rather than blocking, so this is safe to call from a task
+    // running on this pool. If body throws, the iterations not yet started
+    // are skipped and the first exception is rethrown here once the rest
+    // have finished.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    size_t threadCount() const { return m_threads.size(); }
+
+    // Tasks queued but not yet started.
+    size_t queued();
+
+private:
+    void enqueue(std::function<void()> task);
+    void run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stopping;
+
+    std::vector<std::thread> m_threads;
+};
+
+template<typename F>
+auto ThreadPool::submit(F&& task) -> std::future<typename std::result_of<F()>::type>
+{
+    using Result = typename std::result_of<F()>::type;
+
+    // std::function needs a copyable callable, so share the packaged_task.
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> result = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+
+    return result;
+}
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,152 @@
+#include "TileStore.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace gl
+{
+
+constexpr uint32_t kTileStoreMagic = 0x54564c47;   // "GLVT"
+constexpr uint32_t kTileStoreVersion = 1;
+
+// Tiles start on a page boundary.
+constexpr size_t kTileStoreAlignment = 4096;
+
+// Laid out as in the file, which is little-endian like everything we run on.
+struct TileStoreHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tileSize;
+    uint32_t border;
+    uint32_t levels;
+};
+
+const char* tileFormatName(TileFormat format)
+{
+    switch(format)
+    {
+    case TileFormat::RGBA8: return "rgba8";
+    case TileFormat::BC1: return "bc1";
+    case TileFormat::BC3: return "bc3";
+    default: return "bc7";
+    }
+}
+
+BlockFormat tileBlockFormat(TileFormat format)
+{
+    switch(format)
+    {
+    case TileFormat::BC1: return BlockFormat::BC1;
+    case TileFormat::BC3: return BlockFormat::BC3;
+    default: return BlockFormat::BC7;
+    }
+}
+
+size_t TileStoreInfo::tileCount() const
+{
+    if(levels.empty())
+        return 0;
+
+    const TileLevel& last = levels.back();
+    return last.firstTile + (size_t)last.tilesX * last.tilesY;
+}
+
+size_t TileStoreInfo::tileOffset(int level, int x, int y) const
+{
+    const TileLevel& tiles = levels[level];
+    return dataOffset + (tiles.firstTile + (size_t)y * tiles.tilesX + x) * tileBytes;
+}
+
+bool layoutTileStore(TileFormat format, int width, int height, int tileSize, int border, TileStoreInfo& info)
+{
+    if(width <= 0 || height <= 0 || tileSize <= 0 || tileSize % 4 != 0 || border < 0 || border % 4 != 0)
+    {
+        std::cerr << "ERROR::TILE_STORE::BAD_LAYOUT: " << width << "x" << height << " in tiles of " << tileSize
+                  << " with a border of " << border << std::endl;
+        return false;
+    }
+
+    info.format = format;
+    info.width = width;
+    info.height = height;
+    info.tileSize = tileSize;
+    info.border = border;
+    info.levels.clear();
+
+    const int padded = info.paddedTileSize();
+    info.tileBytes = format == TileFormat::RGBA8 ? (size_t)padded * padded * 4
+                                                 : blockLevelSize(tileBlockFormat(format), padded, padded);
+    info.dataOffset = kTileStoreAlignment;
+
+    size_t firstTile = 0;
+    for(;;)
+    {
+        TileLevel level;
+        level.width = width;
+        level.height = height;
+        level.tilesX = (width + tileSize - 1) / tileSize;
+        level.tilesY = (height + tileSize - 1) / tileSize;
+        level.firstTile = firstTile;
+        if(level.tilesX > kMaxTilesPerSide || level.tilesY > kMaxTilesPerSide || (int)info.levels.size() == kMaxTileLevels)
+        {
+            std::cerr << "ERROR::TILE_STORE::TOO_LARGE: " << info.width << "x" << info.height << " in tiles of "
+                      << tileSize << std::endl;
+            return false;
+        }
+
+        info.levels.push_back(level);
+        firstTile += (size_t)level.tilesX * level.tilesY;
+        if(level.tilesX == 1 && level.tilesY == 1)
+            break;
+
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+
+    return true;
+}
+
+bool parseTileStore(const void* data, size_t size, TileStoreInfo& info)
+{
+    TileStoreHeader header;
+    if(size < sizeof(header))
+        return false;
+
+    std::memcpy(&header, data, sizeof(header));
+    if(header.magic != kTileStoreMagic || header.version != kTileStoreVersion ||
+       header.format > (uint32_t)TileFormat::BC7 || header.width > (uint32_t)kMaxTilesPerSide * header.tileSize ||
+       header.height > (uint32_t)kMaxTilesPerSide * header.tileSize || header.border > header.tileSize)
+        return false;
+
+    if(!layoutTileStore((TileFormat)header.format, (int)header.width, (int)header.height, (int)header.tileSize,
+                        (int)header.border, info))
+        return false;
+
+    return info.levels.size() == header.levels && info.dataOffset <= size &&
+           info.tileCount() <= (size - info.dataOffset) / info.tileBytes;
+}
+
+bool writeTileStoreHeader(std::ostream& file, const TileStoreInfo& info)
+{
+    TileStoreHeader header;
+    header.magic = kTileStoreMagic;
+    header.version = kTileStoreVersion;
+    header.format = (uint32_t)info.format;
+    header.width = (uint32_t)info.width;
+    header.height = (uint32_t)info.height;
+    header.tileSize = (uint32_t)info.tileSize;
+    header.border = (uint32_t)info.border;
+    header.levels = (uint32_t)info.levels.size();
+
+    const std::string padding(info.dataOffset - sizeof(header), '\0');
+    file.write((const char*)&header, sizeof(header));
+    file.write(padding.data(), padding.size());
+    return (bool)file;
+}
+
+}   // namespace gl
@@ -0,0 +1,95 @@
+#ifndef TILE_STORE_H
+#define TILE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "DdsFile.h"
+
+namespace gl
+{
+
+// Limits of a store, so a tile's level and position pack into 32 bits: 4
+// bits of level and 14 of each coordinate.
+constexpr int kMaxTileLevels = 16;
+constexpr int kMaxTilesPerSide = 1 << 14;
+
+// How the texels of each tile are stored: as they are, or block-compressed
+// to upload straight into a compressed cache.
+enum class TileFormat
+{
+    RGBA8,
+    BC1,
+    BC3,
+    BC7
+};
+
+const char* tileFormatName(TileFormat format);
+
+// The block format of a compressed tile format.
+BlockFormat tileBlockFormat(TileFormat format);
+
+// One level of a tile store's pyramid.
+struct TileLevel
+{
+    // Texels of the image at this level, each half the one above rounded up.
+    // A level is exactly half the scale of the one above, whose odd last
+    // column or row is repeated to make up the difference.
+    int width = 0;
+    int height = 0;
+
+    int tilesX = 0;
+    int tilesY = 0;
+
+    // Index of the level's first tile among all of the store's tiles.
+    size_t firstTile = 0;
+};
+
+// Layout of a tile store, the file vt_tiler writes for VirtualTexture: the
+// mip pyramid of an image cut into square tiles of tileSize texels, down to
+// the level one tile covers. Each tile also has border texels on every side,
+// taken from its neighbours, so filtering near its edge never reads the
+// unrelated tile next to it in a cache. Past the image's edge the edge
+// texels repeat.
+//
+// The file is a small header, then every tile, tileBytes each: level 0 first
+// and each level row by row from the bottom, as GL expects. The tiles start
+// on a page boundary so they can be used straight from a mapping.
+struct TileStoreInfo
+{
+    TileFormat format = TileFormat::RGBA8;
+    int width = 0;
+    int height = 0;
+    int tileSize = 0;
+    int border = 0;
+
+    size_t tileBytes = 0;
+    size_t dataOffset = 0;
+    std::vector<TileLevel> levels;
+
+    // Texels across a tile with its border.
+    int paddedTileSize() const { return tileSize + border * 2; }
+
+    size_t tileCount() const;
+    size_t tileOffset(int level, int x, int y) const;
+};
+
+// Work out the layout of a store of a width x height image. tileSize and
+// border must be multiples of 4 so compressed tiles are whole blocks.
+// Returns false, having logged why, if the image needs more tiles or levels
+// than a store can have.
+bool layoutTileStore(TileFormat format, int width, int height, int tileSize, int border, TileStoreInfo& info);
+
+// Check the header of a tile store held in memory and work out its layout.
+// Fails if the file is too short to hold every tile.
+bool parseTileStore(const void* data, size_t size, TileStoreInfo& info);
+
+// Write the header of a store laid out by layoutTileStore(), padded to
+// dataOffset. The tiles follow in order.
+bool writeTileStoreHeader(std::ostream& file, const TileStoreInfo& info);
+
+}   // namespace gl
+
+#endif
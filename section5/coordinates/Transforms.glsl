@@ -0,0 +1,27 @@
+// Model, view and projection transforms shared by the vertex shaders.
+#ifndef TRANSFORMS_GLSL
+#define TRANSFORMS_GLSL
+
+// Set once per frame and shared by every program, see gl::CameraBlock. GLSL
+// programs are bound to the same points after linking.
+#ifdef GL_SPIRV
+layout (std140, binding = 0) uniform CameraBlock
+#else
+layout (std140) uniform CameraBlock
+#endif
+{
+    mat4 view;
+    mat4 projection;
+};
+
+// Set for each draw from a ring buffer, see gl::DrawBlock.
+#ifdef GL_SPIRV
+layout (std140, binding = 1) uniform DrawBlock
+#else
+layout (std140) uniform DrawBlock
+#endif
+{
+    mat4 model;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "Uniform.h"
+
+namespace gl
+{
+
+static UniformStats s_uniformStats;
+
+UniformStats& uniformStats()
+{
+    return s_uniformStats;
+}
+
+void resetUniformStats()
+{
+    s_uniformStats = UniformStats();
+}
+
+bool isSamplerType(GLenum type)
+{
+    switch(type)
+    {
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_1D_SHADOW:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_1D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_1D_ARRAY_SHADOW:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_2D_MULTISAMPLE:
+    case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_SAMPLER_CUBE_SHADOW:
+    case GL_SAMPLER_BUFFER:
+    case GL_SAMPLER_2D_RECT:
+    case GL_SAMPLER_2D_RECT_SHADOW:
+    case GL_INT_SAMPLER_1D:
+    case GL_INT_SAMPLER_2D:
+    case GL_INT_SAMPLER_3D:
+    case GL_INT_SAMPLER_CUBE:
+    case GL_INT_SAMPLER_1D_ARRAY:
+    case GL_INT_SAMPLER_2D_ARRAY:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_INT_SAMPLER_BUFFER:
+    case GL_INT_SAMPLER_2D_RECT:
+    case GL_UNSIGNED_INT_SAMPLER_1D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_3D:
+    case GL_UNSIGNED_INT_SAMPLER_CUBE:
+    case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+    case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void uploadUniformRaw(const UniformInfo& info, const void* value)
+{
+    switch(info.type)
+    {
+    case GL_FLOAT:
+        glUniform1fv(info.location, 1, static_cast<const GLfloat*>(value));
+        break;
+    case GL_FLOAT_MAT4:
+        glUniformMatrix4fv(info.location, 1, GL_FALSE, static_cast<const GLfloat*>(value));
+        break;
+    case GL_INT:
+    case GL_BOOL:
+        glUniform1iv(info.location, 1, static_cast<const GLint*>(value));
+        break;
+    default:
+        if(isSamplerType(info.type))
+            glUniform1iv(info.location, 1, static_cast<const GLint*>(value));
+        break;
+    }
+}
+
+}   // namespace gl
@@ -0,0 +1,116 @@
+#ifndef UNIFORM_H
+#define UNIFORM_H
+
+#include <cstdint>
+#include <cstring>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "UniformTable.h"
+
+namespace gl
+{
+
+class Shader;
+
+// Counts of glUniform* calls issued and skipped because the program already
+// held the value. Reset once per frame by the caller.
+struct UniformStats
+{
+    uint32_t uploads = 0;
+    uint32_t skipped = 0;
+};
+
+UniformStats& uniformStats();
+void resetUniformStats();
+
+bool isSamplerType(GLenum type);
+
+// Upload a raw value of the uniform's reflected type, e.g. from the shadow
+// copy of another program. Supports the types UniformTraits handles.
+void uploadUniformRaw(const UniformInfo& info, const void* value);
+
+// Maps a C++ type onto the GLSL types it may be bound to and how to upload it.
+template<typename T>
+struct UniformTraits;
+
+template<>
+struct UniformTraits<GLfloat>
+{
+    static bool accepts(GLenum type) { return type == GL_FLOAT; }
+    static void upload(GLint location, const GLfloat& value) { glUniform1f(location, value); }
+};
+
+template<>
+struct UniformTraits<GLint>
+{
+    static bool accepts(GLenum type) { return type == GL_INT || type == GL_BOOL || isSamplerType(type); }
+    static void upload(GLint location, const GLint& value) { glUniform1i(location, value); }
+};
+
+template<>
+struct UniformTraits<glm::mat4>
+{
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT4; }
+    static void upload(GLint location, const glm::mat4& value)
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+};
+
+// Upload value to the uniform described by info unless its shadow copy shows
+// the program already holds it. The owning program must be bound.
+template<typename T>
+void uploadUniform(UniformInfo& info, const T& value)
+{
+    static_assert(sizeof(T) <= sizeof(info.shadow), "Uniform type too large for shadow copy");
+
+    if(info.shadowValid && std::memcmp(info.shadow, &value, sizeof(T)) == 0)
+    {
+        ++uniformStats().skipped;
+        return;
+    }
+
+    UniformTraits<T>::upload(info.location, value);
+    std::memcpy(info.shadow, &value, sizeof(T));
+    info.shadowValid = true;
+    ++uniformStats().uploads;
+}
+
+// Typed handle to a uniform of a linked program. Obtained from
+// Shader::uniform<T>(), which checks T against the reflected GLSL type. An
+// invalid handle (unknown name or type mismatch) ignores writes. Handles
+// follow the shader across hot reloads, looking the uniform up again the
+// first time they're used after the program changed.
+template<typename T>
+class Uniform
+{
+public:
+    Uniform() = default;
+
+    bool valid() const;
+
+    // Set the value; the owning program must be bound.
+    void set(const T& value) const;
+
+private:
+    friend class Shader;
+
+    Uniform(Shader* shader, UniformID id);
+
+    // Look the uniform up again if the shader's program has been replaced.
+    void refresh() const;
+
+    Shader* m_shader = nullptr;
+    UniformID m_id;
+
+    mutable UniformInfo* m_info = nullptr;
+    mutable uint32_t m_generation = 0;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,95 @@
+#include "UniformBlocks.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace gl
+{
+
+GL_STD140_BLOCK_LAYOUT(CameraBlock, CAMERA_BLOCK_MEMBERS)
+GL_STD140_BLOCK_LAYOUT(DrawBlock, DRAW_BLOCK_MEMBERS)
+GL_STD140_BLOCK_LAYOUT(VirtualTextureBlock, VIRTUAL_TEXTURE_BLOCK_MEMBERS)
+GL_STD140_BLOCK_LAYOUT(EnvironmentBlock, ENVIRONMENT_BLOCK_MEMBERS)
+
+const UniformBlockLayout* findUniformBlockLayout(const char* name)
+{
+    static const UniformBlockLayout* const s_layouts[] = {
+        &CameraBlock::layout(),
+        &DrawBlock::layout(),
+        &VirtualTextureBlock::layout(),
+        &EnvironmentBlock::layout()
+    };
+
+    for(const UniformBlockLayout* layout : s_layouts)
+    {
+        if(std::strcmp(layout->name, name) == 0)
+            return layout;
+    }
+
+    return nullptr;
+}
+
+bool checkUniformBlockLayout(GLuint program, GLuint blockIndex, const UniformBlockLayout& layout)
+{
+    bool matches = true;
+
+    // The C++ struct is what gets uploaded, so it has to cover the block.
+    GLint dataSize = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+    if((size_t)dataSize > layout.size)
+    {
+        std::cerr << "ERROR::UNIFORM_BLOCK::SIZE_MISMATCH: " << layout.name << " is " << dataSize
+                  << " bytes in GLSL but " << layout.size << " in C++" << std::endl;
+        matches = false;
+    }
+
+    GLint numUniforms = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &numUniforms);
+    if(numUniforms == 0)
+        return matches;
+
+    std::vector<GLint> indices(numUniforms);
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+
+    std::vector<GLuint> uniformIndices(indices.begin(), indices.end());
+    std::vector<GLint> offsets(numUniforms);
+    glGetActiveUniformsiv(program, numUniforms, uniformIndices.data(), GL_UNIFORM_OFFSET, offsets.data());
+
+    GLint maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<GLchar> name(maxNameLength + 1, 0);
+
+    for(GLint i = 0; i < numUniforms; ++i)
+    {
+        glGetActiveUniformName(program, uniformIndices[i], (GLsizei)name.size(), NULL, name.data());
+
+        // Members of a block with an instance name are reported as "Block.member".
+        const char* memberName = name.data();
+        if(const char* dot = std::strrchr(memberName, '.'))
+            memberName = dot + 1;
+
+        const UniformBlockMember* member = nullptr;
+        for(const UniformBlockMember& candidate : layout.members)
+        {
+            if(std::strcmp(candidate.name, memberName) == 0)
+                member = &candidate;
+        }
+
+        if(!member)
+        {
+            std::cerr << "ERROR::UNIFORM_BLOCK::UNKNOWN_MEMBER: " << layout.name << "." << memberName << std::endl;
+            matches = false;
+        }
+        else if((size_t)offsets[i] != member->offset)
+        {
+            std::cerr << "ERROR::UNIFORM_BLOCK::OFFSET_MISMATCH: " << layout.name << "." << memberName
+                      << " is at " << offsets[i] << " in GLSL but " << member->offset << " in C++" << std::endl;
+            matches = false;
+        }
+    }
+
+    return matches;
+}
+
+}   // namespace gl
@@ -0,0 +1,132 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+namespace gl
+{
+
+// std140 base alignment and size of the types a block member may have.
+// Types without a specialisation (bool, arrays, mat3...) lay out differently
+// in C++ and are rejected at compile time.
+template<typename T>
+struct Std140;
+
+template<> struct Std140<GLfloat>   { static constexpr size_t alignment = 4;  static constexpr size_t size = 4; };
+template<> struct Std140<GLint>     { static constexpr size_t alignment = 4;  static constexpr size_t size = 4; };
+template<> struct Std140<GLuint>    { static constexpr size_t alignment = 4;  static constexpr size_t size = 4; };
+template<> struct Std140<glm::vec2> { static constexpr size_t alignment = 8;  static constexpr size_t size = 8; };
+template<> struct Std140<glm::vec3> { static constexpr size_t alignment = 16; static constexpr size_t size = 12; };
+template<> struct Std140<glm::vec4> { static constexpr size_t alignment = 16; static constexpr size_t size = 16; };
+template<> struct Std140<glm::mat4> { static constexpr size_t alignment = 16; static constexpr size_t size = 64; };
+
+struct UniformBlockMember
+{
+    const char* name;
+    size_t offset;
+    size_t size;
+};
+
+// What a program's block is checked against when it's linked.
+struct UniformBlockLayout
+{
+    const char* name;
+    GLuint binding;
+    size_t size;
+    std::vector<UniformBlockMember> members;
+};
+
+// Declares a C++ struct laid out like a std140 GLSL block of the same name.
+// MEMBERS(X) must expand X(type, name) for each member in declaration order,
+// e.g.
+//
+//     #define CAMERA_BLOCK_MEMBERS(X) X(glm::mat4, view) X(glm::mat4, projection)
+//     GL_STD140_BLOCK(CameraBlock, 0, CAMERA_BLOCK_MEMBERS)
+//
+// Each member is aligned to its std140 base alignment. Define the layout
+// table in one source file with GL_STD140_BLOCK_LAYOUT(Name, MEMBERS).
+#define GL_STD140_BLOCK(Name, Binding, MEMBERS)                     \
+    struct Name                                                     \
+    {                                                               \
+        MEMBERS(GL_STD140_DECLARE_MEMBER)                           \
+                                                                    \
+        static constexpr GLuint kBinding = Binding;                 \
+        static const UniformBlockLayout& layout();                  \
+    };                                                              \
+    static_assert(sizeof(Name) % 16 == 0, #Name " isn't padded to a vec4");
+
+#define GL_STD140_DECLARE_MEMBER(Type, Name)                        \
+    static_assert(sizeof(Type) == Std140<Type>::size,               \
+                  #Name " has a different size in C++ and std140"); \
+    alignas(Std140<Type>::alignment) Type Name;
+
+#define GL_STD140_BLOCK_LAYOUT(Name, MEMBERS)                       \
+    const UniformBlockLayout& Name::layout()                        \
+    {                                                               \
+        using Block = Name;                                         \
+        static const UniformBlockLayout s_layout = {                \
+            #Name, kBinding, sizeof(Name),                          \
+            {MEMBERS(GL_STD140_DESCRIBE_MEMBER)}};                  \
+        return s_layout;                                            \
+    }
+
+#define GL_STD140_DESCRIBE_MEMBER(Type, Name) {#Name, offsetof(Block, Name), sizeof(Type)},
+
+// Camera transforms, set once per frame and shared by every program.
+#define CAMERA_BLOCK_MEMBERS(X) \
+    X(glm::mat4, view)          \
+    X(glm::mat4, projection)
+
+GL_STD140_BLOCK(CameraBlock, 0, CAMERA_BLOCK_MEMBERS)
+
+// Transforms that change with each draw.
+#define DRAW_BLOCK_MEMBERS(X) \
+    X(glm::mat4, model)
+
+GL_STD140_BLOCK(DrawBlock, 1, DRAW_BLOCK_MEMBERS)
+
+// What VirtualTexture.glsl needs to find a virtual texture's tiles; see
+// VirtualTexture.
+#define VIRTUAL_TEXTURE_BLOCK_MEMBERS(X) \
+    X(glm::vec2, virtualImageSize)       \
+    X(glm::vec2, virtualCacheScale)      \
+    X(GLfloat, virtualTileSize)          \
+    X(GLfloat, virtualTileBorder)        \
+    X(GLint, virtualLevels)              \
+    X(GLfloat, virtualFeedbackBias)
+
+GL_STD140_BLOCK(VirtualTextureBlock, 2, VIRTUAL_TEXTURE_BLOCK_MEMBERS)
+
+// Diffuse lighting from an environment as spherical harmonics, one
+// coefficient's RGB per vec4, and how many levels its specular cube map has;
+// see EnvironmentLighting.
+#define ENVIRONMENT_BLOCK_MEMBERS(X)           \
+    X(glm::vec4, environmentIrradiance0)       \
+    X(glm::vec4, environmentIrradiance1)       \
+    X(glm::vec4, environmentIrradiance2)       \
+    X(glm::vec4, environmentIrradiance3)       \
+    X(glm::vec4, environmentIrradiance4)       \
+    X(glm::vec4, environmentIrradiance5)       \
+    X(glm::vec4, environmentIrradiance6)       \
+    X(glm::vec4, environmentIrradiance7)       \
+    X(glm::vec4, environmentIrradiance8)       \
+    X(GLfloat, environmentSpecularLevels)
+
+GL_STD140_BLOCK(EnvironmentBlock, 3, ENVIRONMENT_BLOCK_MEMBERS)
+
+// The layout of the named block, or nullptr if it isn't one of ours.
+const UniformBlockLayout* findUniformBlockLayout(const char* name);
+
+// Check the linked program's block at blockIndex against layout, logging any
+// member whose offset differs. Returns true if they match.
+bool checkUniformBlockLayout(GLuint program, GLuint blockIndex, const UniformBlockLayout& layout);
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,151 @@
+#include "UniformBuffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace gl
+{
+
+// How long beginFrame() waits on a fence before checking again.
+constexpr GLuint64 kFenceTimeoutNanoseconds = 1000000;
+
+static GLsizeiptr alignUp(GLsizeiptr value, GLsizeiptr alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+UniformBuffer::UniformBuffer(GLsizeiptr size)
+    : m_buffer(0)
+    , m_shadow(size)
+    , m_shadowValid(false)
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void UniformBuffer::bind(GLuint binding)
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_buffer);
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr size)
+{
+    if(size > (GLsizeiptr)m_shadow.size())
+    {
+        std::cerr << "ERROR::UNIFORM_BUFFER::TOO_LARGE: " << size << " bytes into " << m_shadow.size() << std::endl;
+        return;
+    }
+
+    if(m_shadowValid && std::memcmp(m_shadow.data(), data, size) == 0)
+        return;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    std::memcpy(m_shadow.data(), data, size);
+    m_shadowValid = true;
+}
+
+UniformRingBuffer::UniformRingBuffer(GLsizeiptr bytesPerFrame, GLuint frames)
+    : m_buffer(0)
+    , m_regionSize(0)
+    , m_regionCount(frames)
+    , m_offsetAlignment(256)
+    , m_fences(frames, nullptr)
+    , m_region(0)
+    , m_cursor(0)
+    , m_mapped(nullptr)
+{
+    // Every offset we bind has to be a multiple of this, regions included.
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_offsetAlignment);
+    m_regionSize = alignUp(bytesPerFrame, m_offsetAlignment);
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, m_regionSize * m_regionCount, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+    for(GLsync fence : m_fences)
+    {
+        if(fence)
+            glDeleteSync(fence);
+    }
+
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void UniformRingBuffer::beginFrame()
+{
+    if(GLsync fence = m_fences[m_region])
+    {
+        while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeoutNanoseconds) == GL_TIMEOUT_EXPIRED)
+            ;
+
+        glDeleteSync(fence);
+        m_fences[m_region] = nullptr;
+    }
+
+    // The fence already orders us after the GPU's reads, so skip the
+    // driver's own synchronisation.
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    m_mapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, m_region * m_regionSize, m_regionSize,
+                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                                GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    m_cursor = 0;
+
+    if(!m_mapped)
+        std::cerr << "ERROR::UNIFORM_RING_BUFFER::MAP_FAILED" << std::endl;
+}
+
+GLintptr UniformRingBuffer::push(const void* data, GLsizeiptr size)
+{
+    if(!m_mapped || m_cursor + size > m_regionSize)
+    {
+        std::cerr << "ERROR::UNIFORM_RING_BUFFER::FULL: " << m_regionSize << " bytes per frame" << std::endl;
+        return -1;
+    }
+
+    std::memcpy(m_mapped + m_cursor, data, size);
+    GLintptr offset = m_region * m_regionSize + m_cursor;
+    m_cursor = alignUp(m_cursor + size, m_offsetAlignment);
+
+    return offset;
+}
+
+void UniformRingBuffer::unmap()
+{
+    if(!m_mapped)
+        return;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glFlushMappedBufferRange(GL_UNIFORM_BUFFER, 0, std::min(m_cursor, m_regionSize));
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    m_mapped = nullptr;
+}
+
+void UniformRingBuffer::bind(GLuint binding, GLintptr offset, GLsizeiptr size)
+{
+    if(offset >= 0)
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer, offset, size);
+}
+
+void UniformRingBuffer::endFrame()
+{
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_region = (m_region + 1) % m_regionCount;
+}
+
+}   // namespace gl
@@ -0,0 +1,95 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <cstring>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace gl
+{
+
+// A uniform buffer holding one block shared by every program, e.g. the
+// camera. Bind it once to the block's binding point; update() only uploads
+// when the contents change.
+class UniformBuffer
+{
+public:
+    explicit UniformBuffer(GLsizeiptr size);
+
+    UniformBuffer(const UniformBuffer& rhs) = delete;
+    UniformBuffer& operator=(const UniformBuffer& rhs) = delete;
+
+    ~UniformBuffer();
+
+    void bind(GLuint binding);
+
+    void update(const void* data, GLsizeiptr size);
+
+    template<typename Block>
+    void update(const Block& block) { update(&block, sizeof(Block)); }
+
+private:
+    GLuint m_buffer;
+    std::vector<unsigned char> m_shadow;
+    bool m_shadowValid;
+};
+
+// Ring of per-frame regions for data that changes with every draw. Each
+// frame's data is written through a single map and unmap:
+//
+//     ring.beginFrame();
+//     GLintptr offset = ring.push(drawBlock);   // for every draw
+//     ring.unmap();
+//     ring.bind(DrawBlock::kBinding, offset, sizeof(DrawBlock));
+//     glDrawElements(...);                      // for every draw
+//     ring.endFrame();
+//
+// The region is mapped unsynchronised; a fence per region stops the CPU
+// overwriting data the GPU may still be reading from frames ago.
+class UniformRingBuffer
+{
+public:
+    // Space for up to bytesPerFrame of data, including alignment, in each of
+    // frames regions.
+    UniformRingBuffer(GLsizeiptr bytesPerFrame, GLuint frames = 3);
+
+    UniformRingBuffer(const UniformRingBuffer& rhs) = delete;
+    UniformRingBuffer& operator=(const UniformRingBuffer& rhs) = delete;
+
+    ~UniformRingBuffer();
+
+    // Wait until the next region is free and map it.
+    void beginFrame();
+
+    // Copy data into the mapped region and return its buffer offset, or -1
+    // if the region is full.
+    GLintptr push(const void* data, GLsizeiptr size);
+
+    template<typename Block>
+    GLintptr push(const Block& block) { return push(&block, sizeof(Block)); }
+
+    // Flush what was pushed and unmap. Must be called before drawing.
+    void unmap();
+
+    // Bind size bytes at offset, as returned by push(), to binding.
+    void bind(GLuint binding, GLintptr offset, GLsizeiptr size);
+
+    // Fence the region once this frame's draws have been issued.
+    void endFrame();
+
+private:
+    GLuint m_buffer;
+    GLsizeiptr m_regionSize;
+    GLuint m_regionCount;
+    GLint m_offsetAlignment;
+
+    std::vector<GLsync> m_fences;
+    GLuint m_region;
+    GLsizeiptr m_cursor;
+    unsigned char* m_mapped;
+};
+
+}   // namespace gl
+
+#endif
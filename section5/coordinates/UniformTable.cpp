@@ -0,0 +1,85 @@
+#include "UniformTable.h"
+
+namespace gl
+{
+
+// Keep the load factor at or below one half so probe sequences stay short.
+constexpr size_t kMinUniformTableSize = 8;
+
+void UniformTable::reset(size_t count)
+{
+    size_t capacity = kMinUniformTableSize;
+    while(capacity < count * 2)
+        capacity <<= 1;
+
+    m_slots.assign(capacity, UniformInfo());
+    m_mask = capacity - 1;
+    m_count = 0;
+}
+
+bool UniformTable::insert(std::string_view name, GLint location, GLenum type, GLint size)
+{
+    if(m_slots.empty() || (m_count + 1) * 2 > m_slots.size())
+    {
+        // Grow and re-insert; only happens if reset() was given a low count.
+        std::vector<UniformInfo> old;
+        old.swap(m_slots);
+        reset(m_count + 1);
+        for(const UniformInfo& info : old)
+        {
+            if(info.type == GL_NONE)
+                continue;
+
+            size_t slot = slotFor(info.hash);
+            while(m_slots[slot].type != GL_NONE)
+                slot = (slot + 1) & m_mask;
+
+            m_slots[slot] = info;
+            ++m_count;
+        }
+    }
+
+    const uint64_t hash = hashString(name);
+    size_t slot = slotFor(hash);
+    while(m_slots[slot].type != GL_NONE)
+    {
+        if(m_slots[slot].hash == hash)
+            return false;
+
+        slot = (slot + 1) & m_mask;
+    }
+
+    UniformInfo& info = m_slots[slot];
+    info.hash = hash;
+    info.name = name;
+    info.location = location;
+    info.type = type;
+    info.size = size;
+    ++m_count;
+
+    return true;
+}
+
+const UniformInfo* UniformTable::find(UniformID id) const
+{
+    if(m_slots.empty())
+        return nullptr;
+
+    size_t slot = slotFor(id.hash);
+    while(m_slots[slot].type != GL_NONE)
+    {
+        if(m_slots[slot].hash == id.hash)
+            return &m_slots[slot];
+
+        slot = (slot + 1) & m_mask;
+    }
+
+    return nullptr;
+}
+
+UniformInfo* UniformTable::find(UniformID id)
+{
+    return const_cast<UniformInfo*>(static_cast<const UniformTable*>(this)->find(id));
+}
+
+}   // namespace gl
@@ -0,0 +1,87 @@
+#ifndef UNIFORM_TABLE_H
+#define UNIFORM_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "StringHash.h"
+
+namespace gl
+{
+
+// Identifies a uniform by the hash of its name. Construct these as constexpr
+// values so per-frame lookups never touch the string.
+struct UniformID
+{
+    constexpr UniformID() : hash(0) {}
+    constexpr UniformID(const char* name) : hash(hashString(name)) {}
+    constexpr UniformID(std::string_view name) : hash(hashString(name)) {}
+
+    static constexpr UniformID fromHash(uint64_t hash)
+    {
+        UniformID id;
+        id.hash = hash;
+        return id;
+    }
+
+    uint64_t hash;
+};
+
+// Reflection data for a single active uniform, plus a shadow copy of the last
+// value uploaded so redundant glUniform* calls can be skipped.
+struct UniformInfo
+{
+    uint64_t hash = 0;
+    std::string name;
+    GLint location = -1;
+    GLenum type = GL_NONE;
+    GLint size = 0;
+
+    bool shadowValid = false;
+    alignas(16) unsigned char shadow[64];
+};
+
+// Flat open-addressing table of a program's active uniforms. It's built once
+// after linking; from then on entries never move, so pointers to them stay
+// valid for the life of the program.
+class UniformTable
+{
+public:
+    // Drop all entries and size the table to hold count uniforms.
+    void reset(size_t count);
+
+    // Returns false if the name's hash collides with an existing entry.
+    bool insert(std::string_view name, GLint location, GLenum type, GLint size);
+
+    // Returns nullptr if the program has no active uniform with this name.
+    const UniformInfo* find(UniformID id) const;
+    UniformInfo* find(UniformID id);
+
+    size_t size() const { return m_count; }
+
+    // Call f(UniformInfo&) for every entry.
+    template<typename F>
+    void forEach(F f)
+    {
+        for(UniformInfo& info : m_slots)
+        {
+            if(info.type != GL_NONE)
+                f(info);
+        }
+    }
+
+private:
+    size_t slotFor(uint64_t hash) const { return (hash ^ (hash >> 32)) & m_mask; }
+
+    std::vector<UniformInfo> m_slots;
+    size_t m_mask = 0;
+    size_t m_count = 0;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,216 @@
+#include "UploadScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace gl
+{
+
+UploadScheduler::UploadScheduler(const UploadSchedulerOptions& options)
+    : m_options(options)
+    , m_pixelBuffers(std::max<size_t>(1, options.pixelBufferCount), 0)
+    , m_nextPixelBuffer(0)
+    , m_queuedBytes(0)
+{
+    glGenBuffers((GLsizei)m_pixelBuffers.size(), m_pixelBuffers.data());
+}
+
+UploadScheduler::~UploadScheduler()
+{
+    glDeleteBuffers((GLsizei)m_pixelBuffers.size(), m_pixelBuffers.data());
+}
+
+void UploadScheduler::enqueue(const Texture2D& texture, GLint level, GLenum format, GLenum type, const void* pixels,
+                              std::shared_ptr<void> owner, std::function<void()> done)
+{
+    Level queued;
+    queued.texture = texture.id();
+    queued.internalFormat = texture.internalFormat();
+    queued.level = level;
+    queued.width = texture.levelWidth(level);
+    queued.height = texture.levelHeight(level);
+    queued.format = format;
+    queued.type = type;
+    queued.compressed = false;
+    queued.whole = false;
+    queued.pixels = (const unsigned char*)pixels;
+    queued.size = texture.levelSize(level);
+    queued.rowsPerStep = 1;
+    queued.stepSize = queued.size / queued.height;
+    queued.owner = std::move(owner);
+    queued.done = std::move(done);
+    push(std::move(queued));
+}
+
+void UploadScheduler::enqueueCompressed(const Texture2D& texture, GLint level, const void* data,
+                                        std::shared_ptr<void> owner, std::function<void()> done)
+{
+    Level queued;
+    queued.texture = texture.id();
+    queued.internalFormat = texture.internalFormat();
+    queued.level = level;
+    queued.width = texture.levelWidth(level);
+    queued.height = texture.levelHeight(level);
+    queued.format = GL_NONE;
+    queued.type = GL_NONE;
+    queued.compressed = true;
+    queued.whole = !texture.immutable();
+    queued.pixels = (const unsigned char*)data;
+    queued.size = texture.levelSize(level);
+    queued.rowsPerStep = 4;
+    queued.stepSize = queued.size / ((queued.height + 3) / 4);
+    queued.owner = std::move(owner);
+    queued.done = std::move(done);
+    push(std::move(queued));
+}
+
+void UploadScheduler::update()
+{
+    upload(m_options.bytesPerFrame, m_options.millisecondsPerFrame);
+}
+
+void UploadScheduler::finish()
+{
+    while(!m_queue.empty())
+        upload(m_queuedBytes, 0.0);
+}
+
+void UploadScheduler::push(Level level)
+{
+    level.row = 0;
+    m_queuedBytes += level.size;
+    m_queue.push_back(std::move(level));
+
+    m_stats.queuedLevels = m_queue.size();
+    m_stats.queuedBytes = m_queuedBytes;
+}
+
+void UploadScheduler::upload(size_t budget, double milliseconds)
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+
+    m_stats.uploadedBytes = 0;
+    m_stats.bands = 0;
+    m_stats.milliseconds = 0.0;
+    if(m_queue.empty())
+        return;
+
+    // However small the budget, at least one band goes each time.
+    const Level& front = m_queue.front();
+    const size_t capacity = std::max(budget, front.whole ? front.size : front.stepSize);
+
+    const GLuint pixelBuffer = m_pixelBuffers[m_nextPixelBuffer];
+    m_nextPixelBuffer = (m_nextPixelBuffer + 1) % m_pixelBuffers.size();
+
+    // Orphan the buffer's previous storage, which may still be feeding an
+    // earlier upload, rather than waiting for it.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, capacity,
+                                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if(!mapped)
+    {
+        std::cerr << "ERROR::UPLOAD_SCHEDULER::MAP_FAILED: " << capacity << " bytes" << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return;
+    }
+
+    // Stage as many bands as fit, in queue order.
+    m_bands.clear();
+    size_t offset = 0;
+    bool full = false;
+    for(size_t i = 0; i < m_queue.size() && !full; ++i)
+    {
+        Level& level = m_queue[i];
+        while(level.row < level.height)
+        {
+            const GLsizei stepsLeft = (level.height - level.row + level.rowsPerStep - 1) / level.rowsPerStep;
+            const size_t steps = level.whole ? (level.size <= capacity - offset ? 1 : 0)
+                                             : std::min<size_t>(stepsLeft, (capacity - offset) / level.stepSize);
+            if(steps == 0)
+            {
+                full = true;
+                break;
+            }
+
+            Band band;
+            band.level = &level;
+            band.row = level.row;
+            band.rows = level.whole ? level.height : std::min<GLsizei>((GLsizei)steps * level.rowsPerStep,
+                                                                      level.height - level.row);
+            band.offset = offset;
+            band.size = level.whole ? level.size : steps * level.stepSize;
+
+            std::memcpy(mapped + offset, level.pixels + level.row / level.rowsPerStep * level.stepSize, band.size);
+            m_bands.push_back(band);
+
+            level.row += band.rows;
+            offset += band.size;
+
+            const double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            if(milliseconds > 0.0 && elapsed >= milliseconds)
+            {
+                full = true;
+                break;
+            }
+        }
+    }
+
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // With a pixel unpack buffer bound the data pointer is an offset into
+    // it. Rows were staged tightly packed.
+    GLint unpackAlignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for(const Band& band : m_bands)
+    {
+        const Level& level = *band.level;
+        const GLvoid* data = (const GLvoid*)band.offset;
+        glBindTexture(GL_TEXTURE_2D, level.texture);
+        if(level.whole)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level.level, level.internalFormat, level.width, level.height, 0,
+                                   (GLsizei)band.size, data);
+        }
+        else if(level.compressed)
+        {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level.level, 0, band.row, level.width, band.rows,
+                                      level.internalFormat, (GLsizei)band.size, data);
+        }
+        else
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, level.level, 0, band.row, level.width, band.rows,
+                            level.format, level.type, data);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_stats.uploadedBytes = offset;
+    m_stats.bands = m_bands.size();
+    m_bands.clear();
+
+    // Levels finish in the order they were queued.
+    while(!m_queue.empty() && m_queue.front().row >= m_queue.front().height)
+    {
+        std::function<void()> done = std::move(m_queue.front().done);
+        m_queuedBytes -= m_queue.front().size;
+        m_queue.pop_front();
+        if(done)
+            done();
+    }
+
+    m_stats.queuedLevels = m_queue.size();
+    m_stats.queuedBytes = m_queuedBytes;
+    m_stats.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}   // namespace gl
@@ -0,0 +1,142 @@
+#ifndef UPLOAD_SCHEDULER_H
+#define UPLOAD_SCHEDULER_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Texture2D.h"
+
+namespace gl
+{
+
+struct UploadSchedulerOptions
+{
+    // Bytes to upload per update(). A band bigger than this still goes on
+    // its own, so every update makes progress.
+    size_t bytesPerFrame = 4 * 1024 * 1024;
+
+    // Stop early once an update() has taken this long; 0 for no limit.
+    double millisecondsPerFrame = 0.0;
+
+    // Staging buffers cycled through, so the driver can still be reading
+    // one while we fill the next.
+    size_t pixelBufferCount = 2;
+};
+
+// What an UploadScheduler has left and did last update(), for tuning the
+// budget against frame times.
+struct UploadStats
+{
+    size_t queuedLevels = 0;
+    size_t queuedBytes = 0;
+
+    size_t uploadedBytes = 0;
+    size_t bands = 0;
+    double milliseconds = 0.0;
+};
+
+// Spreads texture uploads over frames so a large image never lands in one.
+// Levels are queued whole and uploaded in bands of rows, as many per
+// update() as fit the budget, through a ring of pixel buffer objects. Levels
+// go in the order they were queued, so queue the small mips first to have
+// something to show straight away.
+//
+// Storage must already have been allocated, e.g. by Texture2D, except for
+// compressed textures without immutable storage, whose levels are each
+// uploaded in one go with glCompressedTexImage2D.
+//
+// All calls must be made on the thread that owns the GL context.
+class UploadScheduler
+{
+public:
+    explicit UploadScheduler(const UploadSchedulerOptions& options = UploadSchedulerOptions());
+
+    UploadScheduler(const UploadScheduler& rhs) = delete;
+    UploadScheduler& operator=(const UploadScheduler& rhs) = delete;
+
+    ~UploadScheduler();
+
+    // Queue all of a level of texture, with pixels in format and type. owner
+    // keeps the pixels alive until they've been copied, and done is called
+    // once the whole level has been uploaded.
+    void enqueue(const Texture2D& texture, GLint level, GLenum format, GLenum type, const void* pixels,
+                 std::shared_ptr<void> owner, std::function<void()> done = std::function<void()>());
+
+    // The same for a level of blocks in the texture's compressed format.
+    void enqueueCompressed(const Texture2D& texture, GLint level, const void* data,
+                           std::shared_ptr<void> owner, std::function<void()> done = std::function<void()>());
+
+    // Upload the next bands within the budget. Call once per frame.
+    void update();
+
+    // Upload everything queued, however long it takes.
+    void finish();
+
+    size_t queued() const { return m_queue.size(); }
+    const UploadStats& stats() const { return m_stats; }
+
+private:
+    struct Level
+    {
+        GLuint texture;
+        GLenum internalFormat;
+        GLint level;
+        GLsizei width;
+        GLsizei height;
+        GLenum format;
+        GLenum type;
+        bool compressed;
+
+        // Compressed levels without immutable storage go in one band, as
+        // glCompressedTexImage2D.
+        bool whole;
+
+        const unsigned char* pixels;
+        size_t size;
+
+        // Texel rows per band step, 4 for a row of blocks, and the bytes in
+        // one.
+        GLsizei rowsPerStep;
+        size_t stepSize;
+
+        // Rows uploaded so far.
+        GLsizei row;
+
+        std::shared_ptr<void> owner;
+        std::function<void()> done;
+    };
+
+    // An upload staged in the pixel buffer, issued once it's unmapped.
+    struct Band
+    {
+        Level* level;
+        GLsizei row;
+        GLsizei rows;
+        size_t offset;
+        size_t size;
+    };
+
+    void push(Level level);
+
+    // Stage and upload bands totalling about budget bytes.
+    void upload(size_t budget, double milliseconds);
+
+    UploadSchedulerOptions m_options;
+    std::deque<Level> m_queue;
+    std::vector<Band> m_bands;
+
+    std::vector<GLuint> m_pixelBuffers;
+    size_t m_nextPixelBuffer;
+
+    size_t m_queuedBytes;
+    UploadStats m_stats;
+};
+
+}   // namespace gl
+
+#endif
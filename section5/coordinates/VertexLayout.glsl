@@ -0,0 +1,10 @@
+// Attribute layout of the interleaved position/colour/texture coordinate
+// vertices set up in main.cpp.
+#ifndef VERTEX_LAYOUT_GLSL
+#define VERTEX_LAYOUT_GLSL
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 color;
+layout (location = 2) in vec2 textureCoords;
+
+#endif
@@ -0,0 +1,380 @@
+#include "VideoTexture.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace gl
+{
+
+// Where each JPEG in a motion JPEG file starts and how long it is. Segments
+// are skipped by their lengths, so thumbnails inside EXIF data, with markers
+// of their own, aren't taken for frames; in entropy-coded data a 0xff is
+// only ever followed by 0x00, a restart marker or fill.
+static void splitMotionJpeg(const unsigned char* data, size_t size, std::vector<std::pair<size_t, size_t>>& ranges)
+{
+    size_t i = 0;
+    while(i + 1 < size)
+    {
+        if(data[i] != 0xff || data[i + 1] != 0xd8)
+        {
+            ++i;
+            continue;
+        }
+
+        const size_t start = i;
+        size_t end = 0;
+        i += 2;
+        while(i + 1 < size)
+        {
+            if(data[i] != 0xff)
+            {
+                ++i;
+                continue;
+            }
+
+            const unsigned char marker = data[i + 1];
+            if(marker == 0xd9)
+            {
+                end = i + 2;
+                break;
+            }
+
+            // A frame cut short by the next one starting.
+            if(marker == 0xd8)
+                break;
+
+            if(marker == 0xff)
+                i += 1;
+            else if(marker == 0x00 || (marker >= 0xd0 && marker <= 0xd7))
+                i += 2;
+            else if(i + 3 < size)
+                i += 2 + (data[i + 2] << 8 | data[i + 3]);
+            else
+                break;
+        }
+
+        if(end)
+            ranges.push_back({start, end - start});
+    }
+}
+
+static bool isFrameFile(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".png";
+}
+
+VideoTexture::VideoTexture(const std::string& source, const VideoTextureOptions& options)
+    : m_options(options)
+    , m_valid(false)
+    , m_frameCount(0)
+    , m_width(0)
+    , m_height(0)
+    , m_frameSize(0)
+    , m_backSequence(0)
+    , m_shownSequence(0)
+    , m_pixelBuffer(0)
+    , m_persistent(false)
+    , m_nextFrame(0)
+    , m_started(false)
+    , m_startTime(0.0)
+    , m_stopping(false)
+{
+    ImageView first;
+    std::error_code error;
+    if(std::filesystem::is_directory(source, error))
+    {
+        for(const auto& entry : std::filesystem::directory_iterator(source, error))
+        {
+            if(entry.is_regular_file(error) && isFrameFile(entry.path()))
+                m_paths.push_back(entry.path().string());
+        }
+
+        std::sort(m_paths.begin(), m_paths.end());
+        m_frameCount = m_paths.size();
+        if(m_frameCount == 0 || !ImageDecoder::probeFile(m_paths[0], first))
+        {
+            std::cerr << "ERROR::VIDEO_TEXTURE::NO_FRAMES: " << source << std::endl;
+            return;
+        }
+    }
+    else
+    {
+        m_file.reset(new MappedFile(source));
+        if(m_file->valid())
+            splitMotionJpeg((const unsigned char*)m_file->data(), m_file->size(), m_ranges);
+
+        m_frameCount = m_ranges.size();
+        if(m_frameCount == 0 ||
+           !ImageDecoder::probe((const char*)m_file->data() + m_ranges[0].first, m_ranges[0].second, first))
+        {
+            std::cerr << "ERROR::VIDEO_TEXTURE::NO_FRAMES: " << source << std::endl;
+            return;
+        }
+    }
+
+    m_width = first.width;
+    m_height = first.height;
+    m_frameSize = (size_t)m_width * m_height * 4;
+
+    // Frames replace each other whole and are never minified much, so one
+    // level each.
+    m_front = Texture2D(GL_RGBA8, m_width, m_height, 1);
+    m_back = Texture2D(GL_RGBA8, m_width, m_height, 1);
+    const std::vector<unsigned char> black(m_frameSize, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_front.upload(0, GL_RGBA, GL_UNSIGNED_BYTE, black.data());
+
+    m_frames.resize(std::max(m_options.bufferedFrames, 1));
+    m_persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    glGenBuffers(1, &m_pixelBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffer);
+    if(m_persistent)
+    {
+        // Coherent, so what the decoder writes is visible to uploads issued
+        // after it hands the frame over, with no flush.
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr size = (GLsizeiptr)(m_frameSize * m_frames.size());
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+        unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+        for(size_t i = 0; i < m_frames.size(); ++i)
+        {
+            m_frames[i].offset = i * m_frameSize;
+            m_frames[i].pixels = mapped + m_frames[i].offset;
+        }
+
+        // Immutable storage can't be orphaned, so fall back to a new buffer.
+        m_persistent = mapped != nullptr;
+        if(!m_persistent)
+        {
+            glDeleteBuffers(1, &m_pixelBuffer);
+            glGenBuffers(1, &m_pixelBuffer);
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    for(Frame& frame : m_frames)
+    {
+        frame.arena.reset(new ImageArena());
+        if(!m_persistent)
+        {
+            frame.staging.resize(m_frameSize);
+            frame.pixels = frame.staging.data();
+        }
+    }
+
+    m_valid = true;
+    m_thread = std::thread(&VideoTexture::run, this);
+}
+
+VideoTexture::~VideoTexture()
+{
+    if(m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+
+    for(Frame& frame : m_frames)
+    {
+        if(frame.fence)
+            glDeleteSync(frame.fence);
+    }
+
+    // Deleting the buffer unmaps it.
+    glDeleteBuffers(1, &m_pixelBuffer);
+}
+
+bool VideoTexture::finished() const
+{
+    return !m_options.loop && m_started && m_shownSequence >= m_frameCount;
+}
+
+void VideoTexture::run()
+{
+    uint64_t sequence = 0;
+    size_t next = 0;
+    for(;;)
+    {
+        Frame& frame = m_frames[next];
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [&]() {
+                return m_stopping || (frame.state == Frame::State::Free && (m_options.loop || sequence < m_frameCount));
+            });
+            if(m_stopping)
+                return;
+
+            frame.state = Frame::State::Decoding;
+        }
+
+        // Sequence numbers count from 1 so 0 can mean no frame.
+        decode(sequence % m_frameCount, frame);
+        frame.sequence = ++sequence;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            frame.state = Frame::State::Ready;
+        }
+        next = (next + 1) % m_frames.size();
+    }
+}
+
+void VideoTexture::decode(size_t index, Frame& frame)
+{
+    ImageDecodeOptions options;
+    options.flipVertically = true;
+    options.channels = 4;
+
+    ImageView image;
+    frame.arena->reset();
+    bool decoded = false;
+    if(m_file)
+    {
+        const char* data = (const char*)m_file->data() + m_ranges[index].first;
+        decoded = ImageDecoder::decode(data, m_ranges[index].second, options, *frame.arena, image);
+    }
+    else
+    {
+        decoded = ImageDecoder::decodeFile(m_paths[index], options, *frame.arena, image);
+    }
+
+    frame.failed = !decoded || image.width != m_width || image.height != m_height ||
+                   image.type != ImageChannelType::UInt8;
+    if(decoded && frame.failed)
+        std::cerr << "ERROR::VIDEO_TEXTURE::FRAME_SIZE_CHANGED: frame " << index << " is " << image.width << "x"
+                  << image.height << std::endl;
+
+    if(!frame.failed)
+        std::memcpy(frame.pixels, image.pixels, m_frameSize);
+}
+
+void VideoTexture::release(Frame& frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        frame.state = Frame::State::Free;
+    }
+    m_condition.notify_one();
+}
+
+void VideoTexture::upload(Frame& frame)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffer);
+    glBindTexture(GL_TEXTURE_2D, m_back.id());
+    if(m_persistent)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)frame.offset);
+        frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        frame.state = Frame::State::Uploading;
+    }
+    else
+    {
+        // Orphan the buffer so the driver hands us fresh memory rather than
+        // waiting for the last upload from it.
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)m_frameSize, NULL, GL_STREAM_DRAW);
+        if(void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)m_frameSize,
+                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT))
+        {
+            std::memcpy(mapped, frame.pixels, m_frameSize);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        }
+        release(frame);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_backSequence = frame.sequence;
+}
+
+void VideoTexture::present()
+{
+    std::swap(m_front, m_back);
+    m_shownSequence = m_backSequence;
+    m_backSequence = 0;
+    ++m_stats.presentedFrames;
+}
+
+void VideoTexture::update(double time)
+{
+    if(!m_valid)
+        return;
+
+    // Only the render thread moves a frame on from Ready or Uploading, so
+    // once seen in either it can be used without the lock.
+    auto inState = [this](const Frame& frame, Frame::State state) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return frame.state == state;
+    };
+    auto ready = [&inState](const Frame& frame) { return inState(frame, Frame::State::Ready); };
+
+    // Regions GL has finished uploading from go back to the decoder.
+    for(Frame& frame : m_frames)
+    {
+        if(!inState(frame, Frame::State::Uploading))
+            continue;
+
+        const GLenum status = glClientWaitSync(frame.fence, 0, 0);
+        if(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+        {
+            glDeleteSync(frame.fence);
+            frame.fence = nullptr;
+            release(frame);
+        }
+    }
+
+    if(!m_started)
+    {
+        if(!ready(m_frames[m_nextFrame]))
+            return;
+
+        m_started = true;
+        m_startTime = time;
+    }
+
+    const uint64_t due = (uint64_t)((time - m_startTime) * m_options.framesPerSecond) + 1;
+    if(m_backSequence && m_backSequence <= due)
+        present();
+
+    // Upload the next frame to show, skipping any the one after is already
+    // due in place of. With a single buffered frame there is no one after.
+    while(!m_backSequence && ready(m_frames[m_nextFrame]))
+    {
+        Frame& frame = m_frames[m_nextFrame];
+        Frame& following = m_frames[(m_nextFrame + 1) % m_frames.size()];
+        m_nextFrame = (m_nextFrame + 1) % m_frames.size();
+
+        const bool superseded = &following != &frame && ready(following) && following.sequence <= due;
+        if(frame.failed || superseded)
+        {
+            ++m_stats.droppedFrames;
+            release(frame);
+            continue;
+        }
+
+        upload(frame);
+        if(m_backSequence <= due)
+            present();
+    }
+
+    if(m_shownSequence < due && !m_backSequence && !finished())
+        ++m_stats.lateFrames;
+
+    m_stats.bufferedFrames = 0;
+    for(const Frame& frame : m_frames)
+    {
+        if(ready(frame))
+            ++m_stats.bufferedFrames;
+    }
+}
+
+}   // namespace gl
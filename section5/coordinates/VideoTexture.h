@@ -0,0 +1,170 @@
+#ifndef VIDEO_TEXTURE_H
+#define VIDEO_TEXTURE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+#include "Texture2D.h"
+
+namespace gl
+{
+
+struct VideoTextureOptions
+{
+    // Rate the frames were captured at; independent of the display's.
+    double framesPerSecond = 30.0;
+
+    // Frames decoded ahead of the one on screen, each holding a pixel buffer
+    // region.
+    int bufferedFrames = 4;
+
+    // Start again after the last frame rather than holding it.
+    bool loop = true;
+};
+
+// What a VideoTexture has shown, for judging whether decoding keeps up.
+struct VideoTextureStats
+{
+    size_t presentedFrames = 0;
+
+    // Decoded too late to be shown, or failed to decode.
+    size_t droppedFrames = 0;
+
+    // Updates where the frame due wasn't decoded yet, so the last one stayed
+    // on screen.
+    size_t lateFrames = 0;
+
+    // Decoded and waiting to be uploaded.
+    size_t bufferedFrames = 0;
+};
+
+// Plays a sequence of images into a texture: a directory of JPEG and PNG
+// frames in file name order, or a single motion JPEG file of concatenated
+// JPEGs, which is mapped and split on their start and end markers. Every
+// frame must be the same size.
+//
+// A decode-ahead thread keeps bufferedFrames frames decoded into pixel
+// buffer regions, so the render thread never waits on a decode. With
+// ARB_buffer_storage the regions are persistently mapped and the decoder
+// writes straight into them; otherwise each frame is copied into an orphaned
+// buffer as it's uploaded. A frame is uploaded into a back texture as soon
+// as it's decoded and swapped to the front once update() is called with a
+// time it's due, so presenting costs nothing on the frame it happens. Frames
+// that are due before they've been decoded are dropped to catch up.
+//
+// All calls but the decoding happen on the thread that owns the GL context.
+class VideoTexture
+{
+public:
+    explicit VideoTexture(const std::string& source, const VideoTextureOptions& options = VideoTextureOptions());
+
+    VideoTexture(const VideoTexture& rhs) = delete;
+    VideoTexture& operator=(const VideoTexture& rhs) = delete;
+
+    // Stops the decoder, finishing the frame it's on.
+    ~VideoTexture();
+
+    // False if source has no frames or the first can't be read.
+    bool valid() const { return m_valid; }
+
+    // Present the frame due at time, in seconds on the caller's frame clock,
+    // and upload the next one ahead of it. Playback starts from the first
+    // call after the first frame has been decoded. Call once per frame,
+    // before drawing.
+    void update(double time);
+
+    // The texture showing the current frame; black until the first arrives.
+    GLuint id() const { return m_front.id(); }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    size_t frameCount() const { return m_frameCount; }
+
+    // Playing once, the last frame has been presented.
+    bool finished() const;
+
+    const VideoTextureStats& stats() const { return m_stats; }
+
+private:
+    // A decoded frame and where its pixels wait for upload.
+    struct Frame
+    {
+        enum class State
+        {
+            Free,
+            Decoding,
+            Ready,
+            // Uploaded from its persistently mapped region; free once the
+            // fence says GL is done reading it.
+            Uploading
+        };
+
+        State state = State::Free;
+        uint64_t sequence = 0;
+        bool failed = false;
+
+        std::unique_ptr<ImageArena> arena;
+        unsigned char* pixels = nullptr;
+        std::vector<unsigned char> staging;
+        size_t offset = 0;
+        GLsync fence = nullptr;
+    };
+
+    // Decoder thread: fill free frames in order until stopped.
+    void run();
+    void decode(size_t index, Frame& frame);
+
+    void release(Frame& frame);
+    void upload(Frame& frame);
+
+    // Show the back texture's frame.
+    void present();
+
+    VideoTextureOptions m_options;
+    bool m_valid;
+
+    // Frame files, or where each JPEG is in the mapped motion JPEG file.
+    std::vector<std::string> m_paths;
+    std::unique_ptr<MappedFile> m_file;
+    std::vector<std::pair<size_t, size_t>> m_ranges;
+    size_t m_frameCount;
+
+    int m_width;
+    int m_height;
+    size_t m_frameSize;
+
+    Texture2D m_front;
+    Texture2D m_back;
+    uint64_t m_backSequence;
+    uint64_t m_shownSequence;
+
+    GLuint m_pixelBuffer;
+    bool m_persistent;
+
+    std::vector<Frame> m_frames;
+    size_t m_nextFrame;
+
+    bool m_started;
+    double m_startTime;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping;
+    std::thread m_thread;
+
+    VideoTextureStats m_stats;
+};
+
+}   // namespace gl
+
+#endif
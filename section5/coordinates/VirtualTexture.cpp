@@ -0,0 +1,556 @@
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "SamplerCache.h"
+#include "ThreadPool.h"
+
+namespace gl
+{
+
+static GLsizei nextPowerOfTwo(GLsizei value)
+{
+    GLsizei power = 1;
+    while(power < value)
+        power *= 2;
+
+    return power;
+}
+
+// The cache format for a store's tiles, or 0 if the driver can't sample it.
+static GLenum cacheFormat(TileFormat format)
+{
+    switch(format)
+    {
+    case TileFormat::RGBA8: return GL_RGBA8;
+    case TileFormat::BC1: return GLEW_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : 0;
+    case TileFormat::BC3: return GLEW_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+    default: return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc ? GL_COMPRESSED_RGBA_BPTC_UNORM : 0;
+    }
+}
+
+VirtualTexture::VirtualTexture(ThreadPool& pool, SamplerCache& samplers, const std::string& path,
+                               const VirtualTextureOptions& options)
+    : m_pool(pool)
+    , m_options(options)
+    , m_valid(false)
+    , m_file(new MappedFile(path))
+    , m_cacheFormat(0)
+    , m_cacheSampler(0)
+    , m_pageTableSampler(0)
+    , m_parameters(sizeof(VirtualTextureBlock))
+    , m_frame(0)
+    , m_feedbackFrame(0)
+    , m_framebuffer(0)
+    , m_feedbackTexture(0)
+    , m_depthBuffer(0)
+    , m_feedbackWidth(0)
+    , m_feedbackHeight(0)
+    , m_nextReadback(0)
+    , m_savedFramebuffer(0)
+    , m_savedViewport{0, 0, 0, 0}
+{
+    if(!m_file->valid())
+    {
+        std::cerr << "ERROR::VIRTUAL_TEXTURE::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return;
+    }
+
+    if(!parseTileStore(m_file->data(), m_file->size(), m_info))
+    {
+        std::cerr << "ERROR::VIRTUAL_TEXTURE::BAD_TILE_STORE: " << path << std::endl;
+        return;
+    }
+
+    m_cacheFormat = cacheFormat(m_info.format);
+    if(!m_cacheFormat)
+    {
+        std::cerr << "ERROR::VIRTUAL_TEXTURE::FORMAT_NOT_SUPPORTED: " << tileFormatName(m_info.format) << std::endl;
+        return;
+    }
+
+    if(!createCache())
+        return;
+
+    // One texel per tile of level 0, halving with each level as the tiles
+    // do, so the page table is an ordinary mip chain.
+    const int levels = (int)m_info.levels.size();
+    m_pageTable = Texture2D(GL_RGBA8, nextPowerOfTwo(m_info.levels[0].tilesX), nextPowerOfTwo(m_info.levels[0].tilesY), levels);
+    for(const TileLevel& level : m_info.levels)
+    {
+        m_entries.emplace_back((size_t)level.tilesX * level.tilesY, 0u);
+        m_dirty.push_back({0, 0, 0, 0});
+    }
+
+    // Tiles carry their own borders, so the cache is never mipmapped or
+    // wrapped.
+    SamplerState cacheState;
+    cacheState.minFilter = GL_LINEAR;
+    cacheState.wrapS = GL_CLAMP_TO_EDGE;
+    cacheState.wrapT = GL_CLAMP_TO_EDGE;
+    m_cacheSampler = samplers.get(cacheState);
+    m_pageTableSampler = samplers.get(SamplerState::nearest());
+
+    VirtualTextureBlock parameters;
+    parameters.virtualImageSize = glm::vec2((float)m_info.width, (float)m_info.height);
+    parameters.virtualCacheScale = glm::vec2(1.0f / m_cache.width(), 1.0f / m_cache.height());
+    parameters.virtualTileSize = (float)m_info.tileSize;
+    parameters.virtualTileBorder = (float)m_info.border;
+    parameters.virtualLevels = levels;
+    parameters.virtualFeedbackBias = -std::log2((float)m_options.feedbackScale);
+    m_parameters.update(parameters);
+    m_parameterBlock = parameters;
+
+    // The coarsest tile covers the whole image, so with it always resident
+    // every entry has something to point at.
+    const TileKey root = tileKey(levels - 1, 0, 0);
+    const char* bytes = (const char*)m_file->data() + m_info.tileOffset(levels - 1, 0, 0);
+    m_slots[0].tile = root;
+    m_slots[0].pinned = true;
+    m_resident[root] = 0;
+    uploadTile(0, bytes);
+    markDirty(root);
+    rebuildPageTable();
+
+    m_readbacks.resize(std::max(m_options.feedbackFrames, 1));
+    for(Readback& readback : m_readbacks)
+    {
+        glGenBuffers(1, &readback.buffer);
+        readback.size = 0;
+        readback.width = 0;
+        readback.height = 0;
+        readback.fence = nullptr;
+    }
+
+    m_stats.residentTiles = 1;
+    m_valid = true;
+}
+
+VirtualTexture::~VirtualTexture()
+{
+    for(TileRead& read : m_reads)
+        read.bytes.wait();
+
+    for(Readback& readback : m_readbacks)
+    {
+        if(readback.fence)
+            glDeleteSync(readback.fence);
+
+        glDeleteBuffers(1, &readback.buffer);
+    }
+
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteTextures(1, &m_feedbackTexture);
+    glDeleteRenderbuffers(1, &m_depthBuffer);
+}
+
+VirtualTexture::TileKey VirtualTexture::tileKey(int level, int x, int y)
+{
+    return (TileKey)level << 28 | (TileKey)y << 14 | (TileKey)x;
+}
+
+void VirtualTexture::unpackTileKey(TileKey tile, int& level, int& x, int& y)
+{
+    level = (int)(tile >> 28);
+    y = (int)(tile >> 14 & (kMaxTilesPerSide - 1));
+    x = (int)(tile & (kMaxTilesPerSide - 1));
+}
+
+bool VirtualTexture::createCache()
+{
+    // Slots are addressed by 8-bit page table entries.
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    const int padded = m_info.paddedTileSize();
+    const int cacheTiles = std::min(std::min(m_options.cacheTiles, 256), maxTextureSize / padded);
+    if(cacheTiles < 2)
+    {
+        std::cerr << "ERROR::VIRTUAL_TEXTURE::CACHE_TOO_SMALL: " << cacheTiles << " tiles of " << padded << std::endl;
+        return false;
+    }
+
+    m_options.cacheTiles = cacheTiles;
+    m_cache = Texture2D(m_cacheFormat, cacheTiles * padded, cacheTiles * padded, 1);
+
+    // Without immutable storage a compressed level only exists once it has
+    // been specified in full.
+    if(Texture2D::compressed(m_cacheFormat) && !m_cache.immutable())
+    {
+        const std::vector<uint8_t> blank(m_cache.levelSize(0), 0);
+        m_cache.uploadCompressed(0, (GLsizei)blank.size(), blank.data());
+    }
+
+    m_slots.assign((size_t)cacheTiles * cacheTiles, Slot{~0u, 0, false});
+    return true;
+}
+
+void VirtualTexture::markDirty(TileKey tile)
+{
+    int level = 0;
+    int x = 0;
+    int y = 0;
+    unpackTileKey(tile, level, x, y);
+
+    // The tile covers 2^n x 2^n tiles n levels finer.
+    for(int i = level, shift = 0; i >= 0; --i, ++shift)
+    {
+        const TileLevel& tiles = m_info.levels[i];
+        const int x0 = std::min(x << shift, tiles.tilesX);
+        const int y0 = std::min(y << shift, tiles.tilesY);
+        const int x1 = std::min((x + 1) << shift, tiles.tilesX);
+        const int y1 = std::min((y + 1) << shift, tiles.tilesY);
+        if(x0 == x1 || y0 == y1)
+            break;
+
+        DirtyRect& dirty = m_dirty[i];
+        if(dirty.x0 == dirty.x1)
+        {
+            dirty = {x0, y0, x1, y1};
+        }
+        else
+        {
+            dirty.x0 = std::min(dirty.x0, x0);
+            dirty.y0 = std::min(dirty.y0, y0);
+            dirty.x1 = std::max(dirty.x1, x1);
+            dirty.y1 = std::max(dirty.y1, y1);
+        }
+    }
+}
+
+void VirtualTexture::request(TileKey tile)
+{
+    int level = 0;
+    int x = 0;
+    int y = 0;
+    unpackTileKey(tile, level, x, y);
+    if(level >= (int)m_info.levels.size() || x >= m_info.levels[level].tilesX || y >= m_info.levels[level].tilesY)
+        return;
+
+    // Its ancestors are kept too, to stand in for it if it's evicted and
+    // while the view moves to finer levels.
+    for(; level < (int)m_info.levels.size(); ++level, x /= 2, y /= 2)
+    {
+        tile = tileKey(level, x, y);
+        auto resident = m_resident.find(tile);
+        if(resident != m_resident.end())
+            m_slots[resident->second].lastUsed = m_frame;
+        else
+            m_wanted.push_back(tile);
+    }
+}
+
+void VirtualTexture::processFeedback(const uint32_t* feedback, size_t count)
+{
+    // Most of the screen wants the same few tiles.
+    m_requests.assign(feedback, feedback + count);
+    std::sort(m_requests.begin(), m_requests.end());
+    m_requests.erase(std::unique(m_requests.begin(), m_requests.end()), m_requests.end());
+
+    m_wanted.clear();
+    m_feedbackFrame = m_frame;
+    for(uint32_t tile : m_requests)
+    {
+        if(tile != ~0u)
+            request(tile);
+    }
+
+    // Coarsest first, since it stands in for the most; the level is the top
+    // bits of the key.
+    std::sort(m_wanted.begin(), m_wanted.end(), [](TileKey a, TileKey b) { return a > b; });
+    m_wanted.erase(std::unique(m_wanted.begin(), m_wanted.end()), m_wanted.end());
+}
+
+void VirtualTexture::startReads()
+{
+    for(TileKey tile : m_wanted)
+    {
+        if((int)m_reads.size() >= m_options.readsInFlight)
+            break;
+
+        const bool reading = std::any_of(m_reads.begin(), m_reads.end(),
+                                         [tile](const TileRead& read) { return read.tile == tile; });
+        if(reading || m_resident.count(tile))
+            continue;
+
+        int level = 0;
+        int x = 0;
+        int y = 0;
+        unpackTileKey(tile, level, x, y);
+
+        // Copying the tile out of the mapping faults its pages in on the
+        // worker rather than in the middle of the upload.
+        const uint8_t* bytes = (const uint8_t*)m_file->data() + m_info.tileOffset(level, x, y);
+        const size_t size = m_info.tileBytes;
+        m_reads.push_back({tile, m_pool.submit([bytes, size]() { return std::vector<uint8_t>(bytes, bytes + size); })});
+    }
+}
+
+void VirtualTexture::uploadTiles()
+{
+    size_t uploaded = 0;
+    auto read = m_reads.begin();
+    while(read != m_reads.end() && (int)uploaded < m_options.uploadsPerFrame)
+    {
+        if(read->bytes.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++read;
+            continue;
+        }
+
+        const int slot = allocateSlot();
+        if(slot < 0)
+            break;
+
+        const std::vector<uint8_t> bytes = read->bytes.get();
+        m_slots[slot].tile = read->tile;
+        m_slots[slot].lastUsed = m_frame;
+        m_resident[read->tile] = slot;
+        uploadTile(slot, bytes.data());
+        markDirty(read->tile);
+
+        read = m_reads.erase(read);
+        ++uploaded;
+    }
+
+    m_stats.uploadedTiles = uploaded;
+}
+
+int VirtualTexture::allocateSlot()
+{
+    int oldest = -1;
+    for(size_t i = 0; i < m_slots.size(); ++i)
+    {
+        const Slot& slot = m_slots[i];
+        if(slot.pinned || slot.lastUsed >= m_feedbackFrame)
+            continue;
+
+        if(slot.tile == ~0u)
+            return (int)i;
+
+        if(oldest < 0 || slot.lastUsed < m_slots[oldest].lastUsed)
+            oldest = (int)i;
+    }
+
+    if(oldest >= 0)
+    {
+        m_resident.erase(m_slots[oldest].tile);
+        markDirty(m_slots[oldest].tile);
+        m_slots[oldest].tile = ~0u;
+        ++m_stats.evictedTiles;
+    }
+
+    return oldest;
+}
+
+void VirtualTexture::uploadTile(int slot, const void* bytes)
+{
+    const GLsizei padded = m_info.paddedTileSize();
+    const GLint x = slot % m_options.cacheTiles * padded;
+    const GLint y = slot / m_options.cacheTiles * padded;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, m_cache.id());
+    if(Texture2D::compressed(m_cacheFormat))
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, x, y, padded, padded, m_cacheFormat, (GLsizei)m_info.tileBytes, bytes);
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, padded, padded, GL_RGBA, GL_UNSIGNED_BYTE, bytes);
+}
+
+void VirtualTexture::rebuildPageTable()
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, m_pageTable.id());
+
+    // Coarsest first, so the entries a missing tile inherits are current.
+    for(int level = (int)m_info.levels.size() - 1; level >= 0; --level)
+    {
+        DirtyRect& dirty = m_dirty[level];
+        if(dirty.x0 == dirty.x1)
+            continue;
+
+        const TileLevel& tiles = m_info.levels[level];
+        std::vector<uint32_t>& entries = m_entries[level];
+        for(int y = dirty.y0; y < dirty.y1; ++y)
+        {
+            for(int x = dirty.x0; x < dirty.x1; ++x)
+            {
+                uint32_t& entry = entries[(size_t)y * tiles.tilesX + x];
+                auto resident = m_resident.find(tileKey(level, x, y));
+                if(resident != m_resident.end())
+                {
+                    const uint32_t slotX = resident->second % m_options.cacheTiles;
+                    const uint32_t slotY = resident->second / m_options.cacheTiles;
+                    entry = slotX | slotY << 8 | (uint32_t)level << 16 | 0xffu << 24;
+                }
+                else
+                {
+                    const TileLevel& parent = m_info.levels[level + 1];
+                    entry = m_entries[level + 1][(size_t)(y / 2) * parent.tilesX + x / 2];
+                }
+            }
+        }
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, tiles.tilesX);
+        glTexSubImage2D(GL_TEXTURE_2D, level, dirty.x0, dirty.y0, dirty.x1 - dirty.x0, dirty.y1 - dirty.y0,
+                        GL_RGBA, GL_UNSIGNED_BYTE, entries.data() + (size_t)dirty.y0 * tiles.tilesX + dirty.x0);
+        dirty = {0, 0, 0, 0};
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+void VirtualTexture::beginFeedback(GLsizei screenWidth, GLsizei screenHeight)
+{
+    const GLsizei width = std::max((screenWidth + m_options.feedbackScale - 1) / m_options.feedbackScale, 1);
+    const GLsizei height = std::max((screenHeight + m_options.feedbackScale - 1) / m_options.feedbackScale, 1);
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+
+    if(width != m_feedbackWidth || height != m_feedbackHeight)
+    {
+        if(!m_framebuffer)
+        {
+            glGenFramebuffers(1, &m_framebuffer);
+            glGenTextures(1, &m_feedbackTexture);
+            glGenRenderbuffers(1, &m_depthBuffer);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, m_feedbackTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_feedbackTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "ERROR::VIRTUAL_TEXTURE::FEEDBACK_INCOMPLETE" << std::endl;
+
+        m_feedbackWidth = width;
+        m_feedbackHeight = height;
+    }
+
+    // The feedback's derivatives are larger by however much smaller it is.
+    // Its size is rounded up, so take the larger ratio, erring towards finer
+    // tiles rather than asking for blurrier ones than the scene samples.
+    m_parameterBlock.virtualFeedbackBias = -std::log2(std::max((float)screenWidth / width, (float)screenHeight / height));
+    m_parameters.update(m_parameterBlock);
+
+    // The feedback program reads the block too, and may draw before bind()
+    // has ever been called.
+    m_parameters.bind(VirtualTextureBlock::kBinding);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, width, height);
+
+    // Pixels nothing is drawn to ask for no tile.
+    const GLuint none[4] = {~0u, ~0u, ~0u, ~0u};
+    const GLfloat farthest = 1.0f;
+    glClearBufferuiv(GL_COLOR, 0, none);
+    glClearBufferfv(GL_DEPTH, 0, &farthest);
+}
+
+void VirtualTexture::endFeedback()
+{
+    // Copy the feedback out on the GPU; update() maps it once the fence says
+    // it's there.
+    Readback& readback = m_readbacks[m_nextReadback];
+    m_nextReadback = (m_nextReadback + 1) % m_readbacks.size();
+    if(readback.fence)
+        glDeleteSync(readback.fence);
+
+    const GLsizeiptr size = (GLsizeiptr)m_feedbackWidth * m_feedbackHeight * sizeof(uint32_t);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    if(size != readback.size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        readback.size = size;
+    }
+
+    glReadPixels(0, 0, m_feedbackWidth, m_feedbackHeight, GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.width = m_feedbackWidth;
+    readback.height = m_feedbackHeight;
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+    glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+}
+
+void VirtualTexture::update()
+{
+    if(!m_valid)
+        return;
+
+    ++m_frame;
+    m_stats.evictedTiles = 0;
+
+    // Only the newest feedback that has arrived matters; anything older is
+    // dropped with it. The ring is written in order, so the newest is the
+    // one before m_nextReadback.
+    const size_t count = m_readbacks.size();
+    for(size_t age = 0; age < count; ++age)
+    {
+        Readback& readback = m_readbacks[(m_nextReadback + count - 1 - age) % count];
+        if(!readback.fence)
+            continue;
+
+        const GLenum status = glClientWaitSync(readback.fence, 0, 0);
+        if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        if(const void* feedback = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.size, GL_MAP_READ_BIT))
+        {
+            processFeedback((const uint32_t*)feedback, (size_t)readback.width * readback.height);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        for(size_t older = age; older < count; ++older)
+        {
+            Readback& stale = m_readbacks[(m_nextReadback + count - 1 - older) % count];
+            if(stale.fence)
+                glDeleteSync(stale.fence);
+
+            stale.fence = nullptr;
+        }
+        break;
+    }
+
+    uploadTiles();
+    startReads();
+    rebuildPageTable();
+
+    m_wanted.erase(std::remove_if(m_wanted.begin(), m_wanted.end(),
+                                  [this](TileKey tile) { return m_resident.count(tile) != 0; }),
+                   m_wanted.end());
+    m_stats.residentTiles = m_resident.size();
+    m_stats.readingTiles = m_reads.size();
+    m_stats.wantedTiles = m_wanted.size();
+}
+
+void VirtualTexture::bind(GLuint pageTableUnit, GLuint cacheUnit)
+{
+    glActiveTexture(GL_TEXTURE0 + pageTableUnit);
+    glBindTexture(GL_TEXTURE_2D, m_pageTable.id());
+    glBindSampler(pageTableUnit, m_pageTableSampler);
+
+    glActiveTexture(GL_TEXTURE0 + cacheUnit);
+    glBindTexture(GL_TEXTURE_2D, m_cache.id());
+    glBindSampler(cacheUnit, m_cacheSampler);
+
+    glActiveTexture(GL_TEXTURE0);
+    m_parameters.bind(VirtualTextureBlock::kBinding);
+}
+
+}   // namespace gl
@@ -0,0 +1,65 @@
+// Sampling a gl::VirtualTexture. Its page table has a texel per tile and a
+// level per mip, each naming the tile of the cache that holds it, or the
+// nearest coarser one resident, and that tile's level.
+#ifndef VIRTUAL_TEXTURE_GLSL
+#define VIRTUAL_TEXTURE_GLSL
+
+// Set by the VirtualTexture when it's bound, see gl::VirtualTextureBlock.
+#ifdef GL_SPIRV
+layout (std140, binding = 2) uniform VirtualTextureBlock
+#else
+layout (std140) uniform VirtualTextureBlock
+#endif
+{
+    vec2 virtualImageSize;
+    vec2 virtualCacheScale;
+    float virtualTileSize;
+    float virtualTileBorder;
+    int virtualLevels;
+    float virtualFeedbackBias;
+};
+
+// The level a mipmapped texture of the image's size would sample at uv.
+int virtualLevel(vec2 uv, float bias)
+{
+    vec2 dx = dFdx(uv * virtualImageSize);
+    vec2 dy = dFdy(uv * virtualImageSize);
+    float level = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0)) + bias;
+    return int(clamp(floor(level), 0.0, float(virtualLevels - 1)));
+}
+
+// Where uv is in level 0's texels, kept inside the image so it has a tile.
+vec2 virtualTexels(vec2 uv)
+{
+    return clamp(uv * virtualImageSize, vec2(0.0), virtualImageSize - 0.5);
+}
+
+ivec2 virtualTile(vec2 texels, int level)
+{
+    return ivec2(texels / (virtualTileSize * exp2(float(level))));
+}
+
+// The tile the feedback pass asks for at uv, packed as gl::VirtualTexture
+// reads it: level, then row, then column.
+uint virtualFeedback(vec2 uv)
+{
+    int level = virtualLevel(uv, virtualFeedbackBias);
+    ivec2 tile = virtualTile(virtualTexels(uv), level);
+    return uint(level) << 28 | uint(tile.y) << 14 | uint(tile.x);
+}
+
+// Sample the image at uv from whichever tile is resident for it. Filtering
+// is bilinear within the tile's level; its border keeps the taps inside it.
+vec4 sampleVirtualTexture(sampler2D pageTable, sampler2D cache, vec2 uv)
+{
+    int level = virtualLevel(uv, 0.0);
+    vec2 texels = virtualTexels(uv);
+    vec3 entry = round(texelFetch(pageTable, virtualTile(texels, level), level).rgb * 255.0);
+
+    vec2 tileTexels = texels / exp2(entry.b);
+    vec2 inTile = tileTexels - floor(tileTexels / virtualTileSize) * virtualTileSize;
+    vec2 cacheTexels = entry.rg * (virtualTileSize + 2.0 * virtualTileBorder) + virtualTileBorder + inTile;
+    return textureLod(cache, cacheTexels * virtualCacheScale, 0.0);
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "MappedFile.h"
+#include "Texture2D.h"
+#include "TileStore.h"
+#include "UniformBlocks.h"
+#include "UniformBuffer.h"
+
+namespace gl
+{
+
+class SamplerCache;
+class ThreadPool;
+
+struct VirtualTextureOptions
+{
+    // Tiles the cache holds each way. Its memory depends on this alone,
+    // however big the image is.
+    int cacheTiles = 16;
+
+    // Tiles uploaded to the cache per update(), and read from the store
+    // ahead of being uploaded.
+    int uploadsPerFrame = 8;
+    int readsInFlight = 16;
+
+    // Feedback is rendered at 1/feedbackScale of the screen each way.
+    int feedbackScale = 8;
+
+    // Feedback buffers read back in turn, so each is mapped this many frames
+    // after it was rendered, once the GPU is done with it.
+    int feedbackFrames = 3;
+};
+
+// What a VirtualTexture holds and did last update().
+struct VirtualTextureStats
+{
+    size_t residentTiles = 0;
+    size_t readingTiles = 0;
+
+    // Tiles the last feedback asked for that aren't resident yet.
+    size_t wantedTiles = 0;
+
+    size_t uploadedTiles = 0;
+    size_t evictedTiles = 0;
+};
+
+// An image far bigger than fits in GL, e.g. gigapixel, drawn from a tile
+// store written by vt_tiler (see TileStore.h). Only the tiles on screen are
+// resident, in a fixed-size cache texture, so memory stays flat whatever the
+// image's size; the store itself is mapped, not read.
+//
+// A page table texture, one texel per tile and a level per mip, says where
+// in the cache each tile is. A tile that isn't resident points at the
+// nearest coarser one that is, so the image is never missing, only blurry
+// until its tiles arrive; the coarsest tile is always resident.
+//
+// Which tiles are needed is found by a feedback pass: what uses the texture
+// is drawn again, small, by a program built with VIRTUAL_TEXTURE_FEEDBACK,
+// writing the tile each pixel wants. It's read back through pixel buffers a
+// few frames later so the GPU never stalls. update() then keeps what was
+// asked for, reads missing tiles from the store on the pool, coarsest first,
+// and uploads a few a frame over the least recently used.
+//
+// All calls must be made on the thread that owns the GL context.
+class VirtualTexture
+{
+public:
+    VirtualTexture(ThreadPool& pool, SamplerCache& samplers, const std::string& path,
+                   const VirtualTextureOptions& options = VirtualTextureOptions());
+
+    VirtualTexture(const VirtualTexture& rhs) = delete;
+    VirtualTexture& operator=(const VirtualTexture& rhs) = delete;
+
+    // Waits for tiles still being read.
+    ~VirtualTexture();
+
+    // False if the store couldn't be opened or its format isn't supported.
+    bool valid() const { return m_valid; }
+
+    // Size of the image, e.g. for the aspect of what it's drawn on.
+    int width() const { return m_info.width; }
+    int height() const { return m_info.height; }
+
+    // Draw the feedback pass between these, with the feedback program and
+    // anything else that depth-tests against what samples the texture.
+    // screenWidth x screenHeight is the size the scene is drawn at. The
+    // parameters are bound to VirtualTextureBlock's binding for the pass;
+    // the framebuffer and viewport are put back afterwards.
+    void beginFeedback(GLsizei screenWidth, GLsizei screenHeight);
+    void endFeedback();
+
+    // Take in feedback that has been read back, upload tiles that have been
+    // read and start reading those still wanted, then bring the page table up
+    // to date. Call once per frame, before drawing.
+    void update();
+
+    // Bind the page table and cache, with their samplers, to texture units,
+    // and the parameters to VirtualTextureBlock's binding. The program's
+    // virtualPageTable and virtualCache samplers must use the same units.
+    void bind(GLuint pageTableUnit, GLuint cacheUnit);
+
+    const VirtualTextureStats& stats() const { return m_stats; }
+
+private:
+    // A tile's level and position, packed as the feedback pass writes them.
+    using TileKey = uint32_t;
+
+    // A tile's place in the cache.
+    struct Slot
+    {
+        TileKey tile;
+        uint64_t lastUsed;
+        bool pinned;
+    };
+
+    struct TileRead
+    {
+        TileKey tile;
+        std::future<std::vector<uint8_t>> bytes;
+    };
+
+    // A feedback buffer on its way back from the GPU.
+    struct Readback
+    {
+        GLuint buffer;
+        GLsizeiptr size;
+        GLsizei width;
+        GLsizei height;
+        GLsync fence;
+    };
+
+    // Part of a level of the page table that has to be rebuilt.
+    struct DirtyRect
+    {
+        int x0, y0, x1, y1;
+    };
+
+    static TileKey tileKey(int level, int x, int y);
+    static void unpackTileKey(TileKey tile, int& level, int& x, int& y);
+
+    bool createCache();
+
+    // Mark the page table of a tile and everything it covers out of date.
+    void markDirty(TileKey tile);
+
+    // Keep tile and its ancestors in the cache, and note those that aren't
+    // there yet.
+    void request(TileKey tile);
+
+    void processFeedback(const uint32_t* feedback, size_t count);
+    void startReads();
+    void uploadTiles();
+
+    // The slot to load a tile into, evicting what's there; -1 if every slot
+    // is pinned or in use by the latest feedback.
+    int allocateSlot();
+    void uploadTile(int slot, const void* bytes);
+
+    void rebuildPageTable();
+
+    ThreadPool& m_pool;
+    VirtualTextureOptions m_options;
+    bool m_valid;
+
+    std::unique_ptr<MappedFile> m_file;
+    TileStoreInfo m_info;
+
+    GLenum m_cacheFormat;
+    Texture2D m_cache;
+    Texture2D m_pageTable;
+    GLuint m_cacheSampler;
+    GLuint m_pageTableSampler;
+    UniformBuffer m_parameters;
+    VirtualTextureBlock m_parameterBlock;
+
+    std::vector<Slot> m_slots;
+    std::unordered_map<TileKey, int> m_resident;
+    std::vector<TileRead> m_reads;
+    std::vector<TileKey> m_wanted;
+    uint64_t m_frame;
+
+    // When feedback last arrived. Tiles it asked for are never evicted to
+    // make room for others; when the cache is too small for the view it
+    // stays blurry rather than thrashing.
+    uint64_t m_feedbackFrame;
+
+    // Page table entries level by level, RGBA8 as uploaded: the cache tile
+    // in red and green and its level in blue.
+    std::vector<std::vector<uint32_t>> m_entries;
+    std::vector<DirtyRect> m_dirty;
+
+    GLuint m_framebuffer;
+    GLuint m_feedbackTexture;
+    GLuint m_depthBuffer;
+    GLsizei m_feedbackWidth;
+    GLsizei m_feedbackHeight;
+    std::vector<Readback> m_readbacks;
+    size_t m_nextReadback;
+    std::vector<uint32_t> m_requests;
+
+    GLint m_savedFramebuffer;
+    GLint m_savedViewport[4];
+
+    VirtualTextureStats m_stats;
+};
+
+}   // namespace gl
+
+#endif
@@ -0,0 +1,30 @@
+#version 330 core
+
+#include "SpirvCompat.glsl"
+#include "VirtualTexture.glsl"
+
+// Built with VIRTUAL_TEXTURE_FEEDBACK 1 for the feedback pass, which writes
+// the tile each pixel needs rather than a colour.
+#ifndef VIRTUAL_TEXTURE_FEEDBACK
+#define VIRTUAL_TEXTURE_FEEDBACK 0
+#endif
+
+VARYING_LOCATION(1) in vec2 texCoords;
+
+#if VIRTUAL_TEXTURE_FEEDBACK
+VARYING_LOCATION(0) out uint feedback;
+#else
+VARYING_LOCATION(0) out vec4 color;
+
+UNIFORM_LOCATION(2) uniform sampler2D virtualPageTable;
+UNIFORM_LOCATION(3) uniform sampler2D virtualCache;
+#endif
+
+void main()
+{
+#if VIRTUAL_TEXTURE_FEEDBACK
+    feedback = virtualFeedback(texCoords);
+#else
+    color = sampleVirtualTexture(virtualPageTable, virtualCache, texCoords);
+#endif
+}
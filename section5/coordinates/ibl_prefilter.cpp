@@ -0,0 +1,93 @@
+// Build step that prefilters equirectangular environment images for
+// EnvironmentLighting, so the first run starts with its lighting instead of
+// prefiltering it. The build runs it over the images listed in the CMake
+// cache's ENVIRONMENT_IMAGES, none by default; it can be run by hand on any
+// other image.
+//
+//     ibl_prefilter [--size N] [--levels N] [--samples N] <image>...
+//
+// Each image, usually HDR, is turned into a cube map with faces of --size
+// texels, projected onto spherical harmonics for diffuse light and
+// convolved with --levels GGX lobes of increasing roughness using --samples
+// samples a texel for specular light, as EnvironmentMap.h describes, on
+// every core. The result is written to <image>.ibl, where
+// EnvironmentLighting looks for it; images whose cache is already up to date
+// are skipped. The options must match the ones the program loads with.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "EnvironmentMap.h"
+#include "ThreadPool.h"
+
+// Prefilter one image unless its cache is up to date. Returns false on any
+// error.
+static bool prefilter(const std::string& path, const gl::EnvironmentMapOptions& options, gl::ThreadPool& pool)
+{
+    const uint64_t key = gl::environmentCacheKey(path, options);
+    if(key == 0)
+    {
+        std::cerr << "ERROR::IBL_PREFILTER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    const std::string cachePath = gl::environmentCachePath(path);
+    gl::EnvironmentMap map;
+    if(gl::readEnvironmentCache(cachePath, key, map))
+        return true;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(!gl::prefilterEnvironmentFile(path, options, map, &pool) || !gl::writeEnvironmentCache(cachePath, key, map))
+        return false;
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Prefiltered " << path << " (" << map.faceSize << "x" << map.faceSize << " faces, "
+              << map.specular.size() << " levels) in " << elapsed.count() << "s" << std::endl;
+    return true;
+}
+
+int main(int argc, const char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: ibl_prefilter [--size N] [--levels N] [--samples N] <image>..." << std::endl;
+        return 1;
+    }
+
+    gl::EnvironmentMapOptions options;
+    std::vector<std::string> images;
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if((arg == "--size" || arg == "--levels" || arg == "--samples") && i + 1 < argc)
+        {
+            const int value = std::atoi(argv[++i]);
+            if(value <= 0)
+            {
+                std::cerr << "ERROR::IBL_PREFILTER::BAD_ARGUMENT: " << arg << " " << argv[i] << std::endl;
+                return 1;
+            }
+
+            if(arg == "--size")
+                options.faceSize = value;
+            else if(arg == "--levels")
+                options.specularLevels = value;
+            else
+                options.specularSamples = value;
+            continue;
+        }
+
+        images.push_back(arg);
+    }
+
+    // Images are prefiltered one at a time, each on every core.
+    gl::ThreadPool pool;
+    bool success = true;
+    for(const std::string& image : images)
+        success = prefilter(image, options, pool) && success;
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+// Times JPEG decoding with each of stb_image's kernel sets, to see what the
+// SIMD paths buy on real images.
+//
+//     jpeg_benchmark [--iterations N] <image.jpg>...
+//
+// The images are read into memory, then the whole set is decoded to RGBA N
+// times (20 by default) with the scalar kernels, then SSE2, then AVX2, each
+// only if the CPU has it. Every path has to decode exactly what the scalar
+// one does, since they're meant to be interchangeable.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "ImageDecoder.h"
+#include "stb_image.h"
+
+struct KernelPath
+{
+    const char* name;
+    int simdLimit;
+    bool available;
+};
+
+static bool readFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return false;
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+int main(int argc, const char** argv)
+{
+    int iterations = 20;
+    std::vector<std::string> paths;
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if(arg == "--iterations" && i + 1 < argc)
+        {
+            iterations = std::max(1, std::atoi(argv[++i]));
+            continue;
+        }
+
+        paths.push_back(arg);
+    }
+
+    if(paths.empty())
+    {
+        std::cerr << "usage: jpeg_benchmark [--iterations N] <image.jpg>..." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> files(paths.size());
+    for(size_t i = 0; i < paths.size(); ++i)
+    {
+        if(!readFile(paths[i], files[i]))
+        {
+            std::cerr << "ERROR::JPEG_BENCHMARK::FILE_NOT_SUCCESSFULLY_READ: " << paths[i] << std::endl;
+            return 1;
+        }
+    }
+
+    const gl::CpuFeatures& cpu = gl::cpuFeatures();
+    const KernelPath kernelPaths[] = {{"scalar", 0, true}, {"sse2", 1, cpu.sse2}, {"avx2", 2, cpu.avx2}};
+
+    gl::ImageDecodeOptions options;
+    options.channels = 4;
+
+    // Warm, so the timings don't include the arena growing.
+    gl::ImageArena arena;
+    gl::ImageView image;
+
+    // What the scalar path decodes, for the others to match.
+    std::vector<std::string> reference(files.size());
+    double scalarMilliseconds = 0.0;
+    bool success = true;
+
+    for(const KernelPath& path : kernelPaths)
+    {
+        if(!path.available)
+        {
+            std::cout << path.name << ": not supported by this CPU" << std::endl;
+            continue;
+        }
+
+        stbi_set_simd_limit(path.simdLimit);
+
+        size_t pixels = 0;
+        for(size_t i = 0; i < files.size(); ++i)
+        {
+            if(!gl::ImageDecoder::decode(files[i].data(), files[i].size(), options, arena, image))
+                return 1;
+
+            const std::string decoded((const char*)image.pixels, image.size());
+            if(path.simdLimit == 0)
+            {
+                reference[i] = decoded;
+            }
+            else if(decoded != reference[i])
+            {
+                std::cerr << "ERROR::JPEG_BENCHMARK::MISMATCH: " << path.name << " decodes " << paths[i]
+                          << " differently from scalar" << std::endl;
+                success = false;
+            }
+
+            pixels += (size_t)image.width * image.height;
+            arena.reset();
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for(int iteration = 0; iteration < iterations; ++iteration)
+        {
+            for(const std::string& file : files)
+            {
+                gl::ImageDecoder::decode(file.data(), file.size(), options, arena, image);
+                arena.reset();
+            }
+        }
+        const double milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        if(path.simdLimit == 0)
+            scalarMilliseconds = milliseconds;
+
+        std::cout << path.name << ": " << milliseconds << " ms per pass, " << pixels / (milliseconds * 1000.0)
+                  << " Mpixels/s, " << scalarMilliseconds / milliseconds << "x scalar" << std::endl;
+    }
+
+    stbi_set_simd_limit(2);
+    return success ? 0 : 1;
+}
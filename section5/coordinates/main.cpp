@@ -1,5 +1,9 @@
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
 
 // OpenGL Extension Manager
 #define GLEW_STATIC
@@ -13,60 +17,77 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include "stb_image.h"
-
+#include "EnvironmentLighting.h"
+#include "ProgramCache.h"
+#include "SamplerCache.h"
 #include "Shader.h"
+#include "ShaderCompiler.h"
+#include "ShaderReloader.h"
+#include "ShaderVariants.h"
+#include "TextureLoader.h"
+#include "TexturePacker.h"
+#include "TextureResidency.h"
+#include "SpirvLibrary.h"
+#include "ThreadPool.h"
+#include "UniformBlocks.h"
+#include "UniformBuffer.h"
+#include "VideoTexture.h"
+#include "VirtualTexture.h"
 
 const GLint WIDTH = 800;
 const GLint HEIGHT = 600;
 GLfloat mixLevel = 0.2f;
 GLfloat step = 0.1f;
 
-unsigned char* loadTexture(const char* filePath, int* width, int* height, int* numChannel)
-{
-    stbi_set_flip_vertically_on_load(true);
-    return stbi_load(filePath, width, height, numChannel, 0);
-}
+// Uniform names are hashed at compile time so the render loop never builds
+// strings or asks the driver for locations.
+constexpr gl::UniformID kMixLevelUniform("mixLevel");
+constexpr gl::UniformID kTexture1Uniform("ourTexture");
+constexpr gl::UniformID kTexture2Uniform("ourTexture2");
+constexpr gl::UniformID kTextureArrayUniform("ourTextures");
+constexpr gl::UniformID kTexture1LayerUniform("ourTextureLayer");
+constexpr gl::UniformID kTexture2LayerUniform("ourTexture2Layer");
+constexpr gl::UniformID kVirtualPageTableUniform("virtualPageTable");
+constexpr gl::UniformID kVirtualCacheUniform("virtualCache");
+constexpr gl::UniformID kEnvironmentUniform("environment");
 
-void configureTexture(const char* filePath, GLuint* textureID)
-{
-    // Load the texture.
-    int width, height, numChannels;
-    unsigned char* data = loadTexture(filePath, &width, &height, &numChannels);
-    if(!data)
-    {
-        std::cerr << "Unable to load texture.";
-        return;
-    }
+// Room in the per-draw uniform ring for this many draws a frame.
+constexpr GLsizeiptr kMaxDrawsPerFrame = 64;
 
-    glGenTextures(1, textureID);
-
-    // Set it as the target for our subsequent calls.
-    glBindTexture(GL_TEXTURE_2D, *textureID);
-
-    // Set it as the target for our subsequent calls.
-    glBindTexture(GL_TEXTURE_2D, *textureID);
-
-    // Set up texture wrapping and filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Now we're going to transfer that texture data previously loaded to the CPU
-    glTexImage2D(GL_TEXTURE_2D,     // target
-                 0,                 // mip map level
-                 GL_RGB,            // format we'll store the pixels in OpenGL
-                 width, height,     // texture width & height
-                 0,                 // legacy
-                 numChannels == 3 ? GL_RGB : GL_RGBA,            // source image format
-                 GL_UNSIGNED_BYTE,  // data type of the source image.
-                 data);             // pointer to image data.
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    // Free the image memory in RAM (its now on the GPU)
-    stbi_image_free(data);
-}
+// Features of the multicolour material; each drops a path from its shaders
+// when it's off.
+constexpr gl::FeatureMask kFeatureTexture0 = 1 << 0;
+constexpr gl::FeatureMask kFeatureTexture1 = 1 << 1;
+constexpr gl::FeatureMask kFeatureVertexColour = 1 << 2;
+constexpr gl::FeatureMask kFeatureTextureArray = 1 << 3;
+
+const char* kShaderVariantsFile = "shader_variants.txt";
+
+// Where texture_baker puts the block-compressed textures.
+const char* kBakedTextureDirectory = "textures";
+
+// Larger images are scaled down as they load.
+constexpr int kMaxTextureDimension = 2048;
+
+// Anisotropy for the textured surfaces, clamped to what the driver allows.
+constexpr GLfloat kTextureAnisotropy = 8.0f;
+
+// Texture memory to stay within; past it textures lose detail.
+constexpr size_t kTextureBudget = 256 * 1024 * 1024;
+
+// Texture units the virtual texture's page table and cache are bound to.
+constexpr GLuint kVirtualPageTableUnit = 2;
+constexpr GLuint kVirtualCacheUnit = 3;
+
+// Texture unit the environment's specular cube map is bound to.
+constexpr GLuint kEnvironmentUnit = 4;
+
+// Rate --video frames were captured at.
+constexpr double kVideoFramesPerSecond = 30.0;
+
+// Where the camera sits in front of the quads and what it sees.
+constexpr GLfloat kCameraDistance = 3.0f;
+constexpr GLfloat kCameraFov = 45.0f;
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
@@ -77,6 +98,25 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         mixLevel += step;
     else if(key == GLFW_KEY_DOWN)
         mixLevel -= step;
+
+    // Past either end mix() would extrapolate rather than show one texture.
+    mixLevel = std::min(std::max(mixLevel, 0.0f), 1.0f);
+}
+
+// The cheapest variant that draws mixLevel correctly, sampling the textures
+// from an array once they've been packed into one.
+gl::FeatureMask multiColourFeatures(bool textureArray)
+{
+    // Repeated steps don't land exactly on 0 or 1.
+    const GLfloat epsilon = 1e-4f;
+
+    gl::FeatureMask features = textureArray ? kFeatureTextureArray : 0;
+    if(mixLevel <= epsilon)
+        return features | kFeatureTexture0;
+    else if(mixLevel >= 1.0f - epsilon)
+        return features | kFeatureTexture1;
+
+    return features | kFeatureTexture0 | kFeatureTexture1;
 }
 
 void glm_tests()
@@ -128,16 +168,134 @@ int main(int argc, const char** argv)
     // Setup OpenGL viewport
     glViewport(0, 0, screenWidth, screenHeight);
 
-    GLuint texture1ID, texture2ID;
-    configureTexture("container.jpg", &texture1ID);
-    configureTexture("awesomeface.png", &texture2ID);
+    // Shared by the background texture decodes and shader preprocessing.
+    gl::ThreadPool threadPool;
+
+    // Textures decode in the background and upload a few rows a frame; the
+    // loader's placeholder is bound until each has its first mip.
+    gl::TextureLoaderOptions textureOptions;
+    textureOptions.bakedDirectory = kBakedTextureDirectory;
+    textureOptions.maxDimension = kMaxTextureDimension;
+    gl::TextureLoader textureLoader(threadPool, textureOptions);
+    gl::TextureHandle texture1 = textureLoader.load("container.jpg");
+    gl::TextureHandle texture2 = textureLoader.load("awesomeface.png");
+
+    // Drops mips the quads are too small on screen to need if the textures
+    // ever outgrow the budget.
+    gl::TextureResidencyOptions residencyOptions;
+    residencyOptions.budget = kTextureBudget;
+    gl::TextureResidency textureResidency(textureLoader, residencyOptions);
+
+    // Both textures sample with the same state, so share one sampler. Sampler
+    // bindings belong to the texture unit and outlive the textures bound to it.
+    gl::SamplerCache samplerCache;
+    const GLuint textureSampler = samplerCache.get(gl::SamplerState::trilinear(kTextureAnisotropy));
+    glBindSampler(0, textureSampler);
+    glBindSampler(1, textureSampler);
+
+    // Once both textures are in they're copied into layers of one array, so
+    // the material draws without binding either of them. The array counts
+    // against the texture budget, and the textures themselves are released
+    // as soon as it's drawn. From then on the array is all there is, so the
+    // last array variant that was ready stands in while another compiles.
+    gl::TexturePacker texturePacker;
+    std::vector<gl::PackedTexture> packedTextures;
+    bool texturesPacked = false;
+    const gl::ShaderHandle* arrayShaderHandle = nullptr;
+
+    // Setup the shaders, loading SPIR-V compiled by the build or reusing
+    // linked binaries from previous runs. They compile in the background and
+    // we draw with the fallback until then.
+    gl::ProgramCache programCache("shader_cache");
+    gl::SpirvLibrary spirvLibrary("spirv");
+    gl::ShaderCompiler shaderCompiler(&programCache, &spirvLibrary);
+    if(!shaderCompiler.valid())
+    {
+        std::cerr << "Failed to build the fallback shader." << std::endl;
+        return -1;
+    }
 
-    // Setup the shaders
-    gl::Shader multiColorShader("SimpleVShader.glsl", "MultiColourFragShader.glsl");
-    multiColorShader.use();
-    multiColorShader.setFloat("mixLevel", 0.2f);
-    multiColorShader.setInt("outTexture", 0);
-    multiColorShader.setInt("ourTexture2", 1);
+    // Specialised variants of the multicolour shader are built as they're
+    // first used. Those used by earlier runs are prepared in the background.
+    gl::ShaderVariants multiColorVariants(shaderCompiler, threadPool,
+                                          "SimpleVShader.glsl", "MultiColourFragShader.glsl",
+                                          {{kFeatureTexture0, "FEATURE_TEXTURE0"},
+                                           {kFeatureTexture1, "FEATURE_TEXTURE1"},
+                                           {kFeatureVertexColour, "FEATURE_VERTEX_COLOUR"},
+                                           {kFeatureTextureArray, "FEATURE_TEXTURE_ARRAY"}});
+    multiColorVariants.loadWarmupList(kShaderVariantsFile);
+
+    // The full material can draw any mix level, so it stands in while a
+    // specialised variant compiles.
+    const gl::ShaderHandle& multiColorShaderHandle = multiColorVariants.get(kFeatureTexture0 | kFeatureTexture1);
+
+    // With --reload-shaders, edits to the .glsl files are picked up live.
+    // With --virtual-texture, a tile store from vt_tiler is streamed onto a
+    // floor under the quads. With --video, a directory of frames or a motion
+    // JPEG file plays on a screen above them. With --environment, an
+    // equirectangular HDR image is prefiltered, or read from its cache, for
+    // image-based lighting and drawn behind everything.
+    std::unique_ptr<gl::ShaderReloader> shaderReloader;
+    std::unique_ptr<gl::VirtualTexture> virtualTexture;
+    std::unique_ptr<gl::VideoTexture> videoTexture;
+    std::unique_ptr<gl::EnvironmentLighting> environment;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--reload-shaders") == 0)
+            shaderReloader.reset(new gl::ShaderReloader(shaderCompiler));
+        else if(std::strcmp(argv[i], "--virtual-texture") == 0 && i + 1 < argc)
+            virtualTexture.reset(new gl::VirtualTexture(threadPool, samplerCache, argv[++i]));
+        else if(std::strcmp(argv[i], "--video") == 0 && i + 1 < argc)
+        {
+            gl::VideoTextureOptions videoOptions;
+            videoOptions.framesPerSecond = kVideoFramesPerSecond;
+            videoTexture.reset(new gl::VideoTexture(argv[++i], videoOptions));
+        }
+        else if(std::strcmp(argv[i], "--environment") == 0 && i + 1 < argc)
+            environment.reset(new gl::EnvironmentLighting(threadPool, samplerCache, argv[++i]));
+    }
+
+    gl::ShaderHandle environmentShaderHandle;
+    if(environment)
+        environmentShaderHandle = shaderCompiler.submit("EnvironmentVShader.glsl", "EnvironmentFragShader.glsl");
+
+    if(videoTexture && !videoTexture->valid())
+        videoTexture.reset();
+
+    // Frames are shown about their own size, so sample without mips.
+    gl::SamplerState videoSamplerState;
+    videoSamplerState.minFilter = GL_LINEAR;
+    videoSamplerState.wrapS = GL_CLAMP_TO_EDGE;
+    videoSamplerState.wrapT = GL_CLAMP_TO_EDGE;
+    const GLuint videoSampler = samplerCache.get(videoSamplerState);
+
+    if(virtualTexture && !virtualTexture->valid())
+        virtualTexture.reset();
+
+    // The floor is drawn twice: small, writing which tiles it needs, then
+    // sampling whichever of them are resident.
+    gl::ShaderHandle virtualTextureShaderHandle;
+    gl::ShaderHandle virtualFeedbackShaderHandle;
+    if(virtualTexture)
+    {
+        virtualTextureShaderHandle = shaderCompiler.submit("SimpleVShader.glsl", "VirtualTextureFragShader.glsl");
+        virtualFeedbackShaderHandle = shaderCompiler.submit("SimpleVShader.glsl", "VirtualTextureFragShader.glsl",
+                                                            {{"VIRTUAL_TEXTURE_FEEDBACK", "1"}});
+    }
+
+    // Typed handles for the uniforms we update every frame. These are
+    // fetched again whenever the shader we draw with changes.
+    gl::Shader* activeShader = nullptr;
+    gl::Uniform<GLfloat> mixLevelUniform;
+
+    // Transforms live in uniform blocks shared by every program. The camera
+    // is bound once; each draw binds its slice of the per-frame ring.
+    gl::UniformBuffer cameraBuffer(sizeof(gl::CameraBlock));
+    cameraBuffer.bind(gl::CameraBlock::kBinding);
+
+    GLint uniformOffsetAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformOffsetAlignment);
+    gl::UniformRingBuffer drawBuffer(kMaxDrawsPerFrame * std::max<GLsizeiptr>(sizeof(gl::DrawBlock), uniformOffsetAlignment));
 
     GLfloat verticies[] = {
         // positions          // colours       // texture coordinates
@@ -192,64 +350,263 @@ int main(int argc, const char** argv)
 
     glm_tests();
 
+    double lastStatsTime = glfwGetTime();
+
     // Set up the game loop...
     while( !glfwWindowShouldClose(window) )
     {
         glfwPollEvents();
+        gl::resetUniformStats();
 
         // Render
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1ID);
+        // Upload any textures that have finished decoding.
+        textureLoader.update();
+        textureResidency.update();
+        if(virtualTexture)
+            virtualTexture->update();
+        if(videoTexture)
+            videoTexture->update(glfwGetTime());
+        if(environment)
+        {
+            environment->update();
+            if(environment->failed())
+                environment.reset();
+        }
+
+        if(!texturesPacked && texture1.ready() && texture2.ready() && !texture1.streaming() && !texture2.streaming())
+        {
+            texturesPacked = true;
+            if(gl::TexturePacker::supported())
+            {
+                packedTextures = texturePacker.pack({texture1.texture(), texture2.texture()});
+                for(const gl::Texture2DArray& array : texturePacker.arrays())
+                    textureResidency.track(array);
+            }
+        }
+
+        // Different sizes or formats can't share an array, and then we carry
+        // on binding the textures on their own.
+        const bool textureArray = packedTextures.size() == 2 &&
+                                  packedTextures[0].kind == gl::PackedTexture::Kind::Array &&
+                                  packedTextures[1].texture == packedTextures[0].texture;
+
+        // Swap to the real shader as soon as it has finished compiling.
+        multiColorVariants.update();
+        shaderCompiler.poll();
+        if(shaderReloader)
+            shaderReloader->update();
+
+        const gl::ShaderHandle& variantHandle = multiColorVariants.get(multiColourFeatures(textureArray));
+        if(textureArray && variantHandle.ready())
+        {
+            if(!arrayShaderHandle)
+            {
+                textureResidency.release(texture1);
+                textureResidency.release(texture2);
+            }
+
+            arrayShaderHandle = &variantHandle;
+        }
+
+        // Until an array variant is ready, the shaders standing in for it
+        // sample the textures separately.
+        const bool sampleArray = arrayShaderHandle != nullptr;
+        const gl::ShaderHandle& standInHandle = sampleArray ? *arrayShaderHandle : multiColorShaderHandle;
+        gl::Shader& multiColorShader = variantHandle.getOr(standInHandle.getOr(shaderCompiler.fallback()));
+        multiColorShader.use();
 
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2ID);
+        if(sampleArray)
+        {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, packedTextures[0].texture);
+        }
+        else
+        {
+            // About how many pixels across a unit quad is, for the residency
+            // manager to judge how much detail the textures need.
+            const GLfloat quadScreenSize = screenHeight / (2.0f * std::tan(glm::radians(kCameraFov) / 2.0f) * kCameraDistance);
+            textureResidency.use(texture1, quadScreenSize);
+            textureResidency.use(texture2, quadScreenSize);
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, texture1.id());
+
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, texture2.id());
+        }
+
+        if(&multiColorShader != activeShader)
+        {
+            activeShader = &multiColorShader;
+            if(sampleArray)
+            {
+                multiColorShader.setInt(kTextureArrayUniform, 0);
+                multiColorShader.setInt(kTexture1LayerUniform, packedTextures[0].layer);
+                multiColorShader.setInt(kTexture2LayerUniform, packedTextures[1].layer);
+            }
+            else
+            {
+                multiColorShader.setInt(kTexture1Uniform, 0);
+                multiColorShader.setInt(kTexture2Uniform, 1);
+            }
+
+            mixLevelUniform = multiColorShader.uniform<GLfloat>(kMixLevelUniform);
+
+            if(shaderReloader && &multiColorShader != &shaderCompiler.fallback())
+                shaderReloader->watch(multiColorShader);
+        }
 
         // Load the configuration stored in the vertex array.
-        multiColorShader.use();
-        multiColorShader.setFloat("mixLevel", mixLevel);
+        mixLevelUniform.set(mixLevel);
 
         // Set up the view & projection matricies first.
-        glm::mat4 view;
-        view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
+        gl::CameraBlock camera;
+        camera.view = glm::translate(glm::mat4(), glm::vec3(0.0f, 0.0f, -kCameraDistance));
 
         // Projection
-        glm::mat4 projection;
-        projection = glm::perspective(glm::radians(45.0f), 1.0f * screenWidth / screenHeight, 0.1f, 100.0f);
+        camera.projection = glm::perspective(glm::radians(kCameraFov), 1.0f * screenWidth / screenHeight, 0.1f, 100.0f);
+        cameraBuffer.update(camera);
 
         // Set up model transform
-        glm::mat4 model1Transform;
-        model1Transform = glm::rotate(model1Transform, glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model1Transform = glm::translate(model1Transform, glm::vec3(-0.5f, 0.0, 0.0f));
-
-        unsigned int viewUniformLocation = glGetUniformLocation(multiColorShader.id(), "view");
-        unsigned int projectionUniformLocation = glGetUniformLocation(multiColorShader.id(), "projection");
-        unsigned int transformUniformLocation = glGetUniformLocation(multiColorShader.id(), "model");
-        //                 locationID, numMatricies, shouldTranspose?, matrixData
-        glUniformMatrix4fv(transformUniformLocation, 1, GL_FALSE, glm::value_ptr(model1Transform));
-        glUniformMatrix4fv(viewUniformLocation, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projectionUniformLocation, 1, GL_FALSE, glm::value_ptr(projection));
-
-        glBindVertexArray(vao);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
+        gl::DrawBlock draw1;
+        draw1.model = glm::rotate(glm::mat4(), glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        draw1.model = glm::translate(draw1.model, glm::vec3(-0.5f, 0.0, 0.0f));
 
         // Draw another instance but in the top left.
-        glm::mat4 model2Transform;
+        gl::DrawBlock draw2;
         // Transform orders are in reverse, we rotate around z first then translate.
-        model2Transform = glm::rotate(model2Transform, glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model2Transform = glm::translate(model2Transform, glm::vec3(0.5f, 0.0f, 0.0f));
-        glUniformMatrix4fv(transformUniformLocation, 1, GL_FALSE, glm::value_ptr(model2Transform));
+        draw2.model = glm::rotate(glm::mat4(), glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        draw2.model = glm::translate(draw2.model, glm::vec3(0.5f, 0.0f, 0.0f));
+
+        // A floor below the quads, stretched to the virtual texture's aspect
+        // and running off into the distance.
+        gl::DrawBlock floorDraw;
+        if(virtualTexture)
+        {
+            const GLfloat aspect = 1.0f * virtualTexture->width() / virtualTexture->height();
+            floorDraw.model = glm::translate(glm::mat4(), glm::vec3(0.0f, -1.0f, -4.0f));
+            floorDraw.model = glm::rotate(floorDraw.model, glm::radians(-85.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            floorDraw.model = glm::scale(floorDraw.model, glm::vec3(8.0f * aspect, 8.0f, 1.0f));
+        }
+
+        // A screen above the quads in the video's aspect.
+        gl::DrawBlock videoDraw;
+        if(videoTexture)
+        {
+            const GLfloat aspect = 1.0f * videoTexture->width() / videoTexture->height();
+            videoDraw.model = glm::translate(glm::mat4(), glm::vec3(0.0f, 0.85f, 0.0f));
+            videoDraw.model = glm::scale(videoDraw.model, glm::vec3(0.7f * aspect, 0.7f, 1.0f));
+        }
+
+        // Write every draw's data with one map, then draw.
+        drawBuffer.beginFrame();
+        GLintptr draw1Offset = drawBuffer.push(draw1);
+        GLintptr draw2Offset = drawBuffer.push(draw2);
+        GLintptr floorOffset = virtualTexture ? drawBuffer.push(floorDraw) : -1;
+        GLintptr videoOffset = videoTexture ? drawBuffer.push(videoDraw) : -1;
+        drawBuffer.unmap();
+
+        glBindVertexArray(vao);
+
+        // The environment is drawn first, behind everything, once it has
+        // loaded.
+        if(environment && environment->ready() && environmentShaderHandle.ready())
+        {
+            gl::Shader& environmentShader = environmentShaderHandle.get();
+            environmentShader.use();
+            environmentShader.setInt(kEnvironmentUniform, kEnvironmentUnit);
+            environment->bind(kEnvironmentUnit);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+
+            multiColorShader.use();
+        }
+
+        // The floor goes first so the quads are drawn over it.
+        if(virtualTexture && virtualTextureShaderHandle.ready() && virtualFeedbackShaderHandle.ready())
+        {
+            drawBuffer.bind(gl::DrawBlock::kBinding, floorOffset, sizeof(gl::DrawBlock));
+
+            virtualTexture->beginFeedback(screenWidth, screenHeight);
+            virtualFeedbackShaderHandle.get().use();
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
+            virtualTexture->endFeedback();
+
+            gl::Shader& virtualTextureShader = virtualTextureShaderHandle.get();
+            virtualTextureShader.use();
+            virtualTextureShader.setInt(kVirtualPageTableUniform, kVirtualPageTableUnit);
+            virtualTextureShader.setInt(kVirtualCacheUniform, kVirtualCacheUnit);
+            virtualTexture->bind(kVirtualPageTableUnit, kVirtualCacheUnit);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
+
+            multiColorShader.use();
+        }
+
+        drawBuffer.bind(gl::DrawBlock::kBinding, draw1Offset, sizeof(gl::DrawBlock));
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
 
+        drawBuffer.bind(gl::DrawBlock::kBinding, draw2Offset, sizeof(gl::DrawBlock));
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
 
+        // The video is drawn by the plain single texture material. It samples
+        // unit 0, so the video borrows it with its own sampler; the quads'
+        // textures are bound again next frame.
+        const gl::ShaderHandle* videoShaderHandle = videoTexture ? &multiColorVariants.get(kFeatureTexture0) : nullptr;
+        if(videoShaderHandle && videoShaderHandle->ready())
+        {
+            videoShaderHandle->get().use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, videoTexture->id());
+            glBindSampler(0, videoSampler);
+
+            drawBuffer.bind(gl::DrawBlock::kBinding, videoOffset, sizeof(gl::DrawBlock));
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
+            glBindSampler(0, textureSampler);
+        }
+        drawBuffer.endFrame();
+
         // Unbind the array...
         glBindVertexArray(0);
 
         glfwSwapBuffers(window);
+
+        // Report the last frame's uniform traffic once a second.
+        double now = glfwGetTime();
+        if(now - lastStatsTime >= 1.0)
+        {
+            const gl::UniformStats& stats = gl::uniformStats();
+            std::cout << "Uniforms per frame: " << stats.uploads << " uploaded, "
+                      << stats.skipped << " skipped" << std::endl;
+
+            const gl::UploadStats& uploads = textureLoader.uploadStats();
+            if(uploads.queuedLevels > 0 || uploads.uploadedBytes > 0)
+            {
+                std::cout << "Texture uploads: " << uploads.uploadedBytes << " bytes in " << uploads.bands
+                          << " bands, " << uploads.queuedLevels << " levels queued" << std::endl;
+            }
+
+            if(virtualTexture)
+            {
+                const gl::VirtualTextureStats& tiles = virtualTexture->stats();
+                std::cout << "Virtual texture: " << tiles.residentTiles << " tiles resident, " << tiles.wantedTiles
+                          << " wanted, " << tiles.readingTiles << " reading" << std::endl;
+            }
+
+            if(videoTexture)
+            {
+                const gl::VideoTextureStats& frames = videoTexture->stats();
+                std::cout << "Video: " << frames.presentedFrames << " frames presented, " << frames.droppedFrames
+                          << " dropped, " << frames.lateFrames << " late, " << frames.bufferedFrames << " buffered"
+                          << std::endl;
+            }
+            lastStatsTime = now;
+        }
     }
 
+    multiColorVariants.saveWarmupList(kShaderVariantsFile);
+
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &ebo);
     glDeleteBuffers(1, &vbo);
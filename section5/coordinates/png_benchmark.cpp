@@ -0,0 +1,151 @@
+// Times PNG decoding through stb_image's original inflate and unfilter path
+// against the fast one, to see what the multi-symbol tables, word copies,
+// fused unfiltering and SIMD filters buy on real images.
+//
+//     png_benchmark [--iterations N] <image.png>...
+//
+// The images are read into memory, then the whole set is decoded to RGBA N
+// times (20 by default) through each path. Every path has to decode exactly
+// what the original one does, byte for byte.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "ImageDecoder.h"
+#include "stb_image.h"
+
+struct DecodePath
+{
+    const char* name;
+    bool fast;
+    int simdLimit;
+    bool available;
+};
+
+static bool readFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return false;
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+int main(int argc, const char** argv)
+{
+    int iterations = 20;
+    std::vector<std::string> paths;
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if(arg == "--iterations" && i + 1 < argc)
+        {
+            iterations = std::max(1, std::atoi(argv[++i]));
+            continue;
+        }
+
+        paths.push_back(arg);
+    }
+
+    if(paths.empty())
+    {
+        std::cerr << "usage: png_benchmark [--iterations N] <image.png>..." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> files(paths.size());
+    size_t compressedBytes = 0;
+    for(size_t i = 0; i < paths.size(); ++i)
+    {
+        if(!readFile(paths[i], files[i]))
+        {
+            std::cerr << "ERROR::PNG_BENCHMARK::FILE_NOT_SUCCESSFULLY_READ: " << paths[i] << std::endl;
+            return 1;
+        }
+        compressedBytes += files[i].size();
+    }
+
+    const gl::CpuFeatures& cpu = gl::cpuFeatures();
+    const DecodePath decodePaths[] = {{"original", false, 0, true},
+                                      {"fast, scalar filters", true, 0, true},
+                                      {"fast, sse2 filters", true, 1, cpu.sse2}};
+
+    gl::ImageDecodeOptions options;
+    options.channels = 4;
+
+    // Warm, so the timings don't include the arena growing.
+    gl::ImageArena arena;
+    gl::ImageView image;
+
+    // What the original path decodes, for the others to match.
+    std::vector<std::string> reference(files.size());
+    double originalMilliseconds = 0.0;
+    bool success = true;
+
+    for(const DecodePath& path : decodePaths)
+    {
+        if(!path.available)
+        {
+            std::cout << path.name << ": not supported by this CPU" << std::endl;
+            continue;
+        }
+
+        stbi_set_png_fast_path(path.fast);
+        stbi_set_simd_limit(path.simdLimit);
+
+        size_t rawBytes = 0;
+        for(size_t i = 0; i < files.size(); ++i)
+        {
+            if(!gl::ImageDecoder::decode(files[i].data(), files[i].size(), options, arena, image))
+                return 1;
+
+            const std::string decoded((const char*)image.pixels, image.size());
+            if(!path.fast)
+            {
+                reference[i] = decoded;
+            }
+            else if(decoded != reference[i])
+            {
+                std::cerr << "ERROR::PNG_BENCHMARK::MISMATCH: " << path.name << " decodes " << paths[i]
+                          << " differently from the original path" << std::endl;
+                success = false;
+            }
+
+            rawBytes += decoded.size();
+            arena.reset();
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for(int iteration = 0; iteration < iterations; ++iteration)
+        {
+            for(const std::string& file : files)
+            {
+                gl::ImageDecoder::decode(file.data(), file.size(), options, arena, image);
+                arena.reset();
+            }
+        }
+        const double milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        if(!path.fast)
+            originalMilliseconds = milliseconds;
+
+        std::cout << path.name << ": " << milliseconds << " ms per pass, " << compressedBytes / (milliseconds * 1000.0)
+                  << " MB/s in, " << rawBytes / (milliseconds * 1000.0) << " MB/s out, "
+                  << originalMilliseconds / milliseconds << "x original" << std::endl;
+    }
+
+    stbi_set_png_fast_path(1);
+    stbi_set_simd_limit(2);
+    return success ? 0 : 1;
+}
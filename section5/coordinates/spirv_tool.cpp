@@ -0,0 +1,154 @@
+// Build step that compiles the .glsl files to SPIR-V for SpirvLibrary.
+//
+//     spirv_tool <glslangValidator> <output directory>
+//                [--feature NAME]... <stage>:<file.glsl>...
+//
+// stage is one of glslangValidator's stage names (vert, frag...). Each file
+// is expanded by the same ShaderPreprocessor the runtime uses, once without
+// defines and once for every combination of the features, in the order
+// ShaderVariants lists them. Each expansion is compiled to <key>.spv and a
+// manifest.txt is written describing them. Any compile error fails the build.
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ShaderPreprocessor.h"
+#include "SpirvManifest.h"
+#include "ThreadPool.h"
+
+struct Job
+{
+    std::string stage;
+    std::string path;
+    gl::ShaderDefines defines;
+};
+
+static std::string keyName(uint64_t key)
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return name;
+}
+
+// Expand and compile one stage, filling module. Returns false on any error.
+static bool compile(const std::string& glslang, const std::string& outputDirectory, const Job& job, gl::SpirvModule& module)
+{
+    std::shared_ptr<const std::string> source = gl::shaderPreprocessor().expand(job.path, job.defines);
+    if(source->empty())
+        return false;
+
+    module.key = gl::spirvModuleKey(job.path, job.defines);
+    module.sourceHash = gl::spirvSourceHash(*source);
+    module.file = keyName(module.key) + ".spv";
+    module.uniforms = gl::parseUniformLocations(*source);
+
+    const std::string glslPath = outputDirectory + "/" + keyName(module.key) + ".glsl";
+    std::ofstream glsl(glslPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    glsl << *source;
+    glsl.close();
+    if(!glsl)
+    {
+        std::cerr << "ERROR::SPIRV_TOOL::NOT_WRITTEN: " << glslPath << std::endl;
+        return false;
+    }
+
+    const std::string command = "\"" + glslang + "\" -G -S " + job.stage + " -o \"" +
+                                outputDirectory + "/" + module.file + "\" \"" + glslPath + "\"";
+    if(std::system(command.c_str()) != 0)
+    {
+        std::cerr << "ERROR::SPIRV_TOOL::COMPILATION_FAILED: " << job.path;
+        for(const auto& define : job.defines)
+            std::cerr << " " << define.first << "=" << define.second;
+        std::cerr << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, const char** argv)
+{
+    if(argc < 4)
+    {
+        std::cerr << "usage: spirv_tool <glslangValidator> <output directory> [--feature NAME]... <stage>:<file.glsl>..." << std::endl;
+        return 1;
+    }
+
+    const std::string glslang = argv[1];
+    const std::string outputDirectory = argv[2];
+
+    std::vector<std::string> features;
+    std::vector<std::pair<std::string, std::string>> files;
+    for(int i = 3; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if(arg == "--feature" && i + 1 < argc)
+        {
+            features.push_back(argv[++i]);
+            continue;
+        }
+
+        size_t colon = arg.find(':');
+        if(colon == std::string::npos)
+        {
+            std::cerr << "ERROR::SPIRV_TOOL::BAD_ARGUMENT: " << arg << std::endl;
+            return 1;
+        }
+
+        files.emplace_back(arg.substr(0, colon), arg.substr(colon + 1));
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(outputDirectory, error);
+    if(error)
+    {
+        std::cerr << "ERROR::SPIRV_TOOL::DIRECTORY_NOT_CREATED: " << outputDirectory << std::endl;
+        return 1;
+    }
+
+    // Don't leave a manifest from an earlier build behind if this one fails.
+    std::filesystem::remove(outputDirectory + "/manifest.txt", error);
+
+    std::vector<Job> jobs;
+    for(const auto& file : files)
+    {
+        jobs.push_back({file.first, file.second, {}});
+        for(uint32_t mask = 0; !features.empty() && mask < (1u << features.size()); ++mask)
+        {
+            gl::ShaderDefines defines;
+            for(size_t bit = 0; bit < features.size(); ++bit)
+                defines.emplace_back(features[bit], (mask & (1u << bit)) ? "1" : "0");
+
+            jobs.push_back({file.first, file.second, std::move(defines)});
+        }
+    }
+
+    // glslangValidator runs as a separate process, so compile in parallel.
+    std::vector<gl::SpirvModule> modules(jobs.size());
+    std::vector<std::future<bool>> results;
+    {
+        gl::ThreadPool pool;
+        for(size_t i = 0; i < jobs.size(); ++i)
+        {
+            results.push_back(pool.submit([&glslang, &outputDirectory, &jobs, &modules, i]()
+            {
+                return compile(glslang, outputDirectory, jobs[i], modules[i]);
+            }));
+        }
+    }
+
+    bool success = true;
+    for(std::future<bool>& result : results)
+        success = result.get() && success;
+
+    if(!success)
+        return 1;
+
+    return gl::writeSpirvManifest(outputDirectory + "/manifest.txt", modules) ? 0 : 1;
+}
@@ -1,2 +1,14 @@
+#include "CpuFeatures.h"
+#include "ImageDecoder.h"
+
+// Route stb_image's allocations through the decoding thread's ImageArena.
+#define STBI_MALLOC(sz) gl::imageArenaMalloc(sz)
+#define STBI_REALLOC_SIZED(p, oldsz, newsz) gl::imageArenaRealloc(p, oldsz, newsz)
+#define STBI_FREE(p) gl::imageArenaFree(p)
+#define STBI_THREAD_LOCAL thread_local
+
+// Pick its AVX2 kernels with the same detection as everything else.
+#define STBI_AVX2_AVAILABLE() gl::cpuFeatures().avx2
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
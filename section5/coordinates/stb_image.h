@@ -14,6 +14,9 @@
 
    You can #define STBI_ASSERT(x) before the #include to avoid using assert.h.
    And #define STBI_MALLOC, STBI_REALLOC, and STBI_FREE to avoid using malloc,realloc,free
+   #define STBI_THREAD_LOCAL to a thread-local storage class to make
+   stbi_failure_reason() per thread.
+   stbi_load_from_memory_scaled() decodes JPEGs at 1/2, 1/4 or 1/8 size.
 
 
    QUICK NOTES:
@@ -354,6 +357,16 @@ typedef struct
 STBIDEF stbi_uc *stbi_load_from_memory   (stbi_uc           const *buffer, int len   , int *x, int *y, int *channels_in_file, int desired_channels);
 STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk  , void *user, int *x, int *y, int *channels_in_file, int desired_channels);
 
+// limit the SIMD kernels used to decode: 0 for none, 1 for SSE2 or NEON, 2
+// for AVX2 too (the default). each is still only used where the CPU has it.
+// not thread-safe; meant for comparing the paths
+STBIDEF void stbi_set_simd_limit(int limit);
+
+// as stbi_load_from_memory, but a JPEG is decoded at 1/scale_denominator of
+// its size (1, 2, 4 or 8), rounded up, with a reduced IDCT rather than by
+// decoding it whole and shrinking it. Other formats load at full size.
+STBIDEF stbi_uc *stbi_load_from_memory_scaled(stbi_uc const *buffer, int len, int *x, int *y, int *channels_in_file, int desired_channels, int scale_denominator);
+
 #ifndef STBI_NO_STDIO
 STBIDEF stbi_uc *stbi_load            (char const *filename, int *x, int *y, int *channels_in_file, int desired_channels);
 STBIDEF stbi_uc *stbi_load_from_file  (FILE *f, int *x, int *y, int *channels_in_file, int desired_channels);
@@ -423,6 +436,15 @@ STBIDEF int      stbi_info_from_file  (FILE *f,                  int *x, int *y,
 
 #endif
 
+// whether an image has 16 bits per channel, so stbi_load_16 keeps precision
+// that stbi_load would lose. only 16-bit PNGs are detected
+STBIDEF int      stbi_is_16_bit_from_memory(stbi_uc const *buffer, int len);
+STBIDEF int      stbi_is_16_bit_from_callbacks(stbi_io_callbacks const *clbk, void *user);
+#ifndef STBI_NO_STDIO
+STBIDEF int      stbi_is_16_bit          (char const *filename);
+STBIDEF int      stbi_is_16_bit_from_file(FILE *f);
+#endif
+
 
 
 // for image formats that explicitly notate that they have premultiplied alpha,
@@ -434,6 +456,12 @@ STBIDEF void stbi_set_unpremultiply_on_load(int flag_true_if_should_unpremultipl
 // or just pass them through "as-is"
 STBIDEF void stbi_convert_iphone_png_to_rgb(int flag_true_if_should_convert);
 
+// PNGs inflate through multi-symbol huffman tables with word-sized match
+// copies, and non-interlaced ones are unfiltered a row at a time as they
+// inflate. set this to 0 for the original path, which decodes exactly the
+// same pixels. not thread-safe; meant for comparing the two
+STBIDEF void stbi_set_png_fast_path(int flag_true_if_fast);
+
 // flip the image vertically, so the first pixel in the output array is the bottom left
 STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
@@ -658,6 +686,39 @@ static int stbi__sse2_available(void)
 #endif
 #endif
 
+// AVX2 kernels are compiled in alongside the SSE2 ones whatever the build
+// targets, and picked at runtime. #define STBI_AVX2_AVAILABLE() to share
+// the application's CPU detection, or STBI_NO_AVX2 to leave them out.
+#if defined(STBI_SSE2) && !defined(STBI_NO_AVX2) && (!defined(_MSC_VER) || _MSC_VER >= 1700)
+#define STBI_AVX2
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#define STBI__AVX2_TARGET
+#else
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+static int stbi__avx2_available(void)
+{
+#if defined(STBI_AVX2_AVAILABLE)
+   return STBI_AVX2_AVAILABLE();
+#elif defined(_MSC_VER)
+   int info[4];
+   __cpuid(info,0);
+   if (info[0] < 7) return 0;
+   // the OS has to save the ymm registers too
+   __cpuid(info,1);
+   if (!((info[2] >> 27) & 1) || (_xgetbv(0) & 6) != 6) return 0;
+   __cpuidex(info,7,0);
+   return (info[1] >> 5) & 1;
+#else
+   // this checks the OS saves the ymm registers too
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -693,6 +754,8 @@ typedef struct
 
    stbi_uc *img_buffer, *img_buffer_end;
    stbi_uc *img_buffer_original, *img_buffer_original_end;
+
+   int jpeg_scale_shift; // JPEGs decode at 1/(1<<jpeg_scale_shift) size
 } stbi__context;
 
 
@@ -705,6 +768,7 @@ static void stbi__start_mem(stbi__context *s, stbi_uc const *buffer, int len)
    s->read_from_callbacks = 0;
    s->img_buffer = s->img_buffer_original = (stbi_uc *) buffer;
    s->img_buffer_end = s->img_buffer_original_end = (stbi_uc *) buffer+len;
+   s->jpeg_scale_shift = 0;
 }
 
 // initialize a callback-based context
@@ -717,6 +781,7 @@ static void stbi__start_callbacks(stbi__context *s, stbi_io_callbacks *c, void *
    s->img_buffer_original = s->buffer_start;
    stbi__refill_buffer(s);
    s->img_buffer_original_end = s->img_buffer_end;
+   s->jpeg_scale_shift = 0;
 }
 
 #ifndef STBI_NO_STDIO
@@ -829,7 +894,18 @@ static int      stbi__pnm_info(stbi__context *s, int *x, int *y, int *comp);
 #endif
 
 // this is not threadsafe
+#ifdef STBI_THREAD_LOCAL
+static STBI_THREAD_LOCAL const char *stbi__g_failure_reason;
+#else
 static const char *stbi__g_failure_reason;
+#endif
+
+static int stbi__simd_limit = 2;
+
+STBIDEF void stbi_set_simd_limit(int limit)
+{
+   stbi__simd_limit = limit;
+}
 
 STBIDEF const char *stbi_failure_reason(void)
 {
@@ -1198,6 +1274,15 @@ STBIDEF stbi_uc *stbi_load_from_memory(stbi_uc const *buffer, int len, int *x, i
    return stbi__load_and_postprocess_8bit(&s,x,y,comp,req_comp);
 }
 
+STBIDEF stbi_uc *stbi_load_from_memory_scaled(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp, int scale_denominator)
+{
+   stbi__context s;
+   stbi__start_mem(&s,buffer,len);
+   while ((2 << s.jpeg_scale_shift) <= scale_denominator && s.jpeg_scale_shift < 3)
+      ++s.jpeg_scale_shift;
+   return stbi__load_and_postprocess_8bit(&s,x,y,comp,req_comp);
+}
+
 STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk, void *user, int *x, int *y, int *comp, int req_comp)
 {
    stbi__context s;
@@ -1659,6 +1744,7 @@ typedef struct
 
 // sizes for components, interleaved MCUs
    int img_h_max, img_v_max;
+   int scale_shift; // decoded blocks are (8 >> scale_shift) pixels square
    int img_mcu_x, img_mcu_y;
    int img_mcu_w, img_mcu_h;
 
@@ -1697,8 +1783,14 @@ typedef struct
    int scan_n, order[4];
    int restart_interval, todo;
 
+// a block waiting for another to go through idct_block2_kernel with
+   short   *idct_pending;
+   stbi_uc *idct_pending_out;
+   int      idct_pending_stride;
+
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
+   void (*idct_block2_kernel)(stbi_uc *out0, int out0_stride, short data0[64], stbi_uc *out1, int out1_stride, short data1[64]);
    void (*YCbCr_to_RGB_kernel)(stbi_uc *out, const stbi_uc *y, const stbi_uc *pcb, const stbi_uc *pcr, int count, int step);
    stbi_uc *(*resample_row_hv_2_kernel)(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs);
 } stbi__jpeg;
@@ -2211,6 +2303,68 @@ static void stbi__idct_block(stbi_uc *out, int out_stride, short data[64])
    }
 }
 
+// reduced IDCTs for decoding at 1/2, 1/4 and 1/8 scale. like libjpeg's
+// scaled decoding, only the lowest 4x4, 2x2 or 1x1 coefficients are used,
+// through a 4-, 2- or 1-point IDCT straight into a block that size; the
+// rest were entropy decoded but are never transformed
+#define STBI__IDCT_1D_4(s0,s1,s2,s3) \
+   int t0,t1,o0,o1,x0,x1,x2,x3;                            \
+   t0 = ((s0) + (s2)) * stbi__f2f(0.707106781f);           \
+   t1 = ((s0) - (s2)) * stbi__f2f(0.707106781f);           \
+   o0 = (s1)*stbi__f2f(0.923879533f) + (s3)*stbi__f2f(0.382683432f); \
+   o1 = (s1)*stbi__f2f(0.382683432f) - (s3)*stbi__f2f(0.923879533f); \
+   x0 = t0+o0; x3 = t0-o0;                                 \
+   x1 = t1+o1; x2 = t1-o1;
+
+static void stbi__idct_block_4x4(stbi_uc *out, int out_stride, short data[64])
+{
+   int i,val[16],*v=val;
+   stbi_uc *o;
+   short *d = data;
+
+   // columns, taking the constants' 1<<12 straight back out
+   for (i=0; i < 4; ++i,++d,++v) {
+      STBI__IDCT_1D_4(d[0],d[8],d[16],d[24])
+      v[ 0] = (x0 + 2048) >> 12;
+      v[ 4] = (x1 + 2048) >> 12;
+      v[ 8] = (x2 + 2048) >> 12;
+      v[12] = (x3 + 2048) >> 12;
+   }
+
+   for (i=0, v=val, o=out; i < 4; ++i,v+=4,o+=out_stride) {
+      STBI__IDCT_1D_4(v[0],v[1],v[2],v[3])
+      // 1<<12 from the constants and the 4x4 IDCT's 1/4 make 1<<14 to
+      // remove, rounded, with -128..127 moved up to 0..255 first
+      x0 += 8192 + (128<<14);
+      x1 += 8192 + (128<<14);
+      x2 += 8192 + (128<<14);
+      x3 += 8192 + (128<<14);
+      o[0] = stbi__clamp(x0 >> 14);
+      o[1] = stbi__clamp(x1 >> 14);
+      o[2] = stbi__clamp(x2 >> 14);
+      o[3] = stbi__clamp(x3 >> 14);
+   }
+}
+
+static void stbi__idct_block_2x2(stbi_uc *out, int out_stride, short data[64])
+{
+   // the 2-point IDCT is a sum and a difference, each scaled by 1/sqrt(2),
+   // which with the 2D IDCT's 1/4 makes an exact 1/8
+   int t0 = data[0] + data[8], t1 = data[0] - data[8];
+   int t2 = data[1] + data[9], t3 = data[1] - data[9];
+   out[0]            = stbi__clamp((t0+t2 + 4 + (128<<3)) >> 3);
+   out[1]            = stbi__clamp((t0-t2 + 4 + (128<<3)) >> 3);
+   out[out_stride  ] = stbi__clamp((t1+t3 + 4 + (128<<3)) >> 3);
+   out[out_stride+1] = stbi__clamp((t1-t3 + 4 + (128<<3)) >> 3);
+}
+
+static void stbi__idct_block_1x1(stbi_uc *out, int out_stride, short data[64])
+{
+   // just the block's average
+   STBI_NOTUSED(out_stride);
+   out[0] = stbi__clamp((data[0] + 4 + (128<<3)) >> 3);
+}
+
 #ifdef STBI_SSE2
 // sse2 integer IDCT. not the fastest possible implementation but it
 // produces bit-identical results to the generic C version so it's
@@ -2392,6 +2546,200 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 
 #endif // STBI_SSE2
 
+#ifdef STBI_AVX2
+// avx2 version of stbi__idct_simd doing two blocks at once, one in each
+// 128-bit lane. avx2's unpacks and packs stay within lanes, so it's the same
+// sequence of operations and still bit-identical to the generic C version.
+static STBI__AVX2_TARGET void stbi__idct_avx2(stbi_uc *out0, int out0_stride, short data0[64], stbi_uc *out1, int out1_stride, short data1[64])
+{
+   __m256i row0, row1, row2, row3, row4, row5, row6, row7;
+   __m256i tmp;
+
+   // dot product constant: even elems=x, odd elems=y
+   #define dct_const(x,y)  _mm256_broadcastsi128_si256(_mm_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y)))
+
+   // out(0) = c0[even]*x + c0[odd]*y   (c0, x, y 16-bit, out 32-bit)
+   // out(1) = c1[even]*x + c1[odd]*y
+   #define dct_rot(out0,out1, x,y,c0,c1) \
+      __m256i c0##lo = _mm256_unpacklo_epi16((x),(y)); \
+      __m256i c0##hi = _mm256_unpackhi_epi16((x),(y)); \
+      __m256i out0##_l = _mm256_madd_epi16(c0##lo, c0); \
+      __m256i out0##_h = _mm256_madd_epi16(c0##hi, c0); \
+      __m256i out1##_l = _mm256_madd_epi16(c0##lo, c1); \
+      __m256i out1##_h = _mm256_madd_epi16(c0##hi, c1)
+
+   // out = in << 12  (in 16-bit, out 32-bit)
+   #define dct_widen(out, in) \
+      __m256i out##_l = _mm256_srai_epi32(_mm256_unpacklo_epi16(_mm256_setzero_si256(), (in)), 4); \
+      __m256i out##_h = _mm256_srai_epi32(_mm256_unpackhi_epi16(_mm256_setzero_si256(), (in)), 4)
+
+   // wide add
+   #define dct_wadd(out, a, b) \
+      __m256i out##_l = _mm256_add_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_add_epi32(a##_h, b##_h)
+
+   // wide sub
+   #define dct_wsub(out, a, b) \
+      __m256i out##_l = _mm256_sub_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_sub_epi32(a##_h, b##_h)
+
+   // butterfly a/b, add bias, then shift by "s" and pack
+   #define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m256i abiased_l = _mm256_add_epi32(a##_l, bias); \
+         __m256i abiased_h = _mm256_add_epi32(a##_h, bias); \
+         dct_wadd(sum, abiased, b); \
+         dct_wsub(dif, abiased, b); \
+         out0 = _mm256_packs_epi32(_mm256_srai_epi32(sum_l, s), _mm256_srai_epi32(sum_h, s)); \
+         out1 = _mm256_packs_epi32(_mm256_srai_epi32(dif_l, s), _mm256_srai_epi32(dif_h, s)); \
+      }
+
+   // 8-bit interleave step (for transposes)
+   #define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi8(a, b); \
+      b = _mm256_unpackhi_epi8(tmp, b)
+
+   // 16-bit interleave step (for transposes)
+   #define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi16(a, b); \
+      b = _mm256_unpackhi_epi16(tmp, b)
+
+   #define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m256i sum04 = _mm256_add_epi16(row0, row4); \
+         __m256i dif04 = _mm256_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         dct_wadd(x0, t0e, t3e); \
+         dct_wsub(x3, t0e, t3e); \
+         dct_wadd(x1, t1e, t2e); \
+         dct_wsub(x2, t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m256i sum17 = _mm256_add_epi16(row1, row7); \
+         __m256i sum35 = _mm256_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         dct_wadd(x4, y0o, y4o); \
+         dct_wadd(x5, y1o, y5o); \
+         dct_wadd(x6, y2o, y5o); \
+         dct_wadd(x7, y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
+
+   // a row of each block, the first in the low lane
+   #define dct_load(r) \
+      _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_load_si128((const __m128i *) (data0 + (r)*8))), \
+                              _mm_load_si128((const __m128i *) (data1 + (r)*8)), 1)
+
+   // store one lane's worth of transposed rows, as stbi__idct_simd does
+   #define dct_store(out, out_stride, p0, p1, p2, p3) \
+      _mm_storel_epi64((__m128i *) out, p0); out += out_stride; \
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p0, 0x4e)); out += out_stride; \
+      _mm_storel_epi64((__m128i *) out, p2); out += out_stride; \
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p2, 0x4e)); out += out_stride; \
+      _mm_storel_epi64((__m128i *) out, p1); out += out_stride; \
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p1, 0x4e)); out += out_stride; \
+      _mm_storel_epi64((__m128i *) out, p3); out += out_stride; \
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p3, 0x4e))
+
+   __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+   __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f( 0.765366865f), stbi__f2f(0.5411961f));
+   __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+   __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+   __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f( 0.298631336f), stbi__f2f(-1.961570560f));
+   __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f( 3.072711026f));
+   __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f( 2.053119869f), stbi__f2f(-0.390180644f));
+   __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f( 1.501321110f));
+
+   // rounding biases in column/row passes, see stbi__idct_block for explanation.
+   __m256i bias_0 = _mm256_set1_epi32(512);
+   __m256i bias_1 = _mm256_set1_epi32(65536 + (128<<17));
+
+   // load
+   row0 = dct_load(0);
+   row1 = dct_load(1);
+   row2 = dct_load(2);
+   row3 = dct_load(3);
+   row4 = dct_load(4);
+   row5 = dct_load(5);
+   row6 = dct_load(6);
+   row7 = dct_load(7);
+
+   // column pass
+   dct_pass(bias_0, 10);
+
+   {
+      // 16bit 8x8 transpose pass 1
+      dct_interleave16(row0, row4);
+      dct_interleave16(row1, row5);
+      dct_interleave16(row2, row6);
+      dct_interleave16(row3, row7);
+
+      // transpose pass 2
+      dct_interleave16(row0, row2);
+      dct_interleave16(row1, row3);
+      dct_interleave16(row4, row6);
+      dct_interleave16(row5, row7);
+
+      // transpose pass 3
+      dct_interleave16(row0, row1);
+      dct_interleave16(row2, row3);
+      dct_interleave16(row4, row5);
+      dct_interleave16(row6, row7);
+   }
+
+   // row pass
+   dct_pass(bias_1, 17);
+
+   {
+      // pack
+      __m256i p0 = _mm256_packus_epi16(row0, row1); // a0a1a2a3...a7b0b1b2b3...b7
+      __m256i p1 = _mm256_packus_epi16(row2, row3);
+      __m256i p2 = _mm256_packus_epi16(row4, row5);
+      __m256i p3 = _mm256_packus_epi16(row6, row7);
+
+      // 8bit 8x8 transpose pass 1
+      dct_interleave8(p0, p2); // a0e0a1e1...
+      dct_interleave8(p1, p3); // c0g0c1g1...
+
+      // transpose pass 2
+      dct_interleave8(p0, p1); // a0c0e0g0...
+      dct_interleave8(p2, p3); // b0d0f0h0...
+
+      // transpose pass 3
+      dct_interleave8(p0, p2); // a0b0c0d0...
+      dct_interleave8(p1, p3); // a4b4c4d4...
+
+      // store
+      dct_store(out0, out0_stride, _mm256_castsi256_si128(p0), _mm256_castsi256_si128(p1),
+                _mm256_castsi256_si128(p2), _mm256_castsi256_si128(p3));
+      dct_store(out1, out1_stride, _mm256_extracti128_si256(p0, 1), _mm256_extracti128_si256(p1, 1),
+                _mm256_extracti128_si256(p2, 1), _mm256_extracti128_si256(p3, 1));
+   }
+
+#undef dct_const
+#undef dct_rot
+#undef dct_widen
+#undef dct_wadd
+#undef dct_wsub
+#undef dct_bfly32o
+#undef dct_interleave8
+#undef dct_interleave16
+#undef dct_pass
+#undef dct_load
+#undef dct_store
+}
+
+#endif // STBI_AVX2
+
 #ifdef STBI_NEON
 
 // NEON integer IDCT. should produce bit-identical
@@ -2634,13 +2982,36 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
-static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
+// idct a block, or with a two-block kernel hold it back until there's
+// another to go with it. data must stay put until stbi__jpeg_idct_flush()
+static void stbi__jpeg_idct(stbi__jpeg *z, stbi_uc *out, int out_stride, short *data)
+{
+   if (z->idct_pending) {
+      z->idct_block2_kernel(z->idct_pending_out, z->idct_pending_stride, z->idct_pending, out, out_stride, data);
+      z->idct_pending = NULL;
+   } else if (z->idct_block2_kernel) {
+      z->idct_pending = data;
+      z->idct_pending_out = out;
+      z->idct_pending_stride = out_stride;
+   } else {
+      z->idct_block_kernel(out, out_stride, data);
+   }
+}
+
+static void stbi__jpeg_idct_flush(stbi__jpeg *z)
+{
+   if (z->idct_pending) {
+      z->idct_block_kernel(z->idct_pending_out, z->idct_pending_stride, z->idct_pending);
+      z->idct_pending = NULL;
+   }
+}
+
+static int stbi__parse_entropy_coded_scan(stbi__jpeg *z, short blocks[2][64])
 {
    stbi__jpeg_reset(z);
    if (!z->progressive) {
       if (z->scan_n == 1) {
          int i,j;
-         STBI_SIMD_ALIGN(short, data[64]);
          int n = z->order[0];
          // non-interleaved data, we just need to process one block at a time,
          // in trivial scanline order
@@ -2650,9 +3021,10 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
          int h = (z->img_comp[n].y+7) >> 3;
          for (j=0; j < h; ++j) {
             for (i=0; i < w; ++i) {
+               short *data = blocks[z->idct_pending == blocks[0]];
                int ha = z->img_comp[n].ha;
                if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               stbi__jpeg_idct(z, z->img_comp[n].data+z->img_comp[n].w2*j*(8 >> z->scale_shift)+i*(8 >> z->scale_shift), z->img_comp[n].w2, data);
                // every data block is an MCU, so countdown the restart interval
                if (--z->todo <= 0) {
                   if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
@@ -2666,7 +3038,6 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
          return 1;
       } else { // interleaved
          int i,j,k,x,y;
-         STBI_SIMD_ALIGN(short, data[64]);
          for (j=0; j < z->img_mcu_y; ++j) {
             for (i=0; i < z->img_mcu_x; ++i) {
                // scan an interleaved mcu... process scan_n components in order
@@ -2676,11 +3047,12 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
                   // by the basic H and V specified for the component
                   for (y=0; y < z->img_comp[n].v; ++y) {
                      for (x=0; x < z->img_comp[n].h; ++x) {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
+                        int x2 = (i*z->img_comp[n].h + x)*(8 >> z->scale_shift);
+                        int y2 = (j*z->img_comp[n].v + y)*(8 >> z->scale_shift);
+                        short *data = blocks[z->idct_pending == blocks[0]];
                         int ha = z->img_comp[n].ha;
                         if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+                        stbi__jpeg_idct(z, z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
                      }
                   }
                }
@@ -2758,6 +3130,16 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
    }
 }
 
+static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
+{
+   // baseline blocks are decoded into these in turn, so one can wait for
+   // a two-block idct while the next is decoded into the other
+   STBI_SIMD_ALIGN(short, blocks[2][64]);
+   int r = stbi__parse_entropy_coded_scan(z, blocks);
+   stbi__jpeg_idct_flush(z);
+   return r;
+}
+
 static void stbi__jpeg_dequantize(short *data, stbi__uint16 *dequant)
 {
    int i;
@@ -2777,10 +3159,11 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
                stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               stbi__jpeg_idct(z, z->img_comp[n].data+z->img_comp[n].w2*j*(8 >> z->scale_shift)+i*(8 >> z->scale_shift), z->img_comp[n].w2, data);
             }
          }
       }
+      stbi__jpeg_idct_flush(z);
    }
 }
 
@@ -3012,16 +3395,19 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       z->img_comp[i].coeff = 0;
       z->img_comp[i].raw_coeff = 0;
       z->img_comp[i].linebuf = NULL;
+      // w2, h2 are multiples of 8 (see above). coefficients are kept for
+      // every block, but a reduced scale decodes each into fewer pixels
+      z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
+      z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
+      z->img_comp[i].w2 >>= z->scale_shift;
+      z->img_comp[i].h2 >>= z->scale_shift;
       z->img_comp[i].raw_data = stbi__malloc_mad2(z->img_comp[i].w2, z->img_comp[i].h2, 15);
       if (z->img_comp[i].raw_data == NULL)
          return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
       // align blocks for idct using mmx/sse
       z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
       if (z->progressive) {
-         // w2, h2 are multiples of 8 (see above)
-         z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
-         z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].coeff_w * 8, z->img_comp[i].coeff_h * 8, sizeof(short), 15);
          if (z->img_comp[i].raw_coeff == NULL)
             return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3476,26 +3862,111 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+// avx2 version of stbi__YCbCr_to_RGB_simd, 16 pixels at a time. the first
+// eight go through the low lane and the rest the high one, so each lane does
+// exactly what the sse2 version does
+static STBI__AVX2_TARGET void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 4) {
+      __m256i signflip  = _mm256_set1_epi8(-0x80);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi8((char) (unsigned char) 128);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+
+      for (; i+15 < count; i += 16) {
+         // load, with pixels 8..15 moved up to the high lane
+         __m256i y_bytes  = _mm256_permute4x64_epi64(_mm256_castsi128_si256(_mm_loadu_si128((__m128i *) (y+i))), 0x50);
+         __m256i cr_bytes = _mm256_permute4x64_epi64(_mm256_castsi128_si256(_mm_loadu_si128((__m128i *) (pcr+i))), 0x50);
+         __m256i cb_bytes = _mm256_permute4x64_epi64(_mm256_castsi128_si256(_mm_loadu_si128((__m128i *) (pcb+i))), 0x50);
+         __m256i cr_biased = _mm256_xor_si256(cr_bytes, signflip); // -128
+         __m256i cb_biased = _mm256_xor_si256(cb_bytes, signflip); // -128
+
+         // unpack to short (and left-shift cr, cb by 8)
+         __m256i yw  = _mm256_unpacklo_epi8(y_bias, y_bytes);
+         __m256i crw = _mm256_unpacklo_epi8(_mm256_setzero_si256(), cr_biased);
+         __m256i cbw = _mm256_unpacklo_epi8(_mm256_setzero_si256(), cb_biased);
+
+         // color transform
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte, set up for transpose
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+
+         // transpose to interleave channels
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+         // store, putting the lanes back in order
+         _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+         _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+         out += 64;
+      }
+   }
+
+   stbi__YCbCr_to_RGB_simd(out, y+i, pcb+i, pcr+i, count-i, step);
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
    j->idct_block_kernel = stbi__idct_block;
+   j->idct_block2_kernel = NULL;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
+   j->idct_pending = NULL;
 
 #ifdef STBI_SSE2
-   if (stbi__sse2_available()) {
+   if (stbi__simd_limit >= 1 && stbi__sse2_available()) {
       j->idct_block_kernel = stbi__idct_simd;
       j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
       j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
    }
 #endif
 
+#ifdef STBI_AVX2
+   // single blocks left over still go through stbi__idct_simd
+   if (stbi__simd_limit >= 2 && stbi__avx2_available()) {
+      j->idct_block2_kernel = stbi__idct_avx2;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+   }
+#endif
+
 #ifdef STBI_NEON
-   j->idct_block_kernel = stbi__idct_simd;
-   j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
-   j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   if (stbi__simd_limit >= 1) {
+      j->idct_block_kernel = stbi__idct_simd;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   }
 #endif
+
+   j->scale_shift = j->s->jpeg_scale_shift;
+   if (j->scale_shift) j->idct_block2_kernel = NULL;
+   if (j->scale_shift == 1) j->idct_block_kernel = stbi__idct_block_4x4;
+   if (j->scale_shift == 2) j->idct_block_kernel = stbi__idct_block_2x2;
+   if (j->scale_shift == 3) j->idct_block_kernel = stbi__idct_block_1x1;
 }
 
 // clean up the temporary component buffers
@@ -3532,6 +4003,17 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    // load a jpeg image from whichever source, but leave in YCbCr format
    if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
 
+   // decoded at a reduced scale, the image and its components shrank too
+   if (z->scale_shift) {
+      int k, round = (1 << z->scale_shift) - 1;
+      z->s->img_x = (z->s->img_x + round) >> z->scale_shift;
+      z->s->img_y = (z->s->img_y + round) >> z->scale_shift;
+      for (k=0; k < z->s->img_n; ++k) {
+         z->img_comp[k].x = (z->img_comp[k].x + round) >> z->scale_shift;
+         z->img_comp[k].y = (z->img_comp[k].y + round) >> z->scale_shift;
+      }
+   }
+
    // determine actual number of components to generate
    n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
 
@@ -3740,6 +4222,18 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 #define STBI__ZFAST_BITS  9 // accelerate all cases in default tables
 #define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
 
+// the fast path's literal/length table resolves up to two literals, or a
+// length with its extra bits count, per lookup
+#define STBI__ZMULTI_BITS  11
+#define STBI__ZMULTI_MASK  ((1 << STBI__ZMULTI_BITS) - 1)
+
+static int stbi__png_fast_path = 1;
+
+STBIDEF void stbi_set_png_fast_path(int flag_true_if_fast)
+{
+   stbi__png_fast_path = flag_true_if_fast;
+}
+
 // zlib-style huffman encoding
 // (jpegs packs from left, zlib from right, so can't share code)
 typedef struct
@@ -3833,7 +4327,15 @@ typedef struct
    char *zout_end;
    int   z_expandable;
 
+   // if set, called with everything written so far once the output
+   // reaches notify_len bytes; returns the length to be called at next,
+   // or -1 to stop with an error
+   int (*notify)(void *user, stbi_uc *out, int len);
+   void *notify_user;
+   int   notify_len;
+
    stbi__zhuffman z_length, z_distance;
+   stbi__uint32 z_multi[1 << STBI__ZMULTI_BITS];
 } stbi__zbuf;
 
 stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
@@ -3968,6 +4470,201 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
    }
 }
 
+enum {
+   STBI__ZMULTI_slow=0,    // end of block, or a code longer than the table
+   STBI__ZMULTI_literal,
+   STBI__ZMULTI_literal2,
+   STBI__ZMULTI_length
+};
+
+// entries are bits used | kind << 8 | payload << 16, where the payload is
+// one or two literals, or a length base | extra bits count << 9
+static void stbi__zbuild_multi(stbi__uint32 *multi, const stbi__zhuffman *z)
+{
+   int i,j,s;
+   memset(multi, 0, sizeof(stbi__uint32) << STBI__ZMULTI_BITS);
+   for (s=1; s <= STBI__ZMULTI_BITS; ++s) {
+      int count = z->firstsymbol[s+1] - z->firstsymbol[s];
+      for (i=0; i < count; ++i) {
+         int v = z->value[z->firstsymbol[s] + i];
+         stbi__uint32 e;
+         if (v < 256)
+            e = ((stbi__uint32) v << 16) | (STBI__ZMULTI_literal << 8) | s;
+         else if (v > 256)
+            e = ((stbi__uint32) (stbi__zlength_base[v-257] | (stbi__zlength_extra[v-257] << 9)) << 16) | (STBI__ZMULTI_length << 8) | s;
+         else
+            continue;
+         for (j = stbi__bit_reverse(z->firstcode[s] + i, s); j < (1 << STBI__ZMULTI_BITS); j += (1 << s))
+            multi[j] = e;
+      }
+   }
+   // pair each literal with the one after it where both codes fit. going
+   // down, since the second literal's entry is at a lower index and has to
+   // still be single
+   for (j=(1 << STBI__ZMULTI_BITS)-1; j >= 0; --j) {
+      stbi__uint32 e = multi[j], e2;
+      if (((e >> 8) & 255) != STBI__ZMULTI_literal) continue;
+      s = e & 255;
+      e2 = multi[j >> s];
+      if (((e2 >> 8) & 255) == STBI__ZMULTI_literal && s + (int) (e2 & 255) <= STBI__ZMULTI_BITS)
+         multi[j] = ((e >> 16) | ((e2 >> 16) << 8)) << 16 | (STBI__ZMULTI_literal2 << 8) | (s + (e2 & 255));
+   }
+}
+
+stbi_inline static stbi__uint32 stbi__zload32(const stbi_uc *p)
+{
+   return p[0] | (p[1] << 8) | (p[2] << 16) | ((stbi__uint32) p[3] << 24);
+}
+
+// top the bit buffer up to at least 24 bits with one 32-bit load. only
+// whole bytes are counted as read; the rest of the load sits above num_bits
+// and the next refill loads the same bits there again
+#define STBI__ZREFILL() \
+   if (n < 24) { \
+      bits |= stbi__zload32(in) << n; \
+      in += (31 - n) >> 3; \
+      n |= 24; \
+   }
+
+#define STBI__ZSYNC() \
+   a->zbuffer = in, \
+   a->code_buffer = n < 32 ? bits & ((1U << n) - 1) : bits, \
+   a->num_bits = n
+
+#define STBI__ZRELOAD() \
+   in = a->zbuffer, bits = a->code_buffer, n = a->num_bits
+
+// same as stbi__parse_huffman_block, with the bit buffer in locals, refills
+// unchecked, and matches copied 8 bytes at a time. the input and output
+// always have room for a whole symbol, so near the end of either the block
+// is finished by stbi__parse_huffman_block
+static int stbi__parse_huffman_block_fast(stbi__zbuf *a)
+{
+   char *zout = a->zout;
+   stbi_uc *in = a->zbuffer;
+   stbi__uint32 bits = a->code_buffer;
+   int n = a->num_bits;
+   int notify_len = a->notify ? a->notify_len : 0x7fffffff;
+   for(;;) {
+      stbi__uint32 e;
+      char *p;
+      int z,s,len,dist;
+      if (zout - a->zout_start >= notify_len) {
+         a->zout = zout;
+         len = a->notify(a->notify_user, (stbi_uc *) a->zout_start, (int) (zout - a->zout_start));
+         if (len < 0) return 0;
+         a->notify_len = notify_len = len;
+         continue;
+      }
+      // 4 refills of at most 3 bytes each, and a 4 byte load past the last
+      if (a->zbuffer_end - in < 16 || a->zout_end - zout < 258 + 8)
+         break;
+
+      STBI__ZREFILL();
+      e = a->z_multi[bits & STBI__ZMULTI_MASK];
+      s = e & 255;
+      switch ((e >> 8) & 255) {
+         case STBI__ZMULTI_literal:
+            *zout++ = (char) (e >> 16);
+            bits >>= s;
+            n -= s;
+            continue;
+         case STBI__ZMULTI_literal2:
+            zout[0] = (char) (e >> 16);
+            zout[1] = (char) (e >> 24);
+            zout += 2;
+            bits >>= s;
+            n -= s;
+            continue;
+         case STBI__ZMULTI_length:
+            bits >>= s;
+            n -= s;
+            len = (e >> 16) & 511;
+            s = e >> 25;
+            break;
+         default:
+            STBI__ZSYNC();
+            z = stbi__zhuffman_decode(a, &a->z_length);
+            STBI__ZRELOAD();
+            if (z < 0) return stbi__err("bad huffman code","Corrupt PNG");
+            if (z < 256) {
+               *zout++ = (char) z;
+               continue;
+            }
+            if (z == 256) {
+               a->zout = zout;
+               return 1;
+            }
+            len = stbi__zlength_base[z-257];
+            s = stbi__zlength_extra[z-257];
+            STBI__ZREFILL();
+            break;
+      }
+      len += bits & ((1 << s) - 1);
+      bits >>= s;
+      n -= s;
+
+      STBI__ZREFILL();
+      z = a->z_distance.fast[bits & STBI__ZFAST_MASK];
+      if (z) {
+         s = z >> 9;
+         bits >>= s;
+         n -= s;
+         z &= 511;
+      } else {
+         STBI__ZSYNC();
+         z = stbi__zhuffman_decode_slowpath(a, &a->z_distance);
+         STBI__ZRELOAD();
+         if (z < 0) return stbi__err("bad huffman code","Corrupt PNG");
+      }
+      dist = stbi__zdist_base[z];
+      s = stbi__zdist_extra[z];
+      if (s) {
+         STBI__ZREFILL();
+         dist += bits & ((1 << s) - 1);
+         bits >>= s;
+         n -= s;
+      }
+      if (zout - a->zout_start < dist) return stbi__err("bad dist","Corrupt PNG");
+
+      p = zout - dist;
+      if (dist >= 8) {
+         // chunks never overlap what they read, and can overshoot into the
+         // slack kept at the end since the bytes past len aren't output yet
+         char *end = zout + len;
+         do {
+            memcpy(zout, p, 8);
+            zout += 8;
+            p += 8;
+         } while (zout < end);
+         zout = end;
+      } else if (dist == 1) {
+         memset(zout, *p, len);
+         zout += len;
+      } else {
+         if (len) { do *zout++ = *p++; while (--len); }
+      }
+   }
+   STBI__ZSYNC();
+   a->zout = zout;
+   return stbi__parse_huffman_block(a);
+}
+
+#undef STBI__ZREFILL
+#undef STBI__ZSYNC
+#undef STBI__ZRELOAD
+
+// let the notify callback see the output so far, if it's been waiting
+static int stbi__znotify(stbi__zbuf *a)
+{
+   int len = (int) (a->zout - a->zout_start);
+   if (a->notify && len >= a->notify_len) {
+      a->notify_len = a->notify(a->notify_user, (stbi_uc *) a->zout_start, len);
+      if (a->notify_len < 0) return 0;
+   }
+   return 1;
+}
+
 static int stbi__compute_huffman_codes(stbi__zbuf *a)
 {
    static stbi_uc length_dezigzag[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
@@ -4110,8 +4807,14 @@ static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
          } else {
             if (!stbi__compute_huffman_codes(a)) return 0;
          }
-         if (!stbi__parse_huffman_block(a)) return 0;
+         if (stbi__png_fast_path) {
+            stbi__zbuild_multi(a->z_multi, &a->z_length);
+            if (!stbi__parse_huffman_block_fast(a)) return 0;
+         } else {
+            if (!stbi__parse_huffman_block(a)) return 0;
+         }
       }
+      if (!stbi__znotify(a)) return 0;
    } while (!final);
    return 1;
 }
@@ -4122,6 +4825,7 @@ static int stbi__do_zlib(stbi__zbuf *a, char *obuf, int olen, int exp, int parse
    a->zout       = obuf;
    a->zout_end   = obuf + olen;
    a->z_expandable = exp;
+   a->notify = NULL;
 
    return stbi__parse_zlib(a, parse_header);
 }
@@ -4241,6 +4945,7 @@ typedef struct
    stbi__context *s;
    stbi_uc *idata, *expanded, *out;
    int depth;
+   int filter_simd; // unfilter avg and paeth rows with SSE2
 } stbi__png;
 
 
@@ -4277,13 +4982,68 @@ static int stbi__paeth(int a, int b, int c)
 
 static stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
-// create the png data from post-deflated data
-static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
+#ifdef STBI_SSE2
+// a pixel of 3 or 4 bytes, widened to 16-bit lanes
+stbi_inline static __m128i stbi__png_load_pixel(const stbi_uc *p, int n)
+{
+   stbi__uint32 v = p[0] | (p[1] << 8) | (p[2] << 16);
+   if (n == 4) v |= (stbi__uint32) p[3] << 24;
+   return _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) v), _mm_setzero_si128());
+}
+
+// avg and paeth for 3 and 4 byte pixels. each byte depends on the one a
+// pixel to its left, so this goes a pixel at a time, but without the
+// branches stbi__paeth takes per byte. cur, raw and prior start at the
+// second pixel; if out_n is img_n+1 the alpha is filled in with 255
+static void stbi__unfilter_png_row_sse2(stbi_uc *cur, stbi_uc *raw, stbi_uc *prior, stbi__uint32 count, int filter, int img_n, int out_n)
+{
+   __m128i a = stbi__png_load_pixel(cur - out_n, img_n);
+   __m128i c = stbi__png_load_pixel(prior - out_n, img_n);
+   __m128i zero = _mm_setzero_si128();
+   __m128i mask = _mm_set1_epi16(255);
+   stbi__uint32 i;
+   for (i=0; i < count; ++i, cur += out_n, raw += img_n, prior += out_n) {
+      __m128i b = stbi__png_load_pixel(prior, img_n);
+      __m128i d = stbi__png_load_pixel(raw, img_n);
+      stbi__uint32 v;
+      if (filter == STBI__F_avg) {
+         d = _mm_add_epi16(d, _mm_srli_epi16(_mm_add_epi16(a, b), 1));
+      } else {
+         // with p = a+b-c: pa = |b-c|, pb = |a-c|, pc = |a+b-2c|. the
+         // nearest wins, ties going to a then b as in stbi__paeth
+         __m128i pa = _mm_sub_epi16(b, c);
+         __m128i pb = _mm_sub_epi16(a, c);
+         __m128i pc = _mm_add_epi16(pa, pb);
+         __m128i not_a, not_b, nearest;
+         pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+         pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+         pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+         not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+         not_b = _mm_cmpgt_epi16(pb, pc);
+         nearest = _mm_or_si128(_mm_and_si128(not_b, c), _mm_andnot_si128(not_b, b));
+         nearest = _mm_or_si128(_mm_and_si128(not_a, nearest), _mm_andnot_si128(not_a, a));
+         d = _mm_add_epi16(d, nearest);
+      }
+      d = _mm_and_si128(d, mask);
+      v = (stbi__uint32) _mm_cvtsi128_si32(_mm_packus_epi16(d, d));
+      cur[0] = (stbi_uc) v;
+      cur[1] = (stbi_uc) (v >> 8);
+      cur[2] = (stbi_uc) (v >> 16);
+      if (out_n == 4)
+         cur[3] = img_n == 4 ? (stbi_uc) (v >> 24) : 255;
+      a = d;
+      c = b;
+   }
+}
+#endif
+
+// unfilter row j of the image from raw, which starts at the row's filter byte
+static int stbi__unfilter_png_row(stbi__png *a, stbi_uc *raw, stbi__uint32 j, int out_n, stbi__uint32 x, int depth)
 {
    int bytes = (depth == 16? 2 : 1);
    stbi__context *s = a->s;
-   stbi__uint32 i,j,stride = x*out_n*bytes;
-   stbi__uint32 img_len, img_width_bytes;
+   stbi__uint32 i,stride = x*out_n*bytes;
+   stbi__uint32 img_width_bytes;
    int k;
    int img_n = s->img_n; // copy it into a local for later
 
@@ -4291,114 +5051,121 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
    int filter_bytes = img_n*bytes;
    int width = x;
 
-   STBI_ASSERT(out_n == s->img_n || out_n == s->img_n+1);
-   a->out = (stbi_uc *) stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
-   if (!a->out) return stbi__err("outofmem", "Out of memory");
+   stbi_uc *cur = a->out + stride*j;
+   stbi_uc *prior;
+   int filter = *raw++;
+
+   if (filter > 4)
+      return stbi__err("invalid filter","Corrupt PNG");
 
    img_width_bytes = (((img_n * x * depth) + 7) >> 3);
-   img_len = (img_width_bytes + 1) * y;
-   // we used to check for exact match between raw_len and img_len on non-interlaced PNGs,
-   // but issue #276 reported a PNG in the wild that had extra data at the end (all zeros),
-   // so just check for raw_len < img_len always.
-   if (raw_len < img_len) return stbi__err("not enough pixels","Corrupt PNG");
+   if (depth < 8) {
+      STBI_ASSERT(img_width_bytes <= x);
+      cur += x*out_n - img_width_bytes; // store output to the rightmost img_len bytes, so we can decode in place
+      filter_bytes = 1;
+      width = img_width_bytes;
+   }
+   prior = cur - stride; // bugfix: need to compute this after 'cur +=' computation above
+
+   // if first row, use special filter that doesn't sample previous row
+   if (j == 0) filter = first_row_filter[filter];
+
+   // handle first byte explicitly
+   for (k=0; k < filter_bytes; ++k) {
+      switch (filter) {
+         case STBI__F_none       : cur[k] = raw[k]; break;
+         case STBI__F_sub        : cur[k] = raw[k]; break;
+         case STBI__F_up         : cur[k] = STBI__BYTECAST(raw[k] + prior[k]); break;
+         case STBI__F_avg        : cur[k] = STBI__BYTECAST(raw[k] + (prior[k]>>1)); break;
+         case STBI__F_paeth      : cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(0,prior[k],0)); break;
+         case STBI__F_avg_first  : cur[k] = raw[k]; break;
+         case STBI__F_paeth_first: cur[k] = raw[k]; break;
+      }
+   }
 
-   for (j=0; j < y; ++j) {
-      stbi_uc *cur = a->out + stride*j;
-      stbi_uc *prior;
-      int filter = *raw++;
+   if (depth == 8) {
+      if (img_n != out_n)
+         cur[img_n] = 255; // first pixel
+      raw += img_n;
+      cur += out_n;
+      prior += out_n;
+   } else if (depth == 16) {
+      if (img_n != out_n) {
+         cur[filter_bytes]   = 255; // first pixel top byte
+         cur[filter_bytes+1] = 255; // first pixel bottom byte
+      }
+      raw += filter_bytes;
+      cur += output_bytes;
+      prior += output_bytes;
+   } else {
+      raw += 1;
+      cur += 1;
+      prior += 1;
+   }
 
-      if (filter > 4)
-         return stbi__err("invalid filter","Corrupt PNG");
+   #ifdef STBI_SSE2
+   if (a->filter_simd && depth == 8 && img_n >= 3 && (filter == STBI__F_avg || filter == STBI__F_paeth)) {
+      STBI_ASSERT(out_n == 3 || out_n == 4);
+      stbi__unfilter_png_row_sse2(cur, raw, prior, x-1, filter, img_n, out_n);
+      return 1;
+   }
+   #endif
 
-      if (depth < 8) {
-         STBI_ASSERT(img_width_bytes <= x);
-         cur += x*out_n - img_width_bytes; // store output to the rightmost img_len bytes, so we can decode in place
-         filter_bytes = 1;
-         width = img_width_bytes;
+   // this is a little gross, so that we don't switch per-pixel or per-component
+   if (depth < 8 || img_n == out_n) {
+      int nk = (width - 1)*filter_bytes;
+      #define STBI__CASE(f) \
+          case f:     \
+             for (k=0; k < nk; ++k)
+      switch (filter) {
+         // "none" filter turns into a memcpy here; make that explicit.
+         case STBI__F_none:         memcpy(cur, raw, nk); break;
+         STBI__CASE(STBI__F_sub)          { cur[k] = STBI__BYTECAST(raw[k] + cur[k-filter_bytes]); } break;
+         STBI__CASE(STBI__F_up)           { cur[k] = STBI__BYTECAST(raw[k] + prior[k]); } break;
+         STBI__CASE(STBI__F_avg)          { cur[k] = STBI__BYTECAST(raw[k] + ((prior[k] + cur[k-filter_bytes])>>1)); } break;
+         STBI__CASE(STBI__F_paeth)        { cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(cur[k-filter_bytes],prior[k],prior[k-filter_bytes])); } break;
+         STBI__CASE(STBI__F_avg_first)    { cur[k] = STBI__BYTECAST(raw[k] + (cur[k-filter_bytes] >> 1)); } break;
+         STBI__CASE(STBI__F_paeth_first)  { cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(cur[k-filter_bytes],0,0)); } break;
       }
-      prior = cur - stride; // bugfix: need to compute this after 'cur +=' computation above
-
-      // if first row, use special filter that doesn't sample previous row
-      if (j == 0) filter = first_row_filter[filter];
-
-      // handle first byte explicitly
-      for (k=0; k < filter_bytes; ++k) {
-         switch (filter) {
-            case STBI__F_none       : cur[k] = raw[k]; break;
-            case STBI__F_sub        : cur[k] = raw[k]; break;
-            case STBI__F_up         : cur[k] = STBI__BYTECAST(raw[k] + prior[k]); break;
-            case STBI__F_avg        : cur[k] = STBI__BYTECAST(raw[k] + (prior[k]>>1)); break;
-            case STBI__F_paeth      : cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(0,prior[k],0)); break;
-            case STBI__F_avg_first  : cur[k] = raw[k]; break;
-            case STBI__F_paeth_first: cur[k] = raw[k]; break;
-         }
-      }
-
-      if (depth == 8) {
-         if (img_n != out_n)
-            cur[img_n] = 255; // first pixel
-         raw += img_n;
-         cur += out_n;
-         prior += out_n;
-      } else if (depth == 16) {
-         if (img_n != out_n) {
-            cur[filter_bytes]   = 255; // first pixel top byte
-            cur[filter_bytes+1] = 255; // first pixel bottom byte
-         }
-         raw += filter_bytes;
-         cur += output_bytes;
-         prior += output_bytes;
-      } else {
-         raw += 1;
-         cur += 1;
-         prior += 1;
+      #undef STBI__CASE
+   } else {
+      STBI_ASSERT(img_n+1 == out_n);
+      #define STBI__CASE(f) \
+          case f:     \
+             for (i=x-1; i >= 1; --i, cur[filter_bytes]=255,raw+=filter_bytes,cur+=output_bytes,prior+=output_bytes) \
+                for (k=0; k < filter_bytes; ++k)
+      switch (filter) {
+         STBI__CASE(STBI__F_none)         { cur[k] = raw[k]; } break;
+         STBI__CASE(STBI__F_sub)          { cur[k] = STBI__BYTECAST(raw[k] + cur[k- output_bytes]); } break;
+         STBI__CASE(STBI__F_up)           { cur[k] = STBI__BYTECAST(raw[k] + prior[k]); } break;
+         STBI__CASE(STBI__F_avg)          { cur[k] = STBI__BYTECAST(raw[k] + ((prior[k] + cur[k- output_bytes])>>1)); } break;
+         STBI__CASE(STBI__F_paeth)        { cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(cur[k- output_bytes],prior[k],prior[k- output_bytes])); } break;
+         STBI__CASE(STBI__F_avg_first)    { cur[k] = STBI__BYTECAST(raw[k] + (cur[k- output_bytes] >> 1)); } break;
+         STBI__CASE(STBI__F_paeth_first)  { cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(cur[k- output_bytes],0,0)); } break;
       }
+      #undef STBI__CASE
 
-      // this is a little gross, so that we don't switch per-pixel or per-component
-      if (depth < 8 || img_n == out_n) {
-         int nk = (width - 1)*filter_bytes;
-         #define STBI__CASE(f) \
-             case f:     \
-                for (k=0; k < nk; ++k)
-         switch (filter) {
-            // "none" filter turns into a memcpy here; make that explicit.
-            case STBI__F_none:         memcpy(cur, raw, nk); break;
-            STBI__CASE(STBI__F_sub)          { cur[k] = STBI__BYTECAST(raw[k] + cur[k-filter_bytes]); } break;
-            STBI__CASE(STBI__F_up)           { cur[k] = STBI__BYTECAST(raw[k] + prior[k]); } break;
-            STBI__CASE(STBI__F_avg)          { cur[k] = STBI__BYTECAST(raw[k] + ((prior[k] + cur[k-filter_bytes])>>1)); } break;
-            STBI__CASE(STBI__F_paeth)        { cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(cur[k-filter_bytes],prior[k],prior[k-filter_bytes])); } break;
-            STBI__CASE(STBI__F_avg_first)    { cur[k] = STBI__BYTECAST(raw[k] + (cur[k-filter_bytes] >> 1)); } break;
-            STBI__CASE(STBI__F_paeth_first)  { cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(cur[k-filter_bytes],0,0)); } break;
-         }
-         #undef STBI__CASE
-         raw += nk;
-      } else {
-         STBI_ASSERT(img_n+1 == out_n);
-         #define STBI__CASE(f) \
-             case f:     \
-                for (i=x-1; i >= 1; --i, cur[filter_bytes]=255,raw+=filter_bytes,cur+=output_bytes,prior+=output_bytes) \
-                   for (k=0; k < filter_bytes; ++k)
-         switch (filter) {
-            STBI__CASE(STBI__F_none)         { cur[k] = raw[k]; } break;
-            STBI__CASE(STBI__F_sub)          { cur[k] = STBI__BYTECAST(raw[k] + cur[k- output_bytes]); } break;
-            STBI__CASE(STBI__F_up)           { cur[k] = STBI__BYTECAST(raw[k] + prior[k]); } break;
-            STBI__CASE(STBI__F_avg)          { cur[k] = STBI__BYTECAST(raw[k] + ((prior[k] + cur[k- output_bytes])>>1)); } break;
-            STBI__CASE(STBI__F_paeth)        { cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(cur[k- output_bytes],prior[k],prior[k- output_bytes])); } break;
-            STBI__CASE(STBI__F_avg_first)    { cur[k] = STBI__BYTECAST(raw[k] + (cur[k- output_bytes] >> 1)); } break;
-            STBI__CASE(STBI__F_paeth_first)  { cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(cur[k- output_bytes],0,0)); } break;
-         }
-         #undef STBI__CASE
-
-         // the loop above sets the high byte of the pixels' alpha, but for
-         // 16 bit png files we also need the low byte set. we'll do that here.
-         if (depth == 16) {
-            cur = a->out + stride*j; // start at the beginning of the row again
-            for (i=0; i < x; ++i,cur+=output_bytes) {
-               cur[filter_bytes+1] = 255;
-            }
+      // the loop above sets the high byte of the pixels' alpha, but for
+      // 16 bit png files we also need the low byte set. we'll do that here.
+      if (depth == 16) {
+         cur = a->out + stride*j; // start at the beginning of the row again
+         for (i=0; i < x; ++i,cur+=output_bytes) {
+            cur[filter_bytes+1] = 255;
          }
       }
    }
+   return 1;
+}
+
+// once every row is unfiltered, expand packed pixels and byte-swap 16-bit ones
+static int stbi__finish_png_image_raw(stbi__png *a, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
+{
+   int bytes = (depth == 16? 2 : 1);
+   stbi__context *s = a->s;
+   stbi__uint32 i,j,stride = x*out_n*bytes;
+   stbi__uint32 img_width_bytes = (((s->img_n * x * depth) + 7) >> 3);
+   int k;
+   int img_n = s->img_n;
 
    // we make a separate pass to expand bits to pixels; for performance,
    // this could run two scanlines behind the above code, so it won't
@@ -4488,6 +5255,95 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
    return 1;
 }
 
+// create the png data from post-deflated data
+static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
+{
+   int bytes = (depth == 16? 2 : 1);
+   stbi__context *s = a->s;
+   stbi__uint32 j;
+   stbi__uint32 img_len, img_width_bytes;
+   int img_n = s->img_n; // copy it into a local for later
+
+   int output_bytes = out_n*bytes;
+
+   STBI_ASSERT(out_n == s->img_n || out_n == s->img_n+1);
+   a->out = (stbi_uc *) stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
+   if (!a->out) return stbi__err("outofmem", "Out of memory");
+
+   img_width_bytes = (((img_n * x * depth) + 7) >> 3);
+   img_len = (img_width_bytes + 1) * y;
+   // we used to check for exact match between raw_len and img_len on non-interlaced PNGs,
+   // but issue #276 reported a PNG in the wild that had extra data at the end (all zeros),
+   // so just check for raw_len < img_len always.
+   if (raw_len < img_len) return stbi__err("not enough pixels","Corrupt PNG");
+
+   for (j=0; j < y; ++j, raw += img_width_bytes + 1)
+      if (!stbi__unfilter_png_row(a, raw, j, out_n, x, depth)) return 0;
+
+   return stbi__finish_png_image_raw(a, out_n, x, y, depth, color);
+}
+
+typedef struct
+{
+   stbi__png *a;
+   int out_n;
+   stbi__uint32 row_len;   // including the filter byte
+   stbi__uint32 rows_done;
+} stbi__png_rows;
+
+// zlib notify callback: unfilter each row that's been inflated, and ask to
+// be called again when the next one has
+static int stbi__png_rows_ready(void *user, stbi_uc *raw, int raw_len)
+{
+   stbi__png_rows *r = (stbi__png_rows *) user;
+   stbi__png *a = r->a;
+   while (r->rows_done < a->s->img_y && (r->rows_done+1) * r->row_len <= (stbi__uint32) raw_len) {
+      if (!stbi__unfilter_png_row(a, raw + r->rows_done * r->row_len, r->rows_done, r->out_n, a->s->img_x, a->depth)) return -1;
+      ++r->rows_done;
+   }
+   return r->rows_done < a->s->img_y ? (int) ((r->rows_done+1) * r->row_len) : 0x7fffffff;
+}
+
+// for a non-interlaced image, inflate and unfilter together, so each row is
+// unfiltered while it's still in cache rather than in a pass of its own
+static int stbi__create_png_image_inflating(stbi__png *a, stbi__uint32 idata_len, stbi__uint32 raw_guess, int out_n, int color, int parse_header)
+{
+   stbi__context *s = a->s;
+   stbi__png_rows rows;
+   stbi__zbuf z;
+   char *p;
+   int ok;
+
+   STBI_ASSERT(out_n == s->img_n || out_n == s->img_n+1);
+   a->out = (stbi_uc *) stbi__malloc_mad3(s->img_x, s->img_y, out_n*(a->depth == 16 ? 2 : 1), 0);
+   if (!a->out) return stbi__err("outofmem", "Out of memory");
+   p = (char *) stbi__malloc(raw_guess);
+   if (p == NULL) return stbi__err("outofmem", "Out of memory");
+
+   rows.a = a;
+   rows.out_n = out_n;
+   rows.row_len = (((s->img_n * s->img_x * a->depth) + 7) >> 3) + 1;
+   rows.rows_done = 0;
+
+   z.zbuffer = a->idata;
+   z.zbuffer_end = a->idata + idata_len;
+   z.zout_start = p;
+   z.zout = p;
+   z.zout_end = p + raw_guess;
+   z.z_expandable = 1;
+   z.notify = stbi__png_rows_ready;
+   z.notify_user = &rows;
+   z.notify_len = (int) rows.row_len;
+   ok = stbi__parse_zlib(&z, parse_header);
+   a->expanded = (stbi_uc *) z.zout_start; // freed by the caller either way
+   if (!ok) return 0;
+
+   if ((stbi__uint32) (z.zout - z.zout_start) < rows.row_len * s->img_y) return stbi__err("not enough pixels","Corrupt PNG");
+   if (stbi__png_rows_ready(&rows, a->expanded, (int) (z.zout - z.zout_start)) < 0) return 0;
+
+   return stbi__finish_png_image_raw(a, out_n, s->img_x, s->img_y, a->depth, color);
+}
+
 static int stbi__create_png_image(stbi__png *a, stbi_uc *image_data, stbi__uint32 image_data_len, int out_n, int depth, int color, int interlaced)
 {
    int bytes = (depth == 16 ? 2 : 1);
@@ -4795,14 +5651,24 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
             // initial guess for decoded data size to avoid unnecessary reallocs
             bpl = (s->img_x * z->depth + 7) / 8; // bytes per line, per component
             raw_len = bpl * s->img_y * s->img_n /* pixels */ + s->img_y /* filter mode per row */;
-            z->expanded = (stbi_uc *) stbi_zlib_decode_malloc_guesssize_headerflag((char *) z->idata, ioff, raw_len, (int *) &raw_len, !is_iphone);
-            if (z->expanded == NULL) return 0; // zlib should set error
-            STBI_FREE(z->idata); z->idata = NULL;
             if ((req_comp == s->img_n+1 && req_comp != 3 && !pal_img_n) || has_trans)
                s->img_out_n = s->img_n+1;
             else
                s->img_out_n = s->img_n;
-            if (!stbi__create_png_image(z, z->expanded, raw_len, s->img_out_n, z->depth, color, interlace)) return 0;
+            #ifdef STBI_SSE2
+            z->filter_simd = stbi__png_fast_path && stbi__simd_limit >= 1 && stbi__sse2_available();
+            #else
+            z->filter_simd = 0;
+            #endif
+            if (stbi__png_fast_path && !interlace) {
+               if (!stbi__create_png_image_inflating(z, ioff, raw_len, s->img_out_n, color, !is_iphone)) return 0;
+               STBI_FREE(z->idata); z->idata = NULL;
+            } else {
+               z->expanded = (stbi_uc *) stbi_zlib_decode_malloc_guesssize_headerflag((char *) z->idata, ioff, raw_len, (int *) &raw_len, !is_iphone);
+               if (z->expanded == NULL) return 0; // zlib should set error
+               STBI_FREE(z->idata); z->idata = NULL;
+               if (!stbi__create_png_image(z, z->expanded, raw_len, s->img_out_n, z->depth, color, interlace)) return 0;
+            }
             if (has_trans) {
                if (z->depth == 16) {
                   if (!stbi__compute_transparency16(z, tc16, s->img_out_n)) return 0;
@@ -4912,6 +5778,16 @@ static int stbi__png_info(stbi__context *s, int *x, int *y, int *comp)
    p.s = s;
    return stbi__png_info_raw(&p, x, y, comp);
 }
+
+static int stbi__png_is16(stbi__context *s)
+{
+   stbi__png p;
+   p.s = s;
+   if (!stbi__png_info_raw(&p, NULL, NULL, NULL))
+      return 0;
+   stbi__rewind(s);
+   return p.depth == 16;
+}
 #endif
 
 // Microsoft/Windows BMP image
@@ -6928,6 +7804,14 @@ static int stbi__info_main(stbi__context *s, int *x, int *y, int *comp)
    return stbi__err("unknown image type", "Image not of any known type, or corrupt");
 }
 
+static int stbi__is_16_main(stbi__context *s)
+{
+   #ifndef STBI_NO_PNG
+   if (stbi__png_is16(s))  return 1;
+   #endif
+   return 0;
+}
+
 #ifndef STBI_NO_STDIO
 STBIDEF int stbi_info(char const *filename, int *x, int *y, int *comp)
 {
@@ -6949,6 +7833,27 @@ STBIDEF int stbi_info_from_file(FILE *f, int *x, int *y, int *comp)
    fseek(f,pos,SEEK_SET);
    return r;
 }
+
+STBIDEF int stbi_is_16_bit(char const *filename)
+{
+    FILE *f = stbi__fopen(filename, "rb");
+    int result;
+    if (!f) return stbi__err("can't fopen", "Unable to open file");
+    result = stbi_is_16_bit_from_file(f);
+    fclose(f);
+    return result;
+}
+
+STBIDEF int stbi_is_16_bit_from_file(FILE *f)
+{
+   int r;
+   stbi__context s;
+   long pos = ftell(f);
+   stbi__start_file(&s, f);
+   r = stbi__is_16_main(&s);
+   fseek(f,pos,SEEK_SET);
+   return r;
+}
 #endif // !STBI_NO_STDIO
 
 STBIDEF int stbi_info_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp)
@@ -6965,6 +7870,20 @@ STBIDEF int stbi_info_from_callbacks(stbi_io_callbacks const *c, void *user, int
    return stbi__info_main(&s,x,y,comp);
 }
 
+STBIDEF int stbi_is_16_bit_from_memory(stbi_uc const *buffer, int len)
+{
+   stbi__context s;
+   stbi__start_mem(&s,buffer,len);
+   return stbi__is_16_main(&s);
+}
+
+STBIDEF int stbi_is_16_bit_from_callbacks(stbi_io_callbacks const *c, void *user)
+{
+   stbi__context s;
+   stbi__start_callbacks(&s, (stbi_io_callbacks *) c, user);
+   return stbi__is_16_main(&s);
+}
+
 #endif // STB_IMAGE_IMPLEMENTATION
 
 /*
@@ -0,0 +1,208 @@
+// Build step that bakes images to block-compressed .dds files for
+// TextureLoader, so they load without decoding and take a quarter to an
+// eighth of the memory.
+//
+//     texture_baker <output directory> [--format bc1|bc3|bc7] [--max-size N]
+//                   [--linear] <image>...
+//
+// Each image is decoded, flipped so its first row is the bottom as GL
+// expects, scaled down to fit in --max-size if given, given a full mip chain
+// filtered by MipGenerator (in linear space unless --linear says the image
+// isn't sRGB colour) and compressed to
+// <output directory>/<image file name>.dds. Without --format, opaque images
+// use BC1 and the rest BC3. A .hash file beside each .dds records the source
+// contents and settings it was baked from, and images whose hash hasn't
+// changed are skipped.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "DdsFile.h"
+#include "ImageDecoder.h"
+#include "MipGenerator.h"
+#include "StringHash.h"
+#include "ThreadPool.h"
+
+// Bump when the output for the same input changes.
+constexpr const char* kBakerVersion = "texture_baker 2";
+
+static bool readFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return false;
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+static std::string hashName(uint64_t hash)
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return name;
+}
+
+static bool opaque(const gl::ImageView& image)
+{
+    for(size_t i = 3; i < image.size(); i += 4)
+    {
+        if(image.pixels[i] != 255)
+            return false;
+    }
+
+    return true;
+}
+
+struct BakeSettings
+{
+    std::string format = "auto";
+    int maxSize = 0;
+    gl::MipOptions mips{gl::MipFilter::Kaiser, true};
+};
+
+// Bake one image. Returns false on any error.
+static bool bake(const std::string& path, const std::string& outputDirectory, const BakeSettings& settings, gl::ThreadPool& pool)
+{
+    const std::string name = std::filesystem::path(path).filename().string();
+    const std::string ddsPath = outputDirectory + "/" + name + ".dds";
+    const std::string hashPath = ddsPath + ".hash";
+
+    std::string contents;
+    if(!readFile(path, contents))
+    {
+        std::cerr << "ERROR::TEXTURE_BAKER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    const uint64_t settingsHash = gl::hashString(std::string(kBakerVersion) + " " + settings.format + " " +
+                                                 std::to_string(settings.maxSize) + (settings.mips.srgb ? " srgb" : " linear"));
+    const std::string hash = hashName(gl::hashString(contents, settingsHash));
+
+    std::string bakedHash;
+    if(readFile(hashPath, bakedHash) && bakedHash == hash + "\n" && std::filesystem::exists(ddsPath))
+        return true;
+
+    // Don't leave a hash claiming an old .dds is up to date if this fails.
+    std::error_code error;
+    std::filesystem::remove(hashPath, error);
+
+    gl::ImageArena arena;
+    gl::ImageView image;
+    gl::ImageDecodeOptions options;
+    options.flipVertically = true;
+    options.channels = 4;
+    if(!gl::ImageDecoder::decode(contents.data(), contents.size(), options, arena, image))
+        return false;
+
+    gl::BlockFormat blockFormat = gl::BlockFormat::BC1;
+    if(settings.format == "bc3" || (settings.format == "auto" && !opaque(image)))
+        blockFormat = gl::BlockFormat::BC3;
+    else if(settings.format == "bc7")
+        blockFormat = gl::BlockFormat::BC7;
+
+    int width = image.width;
+    int height = image.height;
+    std::vector<uint8_t> level0(image.pixels, image.pixels + image.size());
+    if(gl::fitDimensions(width, height, settings.maxSize))
+        level0 = gl::resampleImage(image.pixels, image.width, image.height, 4, width, height, settings.mips, &pool);
+
+    std::vector<uint8_t> chain(gl::mipChainSize(width, height, 4));
+    gl::generateMips(level0.data(), width, height, 4, settings.mips, chain.data(), &pool);
+
+    std::vector<std::vector<uint8_t>> levels;
+    levels.push_back(gl::compressImage(blockFormat, level0.data(), width, height, &pool));
+    const uint8_t* level = chain.data();
+    for(int i = 1; i < gl::mipLevelCount(width, height); ++i)
+    {
+        int levelWidth = 0;
+        int levelHeight = 0;
+        gl::mipLevelDimensions(i, width, height, levelWidth, levelHeight);
+        levels.push_back(gl::compressImage(blockFormat, level, levelWidth, levelHeight, &pool));
+        level += (size_t)levelWidth * levelHeight * 4;
+    }
+
+    if(!gl::writeDds(ddsPath, blockFormat, width, height, levels))
+        return false;
+
+    std::ofstream hashFile(hashPath, std::ios_base::out | std::ios_base::trunc);
+    hashFile << hash << "\n";
+    hashFile.close();
+    if(!hashFile)
+    {
+        std::cerr << "ERROR::TEXTURE_BAKER::NOT_WRITTEN: " << hashPath << std::endl;
+        return false;
+    }
+
+    std::cout << "Baked " << path << " (" << width << "x" << height << ", "
+              << gl::blockFormatName(blockFormat) << ", " << levels.size() << " levels)" << std::endl;
+    return true;
+}
+
+int main(int argc, const char** argv)
+{
+    if(argc < 3)
+    {
+        std::cerr << "usage: texture_baker <output directory> [--format bc1|bc3|bc7] [--max-size N] [--linear] <image>..." << std::endl;
+        return 1;
+    }
+
+    const std::string outputDirectory = argv[1];
+
+    BakeSettings settings;
+    std::vector<std::string> images;
+    for(int i = 2; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if(arg == "--format" && i + 1 < argc)
+        {
+            settings.format = argv[++i];
+            if(settings.format != "bc1" && settings.format != "bc3" && settings.format != "bc7")
+            {
+                std::cerr << "ERROR::TEXTURE_BAKER::BAD_ARGUMENT: " << settings.format << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        if(arg == "--max-size" && i + 1 < argc)
+        {
+            settings.maxSize = std::atoi(argv[++i]);
+            continue;
+        }
+
+        if(arg == "--linear")
+        {
+            settings.mips.srgb = false;
+            continue;
+        }
+
+        images.push_back(arg);
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(outputDirectory, error);
+    if(error)
+    {
+        std::cerr << "ERROR::TEXTURE_BAKER::DIRECTORY_NOT_CREATED: " << outputDirectory << std::endl;
+        return 1;
+    }
+
+    // Images are baked one at a time, each compressed on every core.
+    gl::ThreadPool pool;
+    bool success = true;
+    for(const std::string& image : images)
+        success = bake(image, outputDirectory, settings, pool) && success;
+
+    return success ? 0 : 1;
+}
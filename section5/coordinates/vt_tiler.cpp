@@ -0,0 +1,255 @@
+// Build step that cuts an image too big to be a texture into a tile store
+// for VirtualTexture, which streams in just the tiles on screen.
+//
+//     vt_tiler <output.vt> [--tile-size N] [--format rgba8|bc1|bc3|bc7]
+//              [--linear] <image>
+//
+// The image is decoded, flipped so its first row is the bottom as GL
+// expects, and halved level by level with MipGenerator's filter (in linear
+// space unless --linear says the image isn't sRGB colour) until one tile
+// covers it. Every level is cut into tiles of --tile-size texels, 128 by
+// default, each with a border of its neighbours' texels, and written in the
+// order TileStore.h describes. Without --format, opaque images use BC1 and
+// the rest BC3.
+//
+// Levels are held as RGBA8 and halved a band of rows at a time, so only a
+// band is ever expanded to floats. stb_image decodes the whole image at
+// once, though, into at most 2^31 bytes: images over about 536 million
+// texels (23170 x 23170) are refused, and need cutting up first. Some
+// formats stop sooner; PNGs can't decode to more than 2^30 bytes.
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "ImageDecoder.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+#include "TileStore.h"
+
+// Enough for bilinear and anisotropic taps near a tile's edge, and a whole
+// number of compressed blocks.
+constexpr int kTileBorder = 4;
+
+// Rows of the smaller level made by each band when halving a level.
+constexpr int kBandRows = 32;
+
+// Rows either side of a band that are filtered along with it, in rows of the
+// smaller level. MipGenerator's widest filter reaches 3 of them when halving,
+// so the band's own rows come out as they would from the whole level.
+constexpr int kBandMargin = 4;
+
+static bool opaque(const uint8_t* pixels, size_t size)
+{
+    for(size_t i = 3; i < size; i += 4)
+    {
+        if(pixels[i] != 255)
+            return false;
+    }
+
+    return true;
+}
+
+// Halve a level of aboveWidth x aboveHeight into the width x height one
+// below it, its bands filtered on every core.
+//
+// The level's last column and row are repeated out to twice width and
+// height, so texel i of the smaller level is made from exactly texels 2i and
+// 2i + 1 of this one. The shader finds a level's texels by dividing level
+// 0's by 2^level; resampling an odd size straight to the rounded-up half
+// would stretch the level instead, shifting it out of line with the rest.
+static std::vector<uint8_t> halveLevel(const uint8_t* above, int aboveWidth, int aboveHeight, int width, int height,
+                                       const gl::MipOptions& mips, gl::ThreadPool& pool)
+{
+    std::vector<uint8_t> level((size_t)width * height * 4);
+    const int bands = (height + kBandRows - 1) / kBandRows;
+    pool.parallelFor(bands, [&](size_t band) {
+        const int first = (int)band * kBandRows;
+        const int last = std::min(first + kBandRows, height);
+        const int marginFirst = std::max(first - kBandMargin, 0);
+        const int marginLast = std::min(last + kBandMargin, height);
+
+        const int sourceWidth = width * 2;
+        const int sourceHeight = (marginLast - marginFirst) * 2;
+        std::vector<uint8_t> source((size_t)sourceWidth * sourceHeight * 4);
+        for(int y = 0; y < sourceHeight; ++y)
+        {
+            const int aboveY = std::min(marginFirst * 2 + y, aboveHeight - 1);
+            const uint8_t* row = above + (size_t)aboveY * aboveWidth * 4;
+            uint8_t* out = source.data() + (size_t)y * sourceWidth * 4;
+            std::copy(row, row + (size_t)aboveWidth * 4, out);
+            for(int x = aboveWidth; x < sourceWidth; ++x)
+                std::copy(row + (size_t)(aboveWidth - 1) * 4, row + (size_t)aboveWidth * 4, out + (size_t)x * 4);
+        }
+
+        const std::vector<uint8_t> halved = gl::resampleImage(source.data(), sourceWidth, sourceHeight, 4,
+                                                              width, marginLast - marginFirst, mips);
+        std::copy(halved.begin() + (size_t)(first - marginFirst) * width * 4,
+                  halved.begin() + (size_t)(last - marginFirst) * width * 4,
+                  level.begin() + (size_t)first * width * 4);
+    });
+
+    return level;
+}
+
+// Copy tile (tileX, tileY) of a level with its border, repeating the level's
+// edge texels past it, and compress it if the store is compressed.
+static void buildTile(const uint8_t* level, const gl::TileLevel& size, const gl::TileStoreInfo& info,
+                      int tileX, int tileY, std::vector<uint8_t>& texels, uint8_t* tile)
+{
+    const int padded = info.paddedTileSize();
+    const int left = tileX * info.tileSize - info.border;
+    const int bottom = tileY * info.tileSize - info.border;
+
+    uint8_t* out = info.format == gl::TileFormat::RGBA8 ? tile : texels.data();
+    for(int y = 0; y < padded; ++y)
+    {
+        const int sourceY = std::min(std::max(bottom + y, 0), size.height - 1);
+        const uint8_t* row = level + (size_t)sourceY * size.width * 4;
+        for(int x = 0; x < padded; ++x)
+        {
+            const int sourceX = std::min(std::max(left + x, 0), size.width - 1);
+            for(int c = 0; c < 4; ++c)
+                out[((size_t)y * padded + x) * 4 + c] = row[(size_t)sourceX * 4 + c];
+        }
+    }
+
+    if(info.format != gl::TileFormat::RGBA8)
+    {
+        const std::vector<uint8_t> blocks = gl::compressImage(gl::tileBlockFormat(info.format), texels.data(), padded, padded);
+        std::copy(blocks.begin(), blocks.end(), tile);
+    }
+}
+
+int main(int argc, const char** argv)
+{
+    if(argc < 3)
+    {
+        std::cerr << "usage: vt_tiler <output.vt> [--tile-size N] [--format rgba8|bc1|bc3|bc7] [--linear] <image>" << std::endl;
+        return 1;
+    }
+
+    const std::string outputPath = argv[1];
+
+    std::string format = "auto";
+    int tileSize = 128;
+    gl::MipOptions mips{gl::MipFilter::Kaiser, true};
+    std::string imagePath;
+    for(int i = 2; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if(arg == "--format" && i + 1 < argc)
+        {
+            format = argv[++i];
+            if(format != "rgba8" && format != "bc1" && format != "bc3" && format != "bc7")
+            {
+                std::cerr << "ERROR::VT_TILER::BAD_ARGUMENT: " << format << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        if(arg == "--tile-size" && i + 1 < argc)
+        {
+            tileSize = std::atoi(argv[++i]);
+            continue;
+        }
+
+        if(arg == "--linear")
+        {
+            mips.srgb = false;
+            continue;
+        }
+
+        imagePath = arg;
+    }
+
+    gl::ImageView image;
+    if(imagePath.empty() || !gl::ImageDecoder::probeFile(imagePath, image))
+    {
+        std::cerr << "ERROR::VT_TILER::IMAGE_NOT_DECODED: " << imagePath << std::endl;
+        return 1;
+    }
+
+    if((uint64_t)image.width * image.height * 4 > INT_MAX)
+    {
+        std::cerr << "ERROR::VT_TILER::IMAGE_TOO_LARGE: " << imagePath << " (" << image.width << "x" << image.height
+                  << "): stb_image can't decode more than 2^31 bytes of RGBA" << std::endl;
+        return 1;
+    }
+
+    // Holds level 0 until level 1 has been made from it.
+    std::unique_ptr<gl::ImageArena> arena(new gl::ImageArena());
+    gl::ImageDecodeOptions options;
+    options.flipVertically = true;
+    options.channels = 4;
+    if(!gl::ImageDecoder::decodeFile(imagePath, options, *arena, image))
+    {
+        std::cerr << "ERROR::VT_TILER::IMAGE_NOT_DECODED: " << imagePath << std::endl;
+        return 1;
+    }
+
+    gl::TileFormat tileFormat = gl::TileFormat::BC1;
+    if(format == "rgba8")
+        tileFormat = gl::TileFormat::RGBA8;
+    else if(format == "bc3" || (format == "auto" && !opaque(image.pixels, image.size())))
+        tileFormat = gl::TileFormat::BC3;
+    else if(format == "bc7")
+        tileFormat = gl::TileFormat::BC7;
+
+    gl::TileStoreInfo info;
+    if(!gl::layoutTileStore(tileFormat, image.width, image.height, tileSize, kTileBorder, info))
+        return 1;
+
+    std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+    if(!file || !gl::writeTileStoreHeader(file, info))
+    {
+        std::cerr << "ERROR::VT_TILER::NOT_WRITTEN: " << outputPath << std::endl;
+        return 1;
+    }
+
+    // Each level is tiled a row at a time, its tiles built on every core,
+    // then halved for the next.
+    gl::ThreadPool pool;
+    const uint8_t* pixels = image.pixels;
+    std::vector<uint8_t> level;
+    for(size_t i = 0; i < info.levels.size(); ++i)
+    {
+        const gl::TileLevel& size = info.levels[i];
+        if(i > 0)
+        {
+            const gl::TileLevel& above = info.levels[i - 1];
+            level = halveLevel(pixels, above.width, above.height, size.width, size.height, mips, pool);
+            pixels = level.data();
+            arena.reset();
+        }
+
+        std::vector<uint8_t> row((size_t)size.tilesX * info.tileBytes);
+        for(int tileY = 0; tileY < size.tilesY; ++tileY)
+        {
+            pool.parallelFor(size.tilesX, [&](size_t tileX) {
+                std::vector<uint8_t> texels((size_t)info.paddedTileSize() * info.paddedTileSize() * 4);
+                buildTile(pixels, size, info, (int)tileX, tileY, texels, row.data() + tileX * info.tileBytes);
+            });
+            file.write((const char*)row.data(), row.size());
+        }
+    }
+
+    file.close();
+    if(!file)
+    {
+        std::cerr << "ERROR::VT_TILER::NOT_WRITTEN: " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tiled " << imagePath << " (" << info.width << "x" << info.height << ", "
+              << gl::tileFormatName(info.format) << ", " << info.levels.size() << " levels, "
+              << info.tileCount() << " tiles of " << info.tileSize << ")" << std::endl;
+    return 0;
+}